@@ -0,0 +1,155 @@
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#ifndef ARENA_H_
+#define ARENA_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+//
+// Hands out zeroed memory for lots of small objects, by cutting it from
+// large blocks.  Nothing is freed on its own: all the memory goes away
+// at once in release() or in the destructor, hence only objects which
+// need no destructor may be put here.
+//
+// An arena is not thread-safe.  Each thread should use its own arena,
+// and take() moves the blocks of one arena into another.
+//
+class Arena
+{
+public:
+	explicit Arena(size_t _block_size = 64 * 1024) : block_size(_block_size)
+	{
+	}
+
+	~Arena()
+	{
+		release();
+	}
+
+	Arena(const Arena &) = delete;
+	Arena &operator = (const Arena &) = delete;
+
+	void *alloc(size_t size)
+	{
+		size = (size + ALIGN - 1) & ~(ALIGN - 1);
+
+		if (size > avail)
+			newBlock(size);
+
+		void *p = pos;
+
+		pos   += size;
+		avail -= size;
+		used  += size;
+
+		return p;
+	}
+
+	template <typename T>
+	T *alloc()
+	{
+		static_assert(std::is_trivially_destructible<T>::value,
+				"objects in an arena are never destroyed");
+
+		return static_cast<T *>(alloc(sizeof(T)));
+	}
+
+	//
+	// Adds all the memory of the other arena to this one, which then
+	// keeps it alive.  The other arena is left empty.
+	//
+	void take(Arena &other)
+	{
+		blocks.insert(blocks.end(), other.blocks.begin(), other.blocks.end());
+
+		used     += other.used;
+		reserved += other.reserved;
+
+		other.blocks.clear();
+		other.reset();
+	}
+
+	void release()
+	{
+		for (char *block : blocks)
+			free(block);
+
+		blocks.clear();
+		reset();
+	}
+
+	// the memory given out so far
+	size_t bytesUsed() const
+	{
+		return used;
+	}
+
+	// the memory taken from the system, including unused parts of blocks
+	size_t bytesReserved() const
+	{
+		return reserved;
+	}
+
+private:
+	static const size_t ALIGN = alignof(std::max_align_t);
+
+	void newBlock(size_t size)
+	{
+		size_t length = std::max(size, block_size);
+
+		char *block = static_cast<char *>(calloc(1, length));
+
+		if (! block)
+			throw std::bad_alloc();
+
+		blocks.push_back(block);
+
+		pos   = block;
+		avail = length;
+
+		reserved += length;
+	}
+
+	void reset()
+	{
+		pos   = nullptr;
+		avail = 0;
+
+		used     = 0;
+		reserved = 0;
+	}
+
+	size_t block_size;
+
+	std::vector<char *> blocks;
+
+	// the free part of the current block
+	char  *pos   = nullptr;
+	size_t avail = 0;
+
+	size_t used     = 0;
+	size_t reserved = 0;
+};
+
+#endif /* ARENA_H_ */
@@ -0,0 +1,560 @@
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#include "BackupStore.h"
+
+#include "main.h"
+
+#include "lib_file.h"
+#include "SafeOutFile.h"
+#include "w_rawdef.h"
+#include "w_wad.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+
+const char *const MANIFEST_MAGIC = "EUREKA_BACKUP 1";
+
+const char *const MANIFEST_EXTENSION = ".manifest";
+const char *const LEGACY_EXTENSION = ".wad";
+
+fs::path ToPath(const SString &name)
+{
+	return fs::u8path(name.c_str());
+}
+
+//
+// Lump names may hold any byte, so the odd ones are written as %XX
+// to keep the manifest one lump per line.
+//
+SString EscapeName(const SString &name)
+{
+	SString result;
+
+	for (size_t i = 0 ; i < name.length() ; i++)
+	{
+		unsigned char ch = static_cast<unsigned char>(name[i]);
+
+		if (ch <= ' ' || ch >= 0x7f || ch == '%')
+			result += SString::printf("%%%02X", ch);
+		else
+			result.push_back(static_cast<char>(ch));
+	}
+
+	return result;
+}
+
+SString UnescapeName(const SString &text)
+{
+	SString result;
+
+	for (size_t i = 0 ; i < text.length() ; i++)
+	{
+		if (text[i] == '%' && i + 2 < text.length())
+		{
+			result.push_back(static_cast<char>(strtol(text.substr(i + 1, 2).c_str(), nullptr, 16)));
+			i += 2;
+		}
+		else
+		{
+			result.push_back(text[i]);
+		}
+	}
+
+	return result;
+}
+
+// the number of a backup file, or -1 when the name is not a number
+int FileNumber(const fs::path &path)
+{
+	std::string stem = path.stem().u8string();
+
+	if (stem.empty() || stem.length() > 9 ||
+		! std::all_of(stem.begin(), stem.end(), [](char ch) { return isdigit(ch); }))
+	{
+		return -1;
+	}
+
+	return atoi(stem.c_str());
+}
+
+std::time_t ToTime(fs::file_time_type time)
+{
+	auto system = std::chrono::time_point_cast<std::chrono::system_clock::duration>(
+		time - fs::file_time_type::clock::now() + std::chrono::system_clock::now());
+
+	return std::chrono::system_clock::to_time_t(system);
+}
+
+}	// namespace
+
+
+BackupStore::BackupStore(const SString &dir) : mDir(dir)
+{
+}
+
+
+SString BackupStore::manifestPath(int number) const
+{
+	return SString::printf("%s/%d%s", mDir.c_str(), number, MANIFEST_EXTENSION);
+}
+
+
+SString BackupStore::legacyPath(int number) const
+{
+	return SString::printf("%s/%d%s", mDir.c_str(), number, LEGACY_EXTENSION);
+}
+
+
+SString BackupStore::lumpPath(const SString &hash) const
+{
+	// spread over some subdirectories, so none gets huge
+	return mDir + "/lumps/" + hash.substr(0, 2) + "/" + hash;
+}
+
+
+void BackupStore::scan(std::vector<int> &manifests, std::vector<int> &legacy) const
+{
+	std::error_code ec;
+
+	for (const fs::directory_entry &entry : fs::directory_iterator(ToPath(mDir), ec))
+	{
+		if (! entry.is_regular_file(ec))
+			continue;
+
+		int number = FileNumber(entry.path());
+
+		if (number < 0)
+			continue;
+
+		if (entry.path().extension() == MANIFEST_EXTENSION)
+			manifests.push_back(number);
+		else if (entry.path().extension() == LEGACY_EXTENSION)
+			legacy.push_back(number);
+	}
+
+	std::sort(manifests.begin(), manifests.end());
+	std::sort(legacy.begin(), legacy.end());
+}
+
+
+bool BackupStore::readManifest(int number, Manifest &manifest) const
+{
+	FILE *fp = fopen(manifestPath(number).c_str(), "rb");
+	if (! fp)
+		return false;
+
+	std::vector<SString> lines;
+
+	char buffer[512];
+
+	while (fgets(buffer, sizeof(buffer), fp))
+	{
+		SString line = buffer;
+
+		while (! line.empty() && (line.back() == '\n' || line.back() == '\r'))
+			line.pop_back();
+
+		lines.push_back(line);
+	}
+
+	bool failed = ferror(fp) != 0;
+
+	fclose(fp);
+
+	if (failed || lines.empty() || lines[0] != MANIFEST_MAGIC)
+		return false;
+
+	Manifest result;
+
+	for (size_t i = 1 ; i < lines.size() ; i++)
+	{
+		const SString &line = lines[i];
+
+		if (line.startsWith("time "))
+		{
+			result.time = (std::time_t)strtoll(line.substr(5).c_str(), nullptr, 10);
+			continue;
+		}
+
+		if (line.startsWith("kind "))
+		{
+			result.iwad = line.substr(5) == "IWAD";
+			continue;
+		}
+
+		if (! line.startsWith("lump "))
+			continue;
+
+		// lump <hash> <size> <name>
+		size_t hash_end = line.find(' ', 5);
+		if (hash_end == std::string::npos)
+			return false;
+
+		size_t size_end = line.find(' ', hash_end + 1);
+		if (size_end == std::string::npos)
+			return false;
+
+		Entry entry;
+
+		entry.hash = line.substr(5, hash_end - 5);
+		entry.size = strtoull(line.substr(hash_end + 1, size_end - hash_end - 1).c_str(), nullptr, 10);
+		entry.name = UnescapeName(line.substr(size_end + 1));
+
+		// the hash becomes a file name, so be strict about it
+		if (entry.hash.length() != 64 ||
+			! std::all_of(entry.hash.begin(), entry.hash.end(), [](char ch) { return isxdigit(ch); }))
+		{
+			return false;
+		}
+
+		result.entries.push_back(entry);
+	}
+
+	manifest = std::move(result);
+	return true;
+}
+
+
+int BackupStore::store(const Wad_file &wad)
+{
+	std::error_code ec;
+	fs::create_directories(ToPath(mDir + "/lumps"), ec);
+
+	std::vector<int> manifests, legacy;
+	scan(manifests, legacy);
+
+	int number = 1;
+
+	if (! manifests.empty())
+		number = std::max(number, manifests.back() + 1);
+	if (! legacy.empty())
+		number = std::max(number, legacy.back() + 1);
+
+	SString text = SString(MANIFEST_MAGIC) + "\n";
+
+	text += SString::printf("time %lld\n", (long long)std::time(nullptr));
+	text += wad.IsIWAD() ? "kind IWAD\n" : "kind PWAD\n";
+
+	for (const LumpRef &ref : wad.getDir())
+	{
+		const Lump_c *lump = ref.lump.get();
+
+		const SString &hash = lump->ContentHash();
+
+		text += SString::printf("lump %s %d %s\n", hash.c_str(), lump->Length(),
+								EscapeName(lump->Name()).c_str());
+
+		if (lump->Length() == 0)
+			continue;
+
+		// this content is already kept by an earlier version
+		SString path = lumpPath(hash);
+
+		if (fs::file_size(ToPath(path), ec) == (uintmax_t)lump->Length() && ! ec)
+			continue;
+
+		fs::create_directories(ToPath(path).parent_path(), ec);
+
+		SafeOutFile out(path);
+
+		if (! out.openForWriting().success || ! out.write(lump->getData(), lump->Length()).success ||
+			! out.commit().success)
+		{
+			return -1;
+		}
+	}
+
+	// the manifest goes last, once all its lumps are there
+	SafeOutFile out(manifestPath(number));
+
+	if (! out.openForWriting().success || ! out.write(text.c_str(), text.length()).success ||
+		! out.commit().success)
+	{
+		return -1;
+	}
+
+	return number;
+}
+
+
+std::vector<BackupStore::Version> BackupStore::versions() const
+{
+	std::vector<int> manifests, legacy;
+	scan(manifests, legacy);
+
+	std::vector<Version> result;
+
+	std::error_code ec;
+
+	for (int number : manifests)
+	{
+		Manifest manifest;
+
+		if (! readManifest(number, manifest))
+			continue;
+
+		Version version;
+
+		version.number = number;
+		version.time = manifest.time;
+		version.numLumps = (int)manifest.entries.size();
+		version.wadSize = sizeof(raw_wad_header_t) + manifest.entries.size() * sizeof(raw_wad_entry_t);
+
+		for (const Entry &entry : manifest.entries)
+			version.wadSize += entry.size;
+
+		result.push_back(version);
+	}
+
+	for (int number : legacy)
+	{
+		Version version;
+
+		fs::path path = ToPath(legacyPath(number));
+
+		version.number = number;
+		version.time = ToTime(fs::last_write_time(path, ec));
+		version.numLumps = -1;
+		version.wadSize = fs::file_size(path, ec);
+
+		result.push_back(version);
+	}
+
+	std::sort(result.begin(), result.end(), [](const Version &A, const Version &B)
+	{
+		return A.number < B.number;
+	});
+
+	return result;
+}
+
+
+ReportedResult BackupStore::restore(int number, const SString &path) const
+{
+	Manifest manifest;
+
+	if (! readManifest(number, manifest))
+	{
+		// perhaps a whole copy made by an older version
+		if (FileExists(legacyPath(number)))
+		{
+			if (! FileCopy(legacyPath(number), path))
+				return { false, GetErrorMessage(errno) };
+
+			return { true };
+		}
+
+		return { false, SString::printf("backup %d is missing or damaged.", number) };
+	}
+
+	uint32_t dir_start = sizeof(raw_wad_header_t);
+
+	for (const Entry &entry : manifest.entries)
+		dir_start += (uint32_t)entry.size;
+
+	raw_wad_header_t header;
+
+	memcpy(header.ident, manifest.iwad ? "IWAD" : "PWAD", 4);
+	header.num_entries = LE_U32((uint32_t)manifest.entries.size());
+	header.dir_start   = LE_U32(dir_start);
+
+	SafeOutFile out(path);
+
+	ReportedResult result;
+
+	if (! (result = out.openForWriting()).success || ! (result = out.write(&header, sizeof(header))).success)
+		return result;
+
+	std::vector<raw_wad_entry_t> directory;
+
+	uint32_t pos = sizeof(raw_wad_header_t);
+
+	std::vector<uint8_t> data;
+
+	for (const Entry &entry : manifest.entries)
+	{
+		raw_wad_entry_t raw;
+
+		raw.pos  = LE_U32(pos);
+		raw.size = LE_U32((uint32_t)entry.size);
+		W_StoreString(raw.name, entry.name, sizeof(raw.name));
+
+		directory.push_back(raw);
+
+		pos += (uint32_t)entry.size;
+
+		if (entry.size == 0)
+			continue;
+
+		FILE *fp = fopen(lumpPath(entry.hash).c_str(), "rb");
+
+		if (! fp)
+			return { false, SString::printf("the contents of lump %s are missing.", entry.name.c_str()) };
+
+		data.resize(entry.size + 1);
+
+		// reading one byte more tells whether the file is too long
+		size_t got = fread(data.data(), 1, data.size(), fp);
+
+		fclose(fp);
+
+		if (got != entry.size)
+			return { false, SString::printf("the contents of lump %s are damaged.", entry.name.c_str()) };
+
+		if (! (result = out.write(data.data(), entry.size)).success)
+			return result;
+	}
+
+	if (! directory.empty() &&
+		! (result = out.write(directory.data(), directory.size() * sizeof(raw_wad_entry_t))).success)
+	{
+		return result;
+	}
+
+	return out.commit();
+}
+
+
+void BackupStore::prune(int max_versions, uint64_t max_bytes)
+{
+	struct Stored
+	{
+		fs::path path;
+		uint64_t size;
+	};
+
+	std::unordered_map<SString, Stored> lumps;
+
+	std::error_code ec;
+
+	for (const fs::directory_entry &entry : fs::recursive_directory_iterator(ToPath(mDir + "/lumps"), ec))
+	{
+		if (entry.is_regular_file(ec))
+			lumps[entry.path().filename().u8string().c_str()] = { entry.path(), entry.file_size(ec) };
+	}
+
+	std::vector<int> manifests, legacy;
+	scan(manifests, legacy);
+
+	// the newest first, the manifests winning a tie
+	std::vector<std::pair<int, bool>> order;
+
+	for (int number : manifests)
+		order.emplace_back(number, false);
+	for (int number : legacy)
+		order.emplace_back(number, true);
+
+	std::sort(order.begin(), order.end(), [](const std::pair<int, bool> &A, const std::pair<int, bool> &B)
+	{
+		return A.first != B.first ? A.first > B.first : A.second < B.second;
+	});
+
+	std::unordered_set<SString> used;
+
+	uint64_t total = 0;
+	int kept = 0;
+
+	bool keeping = true;
+
+	// whether every kept version is known to use nothing else
+	bool all_known = true;
+
+	for (const std::pair<int, bool> &item : order)
+	{
+		SString path = item.second ? legacyPath(item.first) : manifestPath(item.first);
+
+		uint64_t cost = fs::file_size(ToPath(path), ec);
+
+		if (ec)
+			cost = 0;
+
+		// what this version adds to the ones which are kept
+		Manifest manifest;
+
+		bool known = item.second || readManifest(item.first, manifest);
+
+		if (known)
+		{
+			std::unordered_set<SString> seen;
+
+			for (const Entry &entry : manifest.entries)
+			{
+				auto it = lumps.find(entry.hash);
+
+				if (it != lumps.end() && used.count(entry.hash) == 0 && seen.insert(entry.hash).second)
+					cost += it->second.size;
+			}
+		}
+
+		keeping = keeping && kept < max_versions && (kept < 2 || total + cost <= max_bytes);
+
+		if (! keeping)
+		{
+			fs::remove(ToPath(path), ec);
+			continue;
+		}
+
+		for (const Entry &entry : manifest.entries)
+			used.insert(entry.hash);
+
+		all_known = all_known && known;
+
+		total += cost;
+		kept++;
+	}
+
+	// a kept manifest which cannot be read may still use any lump, so
+	// none are deleted
+	if (! all_known)
+		return;
+
+	// anything else is not used anymore, including what was left over
+	// by an interrupted store()
+	for (const auto &pair : lumps)
+	{
+		if (used.count(pair.first) == 0)
+			fs::remove(pair.second.path, ec);
+	}
+}
+
+
+uint64_t BackupStore::totalSize() const
+{
+	uint64_t total = 0;
+
+	std::error_code ec;
+
+	for (const fs::directory_entry &entry : fs::recursive_directory_iterator(ToPath(mDir), ec))
+	{
+		if (entry.is_regular_file(ec))
+			total += entry.file_size(ec);
+	}
+
+	return total;
+}
@@ -0,0 +1,102 @@
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#ifndef BACKUPSTORE_H_
+#define BACKUPSTORE_H_
+
+#include "Errors.h"
+#include "m_strings.h"
+
+#include <cstdint>
+#include <ctime>
+#include <vector>
+
+class Wad_file;
+
+//
+// The backups of one wad.  Each version is a small manifest listing
+// the lumps by the hash of their contents, and every distinct content
+// is stored once in its own file, so the lumps which did not change
+// are shared by all the versions.
+//
+// Older versions of Eureka copied the whole wad instead ("5.wad").
+// Those copies are still listed, restored and pruned like the others.
+//
+class BackupStore
+{
+public:
+	struct Version
+	{
+		int number;
+		std::time_t time;
+
+		// the size of the wad it makes, and the number of lumps (which
+		// is -1 for the old whole-wad copies)
+		uint64_t wadSize;
+		int numLumps;
+	};
+
+	explicit BackupStore(const SString &dir);
+
+	// adds the current contents of the wad as a new version.  Returns
+	// its number, or -1 if it could not be written.
+	int store(const Wad_file &wad);
+
+	// all the versions, oldest first
+	std::vector<Version> versions() const;
+
+	// makes a wad file of the given version
+	ReportedResult restore(int number, const SString &path) const;
+
+	// deletes the oldest versions while there are more than the given
+	// number, or they take more than the given size on disk, but always
+	// keeps the two newest.  Then the lumps no version uses anymore are
+	// deleted too, unless a kept version cannot be read.
+	void prune(int max_versions, uint64_t max_bytes);
+
+	// the size of the manifests, lumps and old copies, in bytes
+	uint64_t totalSize() const;
+
+private:
+	struct Entry
+	{
+		SString name;
+		SString hash;
+		uint64_t size;
+	};
+
+	struct Manifest
+	{
+		std::time_t time = 0;
+		bool iwad = false;
+		std::vector<Entry> entries;
+	};
+
+	SString manifestPath(int number) const;
+	SString legacyPath(int number) const;
+	SString lumpPath(const SString &hash) const;
+
+	// the numbers of the manifests and of the old copies
+	void scan(std::vector<int> &manifests, std::vector<int> &legacy) const;
+
+	bool readManifest(int number, Manifest &manifest) const;
+
+	SString mDir;
+};
+
+#endif /* BACKUPSTORE_H_ */
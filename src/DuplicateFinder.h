@@ -0,0 +1,88 @@
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#ifndef DUPLICATEFINDER_H_
+#define DUPLICATEFINDER_H_
+
+#include "FixedPoint.h"
+
+#include <array>
+#include <stddef.h>
+#include <stdint.h>
+#include <unordered_map>
+
+//
+// Finds objects sharing exactly the same key, for example the
+// fixed-point coordinates of vertices, or both (normalized) ends
+// of linedefs.  It uses a hash table, hence takes O(N) expected
+// time instead of sorting the objects.
+//
+class DuplicateFinder
+{
+public:
+	typedef std::array<int, 4> Key;
+
+	explicit DuplicateFinder(size_t expected)
+	{
+		table.reserve(expected);
+	}
+
+	//
+	// Adds an object with the given key.  Returns the first object
+	// which was added with the same key, or -1 when there is none.
+	// Hence adding objects in increasing order makes the lowest
+	// numbered one of each group its "original".
+	//
+	int add(int index, const Key &key)
+	{
+		auto result = table.emplace(key, index);
+
+		return result.second ? -1 : result.first->second;
+	}
+
+	static Key makeKey(FFixedPoint x, FFixedPoint y)
+	{
+		return { x.raw(), y.raw(), 0, 0 };
+	}
+
+	static Key makeKey(FFixedPoint x1, FFixedPoint y1, FFixedPoint x2, FFixedPoint y2)
+	{
+		return { x1.raw(), y1.raw(), x2.raw(), y2.raw() };
+	}
+
+private:
+	struct KeyHash
+	{
+		size_t operator() (const Key &key) const
+		{
+			uint64_t h = 0;
+
+			for (int value : key)
+			{
+				h = (h ^ static_cast<uint32_t>(value)) * 0x9E3779B97F4A7C15ULL;
+				h ^= h >> 29;
+			}
+
+			return static_cast<size_t>(h);
+		}
+	};
+
+	std::unordered_map<Key, int, KeyHash> table;
+};
+
+#endif /* DUPLICATEFINDER_H_ */
@@ -29,6 +29,7 @@
 #include "r_grid.h"
 #include "r_render.h"
 #include "r_subdiv.h"
+#include "r_vanilla.h"
 #include "w_texture.h"
 #include "w_wad.h"
 #include "WadData.h"
@@ -42,6 +43,18 @@ class UI_ProjectSetup;
 struct v2double_t;
 struct v2int_t;
 
+//
+// The nodes of a saved level being built in the background, see
+// BuildNodesAfterSave().  Destroying it cancels the build and waits
+// for its thread.
+//
+struct BackgroundNodeBuild
+{
+	SString level_name;
+
+	virtual ~BackgroundNodeBuild() = default;
+};
+
 //
 // An instance with a document, holding all other associated data, such as the window reference, the
 // wad list.
@@ -71,6 +84,7 @@ public:
 	void CMD_Clipboard_Copy();
 	void CMD_Clipboard_Cut();
 	void CMD_Clipboard_Paste();
+	void CMD_CompactWad();
 	void CMD_CopyAndPaste();
 	void CMD_CopyMap();
 	void CMD_CopyProperties();
@@ -124,6 +138,7 @@ public:
 	void CMD_Quit();
 	void CMD_RecalcSectors();
 	void CMD_RenameMap();
+	void CMD_RestoreBackup();
 	void CMD_Redo();
 	void CMD_Rotate90();
 	void CMD_RotateObjects_Dialog();
@@ -144,6 +159,7 @@ public:
 	void CMD_ToggleVar();
 	void CMD_Undo();
 	void CMD_UnselectAll();
+	void CMD_VanillaHeatmap();
 	void CMD_VT_ShapeArc();
 	void CMD_VT_ShapeLine();
 	void CMD_WHEEL_Scroll();
@@ -281,7 +297,12 @@ public:
 	void ValidateSidedefRefs(LineDef *ld, int num);
 	
 	// M_NODES
+	// builds every level of the edit wad, or just the given one.
+	build_result_e BuildAllNodes(nodebuildinfo_t *info, int only_level = -1);
 	void BuildNodesAfterSave(int lev_idx);
+	bool BuildingNodesFor(const SString &level) const;
+	void CheckBackgroundNodes();
+	void FinishBackgroundNodes(bool cancel = false);
 	void GB_PrintMsg(EUR_FORMAT_STRING(const char *str), ...) const EUR_PRINTF(2, 3);
 
 	// M_TESTMAP
@@ -408,9 +429,6 @@ private:
 	void SaveVertices();
 	void ShowLoadProblem() const;
 
-	// M_NODES
-	build_result_e BuildAllNodes(nodebuildinfo_t *info);
-
 	// M_UDMF
 	void ValidateLevel_UDMF();
 
@@ -487,6 +505,13 @@ public:	// will be private when we encapsulate everything
 	int saving_level = 0;
 	UI_NodeDialog *nodeialog = nullptr;
 	nodebuildinfo_t *nb_info = nullptr;
+	// nodes being built after a save, see BuildNodesAfterSave()
+	std::unique_ptr<BackgroundNodeBuild> bg_nodes;
+	// partitions of the last build, reused when saving the level again
+	nodebuildcache_t node_cache;
+	// the vanilla limits over the level, while they are shown.  Any
+	// change to the level throws it away.
+	std::unique_ptr<vanilla_heatmap_t> vanilla_heat;
 
 	WadData wad;
 
@@ -0,0 +1,98 @@
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+std::shared_ptr<MappedFile> MappedFile::open(const SString &path)
+{
+#ifdef _WIN32
+	// the sharing flags let the file be replaced while it is mapped
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ,
+							  FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+							  NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return nullptr;
+
+	LARGE_INTEGER size;
+
+	if (! GetFileSizeEx(file, &size) || size.QuadPart <= 0 ||
+		(uint64_t)size.QuadPart > SIZE_MAX)
+	{
+		CloseHandle(file);
+		return nullptr;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(file);
+
+	if (! mapping)
+		return nullptr;
+
+	// the view keeps the mapping alive by itself
+	void *addr = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);
+
+	if (! addr)
+		return nullptr;
+
+	return std::shared_ptr<MappedFile>(new MappedFile(static_cast<const uint8_t *>(addr),
+													  (size_t)size.QuadPart));
+#else
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return nullptr;
+
+	struct stat info;
+
+	if (fstat(fd, &info) != 0 || info.st_size <= 0 || (uint64_t)info.st_size > SIZE_MAX)
+	{
+		::close(fd);
+		return nullptr;
+	}
+
+	void *addr = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+	// the mapping keeps the file open by itself
+	::close(fd);
+
+	if (addr == MAP_FAILED)
+		return nullptr;
+
+	return std::shared_ptr<MappedFile>(new MappedFile(static_cast<const uint8_t *>(addr),
+													  (size_t)info.st_size));
+#endif
+}
+
+
+MappedFile::~MappedFile()
+{
+#ifdef _WIN32
+	UnmapViewOfFile(mData);
+#else
+	munmap(const_cast<uint8_t *>(mData), mSize);
+#endif
+}
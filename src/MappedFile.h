@@ -0,0 +1,64 @@
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#ifndef MAPPEDFILE_H_
+#define MAPPEDFILE_H_
+
+#include "m_strings.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+//
+// A whole file mapped into memory for reading.  Only the pages which
+// are actually looked at get read from the disk.  The file stays
+// mapped until the last reference goes away.
+//
+class MappedFile
+{
+public:
+	// returns NULL when the file cannot be opened or mapped (an empty
+	// file cannot be mapped either).
+	static std::shared_ptr<MappedFile> open(const SString &path);
+
+	~MappedFile();
+
+	const uint8_t *data() const
+	{
+		return mData;
+	}
+
+	size_t size() const
+	{
+		return mSize;
+	}
+
+private:
+	MappedFile(const uint8_t *data, size_t size) : mData(data), mSize(size)
+	{
+	}
+
+	MappedFile(const MappedFile &other) = delete;
+	MappedFile &operator= (const MappedFile &other) = delete;
+
+	const uint8_t *mData;
+	size_t mSize;
+};
+
+#endif /* MAPPEDFILE_H_ */
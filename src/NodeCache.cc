@@ -0,0 +1,329 @@
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#include "NodeCache.h"
+
+#include "Errors.h"
+#include "SafeOutFile.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+
+const char ENTRY_MAGIC[4] = { 'E', 'N', 'O', 'D' };
+const uint32_t ENTRY_VERSION = 1;
+
+const char *const ENTRY_EXTENSION = ".nodes";
+
+// the checksum of the entries is an FNV-1a hash
+const uint64_t PRIME_A = 0x100000001b3ULL;
+
+uint64_t Finish(uint64_t h)
+{
+	// the finaliser of MurmurHash3, spreads every bit over the result
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+
+	return h;
+}
+
+void PutU32(std::vector<uint8_t> &buf, uint32_t value)
+{
+	for (int i = 0 ; i < 4 ; i++)
+		buf.push_back((uint8_t)(value >> (i * 8)));
+}
+
+bool GetU32(const std::vector<uint8_t> &buf, size_t &pos, uint32_t &value)
+{
+	if (pos + 4 > buf.size())
+		return false;
+
+	value = 0;
+
+	for (int i = 0 ; i < 4 ; i++)
+		value |= (uint32_t)buf[pos + i] << (i * 8);
+
+	pos += 4;
+	return true;
+}
+
+// the checksum which ends each entry
+uint64_t Checksum(const uint8_t *data, size_t length)
+{
+	uint64_t h = 0xcbf29ce484222325ULL;
+
+	for (size_t i = 0 ; i < length ; i++)
+		h = (h ^ data[i]) * PRIME_A;
+
+	return Finish(h ^ length);
+}
+
+fs::path ToPath(const SString &name)
+{
+	return fs::u8path(name.c_str());
+}
+
+}	// namespace
+
+
+void NodeCacheKey::add(const void *data, size_t length)
+{
+	mHash.AddBlock(data, length);
+}
+
+
+void NodeCacheKey::addInt(int64_t value)
+{
+	uint8_t bytes[8];
+
+	for (int i = 0 ; i < 8 ; i++)
+		bytes[i] = (uint8_t)((uint64_t)value >> (i * 8));
+
+	add(bytes, sizeof(bytes));
+}
+
+
+void NodeCacheKey::addString(const SString &text)
+{
+	// the length keeps "AB" + "C" apart from "A" + "BC"
+	addInt((int64_t)text.length());
+	add(text.c_str(), text.length());
+}
+
+
+SString NodeCacheKey::hex() const
+{
+	// more can still be added afterwards
+	sha256_c copy = mHash;
+
+	return copy.Finish();
+}
+
+
+//------------------------------------------------------------------------
+
+
+NodeCache::NodeCache(const SString &dir, uint64_t max_bytes) :
+	mDir(dir), mMaxBytes(max_bytes)
+{
+}
+
+
+SString NodeCache::entryPath(const SString &key) const
+{
+	return mDir + "/" + key + ENTRY_EXTENSION;
+}
+
+
+bool NodeCache::load(const SString &key, std::vector<Lump> &lumps) const
+{
+	SString path = entryPath(key);
+
+	FILE *fp = fopen(path.c_str(), "rb");
+	if (! fp)
+		return false;
+
+	std::vector<uint8_t> buf;
+
+	uint8_t chunk[65536];
+	size_t got;
+
+	while ((got = fread(chunk, 1, sizeof(chunk), fp)) > 0)
+		buf.insert(buf.end(), chunk, chunk + got);
+
+	bool failed = ferror(fp) != 0;
+
+	fclose(fp);
+
+	if (failed || buf.size() < sizeof(ENTRY_MAGIC) + 16 ||
+		memcmp(buf.data(), ENTRY_MAGIC, sizeof(ENTRY_MAGIC)) != 0)
+	{
+		return false;
+	}
+
+	// the last 8 bytes are the checksum of the rest
+	size_t end = buf.size() - 8;
+
+	uint64_t sum = 0;
+
+	for (int i = 0 ; i < 8 ; i++)
+		sum |= (uint64_t)buf[end + i] << (i * 8);
+
+	if (sum != Checksum(buf.data(), end))
+		return false;
+
+	size_t pos = sizeof(ENTRY_MAGIC);
+
+	uint32_t version, count;
+
+	if (! GetU32(buf, pos, version) || version != ENTRY_VERSION ||
+		! GetU32(buf, pos, count))
+	{
+		return false;
+	}
+
+	std::vector<Lump> result(count);
+
+	for (Lump &lump : result)
+	{
+		uint32_t name_len, data_len;
+
+		if (! GetU32(buf, pos, name_len) || pos + name_len > end)
+			return false;
+
+		lump.name = SString((const char *)buf.data() + pos, (int)name_len);
+		pos += name_len;
+
+		if (! GetU32(buf, pos, data_len) || pos + data_len > end)
+			return false;
+
+		lump.data.assign(buf.begin() + pos, buf.begin() + pos + data_len);
+		pos += data_len;
+	}
+
+	if (pos != end)
+		return false;
+
+	lumps = std::move(result);
+
+	// this entry is the newest now
+	std::error_code ec;
+	fs::last_write_time(ToPath(path), fs::file_time_type::clock::now(), ec);
+
+	return true;
+}
+
+
+bool NodeCache::store(const SString &key, const std::vector<Lump> &lumps)
+{
+	std::vector<uint8_t> buf(ENTRY_MAGIC, ENTRY_MAGIC + sizeof(ENTRY_MAGIC));
+
+	PutU32(buf, ENTRY_VERSION);
+	PutU32(buf, (uint32_t)lumps.size());
+
+	for (const Lump &lump : lumps)
+	{
+		PutU32(buf, (uint32_t)lump.name.length());
+		buf.insert(buf.end(), lump.name.c_str(), lump.name.c_str() + lump.name.length());
+
+		PutU32(buf, (uint32_t)lump.data.size());
+		buf.insert(buf.end(), lump.data.begin(), lump.data.end());
+	}
+
+	uint64_t sum = Checksum(buf.data(), buf.size());
+
+	for (int i = 0 ; i < 8 ; i++)
+		buf.push_back((uint8_t)(sum >> (i * 8)));
+
+	// never let a single entry flush the whole cache
+	if (buf.size() > mMaxBytes)
+		return false;
+
+	std::error_code ec;
+	fs::create_directories(ToPath(mDir), ec);
+
+	SafeOutFile out(entryPath(key));
+
+	if (! out.openForWriting().success || ! out.write(buf.data(), buf.size()).success ||
+		! out.commit().success)
+	{
+		return false;
+	}
+
+	evict(key);
+	return true;
+}
+
+
+uint64_t NodeCache::totalSize() const
+{
+	uint64_t total = 0;
+
+	std::error_code ec;
+
+	for (const fs::directory_entry &entry : fs::directory_iterator(ToPath(mDir), ec))
+	{
+		if (entry.is_regular_file(ec) && entry.path().extension() == ENTRY_EXTENSION)
+			total += entry.file_size(ec);
+	}
+
+	return total;
+}
+
+
+void NodeCache::evict(const SString &keep)
+{
+	struct Entry
+	{
+		fs::path path;
+		fs::file_time_type time;
+		uint64_t size;
+	};
+
+	std::vector<Entry> entries;
+
+	uint64_t total = 0;
+
+	std::error_code ec;
+
+	fs::path keep_path = ToPath(entryPath(keep));
+
+	for (const fs::directory_entry &entry : fs::directory_iterator(ToPath(mDir), ec))
+	{
+		if (! entry.is_regular_file(ec) || entry.path().extension() != ENTRY_EXTENSION)
+			continue;
+
+		Entry E;
+
+		E.path = entry.path();
+		E.time = entry.last_write_time(ec);
+		E.size = entry.file_size(ec);
+
+		total += E.size;
+
+		if (E.path.filename() != keep_path.filename())
+			entries.push_back(E);
+	}
+
+	if (total <= mMaxBytes)
+		return;
+
+	// the least recently used go first
+	std::sort(entries.begin(), entries.end(), [](const Entry &A, const Entry &B)
+	{
+		return A.time < B.time;
+	});
+
+	for (const Entry &E : entries)
+	{
+		if (total <= mMaxBytes)
+			break;
+
+		if (fs::remove(E.path, ec))
+			total -= E.size;
+	}
+}
@@ -0,0 +1,88 @@
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#ifndef NODECACHE_H_
+#define NODECACHE_H_
+
+#include "lib_sha256.h"
+#include "m_strings.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//
+// The SHA-256 of everything fed into it, used to name the entries of
+// the NodeCache.  Two levels which got the same key would share their
+// nodes, so it must not be possible to make them match.
+//
+class NodeCacheKey
+{
+public:
+	void add(const void *data, size_t length);
+
+	void addInt(int64_t value);
+	void addString(const SString &text);
+
+	// the hash as 64 hex digits
+	SString hex() const;
+
+private:
+	sha256_c mHash;
+};
+
+
+//
+// The node lumps built for levels, kept on disk so that levels which
+// have not changed get their nodes back instantly.  Each entry is a
+// file named after the key (a hash of everything the node builder
+// reads).  Once the entries take more than the size limit, the least
+// recently used ones are deleted.
+//
+class NodeCache
+{
+public:
+	struct Lump
+	{
+		SString name;
+		std::vector<uint8_t> data;
+	};
+
+	NodeCache(const SString &dir, uint64_t max_bytes);
+
+	// looks up an entry, returns false if there is none or it is
+	// damaged.  A hit makes the entry the most recently used one.
+	bool load(const SString &key, std::vector<Lump> &lumps) const;
+
+	// adds an entry, then deletes the oldest ones while the cache is
+	// too big.  Returns false if the entry could not be written.
+	bool store(const SString &key, const std::vector<Lump> &lumps);
+
+	// the size of all the entries, in bytes
+	uint64_t totalSize() const;
+
+private:
+	SString entryPath(const SString &key) const;
+
+	void evict(const SString &keep);
+
+	SString mDir;
+	uint64_t mMaxBytes;
+};
+
+#endif /* NODECACHE_H_ */
@@ -0,0 +1,178 @@
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#include "ParallelDeflate.h"
+
+#include "Errors.h"
+#include "TaskPool.h"
+
+#include <algorithm>
+
+#include <zlib.h>
+
+namespace
+{
+
+// deflate looks back this far for matches
+const size_t WINDOW_SIZE = 32768;
+
+struct Chunk
+{
+	const uint8_t *data;
+	size_t length;
+
+	std::vector<uint8_t> output;
+
+	uLong adler;
+};
+
+//
+// Compresses one chunk as raw deflate data, with the window before it
+// as the dictionary.  Only the last chunk ends the deflate stream.
+//
+void CompressChunk(const uint8_t *start, Chunk &chunk, int level, bool last)
+{
+	z_stream zs = {};
+
+	if (deflateInit2(&zs, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+		ThrowException("Trouble setting up zlib compression\n");
+
+	if (chunk.data > start)
+	{
+		size_t dict = std::min(WINDOW_SIZE, (size_t)(chunk.data - start));
+
+		deflateSetDictionary(&zs, chunk.data - dict, (uInt)dict);
+	}
+
+	// a sync flush adds an empty stored block (5 bytes)
+	chunk.output.resize(deflateBound(&zs, (uLong)chunk.length) + 16);
+
+	zs.next_in  = const_cast<Bytef *>(chunk.data);
+	zs.avail_in = (uInt)chunk.length;
+
+	size_t used = 0;
+
+	for (;;)
+	{
+		zs.next_out  = chunk.output.data() + used;
+		zs.avail_out = (uInt)(chunk.output.size() - used);
+
+		int err = deflate(&zs, last ? Z_FINISH : Z_SYNC_FLUSH);
+
+		used = chunk.output.size() - zs.avail_out;
+
+		if (last ? (err == Z_STREAM_END) : (err == Z_OK && zs.avail_out > 0))
+			break;
+
+		if (err != Z_OK && err != Z_BUF_ERROR)
+		{
+			deflateEnd(&zs);
+			ThrowException("Trouble compressing %zu bytes (zlib)\n", chunk.length);
+		}
+
+		// did not fit, which should not happen
+		chunk.output.resize(chunk.output.size() * 2);
+	}
+
+	deflateEnd(&zs);
+
+	chunk.output.resize(used);
+
+	chunk.adler = adler32(adler32(0L, Z_NULL, 0), chunk.data, (uInt)chunk.length);
+}
+
+}	// namespace
+
+
+std::vector<uint8_t> ParallelDeflate(const void *data, size_t length, int level,
+									 TaskPool &pool, size_t chunk_size)
+{
+	if (level < 0 || level > 9)
+		level = Z_DEFAULT_COMPRESSION;
+
+	const uint8_t *start = static_cast<const uint8_t *>(data);
+
+	size_t num_chunks = std::max((size_t)1, (length + chunk_size - 1) / chunk_size);
+
+	std::vector<Chunk> chunks(num_chunks);
+
+	for (size_t i = 0 ; i < num_chunks ; i++)
+	{
+		chunks[i].data   = start + i * chunk_size;
+		chunks[i].length = std::min(chunk_size, length - i * chunk_size);
+	}
+
+	if (num_chunks == 1)
+	{
+		CompressChunk(start, chunks[0], level, true);
+	}
+	else
+	{
+		TaskGroup group(pool);
+
+		for (size_t i = 0 ; i < num_chunks ; i++)
+		{
+			group.run([start, &chunks, i, level, num_chunks]()
+			{
+				CompressChunk(start, chunks[i], level, i + 1 == num_chunks);
+			});
+		}
+
+		group.wait();
+	}
+
+	// the header, made the same way as deflate() does it
+	int effective = (level == Z_DEFAULT_COMPRESSION) ? 6 : level;
+
+	unsigned level_flags = (effective < 2) ? 0 : (effective < 6) ? 1 : (effective == 6) ? 2 : 3;
+
+	unsigned header = (Z_DEFLATED + ((MAX_WBITS - 8) << 4)) << 8;
+
+	header |= level_flags << 6;
+	header += 31 - (header % 31);
+
+	size_t total = 2 + 4;
+
+	for (const Chunk &chunk : chunks)
+		total += chunk.output.size();
+
+	std::vector<uint8_t> result;
+
+	result.reserve(total);
+
+	result.push_back((uint8_t)(header >> 8));
+	result.push_back((uint8_t)(header & 0xFF));
+
+	uLong adler = chunks[0].adler;
+
+	for (size_t i = 0 ; i < num_chunks ; i++)
+	{
+		result.insert(result.end(), chunks[i].output.begin(), chunks[i].output.end());
+
+		if (i > 0)
+			adler = adler32_combine(adler, chunks[i].adler, (z_off_t)chunks[i].length);
+	}
+
+	// the checksum of all the data, big-endian
+	result.push_back((uint8_t)(adler >> 24));
+	result.push_back((uint8_t)(adler >> 16));
+	result.push_back((uint8_t)(adler >> 8));
+	result.push_back((uint8_t)(adler));
+
+	return result;
+}
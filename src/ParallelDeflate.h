@@ -0,0 +1,44 @@
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#ifndef PARALLELDEFLATE_H_
+#define PARALLELDEFLATE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class TaskPool;
+
+//
+// Compresses the data into a single zlib stream, the same format which
+// compress2() makes, using the task pool for large amounts of data.
+//
+// Like pigz, the data is cut into chunks which are compressed on their
+// own, each one primed with the 32 KB before it so that little is lost.
+// The chunks end on a byte boundary (a sync flush), hence they can just
+// be put one after another.  When the data fits into one chunk, the
+// result is identical to compress2().
+//
+// 'level' goes from 0 (no compression) to 9 (best), or -1 for zlib's
+// default.  Throws when zlib fails.
+//
+std::vector<uint8_t> ParallelDeflate(const void *data, size_t length, int level,
+									 TaskPool &pool, size_t chunk_size = 128 * 1024);
+
+#endif /* PARALLELDEFLATE_H_ */
@@ -0,0 +1,708 @@
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#include "RejectBuilder.h"
+#include "TaskPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+
+// distances (in map units) below which things are considered touching.
+// being generous here only makes the result more conservative.
+#define DIST_EPSILON   (1.0 / 64.0)
+
+#define ANGLE_EPSILON  1e-9
+
+// how many portals to visit between checking the time
+#define CHECK_INTERVAL  4096
+
+
+RejectBuilder::RejectBuilder(int _num_sectors) :
+	num_sectors(_num_sectors), sector_portals(_num_sectors)
+{
+}
+
+
+void RejectBuilder::addPortal(double x1, double y1, double x2, double y2, int front, int back)
+{
+	if (front < 0 || back < 0 || front >= num_sectors || back >= num_sectors)
+		return;
+
+	double len = hypot(x2 - x1, y2 - y1);
+
+	if (len < DIST_EPSILON)
+		return;
+
+	// the left side of the line is the back
+	double nx = (y1 - y2) / len;
+	double ny = (x2 - x1) / len;
+
+	Portal P = { x1, y1, x2, y2, nx, ny, num_lines, front, back };
+
+	sector_portals[front].push_back((int)portals.size());
+	portals.push_back(P);
+
+	Portal Q = { x1, y1, x2, y2, -nx, -ny, num_lines, back, front };
+
+	sector_portals[back].push_back((int)portals.size());
+	portals.push_back(Q);
+
+	num_lines++;
+}
+
+
+//------------------------------------------------------------------------
+
+//
+// The set of directions which a sight line may still travel in.  It has
+// to cross every portal from its 'from' side to its 'to' side, hence it
+// is the intersection of the half-planes in front of those portals.
+// Stored as a range of angles (in radians), at most a half circle.
+//
+struct sight_cone_t
+{
+	double lo, hi;
+
+	static sight_cone_t InFrontOf(double nx, double ny)
+	{
+		double mid = atan2(ny, nx);
+
+		return { mid - M_PI / 2, mid + M_PI / 2 };
+	}
+
+	// the same cone, with its angles moved near to the other cone
+	sight_cone_t MovedNear(const sight_cone_t &other) const
+	{
+		double diff  = (other.lo + other.hi) / 2 - (lo + hi) / 2;
+		double shift = 2 * M_PI * floor(diff / (2 * M_PI) + 0.5);
+
+		return { lo + shift, hi + shift };
+	}
+
+	// returns false if no direction is left
+	bool Intersect(const sight_cone_t &other)
+	{
+		sight_cone_t near = other.MovedNear(*this);
+
+		lo = std::max(lo, near.lo);
+		hi = std::min(hi, near.hi);
+
+		if (lo > hi + ANGLE_EPSILON)
+			return false;
+
+		if (lo > hi)
+			lo = hi = (lo + hi) / 2;
+
+		return true;
+	}
+
+	// grow to include the other cone, returns true if it changed
+	bool Merge(const sight_cone_t &other)
+	{
+		sight_cone_t near = other.MovedNear(*this);
+
+		bool changed = false;
+
+		if (near.lo < lo - ANGLE_EPSILON)
+		{
+			lo = near.lo;
+			changed = true;
+		}
+		if (near.hi > hi + ANGLE_EPSILON)
+		{
+			hi = near.hi;
+			changed = true;
+		}
+		return changed;
+	}
+
+	// the normals of the two half-planes which make up the cone
+	void GetNormals(double *mx, double *my) const
+	{
+		mx[0] = -sin(lo); my[0] =  cos(lo);
+		mx[1] =  sin(hi); my[1] = -cos(hi);
+	}
+};
+
+
+//
+// A part of a portal which may still be seen.
+//
+struct sight_window_t
+{
+	double x1, y1;
+	double x2, y2;
+};
+
+
+//
+// clip the range [u0, u1] to where (a + b * u) >= 0.
+// returns false if nothing is left.
+//
+static bool ClipRange(double a, double b, double &u0, double &u1)
+{
+	if (fabs(b) < 1e-12)
+	{
+		if (a < 0)
+			u1 = u0 - 1;
+	}
+	else if (b > 0)
+	{
+		u0 = std::max(u0, -a / b);
+	}
+	else
+	{
+		u1 = std::min(u1, -a / b);
+	}
+
+	return u0 <= u1;
+}
+
+
+//
+// What is known about a portal while following the sight lines from a
+// single source portal: the part of it which may be seen, and in which
+// directions sight lines may pass through it.  These only ever grow,
+// and after too many updates they become everything.
+//
+struct portal_state_t
+{
+	int stamp;
+	int updates;
+	bool queued;
+
+	double u0, u1;
+
+	sight_cone_t cone;
+};
+
+#define MAX_UPDATES  8
+
+
+//
+// Follows the sight lines leading away from a single source sector,
+// marking every sector reached.
+//
+class RejectBuilder::Flow
+{
+public:
+	Flow(const RejectBuilder &_rb,
+		 std::chrono::steady_clock::time_point _deadline,
+		 const std::atomic<bool> *_cancelled) :
+		rb(_rb), row_bits(_rb.set_words),
+		deadline(_deadline), cancelled(_cancelled),
+		states(_rb.portals.size())
+	{
+		for (portal_state_t &st : states)
+			st.stamp = 0;
+	}
+
+	// fills in the row of the visibility matrix for the source sector.
+	// returns false if time ran out.
+	bool Run(int source_sec, unsigned char *_row);
+
+private:
+	void RunPortal(int p0);
+
+	void Reach(int p, double u0, double u1, const sight_cone_t &cone);
+
+	void Process(int p);
+
+	void MarkVisible(int sector)
+	{
+		row[sector] = 1;
+		row_bits[sector >> 6] |= (uint64_t)1 << (sector & 63);
+	}
+
+	// true when something not yet visible might be seen through the
+	// portal (with the current source portal).
+	bool MightSeeMore(int p) const;
+
+	bool ClipToSeparators(const sight_window_t &W, const Portal &C,
+						  double &u0, double &u1) const;
+
+	bool ClipToCone(const sight_window_t &W, const sight_cone_t &cone,
+					const Portal &C, double &u0, double &u1) const;
+
+	bool CheckTime();
+
+	const RejectBuilder &rb;
+
+	unsigned char *row = nullptr;
+
+	// same as 'row', as a bit set
+	std::vector<uint64_t> row_bits;
+
+	std::chrono::steady_clock::time_point deadline;
+	const std::atomic<bool> *cancelled;
+
+	// the source portal
+	sight_window_t source;
+	const uint64_t *source_might = nullptr;
+
+	std::vector<portal_state_t> states;
+	int stamp = 0;
+
+	// portals whose state has grown and need to be processed again
+	std::vector<int> pending;
+
+	int counter = 0;
+	bool aborted = false;
+};
+
+
+bool RejectBuilder::Flow::CheckTime()
+{
+	if (aborted)
+		return false;
+
+	if (++counter < CHECK_INTERVAL)
+		return true;
+
+	counter = 0;
+
+	if ((cancelled && *cancelled) || std::chrono::steady_clock::now() > deadline)
+		aborted = true;
+
+	return ! aborted;
+}
+
+
+bool RejectBuilder::Flow::MightSeeMore(int p) const
+{
+	const uint64_t *portal_might = &rb.might_see[(size_t)p * rb.set_words];
+
+	for (int i = 0 ; i < rb.set_words ; i++)
+		if (source_might[i] & portal_might[i] & ~row_bits[i])
+			return true;
+
+	return false;
+}
+
+
+bool RejectBuilder::Flow::Run(int source_sec, unsigned char *_row)
+{
+	row = _row;
+
+	std::fill(row_bits.begin(), row_bits.end(), 0);
+
+	MarkVisible(source_sec);
+
+	for (int p : rb.sector_portals[source_sec])
+		MarkVisible(rb.portals[p].to);
+
+	for (int p : rb.sector_portals[source_sec])
+	{
+		if (aborted)
+			return false;
+
+		source_might = &rb.might_see[(size_t)p * rb.set_words];
+
+		if (MightSeeMore(p))
+			RunPortal(p);
+	}
+
+	return ! aborted;
+}
+
+
+void RejectBuilder::Flow::RunPortal(int p0)
+{
+	const Portal &P = rb.portals[p0];
+
+	source = { P.x1, P.y1, P.x2, P.y2 };
+
+	stamp++;
+
+	Reach(p0, 0, 1, sight_cone_t::InFrontOf(P.nx, P.ny));
+
+	while (! pending.empty())
+	{
+		int p = pending.back();
+		pending.pop_back();
+
+		states[p].queued = false;
+
+		if (! CheckTime())
+		{
+			pending.clear();
+			return;
+		}
+
+		Process(p);
+	}
+}
+
+
+void RejectBuilder::Flow::Reach(int p, double u0, double u1, const sight_cone_t &cone)
+{
+	portal_state_t &st = states[p];
+
+	if (st.stamp != stamp)
+	{
+		st = { stamp, 0, false, u0, u1, cone };
+	}
+	else
+	{
+		if (st.updates >= MAX_UPDATES)
+			return;
+
+		bool changed = st.cone.Merge(cone);
+
+		if (u0 < st.u0)
+		{
+			st.u0 = u0;
+			changed = true;
+		}
+		if (u1 > st.u1)
+		{
+			st.u1 = u1;
+			changed = true;
+		}
+
+		if (! changed)
+			return;
+
+		if (++st.updates >= MAX_UPDATES)
+		{
+			const Portal &C = rb.portals[p];
+
+			st.u0 = 0;
+			st.u1 = 1;
+			st.cone = sight_cone_t::InFrontOf(C.nx, C.ny);
+		}
+	}
+
+	if (! st.queued)
+	{
+		st.queued = true;
+		pending.push_back(p);
+	}
+}
+
+
+void RejectBuilder::Flow::Process(int p)
+{
+	if (! MightSeeMore(p))
+		return;
+
+	const Portal &P = rb.portals[p];
+	const portal_state_t &st = states[p];
+
+	double dx = P.x2 - P.x1;
+	double dy = P.y2 - P.y1;
+
+	sight_window_t W =
+	{
+		P.x1 + dx * st.u0, P.y1 + dy * st.u0,
+		P.x1 + dx * st.u1, P.y1 + dy * st.u1
+	};
+
+	sight_cone_t cone = st.cone;
+
+	for (int c : rb.sector_portals[P.to])
+	{
+		const Portal &C = rb.portals[c];
+
+		if (C.line == P.line)
+			continue;
+
+		sight_cone_t new_cone = cone;
+
+		if (! new_cone.Intersect(sight_cone_t::InFrontOf(C.nx, C.ny)))
+			continue;
+
+		double u0 = 0;
+		double u1 = 1;
+
+		if (! ClipToSeparators(W, C, u0, u1))
+			continue;
+
+		if (! ClipToCone(W, new_cone, C, u0, u1))
+			continue;
+
+		MarkVisible(C.to);
+
+		Reach(c, u0, u1, new_cone);
+	}
+}
+
+
+//
+// A sight line passes through the source portal and then through the
+// window W, so beyond W it stays behind every line which separates the
+// two (a line through an end point of each, having the source on one
+// side and W on the other side).
+//
+bool RejectBuilder::Flow::ClipToSeparators(const sight_window_t &W, const Portal &C,
+										   double &u0, double &u1) const
+{
+	const double ax[2] = { source.x1, source.x2 };
+	const double ay[2] = { source.y1, source.y2 };
+
+	const double wx[2] = { W.x1, W.x2 };
+	const double wy[2] = { W.y1, W.y2 };
+
+	double w_dx = W.x2 - W.x1;
+	double w_dy = W.y2 - W.y1;
+	double w_len2 = w_dx * w_dx + w_dy * w_dy;
+
+	for (int i = 0 ; i < 2 ; i++)
+	for (int j = 0 ; j < 2 ; j++)
+	{
+		double dx = wx[j] - ax[i];
+		double dy = wy[j] - ay[i];
+		double len = hypot(dx, dy);
+
+		if (len < DIST_EPSILON)
+			continue;
+
+		double mx = -dy / len;
+		double my =  dx / len;
+
+		double side_a = (ax[1-i] - ax[i]) * mx + (ay[1-i] - ay[i]) * my;
+		double side_w = (wx[1-j] - ax[i]) * mx + (wy[1-j] - ay[i]) * my;
+
+		if (fabs(side_a) <= DIST_EPSILON)
+			continue;
+
+		if (side_a < 0)
+		{
+			mx = -mx; my = -my;
+			side_a = -side_a;
+			side_w = -side_w;
+		}
+
+		// the source is now in front, W must be behind
+		if (side_w > DIST_EPSILON)
+			continue;
+
+		// when W lies along the line and contains the source's end
+		// point, sight lines through that point can go anywhere.
+		if (side_w >= -DIST_EPSILON && w_len2 > 0)
+		{
+			double along = ((ax[i] - W.x1) * w_dx + (ay[i] - W.y1) * w_dy) / w_len2;
+
+			if (along > -0.01 && along < 1.01)
+				continue;
+		}
+
+		// keep the part of C which is behind the separating line
+		double a = (C.x1 - ax[i]) * mx + (C.y1 - ay[i]) * my;
+		double b = (C.x2 - C.x1)  * mx + (C.y2 - C.y1)  * my;
+
+		if (! ClipRange(DIST_EPSILON - a, -b, u0, u1))
+			return false;
+	}
+
+	return true;
+}
+
+
+//
+// Every point reached beyond W lies at (q + d) for some point q of W
+// and some direction d of the cone.  For a point X(u) of the portal C
+// and q(t) = W1 + t * (W2 - W1), each normal m of the cone requires:
+//
+//     (X(u) - W1).m  -  t * (W2 - W1).m  >=  0       with 0 <= t <= 1
+//
+// Eliminating t gives a few linear conditions on u.
+//
+bool RejectBuilder::Flow::ClipToCone(const sight_window_t &W, const sight_cone_t &cone,
+									 const Portal &C, double &u0, double &u1) const
+{
+	double mx[2], my[2];
+
+	cone.GetNormals(mx, my);
+
+	// the constraint is (g0 + g1 * u) - t * h >= 0
+	double g0[2], g1[2], h[2];
+
+	for (int k = 0 ; k < 2 ; k++)
+	{
+		g0[k] = (C.x1 - W.x1) * mx[k] + (C.y1 - W.y1) * my[k] + DIST_EPSILON;
+		g1[k] = (C.x2 - C.x1) * mx[k] + (C.y2 - C.y1) * my[k];
+		h [k] = (W.x2 - W.x1) * mx[k] + (W.y2 - W.y1) * my[k];
+
+		if (fabs(h[k]) < 1e-9)
+			h[k] = 0;
+
+		// an upper bound for t must not be below zero, and a lower
+		// bound must not be above one.
+		if (h[k] >= 0)
+		{
+			if (! ClipRange(g0[k], g1[k], u0, u1))
+				return false;
+		}
+		else
+		{
+			if (! ClipRange(g0[k] - h[k], g1[k], u0, u1))
+				return false;
+		}
+	}
+
+	// a lower bound from one normal must not exceed an upper bound from
+	// the other one:  g_k / h_k <= g_j / h_j  where h_k < 0 < h_j.
+	for (int k = 0 ; k < 2 ; k++)
+	{
+		int j = 1 - k;
+
+		if (h[k] < 0 && h[j] > 0)
+		{
+			if (! ClipRange(g0[k] * h[j] - g0[j] * h[k], g1[k] * h[j] - g1[j] * h[k], u0, u1))
+				return false;
+		}
+	}
+
+	return true;
+}
+
+
+//------------------------------------------------------------------------
+
+//
+// A sight line which went through a portal stays in front of it, so
+// only the sectors reachable through portals which are (partly) in
+// front of it can be seen.
+//
+void RejectBuilder::computeMightSee(TaskPool &pool)
+{
+	set_words = (num_sectors + 63) / 64;
+
+	might_see.assign((size_t)portals.size() * set_words, 0);
+
+	std::atomic<int> next_portal(0);
+
+	auto worker = [&]()
+	{
+		std::vector<int> stack;
+
+		for (;;)
+		{
+			int p = next_portal++;
+
+			if (p >= (int)portals.size())
+				break;
+
+			const Portal &P = portals[p];
+
+			uint64_t *bits = &might_see[(size_t)p * set_words];
+
+			bits[P.to >> 6] |= (uint64_t)1 << (P.to & 63);
+			stack.push_back(P.to);
+
+			while (! stack.empty())
+			{
+				int sec = stack.back();
+				stack.pop_back();
+
+				for (int c : sector_portals[sec])
+				{
+					const Portal &C = portals[c];
+
+					if (C.line == P.line)
+						continue;
+
+					if (bits[C.to >> 6] & ((uint64_t)1 << (C.to & 63)))
+						continue;
+
+					double d1 = (C.x1 - P.x1) * P.nx + (C.y1 - P.y1) * P.ny;
+					double d2 = (C.x2 - P.x1) * P.nx + (C.y2 - P.y1) * P.ny;
+
+					if (std::max(d1, d2) < -DIST_EPSILON)
+						continue;
+
+					bits[C.to >> 6] |= (uint64_t)1 << (C.to & 63);
+					stack.push_back(C.to);
+				}
+			}
+		}
+	};
+
+	TaskGroup group(pool);
+
+	for (int i = 0 ; i < pool.numWorkers() ; i++)
+		group.run(worker);
+
+	worker();
+
+	group.wait();
+}
+
+
+bool RejectBuilder::build(TaskPool &pool, double time_limit, const std::atomic<bool> *cancelled)
+{
+	visible.assign((size_t)num_sectors * num_sectors, 0);
+
+	computeMightSee(pool);
+
+	auto deadline = std::chrono::steady_clock::now() +
+		std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+			std::chrono::duration<double>(time_limit));
+
+	std::atomic<int> next_sector(0);
+	std::atomic<int> unfinished(0);
+
+	auto worker = [&]()
+	{
+		Flow flow(*this, deadline, cancelled);
+
+		for (;;)
+		{
+			int sec = next_sector++;
+
+			if (sec >= num_sectors)
+				break;
+
+			unsigned char *row = &visible[(size_t)sec * num_sectors];
+
+			bool out_of_time = (cancelled && *cancelled) ||
+				std::chrono::steady_clock::now() > deadline;
+
+			if (out_of_time || ! flow.Run(sec, row))
+			{
+				// give up on this sector, it might see anything
+				std::fill(row, row + num_sectors, 1);
+				unfinished++;
+			}
+		}
+	};
+
+	TaskGroup group(pool);
+
+	for (int i = 0 ; i < pool.numWorkers() ; i++)
+		group.run(worker);
+
+	worker();
+
+	group.wait();
+
+	num_unfinished = unfinished;
+
+	return num_unfinished == 0;
+}
+
+
+bool RejectBuilder::canSee(int sec1, int sec2) const
+{
+	// sight works both ways, and each direction was computed separately
+	// (with somewhat different approximations).
+	return visible[(size_t)sec1 * num_sectors + sec2] ||
+		   visible[(size_t)sec2 * num_sectors + sec1];
+}
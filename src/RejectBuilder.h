@@ -0,0 +1,101 @@
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#ifndef REJECTBUILDER_H_
+#define REJECTBUILDER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+class TaskPool;
+
+//
+// Works out which sectors may be able to see each other, for building
+// a REJECT lump with line-of-sight information.
+//
+// Sight can only pass from one sector into another through two-sided
+// lines (the "portals").  Starting at each portal of a sector, we flood
+// through the portals which a straight line could pass through, keeping
+// track of which part of each portal may be seen, and in which
+// directions.
+//
+// The result is conservative: heights are ignored (a door may open) and
+// the visible part of a portal is over-estimated, so two sectors are
+// only considered hidden from each other when no sight line can exist.
+//
+class RejectBuilder
+{
+public:
+	explicit RejectBuilder(int num_sectors);
+
+	// adds a two-sided line.  'front' is the sector on its right side.
+	void addPortal(double x1, double y1, double x2, double y2, int front, int back);
+
+	// computes the visibility of all sectors, using the given pool.
+	// returns false if it gave up because 'time_limit' seconds passed
+	// or 'cancelled' became set, in which case each sector which was not
+	// finished is considered to see every other sector.
+	bool build(TaskPool &pool, double time_limit, const std::atomic<bool> *cancelled = nullptr);
+
+	bool canSee(int sec1, int sec2) const;
+
+	int numUnfinished() const
+	{
+		return num_unfinished;
+	}
+
+private:
+	class Flow;
+
+	void computeMightSee(TaskPool &pool);
+
+	// a two-sided line, seen from one of its sides
+	struct Portal
+	{
+		double x1, y1;
+		double x2, y2;
+
+		// unit normal, pointing into the 'to' sector
+		double nx, ny;
+
+		int line;
+		int from, to;
+	};
+
+	int num_sectors;
+	int num_lines = 0;
+
+	std::vector<Portal> portals;
+
+	// the portals leading out of each sector
+	std::vector<std::vector<int>> sector_portals;
+
+	// for each portal, a bit set of the sectors which are reachable
+	// through portals in front of it.  nothing else can be seen
+	// through that portal.
+	std::vector<uint64_t> might_see;
+	int set_words = 0;
+
+	// [source * num_sectors + target] is non-zero when visible
+	std::vector<unsigned char> visible;
+
+	int num_unfinished = 0;
+};
+
+#endif /* REJECTBUILDER_H_ */
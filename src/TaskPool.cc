@@ -0,0 +1,250 @@
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#include "TaskPool.h"
+
+#include <algorithm>
+
+// which pool (and queue of it) the current thread is a worker of
+static thread_local TaskPool *tls_pool  = nullptr;
+static thread_local int       tls_queue = 0;
+
+
+TaskPool::TaskPool(int num_workers)
+{
+	num_workers = std::max(0, num_workers);
+
+	for (int i = 0 ; i <= num_workers ; i++)
+		queues.push_back(std::make_unique<Queue>());
+
+	for (int i = 1 ; i <= num_workers ; i++)
+		workers.emplace_back(&TaskPool::workerLoop, this, i);
+}
+
+
+TaskPool::~TaskPool()
+{
+	stopping = true;
+	wakeUp();
+
+	for (std::thread &thread : workers)
+		thread.join();
+}
+
+
+static int global_threads = 0;
+
+TaskPool &TaskPool::global()
+{
+	static TaskPool pool((global_threads > 0 ? global_threads :
+						  (int)std::thread::hardware_concurrency()) - 1);
+
+	return pool;
+}
+
+
+void TaskPool::setGlobalThreads(int num_threads)
+{
+	global_threads = num_threads;
+}
+
+
+void TaskPool::wakeUp()
+{
+	// taking the lock here means a thread which has just checked its
+	// wake-up condition cannot miss this notification.
+	{
+		std::lock_guard<std::mutex> lock(sleep_mutex);
+	}
+
+	sleep_cond.notify_all();
+}
+
+
+void TaskPool::push(Task &&task)
+{
+	Queue &queue = *queues[(tls_pool == this) ? tls_queue : 0];
+
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.tasks.push_back(std::move(task));
+	}
+
+	num_queued++;
+	wakeUp();
+}
+
+
+bool TaskPool::popTask(Task &task)
+{
+	if (num_queued == 0)
+		return false;
+
+	int own   = (tls_pool == this) ? tls_queue : 0;
+	int count = (int)queues.size();
+
+	// a worker prefers the newest task of its own queue
+	if (own > 0)
+	{
+		Queue &queue = *queues[own];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+
+		if (! queue.tasks.empty())
+		{
+			task = std::move(queue.tasks.back());
+			queue.tasks.pop_back();
+
+			num_queued--;
+			return true;
+		}
+	}
+
+	// otherwise take the oldest task of another queue
+	for (int k = 0 ; k < count ; k++)
+	{
+		int index = (own + k) % count;
+
+		if (index == own && own > 0)
+			continue;
+
+		Queue &queue = *queues[index];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+
+		if (! queue.tasks.empty())
+		{
+			task = std::move(queue.tasks.front());
+			queue.tasks.pop_front();
+
+			num_queued--;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+bool TaskPool::runOne()
+{
+	Task task;
+
+	if (! popTask(task))
+		return false;
+
+	std::exception_ptr error;
+
+	try
+	{
+		task.func();
+	}
+	catch (...)
+	{
+		error = std::current_exception();
+	}
+
+	task.group->finished(error);
+	return true;
+}
+
+
+void TaskPool::workerLoop(int index)
+{
+	tls_pool  = this;
+	tls_queue = index;
+
+	for (;;)
+	{
+		if (runOne())
+			continue;
+
+		std::unique_lock<std::mutex> lock(sleep_mutex);
+
+		sleep_cond.wait(lock, [this]() { return stopping || num_queued > 0; });
+
+		if (stopping && num_queued == 0)
+			return;
+	}
+}
+
+
+//------------------------------------------------------------------------
+
+TaskGroup::~TaskGroup()
+{
+	waitAll();
+}
+
+
+void TaskGroup::run(std::function<void()> func)
+{
+	pending++;
+
+	pool.push(TaskPool::Task{ std::move(func), this });
+}
+
+
+void TaskGroup::waitAll()
+{
+	while (pending > 0)
+	{
+		// help out while waiting, this may run tasks of other groups
+		if (pool.runOne())
+			continue;
+
+		std::unique_lock<std::mutex> lock(pool.sleep_mutex);
+
+		pool.sleep_cond.wait(lock, [this]()
+		{
+			return pending == 0 || pool.num_queued > 0;
+		});
+	}
+}
+
+
+void TaskGroup::wait()
+{
+	waitAll();
+
+	std::exception_ptr error;
+
+	{
+		std::lock_guard<std::mutex> lock(error_mutex);
+		std::swap(error, first_error);
+	}
+
+	if (error)
+		std::rethrow_exception(error);
+}
+
+
+void TaskGroup::finished(std::exception_ptr error)
+{
+	if (error)
+	{
+		std::lock_guard<std::mutex> lock(error_mutex);
+
+		if (! first_error)
+			first_error = error;
+	}
+
+	// the group may be destroyed as soon as 'pending' reaches zero
+	TaskPool &the_pool = pool;
+
+	if (--pending == 0)
+		the_pool.wakeUp();
+}
@@ -0,0 +1,138 @@
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#ifndef TASKPOOL_H_
+#define TASKPOOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class TaskGroup;
+
+//
+// A pool of worker threads for fork/join style parallelism.
+//
+// Every worker has its own queue: tasks added by a worker go to the
+// back of its queue and are taken from there again (newest first),
+// while idle workers steal the oldest task of another queue.  Tasks
+// added by other threads go into a shared queue.
+//
+class TaskPool
+{
+	friend class TaskGroup;
+
+public:
+	explicit TaskPool(int num_workers);
+	~TaskPool();
+
+	// the pool shared by the whole program.  It has one worker less
+	// than the number of cores, since the waiting thread helps out.
+	static TaskPool &global();
+
+	// limits the threads of the global pool (including the waiting
+	// thread), which only works before it is first used.
+	static void setGlobalThreads(int num_threads);
+
+	int numWorkers() const
+	{
+		return (int)workers.size();
+	}
+
+private:
+	struct Task
+	{
+		std::function<void()> func;
+		TaskGroup *group;
+	};
+
+	struct Queue
+	{
+		std::mutex mutex;
+		std::deque<Task> tasks;
+	};
+
+	void push(Task &&task);
+
+	// runs a single queued task, returns false if there was none
+	bool runOne();
+
+	bool popTask(Task &task);
+
+	void workerLoop(int index);
+
+	// a task has finished or was added
+	void wakeUp();
+
+	std::vector<std::thread> workers;
+
+	// [0] is the shared queue, [1..] are the queues of the workers
+	std::vector<std::unique_ptr<Queue>> queues;
+
+	std::atomic<int> num_queued{ 0 };
+	std::atomic<bool> stopping{ false };
+
+	std::mutex sleep_mutex;
+	std::condition_variable sleep_cond;
+};
+
+
+//
+// A set of tasks which can be waited for.  A task may itself create
+// a TaskGroup and wait for it, since waiting runs other queued tasks
+// instead of blocking.
+//
+class TaskGroup
+{
+	friend class TaskPool;
+
+public:
+	explicit TaskGroup(TaskPool &_pool = TaskPool::global()) : pool(_pool)
+	{
+	}
+
+	// waits for any unfinished tasks (but ignores their errors)
+	~TaskGroup();
+
+	void run(std::function<void()> func);
+
+	// waits until all the tasks have finished.  If any of them threw
+	// an exception, the first one is re-thrown here.
+	void wait();
+
+private:
+	// runs queued tasks until our own ones are done
+	void waitAll();
+
+	void finished(std::exception_ptr error);
+
+	TaskPool &pool;
+
+	std::atomic<int> pending{ 0 };
+
+	std::mutex error_mutex;
+	std::exception_ptr first_error;
+};
+
+#endif /* TASKPOOL_H_ */
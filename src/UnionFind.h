@@ -0,0 +1,105 @@
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#ifndef UNIONFIND_H_
+#define UNIONFIND_H_
+
+#include <utility>
+#include <vector>
+
+//
+// Keeps track of which objects (numbered 0 to N-1) are connected to
+// each other, e.g. sectors joined by two-sided linedefs.  Joining two
+// groups and finding the group of an object take nearly constant time,
+// thanks to union by size and path compression.
+//
+class UnionFind
+{
+public:
+	explicit UnionFind(int count) : parent(count), size(count, 1), num_groups(count)
+	{
+		for (int i = 0 ; i < count ; i++)
+			parent[i] = i;
+	}
+
+	int count() const
+	{
+		return (int)parent.size();
+	}
+
+	int numGroups() const
+	{
+		return num_groups;
+	}
+
+	//
+	// Returns the representative of the object's group.  It stays the
+	// same until the group gets merged with another one.
+	//
+	int find(int x)
+	{
+		while (parent[x] != x)
+		{
+			// path halving
+			parent[x] = parent[parent[x]];
+			x = parent[x];
+		}
+		return x;
+	}
+
+	//
+	// Joins the groups of both objects.  Returns false if they were
+	// already in the same group.
+	//
+	bool merge(int a, int b)
+	{
+		a = find(a);
+		b = find(b);
+
+		if (a == b)
+			return false;
+
+		if (size[a] < size[b])
+			std::swap(a, b);
+
+		parent[b] = a;
+		size[a] += size[b];
+
+		num_groups--;
+		return true;
+	}
+
+	bool connected(int a, int b)
+	{
+		return find(a) == find(b);
+	}
+
+	// the number of objects in the object's group
+	int groupSize(int x)
+	{
+		return size[find(x)];
+	}
+
+private:
+	std::vector<int> parent;
+	std::vector<int> size;
+
+	int num_groups;
+};
+
+#endif /* UNIONFIND_H_ */
@@ -23,9 +23,11 @@
 #include "im_img.h"
 #include "m_strings.h"
 #include "sys_type.h"
+#include "w_wad.h"
 
 #include <map>
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
 class Img_c;
@@ -164,6 +166,16 @@ public:
 
 	Lump_c *W_FindGlobalLump(const SString &name) const;
 	Lump_c *W_FindSpriteLump(const SString &name) const;
+private:
+	Lump_c *FindLump(const SString &name, WadNamespace ns) const;
+
+	// the lumps of all the loaded wads, where the later wads override
+	// the earlier ones.  It is made again whenever the list of wads or
+	// any of their directories has changed.
+	void UpdateIndex() const;
+
+	mutable std::unordered_map<LumpKey, Lump_c *, LumpKeyHash> index;
+	mutable std::vector<std::pair<const Wad_file *, uint64_t>> indexed_wads;
 public:	// TODO: make private
 	// the current PWAD, or NULL for none.
 	// when present it is also at master_dir.back()
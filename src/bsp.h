@@ -21,9 +21,16 @@
 #ifndef __EUREKA_BSP_H__
 #define __EUREKA_BSP_H__
 
+#include "Arena.h"
 #include "lib_util.h"
+#include "m_strings.h"
+#include "NodeCache.h"
 #include "sys_type.h"
 
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <memory>
 #include <vector>
 
 class Instance;
@@ -32,6 +39,38 @@ struct Sector;
 enum class Side;
 struct Document;
 
+// the instructions used for working out the cost of a partition.
+// all of them give exactly the same results.
+enum eval_kernel_e
+{
+	EVAL_Scalar = 0,
+	EVAL_SSE2,
+	EVAL_AVX2
+};
+
+// the fastest kind which this CPU supports
+eval_kernel_e BestEvalKernel();
+
+
+// what to aim for when several ways of building the nodes are tried,
+// keeping the best result.
+enum build_goal_e
+{
+	// just build once, with the options given
+	GOAL_None = 0,
+
+	// the fewest segs (the SEGS lump, then the GL segs too)
+	GOAL_FewestSegs,
+
+	// the least deep BSP tree
+	GOAL_Shallowest,
+
+	// staying within the limits of the original DOOM engine, then
+	// the fewest segs
+	GOAL_Vanilla
+};
+
+
 // Node Build Information Structure
 //
 // Memory note: when changing the string values here (and in
@@ -51,19 +90,44 @@ struct nodebuildinfo_t
 	bool do_blockmap = true;
 	bool do_reject = true;
 
+	// use line-of-sight for the REJECT lump, giving up after the
+	// time limit (in seconds) and keeping the simple one.
+	bool los_reject = false;
+	int  reject_time = 30;
+
 	bool fast = false;
 	bool warnings = false;
 
+	// add a little to the cost of partition lines which are neither
+	// horizontal nor vertical, which decides between near-equal ones.
+	bool axis_bias = true;
+
+	// with a goal, BuildAllNodes tries several strategies at once and
+	// keeps the best.  Each strategy (apart from the one using the
+	// options here) is given up after the time limit, in seconds.
+	build_goal_e goal = GOAL_None;
+	int strategy_time = 60;
+
 	bool force_v5 = false;
 	bool force_xnod = false;
 	bool force_compress = false;
 
+	// for zlib, from 1 (fastest) to 9 (smallest)
+	int compress_level = 6;
+
+	eval_kernel_e kernel = BestEvalKernel();
+
+	// how many levels BuildAllNodes() builds at once, 0 for one per
+	// core.
+	int jobs = 0;
+
 	// the GUI can set this to tell the node builder to stop
-	bool cancelled = false;
+	std::atomic<bool> cancelled{ false };
 
-	// from here on, various bits of internal state
-	int total_failed_maps = 0;
-	int total_warnings = 0;
+	// from here on, various bits of internal state.
+	// these are atomic since several levels may be built at once.
+	std::atomic<int> total_failed_maps{ 0 };
+	std::atomic<int> total_warnings{ 0 };
 };
 
 
@@ -83,24 +147,124 @@ enum build_result_e
 };
 
 
-build_result_e AJBSP_BuildLevel(nodebuildinfo_t *info, int lev_idx, const Instance &inst);
+//
+// The partition lines of the last build of a level.  Building the
+// level again reuses each one which can still be found, hence only
+// the areas around the changes need to be partitioned again.
+//
+struct nodebuildcache_t
+{
+	struct partition_t
+	{
+		// the seg used as the partition line
+		int linedef;
+		double x1, y1;
+		double x2, y2;
+
+		// the partitions of the right and left halves, or -1 when
+		// that half became a subsector.
+		int right, left;
+	};
+
+	// the root node is the first one (unless this is empty)
+	std::vector<partition_t> partitions;
+
+	// the level and options the tree was built with
+	SString level_name;
+	int  factor = 0;
+	bool fast = false;
+	bool axis_bias = true;
+};
 
 
-//======================================================================
 //
-//    INTERNAL STUFF FROM HERE ON
+// Statistics about building the nodes of one level: where the time
+// went, and how close the result is to the limits of the original
+// DOOM engine.  Times are in seconds.
 //
-//======================================================================
+struct nodebuildstats_t
+{
+	SString level_name;
 
-namespace ajbsp
+	double time_segs     = 0;	// creating the initial segs
+	double time_tree     = 0;	// building the BSP tree
+	double time_blockmap = 0;
+	double time_reject   = 0;
+	double time_write    = 0;	// writing all the other lumps
+
+	// the part of 'time_tree' spent choosing partitions.  Parts of the
+	// tree are built in parallel, hence this can be more than that.
+	double time_picknode = 0;
+
+	long long partitions_evaluated = 0;
+
+	int seg_splits = 0;
+	int height = 0;
+
+	// the memory used by the node building structures, which is only
+	// freed at the end, hence this is also the peak.
+	size_t peak_memory = 0;
+
+	int vertices = 0;
+	int segs     = 0;	// not counting minisegs
+	int subsecs  = 0;
+	int nodes    = 0;
+	int sectors  = 0;
+	int sidedefs = 0;
+	int linedefs = 0;
+
+	// in bytes.  It is still set when the blockmap overflowed.
+	int blockmap_size = 0;
+
+	struct limit_t
+	{
+		const char *name;
+		int count;
+		int limit;
+	};
+
+	// the counts above, each with the limit of the original engine.
+	std::vector<limit_t> VanillaLimits() const;
+};
+
+
+//
+// The options of one way to build the nodes, when several are tried.
+//
+struct nodebuildstrategy_t
 {
+	const char *name;
+
+	int  factor;
+	bool fast;
+	bool axis_bias;
+};
+
+// the strategies to try for the goal of 'info'.  The first one always
+// uses the options of 'info' itself.
+std::vector<nodebuildstrategy_t> AJBSP_Strategies(const nodebuildinfo_t *info);
+
+// creates the options for a strategy, otherwise the same as 'info'.
+std::unique_ptr<nodebuildinfo_t> AJBSP_StrategyInfo(const nodebuildinfo_t *info,
+													const nodebuildstrategy_t &strategy);
 
 
-// internal storage of node building parameters
+// when 'cache' is given, the partitions stored there are reused and
+// are then replaced by the new ones.  When 'stats' is given, it gets
+// the statistics of the build.
+build_result_e AJBSP_BuildLevel(nodebuildinfo_t *info, int lev_idx, const Instance &inst,
+								nodebuildcache_t *cache = nullptr,
+								nodebuildstats_t *stats = nullptr);
 
-extern nodebuildinfo_t * cur_info;
 
+//======================================================================
+//
+//    INTERNAL STUFF FROM HERE ON
+//
+//======================================================================
 
+namespace ajbsp
+{
 
 /* ----- basic types --------------------------- */
 
@@ -122,9 +286,6 @@ typedef double angle_g;  // degrees, 0 is E, 90 is N
 
 void PrintDetail(const char *fmt, ...);
 
-void Failure(const Instance &inst, EUR_FORMAT_STRING(const char *fmt), ...) EUR_PRINTF(2, 3);
-void Warning(const Instance &inst, EUR_FORMAT_STRING(const char *fmt), ...) EUR_PRINTF(2, 3);
-
 // allocate and clear some memory.  guaranteed not to fail.
 void *UtilCalloc(int size);
 
@@ -152,11 +313,16 @@ void Adler32_Finish(u32_t *crc);
 //------------------------------------------------------------------------
 
 // utility routines...
-void GetBlockmapBounds(int *x, int *y, int *w, int *h);
-
 int CheckLinedefInsideBox(int xmin, int ymin, int xmax, int ymax,
     int x1, int y1, int x2, int y2);
 
+// a line touching a block, while the blockmap is being built
+struct blockref_t
+{
+	int block;
+	int line;
+};
+
 
 //------------------------------------------------------------------------
 // LEVEL : Level structures & read/write functions.
@@ -165,6 +331,9 @@ int CheckLinedefInsideBox(int xmin, int ymin, int xmax, int ymax,
 struct node_t;
 
 class quadtree_c;
+class LevelBuilder;
+
+struct subtree_t;
 
 
 // a wall-tip is where a wall meets a vertex
@@ -257,6 +426,17 @@ struct seg_t
 	// this only used by ClockwiseOrder()
 	angle_g cmp_angle;
 
+	// these are only used when building subtrees in parallel (see
+	// subtree_t).  'owner' is the subtree which the seg belongs to, or
+	// NULL for the level itself.  'lent' is set while a copy of this
+	// seg is used by another subtree, and 'replaced_by' points to that
+	// copy once it has taken over.  'pending' is set on the new half
+	// of a partner whose split has been postponed.
+	subtree_t *owner;
+	subtree_t *lent;
+	struct seg_t *replaced_by;
+	bool pending;
+
 public:
 	// compute the seg private info (psx/y, pex/y, pdx/y, etc).
 	void Recompute();
@@ -303,9 +483,9 @@ struct subsec_t
 public:
 	void DetermineMiddle();
 	void ClockwiseOrder(const Document &doc);
-	void RenumberSegs();
+	void RenumberSegs(int &next_index);
 
-	void RoundOff();
+	void RoundOff(LevelBuilder &builder);
 	void Normalise();
 
 	void SanityCheckClosed();
@@ -348,8 +528,46 @@ struct node_t
 	// created.
 	int index;
 
+	// the seg which was used as the partition, kept for the cache
+	int part_line;
+	double part_x1, part_y1;
+	double part_x2, part_y2;
+
 public:
-	void SetPartition(const seg_t *part, const Instance &inst);
+	void SetPartition(const seg_t *part, LevelBuilder &builder);
+};
+
+
+//
+// The segs of a whole quadtree, with the fields which are needed for
+// every seg when evaluating a partition laid out as separate arrays,
+// so that several segs can be handled at once.  The segs of each block
+// are next to each other, and the blocks are in the same order as the
+// evaluation visits them.
+//
+struct seg_block_t
+{
+	int count = 0;
+
+	std::vector<double> sx, sy;
+	std::vector<double> ex, ey;
+
+	std::vector<int> source_line;
+	std::vector<int> linedef;
+
+	std::vector<seg_t *> segs;
+
+	// appends the segs of the list, returns the index of the first one.
+	int Add(seg_t *list);
+
+	// computes the perpendicular distances of the start and end of the
+	// segs [first, first+num) from the partition line, multiplied by
+	// its length (i.e. PerpDist() without the division).  Bit k of
+	// 'right' and 'left' is set when both ends of seg first+k are at
+	// least 'margin' (also multiplied) away on that side.
+	void Distances(eval_kernel_e kernel, const seg_t *part, int first, int num,
+				   double margin, double *a, double *b,
+				   unsigned *right, unsigned *left) const;
 };
 
 
@@ -374,6 +592,15 @@ public:
 	// list of segs contained in this node itself.
 	seg_t *list;
 
+	// where the same segs (in the same order) are in the arrays of the
+	// whole tree.  Only valid after Flatten().
+	const seg_block_t *block;
+	int block_first;
+	int block_count;
+
+	// the arrays, only in the root node.
+	seg_block_t *arrays;
+
 public:
 	quadtree_c(int _x1, int _y1, int _x2, int _y2);
 	~quadtree_c();
@@ -388,6 +615,10 @@ public:
 
 	void ConvertToList(seg_t **list);
 
+	// fills in the arrays of the whole tree, once all the segs have
+	// been added.  Only called for the root node.
+	void Flatten();
+
 	// check relationship between this box and the partition line.
 	// returns SIDE_LEFT or SIDE_RIGHT if box is definitively on a
 	// particular side, or 0 if the line intersects/touches the box.
@@ -396,38 +627,6 @@ public:
 };
 
 
-/* ----- Level data arrays ----------------------- */
-
-extern std::vector<vertex_t *>  lev_vertices;
-extern std::vector<seg_t *>     lev_segs;
-extern std::vector<subsec_t *>  lev_subsecs;
-extern std::vector<node_t *>    lev_nodes;
-extern std::vector<walltip_t *> lev_walltips;
-
-#define num_vertices  ((int)lev_vertices.size())
-#define num_segs      ((int)lev_segs.size())
-#define num_subsecs   ((int)lev_subsecs.size())
-#define num_nodes     ((int)lev_nodes.size())
-#define num_walltips  ((int)lev_walltips.size())
-
-extern int num_old_vert;
-extern int num_new_vert;
-
-
-/* ----- function prototypes ----------------------- */
-
-// allocation routines
-vertex_t  *NewVertex();
-seg_t     *NewSeg();
-subsec_t  *NewSubsec();
-node_t    *NewNode();
-walltip_t *NewWallTip();
-
-// Zlib compression support
-void ZLibBeginLump(Lump_c *lump);
-void ZLibAppendLump(const void *data, int length);
-void ZLibFinishLump(void);
-
 /* limit flags, to show what went wrong */
 #define LIMIT_VERTEXES     0x000001
 #define LIMIT_SECTORS      0x000002
@@ -450,24 +649,7 @@ void ZLibFinishLump(void);
 
 
 // detection routines
-void DetectOverlappingVertices(const Document &doc);
 void DetectOverlappingLines(const Document &doc);
-void DetectPolyobjSectors(const Instance &inst);
-
-// computes the wall tips for all of the vertices
-void CalculateWallTips(const Document &doc);
-
-// return a new vertex (with correct wall-tip info) for the split that
-// happens along the given seg at the given location.
-//
-vertex_t *NewVertexFromSplitSeg(seg_t *seg, double x, double y, const Document &doc);
-
-// return a new end vertex to compensate for a seg that would end up
-// being zero-length (after integer rounding).  Doesn't compute the
-// wall-tip info (thus this routine should only be used _after_ node
-// building).
-//
-vertex_t *NewVertexDegenerate(vertex_t *start, vertex_t *end);
 
 // check whether a line with the given delta coordinates from this
 // vertex is open or closed.  If there exists a walltip at same
@@ -520,97 +702,513 @@ struct intersection_t
 };
 
 
-/* -------- functions ---------------------------- */
+// a split of a partner seg which belongs to another subtree.  It is
+// done later, when the subtrees are joined together.
+struct partner_split_t
+{
+	seg_t *partner;
+	seg_t *new_seg;
+	vertex_t *vert;
+};
+
 
-// scan all the segs in the list, and choose the best seg to use as a
-// partition line, returning it.  If no seg can be used, returns NULL.
-// The 'depth' parameter is the current depth in the tree, used for
-// computing the current progress.
 //
-seg_t *PickNode(quadtree_c *tree, int depth, const bbox_t *bbox);
+// The right half of a node, built on the task pool while the current
+// thread builds the left half.  It works on copies of the segs, and
+// everything it creates is kept here until it is joined, which adds
+// it all to the level in the same order as a serial build would.
+//
+// Splitting a seg also splits its partner, which may be in the other
+// half.  Such splits of the right half are postponed until the join,
+// whereas when the left half splits a lent seg, the subtree becomes
+// 'stale' and is built again afterwards.
+//
+struct subtree_t
+{
+	std::vector<vertex_t *>  vertices;
+	std::vector<seg_t *>     segs;
+	std::vector<subsec_t *>  subsecs;
+	std::vector<node_t *>    nodes;
+	std::vector<walltip_t *> walltips;
 
-// compute the boundary of the list of segs
-void FindLimits2(seg_t *list, bbox_t *bbox);
+	// everything above (and the intersections) is allocated here
+	Arena arena;
 
-// take the given seg 'cur', compare it with the partition line, and
-// determine it's fate: moving it into either the left or right lists
-// (perhaps both, when splitting it in two).  Handles partners as
-// well.  Updates the intersection list if the seg lies on or crosses
-// the partition line.
-//
-void DivideOneSeg(seg_t *cur, seg_t *part,
-    quadtree_c *left_quad, quadtree_c *right_quad,
-    intersection_t ** cut_list);
+	intersection_t *quick_alloc_cuts = NULL;
 
-// remove all the segs from the list, partitioning them into the left
-// or right lists based on the given partition line.  Adds any
-// intersections into the intersection list as it goes.
-//
-void SeparateSegs(quadtree_c *tree, seg_t *part,
-    quadtree_c *left_quad, quadtree_c *right_quad,
-    intersection_t ** cut_list);
+	std::vector<SString> messages;
+	int num_warnings = 0;
 
-// analyse the intersection list, and add any needed minisegs to the
-// given seg lists (one miniseg on each side).  All the intersection
-// structures will be freed back into a quick-alloc list.
-//
-void AddMinisegs(seg_t *part,
-    quadtree_c *left_quad, quadtree_c *right_list,
-    intersection_t *cut_list);
+	// the segs which were lent, and their copies (in the same order)
+	std::vector<seg_t *> lent;
+	std::vector<seg_t *> copies;
+
+	// copies whose partner is outside of this subtree
+	std::vector<seg_t *> outer_copies;
+
+	std::vector<partner_split_t> partner_splits;
 
-// free the quick allocation cut list
-void FreeQuickAllocCuts(void);
+	bool stale = false;
+
+	// result of building it
+	build_result_e result = BUILD_OK;
+	std::exception_ptr error;
+
+	node_t   *node   = NULL;
+	subsec_t *subsec = NULL;
+	bbox_t    bounds;
+};
+
+
+// compute the boundary of the list of segs
+void FindLimits2(seg_t *list, bbox_t *bbox);
+
+// compute the height of the bsp tree, starting at 'node'.
+int ComputeBspHeight(node_t *node);
 
 
 //------------------------------------------------------------------------
-// NODE : Recursively create nodes and return the pointers.
+// BUILDER : Building the nodes of a single level
 //------------------------------------------------------------------------
 
+struct eval_info_t;
 
 
-// scan all the linedef of the level and convert each sidedef into a
-// seg (or seg pair).  Returns the list of segs.
-//
-seg_t *CreateSegs(const Instance &inst);
+// a summary of a BSP tree, for choosing between the trees built by
+// several strategies.
+struct tree_stats_t
+{
+	// segs which are not minisegs, i.e. those in the SEGS lump
+	int real_segs = 0;
+	int all_segs  = 0;
 
-quadtree_c *TreeFromSegList(seg_t *list);
+	int nodes    = 0;
+	int subsecs  = 0;
+	int vertices = 0;
 
-// takes the seg list and determines if it is convex.  When it is, the
-// segs are converted to a subsector, and '*S' is the new subsector
-// (and '*N' is set to NULL).  Otherwise the seg list is divided into
-// two halves, a node is created by calling this routine recursively,
-// and '*N' is the new node (and '*S' is set to NULL).  Normally
-// returns BUILD_OK, or BUILD_Cancelled if user stopped it.
-//
-build_result_e BuildNodes(seg_t *list, bbox_t *bounds /* output */,
-    node_t ** N, subsec_t ** S, int depth, const Instance &inst);
+	int height = 0;
 
-// compute the height of the bsp tree, starting at 'node'.
-int ComputeBspHeight(node_t *node);
+	// whether the original DOOM engine can handle it
+	bool vanilla = true;
+};
+
+// returns true if tree A suits the goal better than tree B.
+bool BetterTree(const tree_stats_t &A, const tree_stats_t &B, build_goal_e goal);
 
-// put all the segs in each subsector into clockwise order, and renumber
-// the seg indices.
 //
-// [ This cannot be done DURING BuildNodes() since splitting a seg with
-//   a partner will insert another seg into that partner's list, usually
-//   in the wrong place order-wise. ]
+// Holds everything needed while building the nodes of one level.
+// Nothing here is shared with other builders (apart from the
+// nodebuildinfo_t), hence several levels can be built at the same
+// time, as long as each one was loaded into its own Instance.
 //
-void ClockwiseBspTree(const Document &doc);
+class LevelBuilder
+{
+public:
+	LevelBuilder(nodebuildinfo_t *info, int lev_idx, const Instance &inst);
+	~LevelBuilder();
 
-// traverse the BSP tree and do whatever is necessary to convert the
-// node information from GL standard to normal standard (for example,
-// removing minisegs).
-//
-void NormaliseBspTree();
+	// analyse the level and create the BSP tree.  The edit wad is not
+	// touched here, so this may run on a worker thread.
+	build_result_e Build();
+
+	// write all the lumps into the edit wad.  Must only be called from
+	// the main thread, and after Build() has returned BUILD_OK.
+	build_result_e Save();
+
+	// when set, messages are remembered instead of being shown, and
+	// FlushMessages() passes them on to the GUI and the log file.
+	bool defer_messages = false;
+
+	void FlushMessages();
+
+	// when set, partitions are taken from this cache where possible,
+	// and it is updated after a successful build.
+	nodebuildcache_t *cache = NULL;
+
+	// how many partitions came from the cache, and how many had to be
+	// searched for (including the failed searches of subsectors).
+	std::atomic<int> partitions_reused{ 0 };
+	std::atomic<int> partitions_searched{ 0 };
+
+	// for the statistics, these are counted by all the threads.
+	std::atomic<long long> partitions_evaluated{ 0 };
+	std::atomic<long long> picknode_nanos{ 0 };
+	std::atomic<int> seg_splits{ 0 };
+
+	// filled in by Build() and Save().
+	nodebuildstats_t stats;
+
+	// a hash of everything which Build() and Save() depend on, which
+	// names the entry of this level in the NodeCache.  This must be
+	// called before Build().
+	SString CacheKey() const;
+
+	// the lumps written by Save(), to be stored in the NodeCache.
+	std::vector<NodeCache::Lump> CollectLumps();
+
+	// writes lumps from the NodeCache into the edit wad, which takes
+	// the place of Build() and Save().  Must only be called from the
+	// main thread.
+	build_result_e SaveCached(const std::vector<NodeCache::Lump> &lumps);
+
+	// a summary of the tree made by Build().
+	tree_stats_t TreeStats() const;
+
+	// the tree made by Build().  When the whole level is a single
+	// subsector, there is no root node.
+	const node_t *RootNode() const
+	{
+		return root_node;
+	}
+
+	const subsec_t *RootSubsec() const
+	{
+		return root_sub;
+	}
+
+	// a rough estimate of how far Build() has got, from 0 to 100.
+	// this may be called from any thread.
+	int Progress() const;
+
+	// the level may have moved within the wad since it was loaded
+	// (e.g. by sorting the levels), this looks it up by name again.
+	// returns false when it is gone.
+	bool RelocateLevel();
+
+	void PrintMsg(EUR_FORMAT_STRING(const char *fmt), ...) EUR_PRINTF(2, 3);
+
+	void Failure(EUR_FORMAT_STRING(const char *fmt), ...) EUR_PRINTF(2, 3);
+	void Warning(EUR_FORMAT_STRING(const char *fmt), ...) EUR_PRINTF(2, 3);
+
+	// allocation routines
+	vertex_t  *NewVertex();
+	seg_t     *NewSeg();
+	subsec_t  *NewSubsec();
+	node_t    *NewNode();
+	walltip_t *NewWallTip();
+
+	// return a new end vertex to compensate for a seg that would end up
+	// being zero-length (after integer rounding).  Doesn't compute the
+	// wall-tip info (thus this routine should only be used _after_ node
+	// building).
+	//
+	vertex_t *NewVertexDegenerate(vertex_t *start, vertex_t *end);
+
+	// internal storage of node building parameters
+	nodebuildinfo_t *cur_info;
+
+	const Instance &inst;
+
+	/* ----- Level data arrays ----------------------- */
+
+	std::vector<vertex_t *>  lev_vertices;
+	std::vector<seg_t *>     lev_segs;
+	std::vector<subsec_t *>  lev_subsecs;
+	std::vector<node_t *>    lev_nodes;
+	std::vector<walltip_t *> lev_walltips;
+
+	// the above structures live in here, and are freed all at once
+	// when the builder is destroyed.
+	Arena arena;
+
+	int num_old_vert = 0;
+	int num_new_vert = 0;
+
+private:
+	// ANALYZE
+	void MarkPolyobjPoint(double x, double y);
+	void DetectPolyobjSectors();
+	void DetectOverlappingVertices(const Document &doc);
+	void VertexAddWallTip(vertex_t *vert, double dx, double dy,
+						  int open_left, int open_right);
+	void CalculateWallTips(const Document &doc);
+
+	// return a new vertex (with correct wall-tip info) for the split that
+	// happens along the given seg at the given location.
+	//
+	vertex_t *NewVertexFromSplitSeg(seg_t *seg, double x, double y, const Document &doc);
+
+	// SEG
+	intersection_t *NewIntersection();
+	seg_t *SplitSeg(seg_t *old_seg, double x, double y, const Document &doc);
+	void AddIntersection(intersection_t ** cut_list,
+						 vertex_t *vert, seg_t *part, bool self_ref);
+	int EvalPartitionWorker(quadtree_c *tree, seg_t *part,
+							int best_cost, eval_info_t *info, const Document &doc);
+	int EvalPartition(quadtree_c *tree, seg_t *part, int best_cost, const Document &doc);
+	seg_t *FindFastSeg(quadtree_c *tree, const Document &doc);
+	bool PickNodeWorker(quadtree_c *part_list,
+						quadtree_c *tree, seg_t ** best, int *best_cost, const Document &doc);
+	bool PickNodeParallel(quadtree_c *tree, seg_t ** best,
+						  int *best_cost, const Document &doc);
+
+	// scan all the segs in the list, and choose the best seg to use as a
+	// partition line, returning it.  If no seg can be used, returns NULL.
+	// The 'depth' parameter is the current depth in the tree, used for
+	// computing the current progress.
+	//
+	seg_t *PickNode(quadtree_c *tree, int depth, const Document &doc);
+
+	// take the given seg 'cur', compare it with the partition line, and
+	// determine it's fate: moving it into either the left or right lists
+	// (perhaps both, when splitting it in two).  Handles partners as
+	// well.  Updates the intersection list if the seg lies on or crosses
+	// the partition line.
+	//
+	void DivideOneSeg(seg_t *seg, seg_t *part,
+					  seg_t **left_list, seg_t **right_list,
+					  intersection_t ** cut_list, const Document &doc);
+
+	// remove all the segs from the list, partitioning them into the left
+	// or right lists based on the given partition line.  Adds any
+	// intersections into the intersection list as it goes.
+	//
+	void SeparateSegs(quadtree_c *tree, seg_t *part,
+					  seg_t **left_list, seg_t **right_list,
+					  intersection_t ** cut_list, const Document &doc);
+
+	// analyse the intersection list, and add any needed minisegs to the
+	// given seg lists (one miniseg on each side).  All the intersection
+	// structures will be freed back into a quick-alloc list.
+	//
+	void AddMinisegs(intersection_t *cut_list, seg_t *part,
+					 seg_t **left_list, seg_t **right_list);
+
+	// NODE
+	seg_t *CreateOneSeg(int line, vertex_t *start, vertex_t *end,
+						int sidedef, int what_side /* 0 or 1 */);
+
+	// scan all the linedef of the level and convert each sidedef into a
+	// seg (or seg pair).  Returns the list of segs.
+	//
+	seg_t *CreateSegs();
+
+	subsec_t *CreateSubsector(quadtree_c *tree);
+
+	// takes the seg list and determines if it is convex.  When it is, the
+	// segs are converted to a subsector, and '*S' is the new subsector
+	// (and '*N' is set to NULL).  Otherwise the seg list is divided into
+	// two halves, a node is created by calling this routine recursively,
+	// and '*N' is the new node (and '*S' is set to NULL).  Normally
+	// returns BUILD_OK, or BUILD_Cancelled if user stopped it.
+	//
+	// 'cached' is the partition of the cache to try first, or -1.
+	//
+	build_result_e BuildNodes(seg_t *list, bbox_t *bounds /* output */,
+							  node_t ** N, subsec_t ** S, int depth, int cached);
+
+	// CACHE
+	// find the seg for a partition of the cache, returns NULL if there
+	// is no such seg or it cannot be used anymore.
+	seg_t *FindCachedPartition(quadtree_c *tree, int cached);
 
-// traverse the BSP tree, doing whatever is necessary to round
-// vertices to integer coordinates (for example, removing segs whose
-// rounded coordinates degenerate to the same point).
+	void StoreCache();
+
+	// SUBTREES
+	// the subtree being built by the current thread, or NULL when
+	// building directly into the level.
+	static thread_local subtree_t *cur_subtree;
+
+	intersection_t *& QuickAllocCuts();
+
+	// split the partner of a seg, or remember to do it later if the
+	// partner belongs to another subtree.
+	void SplitPartner(seg_t *partner, seg_t *new_seg, vertex_t *new_vert);
+
+	// build both halves of a node, the right one on the task pool.
+	build_result_e BuildSidesInParallel(node_t *node, seg_t *lefts,
+										seg_t *rights, int depth,
+										int cached_left, int cached_right);
+
+	seg_t *LendSegs(seg_t *list, subtree_t &sub);
+	void JoinSubtree(subtree_t &sub);
+	void DiscardSubtree(subtree_t &sub, seg_t *lent_list);
+
+	// free the segs which were replaced by their copies.
+	void RemoveReplacedSegs();
+
+	// put all the segs in each subsector into clockwise order, and renumber
+	// the seg indices.
+	//
+	// [ This cannot be done DURING BuildNodes() since splitting a seg with
+	//   a partner will insert another seg into that partner's list, usually
+	//   in the wrong place order-wise. ]
+	//
+	void ClockwiseBspTree(const Document &doc);
+
+	// traverse the BSP tree and do whatever is necessary to convert the
+	// node information from GL standard to normal standard (for example,
+	// removing minisegs).
+	//
+	void NormaliseBspTree();
+
+	// traverse the BSP tree, doing whatever is necessary to round
+	// vertices to integer coordinates (for example, removing segs whose
+	// rounded coordinates degenerate to the same point).
+	//
+	void RoundOffVertices();
+	void RoundOffBspTree();
+
+	// BLOCKMAP
+	void BlockAddLine(int line_index, const Document &doc, int first_row, int last_row,
+					  std::vector<blockref_t> &refs) const;
+	void CreateBlockmap(const Document &doc);
+	bool SameBlockLists(int blk_num1, int blk_num2) const;
+	void CompressBlockmap();
+	void WriteBlockmap();
+	void FreeBlockmap();
+	void FindBlockmapLimits(bbox_t *bbox, const Document &doc);
+	void InitBlockmap(const Document &doc);
+	void PutBlockmap();
+
+	// REJECT
+	void Reject_Init(const Document &doc);
+	void Reject_Free();
+	void Reject_GroupSectors(const Document &doc);
+	void Reject_ProcessSectors(const Document &doc);
+	void Reject_LineOfSight(const Document &doc);
+	void Reject_WriteLump();
+	void PutReject();
+
+	// LEVEL
+	Arena &CurrentArena();
+
+	void GetVertices(const Document &doc);
+	void MarkOverflow(int flags);
+
+	void PutVertices(const char *name, int do_gl);
+	void PutGLVertices(int do_v5);
+	u32_t VertexIndex_XNOD(const vertex_t *v) const;
+	void PutSegs();
+	void PutGLSegs();
+	void PutGLSegs_V5();
+	void PutSubsecs(const char *name, int do_gl);
+	void PutGLSubsecs_V5();
+	void PutOneNode(node_t *node, Lump_c *lump);
+	void PutOneNode_V5(node_t *node, Lump_c *lump);
+	void PutNodes(const char *name, int do_v5, node_t *root);
+	void CheckLimits(bool& force_v5, bool& force_xnod);
+	void SortSegs();
+
+	void PutZVertices();
+	void PutZSubsecs();
+	void PutZSegs();
+	void PutXGL3Segs();
+	void PutOneZNode(node_t *node, bool do_xgl3);
+	void PutZNodes(node_t *root, bool do_xgl3);
+	void SaveZDFormat(node_t *root_node);
+	void SaveXGL3Format(node_t *root_node);
+
+	void LoadLevel();
+	void FreeLevel();
+	u32_t CalcGLChecksum();
+	SString CalcOptionsString() const;
+	void UpdateGLMarker(Lump_c *marker);
+	void AddMissingLump(const char *name, const char *after);
+	build_result_e SaveLevel(node_t *root_node);
+	build_result_e SaveUDMF(node_t *root_node);
+
+	// Zlib compression support
+	void ZLibBeginLump(Lump_c *lump, bool compress);
+	void ZLibAppendLump(const void *data, int length);
+	void ZLibFinishLump();
+
+	Lump_c *FindLevelLump(const char *name);
+	Lump_c *CreateLevelLump(const char *name);
+	Lump_c *CreateGLMarker();
+
+	std::vector<SString> messages;
+
+	// result of Build()
+	build_result_e build_result = BUILD_OK;
+
+	// for Progress(): the number of real segs at the start, and how
+	// many have ended up in a subsector so far.
+	std::atomic<int> segs_total{ 0 };
+	std::atomic<int> segs_finished{ 0 };
+
+	// memory of the subtrees which were thrown away
+	std::atomic<size_t> arena_discarded{ 0 };
+
+	node_t   *root_node = NULL;
+	subsec_t *root_sub  = NULL;
+	bbox_t    root_bbox;
+
+	// per-level variables
+	SString lev_current_name;
+
+	int lev_current_idx;
+
+	int lev_overflows = 0;
+
+	int num_real_lines = 0;
+
+	// used while renumbering segs
+	int current_seg_index = 0;
+
+	// used while writing the nodes
+	int node_cur_index = 0;
+
+	intersection_t *quick_alloc_cuts = NULL;
+
+	// blockmap
+	int block_x = 0, block_y = 0;
+	int block_w = 0, block_h = 0;
+	int block_count = 0;
+
+	int block_mid_x = 0;
+	int block_mid_y = 0;
+
+	// the lines of each block, one block after another.  The lines of
+	// block N start at block_lines[block_start[N]], and end where the
+	// next block starts.
+	std::vector<int> block_start;
+	std::vector<int> block_lines;
+	std::vector<u32_t> block_hashes;
+
+	// the offset (in words) of the list used by each block, and the
+	// blocks whose lists are written, in that order.
+	std::vector<int> block_ptrs;
+	std::vector<int> block_order;
+
+	int block_compression = 0;
+	int block_overflowed = 0;
+
+	// reject
+	u8_t *rej_matrix = NULL;
+	int   rej_total_size = 0;	// in bytes
+
+	std::vector<int> rej_sector_groups;
+
+	// zlib output
+	Lump_c *zout_lump = NULL;
+	bool zout_compress = false;
+
+	// the whole lump is built here, then compressed in one go
+	std::vector<u8_t> zout_data;
+};
+
+
+//
+// Runs Build() of each builder on its own thread, and returns the index
+// of the one whose tree suits the goal best (the earliest one when it
+// is a tie), or -1 if none of them succeeded.  Each builder must have
+// its own nodebuildinfo_t, and each one apart from the first is
+// cancelled once 'time_limit' seconds have passed.  All of them are
+// cancelled when 'cancelled' becomes set.
+//
+// An exception thrown by the first builder is re-thrown, whereas the
+// other builders just count as having failed.
 //
-void RoundOffBspTree();
+int BuildStrategies(const std::vector<LevelBuilder *> &builders, build_goal_e goal,
+					int time_limit, const std::atomic<bool> &cancelled);
 
-// free all the superblocks on the quick-alloc list
-void FreeQuickAllocSupers(void);
+
+#define num_vertices  ((int)lev_vertices.size())
+#define num_segs      ((int)lev_segs.size())
+#define num_subsecs   ((int)lev_subsecs.size())
+#define num_nodes     ((int)lev_nodes.size())
+#define num_walltips  ((int)lev_walltips.size())
 
 }  // namespace ajbsp
 
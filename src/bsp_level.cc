@@ -23,13 +23,23 @@
 #include "LineDef.h"
 #include "main.h"
 #include "bsp.h"
+#include "ParallelDeflate.h"
+#include "RejectBuilder.h"
 #include "SideDef.h"
+#include "TaskPool.h"
+#include "Thing.h"
+#include "UnionFind.h"
 #include "Vertex.h"
 
 #include "w_rawdef.h"
 #include "w_wad.h"
 
-#include <zlib.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <tuple>
 
 
 namespace ajbsp
@@ -41,30 +51,13 @@ namespace ajbsp
 #define DEBUG_BSP       0
 
 
-static int block_x, block_y;
-static int block_w, block_h;
-static int block_count;
-
-static int block_mid_x = 0;
-static int block_mid_y = 0;
-
-static u16_t ** block_lines;
-
-static u16_t *block_ptrs;
-static u16_t *block_dups;
-
-static int block_compression;
-static int block_overflowed;
-
 #define BLOCK_LIMIT  16000
 
-#define DUMMY_DUP  0xFFFF
-
 
-void GetBlockmapBounds(int *x, int *y, int *w, int *h)
+// for the statistics
+static double SecondsSince(std::chrono::steady_clock::time_point start)
 {
-	*x = block_x; *y = block_y;
-	*w = block_w; *h = block_h;
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
 }
 
 
@@ -141,50 +134,18 @@ int CheckLinedefInsideBox(int xmin, int ymin, int xmax, int ymax,
 
 /* ----- create blockmap ------------------------------------ */
 
-#define BK_NUM    0
-#define BK_MAX    1
-#define BK_XOR    2
-#define BK_FIRST  3
-
-#define BK_QUANTUM  32
-
-static void BlockAdd(int blk_num, int line_index)
-{
-	u16_t *cur = block_lines[blk_num];
-
-# if DEBUG_BLOCKMAP
-	gLog.debugPrintf("Block %d has line %d\n", blk_num, line_index);
-# endif
+// blockmaps with fewer blocks than this are built by a single thread
+#define BLOCK_PARALLEL_MIN  4096
 
-	if (blk_num < 0 || blk_num >= block_count)
-		BugError("BlockAdd: bad block number %d\n", blk_num);
+// the fewest rows in each band of blocks which a thread works on
+#define BLOCK_BAND_ROWS  8
 
-	if (! cur)
-	{
-		// create empty block
-		block_lines[blk_num] = cur = (u16_t *)UtilCalloc(BK_QUANTUM * sizeof(u16_t));
-		cur[BK_NUM] = 0;
-		cur[BK_MAX] = BK_QUANTUM;
-		cur[BK_XOR] = 0x1234;
-	}
-
-	if (BK_FIRST + cur[BK_NUM] == cur[BK_MAX])
-	{
-		// no more room, so allocate some more...
-		cur[BK_MAX] += BK_QUANTUM;
-
-		block_lines[blk_num] = cur = (u16_t *)UtilRealloc(cur, cur[BK_MAX] * sizeof(u16_t));
-	}
-
-	// compute new checksum
-	cur[BK_XOR] = static_cast<u16_t>(((cur[BK_XOR] << 4) | (cur[BK_XOR] >> 12)) ^ line_index);
-
-	cur[BK_FIRST + cur[BK_NUM]] = LE_U16(line_index);
-	cur[BK_NUM]++;
-}
-
-
-static void BlockAddLine(int line_index, const Document &doc)
+//
+// Finds the blocks which a linedef touches, only looking at the rows
+// from first_row to last_row (inclusive).
+//
+void LevelBuilder::BlockAddLine(int line_index, const Document &doc, int first_row, int last_row,
+								std::vector<blockref_t> &refs) const
 {
 	const LineDef *L = doc.linedefs[line_index];
 
@@ -211,16 +172,21 @@ static void BlockAddLine(int line_index, const Document &doc)
 	if (bx2 >= block_w) bx2 = block_w - 1;
 	if (by2 >= block_h) by2 = block_h - 1;
 
+	// the rows outside the band belong to other threads
+	bool horizontal = (by1 == by2);
+
+	if (by1 < first_row) by1 = first_row;
+	if (by2 > last_row)  by2 = last_row;
+
 	if (bx2 < bx1 || by2 < by1)
 		return;
 
 	// handle simple case #1: completely horizontal
-	if (by1 == by2)
+	if (horizontal)
 	{
 		for (bx=bx1 ; bx <= bx2 ; bx++)
 		{
-			int blk_num = by1 * block_w + bx;
-			BlockAdd(blk_num, line_index);
+			refs.push_back({ by1 * block_w + bx, line_index });
 		}
 		return;
 	}
@@ -230,8 +196,7 @@ static void BlockAddLine(int line_index, const Document &doc)
 	{
 		for (by=by1 ; by <= by2 ; by++)
 		{
-			int blk_num = by * block_w + bx1;
-			BlockAdd(blk_num, line_index);
+			refs.push_back({ by * block_w + bx1, line_index });
 		}
 		return;
 	}
@@ -241,8 +206,6 @@ static void BlockAddLine(int line_index, const Document &doc)
 	for (by=by1 ; by <= by2 ; by++)
 	for (bx=bx1 ; bx <= bx2 ; bx++)
 	{
-		int blk_num = by * block_w + bx;
-
 		int minx = block_x + bx * 128;
 		int miny = block_y + by * 128;
 		int maxx = minx + 127;
@@ -250,130 +213,197 @@ static void BlockAddLine(int line_index, const Document &doc)
 
 		if (CheckLinedefInsideBox(minx, miny, maxx, maxy, x1, y1, x2, y2))
 		{
-			BlockAdd(blk_num, line_index);
+			refs.push_back({ by * block_w + bx, line_index });
 		}
 	}
 }
 
 
-static void CreateBlockmap(const Document &doc)
+void LevelBuilder::CreateBlockmap(const Document &doc)
 {
-	block_lines = (u16_t **) UtilCalloc(block_count * sizeof(u16_t *));
+	// the rows of blocks are split into bands, and each band is done
+	// by its own thread.  The lines are visited in order, hence the
+	// lines of each block are always in order too.
+	int num_bands = 1;
 
-	for (int i=0 ; i < doc.numLinedefs() ; i++)
+	if (block_count >= BLOCK_PARALLEL_MIN)
 	{
-		// ignore zero-length lines
-		if (doc.linedefs[i]->IsZeroLength(doc))
-			continue;
+		int threads = TaskPool::global().numWorkers() + 1;
 
-		BlockAddLine(i, doc);
+		num_bands = clamp(1, block_h / BLOCK_BAND_ROWS, threads * 4);
 	}
-}
 
+	std::vector<std::vector<blockref_t>> band_refs(num_bands);
 
-static int BlockCompare(const void *p1, const void *p2)
-{
-	int blk_num1 = ((const u16_t *) p1)[0];
-	int blk_num2 = ((const u16_t *) p2)[0];
+	block_start.assign(block_count + 1, 0);
+	block_hashes.assign(block_count, 0);
 
-	const u16_t *A = block_lines[blk_num1];
-	const u16_t *B = block_lines[blk_num2];
+	auto band_rows = [this, num_bands](int band, int &first_row, int &last_row)
+	{
+		first_row = block_h * band / num_bands;
+		last_row  = block_h * (band + 1) / num_bands - 1;
+	};
 
-	if (A == B)
-		return 0;
+	// first pass: find the lines in each block, and count them
+	auto find_lines = [this, &doc, &band_refs, &band_rows](int band)
+	{
+		int first_row, last_row;
+		band_rows(band, first_row, last_row);
+
+		std::vector<blockref_t> &refs = band_refs[band];
+
+		for (int i=0 ; i < doc.numLinedefs() ; i++)
+		{
+			// ignore zero-length lines
+			if (doc.linedefs[i]->IsZeroLength(doc))
+				continue;
 
-	if (A == NULL) return -1;
-	if (B == NULL) return +1;
+			BlockAddLine(i, doc, first_row, last_row, refs);
+		}
+
+		// each band only touches the counts of its own blocks
+		for (const blockref_t &ref : refs)
+			block_start[ref.block + 1]++;
+	};
 
-	if (A[BK_NUM] != B[BK_NUM])
+	// second pass: put the lines of each block together (a counting
+	// sort, which keeps them in order), and hash each list.
+	auto gather_lines = [this, &band_refs, &band_rows](int band)
 	{
-		return A[BK_NUM] - B[BK_NUM];
-	}
+		int first_row, last_row;
+		band_rows(band, first_row, last_row);
+
+		int first_block = first_row * block_w;
+		int end_block   = (last_row + 1) * block_w;
 
-	if (A[BK_XOR] != B[BK_XOR])
+		std::vector<int> next(block_start.begin() + first_block, block_start.begin() + end_block);
+
+		for (const blockref_t &ref : band_refs[band])
+			block_lines[next[ref.block - first_block]++] = ref.line;
+
+		band_refs[band].clear();
+		band_refs[band].shrink_to_fit();
+
+		for (int blk_num = first_block ; blk_num < end_block ; blk_num++)
+		{
+			// FNV-1a
+			u32_t hash = 2166136261u;
+
+			for (int k = block_start[blk_num] ; k < block_start[blk_num + 1] ; k++)
+				hash = (hash ^ (u32_t)block_lines[k]) * 16777619u;
+
+			block_hashes[blk_num] = hash;
+		}
+	};
+
+	auto run_bands = [num_bands](const std::function<void(int)> &func)
 	{
-		return A[BK_XOR] - B[BK_XOR];
-	}
+		if (num_bands == 1)
+		{
+			func(0);
+			return;
+		}
+
+		TaskGroup group(TaskPool::global());
 
-	return memcmp(A+BK_FIRST, B+BK_FIRST, A[BK_NUM] * sizeof(u16_t));
+		for (int band = 0 ; band < num_bands ; band++)
+			group.run([&func, band]() { func(band); });
+
+		group.wait();
+	};
+
+	run_bands(find_lines);
+
+	for (int blk_num = 0 ; blk_num < block_count ; blk_num++)
+		block_start[blk_num + 1] += block_start[blk_num];
+
+	block_lines.resize(block_start[block_count]);
+
+	run_bands(gather_lines);
 }
 
 
-static void CompressBlockmap(void)
+bool LevelBuilder::SameBlockLists(int blk_num1, int blk_num2) const
 {
-	int i;
-	int cur_offset;
-	int dup_count=0;
+	int len1 = block_start[blk_num1 + 1] - block_start[blk_num1];
+	int len2 = block_start[blk_num2 + 1] - block_start[blk_num2];
 
-	int orig_size, new_size;
+	if (len1 != len2 || block_hashes[blk_num1] != block_hashes[blk_num2])
+		return false;
 
-	block_ptrs = (u16_t *)UtilCalloc(block_count * sizeof(u16_t));
-	block_dups = (u16_t *)UtilCalloc(block_count * sizeof(u16_t));
+	return std::equal(block_lines.begin() + block_start[blk_num1],
+					  block_lines.begin() + block_start[blk_num1 + 1],
+					  block_lines.begin() + block_start[blk_num2]);
+}
+
+
+void LevelBuilder::CompressBlockmap()
+{
+	int dup_count=0;
+
+	block_ptrs.assign(block_count, 0);
+	block_order.clear();
 
-	// sort duplicate-detecting array.  After the sort, all duplicates
-	// will be next to each other.  The duplicate array gives the order
-	// of the blocklists in the BLOCKMAP lump.
+	// all the empty blocks share the list after the pointers
+	int null_offset = 4 + block_count;
 
-	for (i=0 ; i < block_count ; i++)
-		block_dups[i] = static_cast<u16_t>(i);
+	int cur_offset = null_offset + 2;
 
-	qsort(block_dups, block_count, sizeof(u16_t), BlockCompare);
+	int orig_size = 4 + block_count;
+	int new_size  = cur_offset;
 
-	// scan duplicate array and build up offset array
+	// duplicate lists are found with a hash table (open addressing),
+	// which holds the first block with each list.
+	size_t table_size = 64;
 
-	cur_offset = 4 + block_count + 2;
+	while (table_size < (size_t)block_count * 2)
+		table_size *= 2;
 
-	orig_size = 4 + block_count;
-	new_size  = cur_offset;
+	std::vector<int> table(table_size, -1);
 
-	for (i=0 ; i < block_count ; i++)
+	for (int blk_num = 0 ; blk_num < block_count ; blk_num++)
 	{
-		int blk_num = block_dups[i];
-		int count;
+		int count = block_start[blk_num + 1] - block_start[blk_num];
 
 		// empty block ?
-		if (block_lines[blk_num] == NULL)
+		if (count == 0)
 		{
-			block_ptrs[blk_num] = static_cast<u16_t>(4 + block_count);
-			block_dups[i] = DUMMY_DUP;
+			block_ptrs[blk_num] = null_offset;
 
 			orig_size += 2;
 			continue;
 		}
 
-		count = 2 + block_lines[blk_num][BK_NUM];
-
-		// duplicate ?  Only the very last one of a sequence of duplicates
-		// will update the current offset value.
+		count += 2;
+		orig_size += count;
 
-		if (i+1 < block_count &&
-				BlockCompare(block_dups + i, block_dups + i+1) == 0)
-		{
-			block_ptrs[blk_num] = static_cast<u16_t>(cur_offset);
-			block_dups[i] = DUMMY_DUP;
+		size_t slot = block_hashes[blk_num] & (table_size - 1);
 
-			// free the memory of the duplicated block
-			UtilFree(block_lines[blk_num]);
-			block_lines[blk_num] = NULL;
+		while (table[slot] >= 0 && ! SameBlockLists(table[slot], blk_num))
+			slot = (slot + 1) & (table_size - 1);
 
+		// duplicate ?
+		if (table[slot] >= 0)
+		{
+			block_ptrs[blk_num] = block_ptrs[table[slot]];
 			dup_count++;
-
-			orig_size += count;
 			continue;
 		}
 
-		// OK, this block is either the last of a series of duplicates, or
-		// just a singleton.
+		table[slot] = blk_num;
 
-		block_ptrs[blk_num] = static_cast<u16_t>(cur_offset);
+		block_ptrs[blk_num] = cur_offset;
+		block_order.push_back(blk_num);
 
 		cur_offset += count;
-
-		orig_size += count;
-		new_size  += count;
+		new_size   += count;
 	}
 
-	if (cur_offset > 65535)
+	stats.blockmap_size = cur_offset * 2;
+
+	// the offsets are 16 bits, and line numbers must not be 0xFFFF
+	// (the end of a list).
+	if (cur_offset > 65535 || inst.level.numLinedefs() > 65535)
 	{
 		block_overflowed = true;
 		return;
@@ -391,17 +421,9 @@ static void CompressBlockmap(void)
 		block_compression = 0;
 }
 
-static Lump_c *CreateLevelLump(const Instance &inst, const char *name);
-
-static void WriteBlockmap(const Instance &inst)
+void LevelBuilder::WriteBlockmap()
 {
-	int i;
-
-	Lump_c *lump = CreateLevelLump(inst, "BLOCKMAP");
-
-	u16_t null_block[2] = { 0x0000, 0xFFFF };
-	u16_t m_zero = 0x0000;
-	u16_t m_neg1 = 0xFFFF;
+	Lump_c *lump = CreateLevelLump("BLOCKMAP");
 
 	// fill in header
 	raw_blockmap_header_t header;
@@ -413,54 +435,59 @@ static void WriteBlockmap(const Instance &inst)
 
 	lump->Write(&header, sizeof(header));
 
+	// the rest is put together first, then written in one go
+	std::vector<u16_t> data;
+
+	data.reserve(stats.blockmap_size / 2);
+
 	// handle pointers
-	for (i=0 ; i < block_count ; i++)
+	for (int i=0 ; i < block_count ; i++)
 	{
-		u16_t ptr = LE_U16(block_ptrs[i]);
-
-		if (ptr == 0)
+		if (block_ptrs[i] == 0)
 			BugError("WriteBlockmap: offset %d not set.\n", i);
 
-		lump->Write(&ptr, sizeof(u16_t));
+		data.push_back(LE_U16(block_ptrs[i]));
 	}
 
 	// add the null block which *all* empty blocks will use
-	lump->Write(null_block, sizeof(null_block));
+	data.push_back(0x0000);
+	data.push_back(0xFFFF);
 
-	// handle each block list
-	for (i=0 ; i < block_count ; i++)
+	// handle each block list, the duplicates are not written
+	for (int blk_num : block_order)
 	{
-		int blk_num = block_dups[i];
+		data.push_back(0x0000);
 
-		// ignore duplicate or empty blocks
-		if (blk_num == DUMMY_DUP)
-			continue;
+		for (int k = block_start[blk_num] ; k < block_start[blk_num + 1] ; k++)
+			data.push_back(LE_U16(block_lines[k]));
 
-		u16_t *blk = block_lines[blk_num];
-		SYS_ASSERT(blk);
-
-		lump->Write(&m_zero, sizeof(u16_t));
-		lump->Write(blk + BK_FIRST, blk[BK_NUM] * sizeof(u16_t));
-		lump->Write(&m_neg1, sizeof(u16_t));
+		data.push_back(0xFFFF);
 	}
+
+	lump->Write(data.data(), (int)(data.size() * sizeof(u16_t)));
 }
 
 
-static void FreeBlockmap(void)
+void LevelBuilder::FreeBlockmap()
 {
-	for (int i=0 ; i < block_count ; i++)
-	{
-		if (block_lines[i])
-			UtilFree(block_lines[i]);
-	}
+	block_start.clear();
+	block_start.shrink_to_fit();
+
+	block_lines.clear();
+	block_lines.shrink_to_fit();
+
+	block_hashes.clear();
+	block_hashes.shrink_to_fit();
 
-	UtilFree(block_lines);
-	UtilFree(block_ptrs);
-	UtilFree(block_dups);
+	block_ptrs.clear();
+	block_ptrs.shrink_to_fit();
+
+	block_order.clear();
+	block_order.shrink_to_fit();
 }
 
 
-static void FindBlockmapLimits(bbox_t *bbox, const Document &doc)
+void LevelBuilder::FindBlockmapLimits(bbox_t *bbox, const Document &doc)
 {
 	int mid_x = 0;
 	int mid_y = 0;
@@ -510,7 +537,7 @@ static void FindBlockmapLimits(bbox_t *bbox, const Document &doc)
 // compute blockmap origin & size (the block_x/y/w/h variables)
 // based on the set of loaded linedefs.
 //
-static void InitBlockmap(const Document &doc)
+void LevelBuilder::InitBlockmap(const Document &doc)
 {
 	bbox_t map_bbox;
 
@@ -532,12 +559,12 @@ static void InitBlockmap(const Document &doc)
 //
 // build the blockmap and write the data into the BLOCKMAP lump
 //
-static void PutBlockmap(const Instance &inst)
+void LevelBuilder::PutBlockmap()
 {
 	if (! cur_info->do_blockmap || inst.level.numLinedefs() == 0)
 	{
 		// just create an empty blockmap lump
-		CreateLevelLump(inst, "BLOCKMAP");
+		CreateLevelLump("BLOCKMAP");
 		return;
 	}
 
@@ -548,9 +575,9 @@ static void PutBlockmap(const Instance &inst)
 
 	CreateBlockmap(inst.level);
 
-	// -AJA- second phase: compress the blockmap.  We do this by sorting
-	//       the blocks, which is a typical way to detect duplicates in
-	//       a large list.  This also detects BLOCKMAP overflow.
+	// -AJA- second phase: compress the blockmap.  Blocks with the same
+	//       list of lines share it, the duplicates are found by hashing
+	//       the lists.  This also detects BLOCKMAP overflow.
 
 	CompressBlockmap();
 
@@ -559,13 +586,15 @@ static void PutBlockmap(const Instance &inst)
 	if (block_overflowed)
 	{
 		// leave an empty blockmap lump
-		CreateLevelLump(inst, "BLOCKMAP");
+		CreateLevelLump("BLOCKMAP");
 
-		Warning(inst, "Blockmap overflowed (lump will be empty)\n");
+		// ports which handle such big maps build their own blockmap
+		// when the lump is empty.
+		Warning("Blockmap overflowed (lump will be empty)\n");
 	}
 	else
 	{
-		WriteBlockmap(inst);
+		WriteBlockmap();
 
 		PrintDetail("Completed blockmap, size %dx%d (compression: %d%%)\n",
 				block_w, block_h, block_compression);
@@ -580,16 +609,10 @@ static void PutBlockmap(const Instance &inst)
 //------------------------------------------------------------------------
 
 
-static u8_t *rej_matrix;
-static int   rej_total_size;	// in bytes
-
-static std::vector<int> rej_sector_groups;
-
-
 //
 // Allocate the matrix, init sectors into individual groups.
 //
-static void Reject_Init(const Document &doc)
+void LevelBuilder::Reject_Init(const Document &doc)
 {
 	rej_total_size = (doc.numSectors() * doc.numSectors() + 7) / 8;
 
@@ -605,7 +628,7 @@ static void Reject_Init(const Document &doc)
 }
 
 
-static void Reject_Free()
+void LevelBuilder::Reject_Free()
 {
 	delete[] rej_matrix;
 	rej_matrix = NULL;
@@ -619,34 +642,15 @@ static void Reject_Free()
 // Now we scan the linedef list.  For each two-sectored line,
 // merge the two sector groups into one.  That's it!
 //
-static void Reject_GroupSectors(const Document &doc)
+void LevelBuilder::Reject_GroupSectors(const Document &doc)
 {
-	for(const LineDef *L : doc.linedefs)
-	{
-		if (L->right < 0 || L->left < 0)
-			continue;
-
-		int sec1 = L->Right(doc)->sector;
-		int sec2 = L->Left(doc) ->sector;
+	UnionFind groups(doc.numSectors());
 
-		if (sec1 < 0 || sec2 < 0 || sec1 == sec2)
-			continue;
-
-		// already in the same group ?
-		int group1 = rej_sector_groups[sec1];
-		int group2 = rej_sector_groups[sec2];
-
-		if (group1 == group2)
-			continue;
+	doc.secmod.groupConnectedSectors(groups);
 
-		// prefer the group numbers to become lower
-		if (group1 > group2)
-			std::swap(group1, group2);
-
-		// merge the groups
-		for (int s = 0 ; s < doc.numSectors() ; s++)
-			if (rej_sector_groups[s] == group2)
-				rej_sector_groups[s] =  group1;
+	for (int i=0 ; i < doc.numSectors() ; i++)
+	{
+		rej_sector_groups[i] = groups.find(i);
 	}
 }
 
@@ -679,29 +683,127 @@ static void Reject_DebugGroups()
 #endif
 
 
-static void Reject_ProcessSectors(const Document &doc)
+//
+// Every sector rejects all sectors outside of its group, so the rows
+// of the matrix for the members of a group are all the same.  Build
+// that row once per group and copy it into place a byte at a time.
+//
+void LevelBuilder::Reject_ProcessSectors(const Document &doc)
+{
+	int num_sectors = doc.numSectors();
+
+	// list the members of each group
+	std::vector<std::vector<int>> members(num_sectors);
+
+	for (int i=0 ; i < num_sectors ; i++)
+		members[rej_sector_groups[i]].push_back(i);
+
+	std::vector<u8_t> row((num_sectors + 7) / 8);
+
+	for (const std::vector<int> &group : members)
+	{
+		if (group.empty())
+			continue;
+
+		// a single group means nothing to reject
+		if ((int)group.size() == num_sectors)
+			break;
+
+		std::fill(row.begin(), row.end(), 0xFF);
+
+		// clear the unused bits at the end of the row
+		if (num_sectors & 7)
+			row.back() = (u8_t)((1 << (num_sectors & 7)) - 1);
+
+		for (int target : group)
+			row[target >> 3] &= ~(1 << (target & 7));
+
+		for (int view : group)
+		{
+			int pos   = view * num_sectors;
+			int shift = pos & 7;
+
+			u8_t *dest = rej_matrix + (pos >> 3);
+
+			if (shift == 0)
+			{
+				for (size_t k = 0 ; k < row.size() ; k++)
+					dest[k] |= row[k];
+
+				continue;
+			}
+
+			// rows are not byte aligned, spread each byte over two
+			for (size_t k = 0 ; k < row.size() ; k++)
+			{
+				dest[k] |= (u8_t)(row[k] << shift);
+
+				u8_t spill = (u8_t)(row[k] >> (8 - shift));
+
+				if (spill)
+					dest[k + 1] |= spill;
+			}
+		}
+	}
+}
+
+
+//
+// Sectors of a group can still be hidden from each other, this finds
+// those pairs by following the lines of sight through two-sided lines.
+//
+void LevelBuilder::Reject_LineOfSight(const Document &doc)
 {
+	RejectBuilder builder(doc.numSectors());
+
+	for (const LineDef *L : doc.linedefs)
+	{
+		if (L->right < 0 || L->left < 0)
+			continue;
+
+		builder.addPortal(L->Start(doc)->x(), L->Start(doc)->y(),
+						  L->End(doc)->x(),   L->End(doc)->y(),
+						  L->Right(doc)->sector, L->Left(doc)->sector);
+	}
+
+	if (! builder.build(TaskPool::global(), cur_info->reject_time, &cur_info->cancelled))
+	{
+		if (cur_info->cancelled)
+			return;
+
+		Warning("Line-of-sight reject ran out of time (%d sectors unfinished)\n",
+				builder.numUnfinished());
+	}
+
+	int num_hidden = 0;
+
 	for (int view=0 ; view < doc.numSectors() ; view++)
 	{
 		for (int target=0 ; target < view ; target++)
 		{
-			if (rej_sector_groups[view] == rej_sector_groups[target])
+			if (rej_sector_groups[view] != rej_sector_groups[target])
+				continue;
+
+			if (builder.canSee(view, target))
 				continue;
 
 			int p1 = view * doc.numSectors() + target;
 			int p2 = target * doc.numSectors() + view;
 
-			// must do both directions at same time
 			rej_matrix[p1 >> 3] |= (1 << (p1 & 7));
 			rej_matrix[p2 >> 3] |= (1 << (p2 & 7));
+
+			num_hidden++;
 		}
 	}
+
+	PrintDetail("Line-of-sight reject: %d pairs of sectors hidden\n", num_hidden);
 }
 
 
-static void Reject_WriteLump(const Instance &inst)
+void LevelBuilder::Reject_WriteLump()
 {
-	Lump_c *lump = CreateLevelLump(inst, "REJECT");
+	Lump_c *lump = CreateLevelLump("REJECT");
 
 	lump->Write(rej_matrix, rej_total_size);
 }
@@ -710,16 +812,17 @@ static void Reject_WriteLump(const Instance &inst)
 //
 // build the reject table and write it into the REJECT lump
 //
-// For now we only do very basic reject processing, limited to
-// determining all isolated groups of sectors (islands that are
-// surrounded by void space).
+// The basic reject processing is limited to determining all isolated
+// groups of sectors (islands that are surrounded by void space).  The
+// optional line-of-sight processing also rejects sectors of the same
+// group which are hidden from each other.
 //
-static void PutReject(const Instance &inst)
+void LevelBuilder::PutReject()
 {
 	if (! cur_info->do_reject || inst.level.numSectors() == 0)
 	{
 		// just create an empty reject lump
-		CreateLevelLump(inst, "REJECT");
+		CreateLevelLump("REJECT");
 		return;
 	}
 
@@ -727,14 +830,20 @@ static void PutReject(const Instance &inst)
 	Reject_GroupSectors(inst.level);
 	Reject_ProcessSectors(inst.level);
 
+	if (cur_info->los_reject)
+		Reject_LineOfSight(inst.level);
+
 # if DEBUG_REJECT
 	Reject_DebugGroups();
 # endif
 
-	Reject_WriteLump(inst);
+	Reject_WriteLump();
 	Reject_Free();
 
-	PrintDetail("Added simple reject lump\n");
+	if (cur_info->los_reject)
+		PrintDetail("Added line-of-sight reject lump\n");
+	else
+		PrintDetail("Added simple reject lump\n");
 }
 
 
@@ -749,111 +858,53 @@ static void PutReject(const Instance &inst)
 #define ALLOC_BLKNUM  1024
 
 
-// per-level variables
-
-static SString lev_current_name;
-
-int lev_current_idx;
-int lev_current_start;
-
-int lev_overflows;
-
-
-std::vector<vertex_t *>  lev_vertices;
-std::vector<seg_t *>     lev_segs;
-std::vector<subsec_t *>  lev_subsecs;
-std::vector<node_t *>    lev_nodes;
-std::vector<walltip_t *> lev_walltips;
-
-int num_old_vert = 0;
-int num_new_vert = 0;
-int num_real_lines = 0;
-
-
 /* ----- allocation routines ---------------------------- */
 
-vertex_t *NewVertex()
+Arena &LevelBuilder::CurrentArena()
+{
+	return cur_subtree ? cur_subtree->arena : arena;
+}
+
+vertex_t *LevelBuilder::NewVertex()
 {
-	vertex_t *V = (vertex_t *) UtilCalloc(sizeof(vertex_t));
-	lev_vertices.push_back(V);
+	vertex_t *V = CurrentArena().alloc<vertex_t>();
+	(cur_subtree ? cur_subtree->vertices : lev_vertices).push_back(V);
 	return V;
 }
 
-seg_t *NewSeg()
+seg_t *LevelBuilder::NewSeg()
 {
-	seg_t *S = (seg_t *) UtilCalloc(sizeof(seg_t));
-	lev_segs.push_back(S);
+	seg_t *S = CurrentArena().alloc<seg_t>();
+	S->owner = cur_subtree;
+	(cur_subtree ? cur_subtree->segs : lev_segs).push_back(S);
 	return S;
 }
 
-subsec_t *NewSubsec()
+subsec_t *LevelBuilder::NewSubsec()
 {
-	subsec_t *S = (subsec_t *) UtilCalloc(sizeof(subsec_t));
-	lev_subsecs.push_back(S);
+	subsec_t *S = CurrentArena().alloc<subsec_t>();
+	(cur_subtree ? cur_subtree->subsecs : lev_subsecs).push_back(S);
 	return S;
 }
 
-node_t *NewNode()
+node_t *LevelBuilder::NewNode()
 {
-	node_t *N = (node_t *) UtilCalloc(sizeof(node_t));
-	lev_nodes.push_back(N);
+	node_t *N = CurrentArena().alloc<node_t>();
+	(cur_subtree ? cur_subtree->nodes : lev_nodes).push_back(N);
 	return N;
 }
 
-walltip_t *NewWallTip()
+walltip_t *LevelBuilder::NewWallTip()
 {
-	walltip_t *WT = (walltip_t *) UtilCalloc(sizeof(walltip_t));
-	lev_walltips.push_back(WT);
+	walltip_t *WT = CurrentArena().alloc<walltip_t>();
+	(cur_subtree ? cur_subtree->walltips : lev_walltips).push_back(WT);
 	return WT;
 }
 
 
-/* ----- free routines ---------------------------- */
-
-void FreeVertices()
-{
-	for (unsigned int i = 0 ; i < lev_vertices.size() ; i++)
-		UtilFree((void *) lev_vertices[i]);
-
-	lev_vertices.clear();
-}
-
-void FreeSegs()
-{
-	for (unsigned int i = 0 ; i < lev_segs.size() ; i++)
-		UtilFree((void *) lev_segs[i]);
-
-	lev_segs.clear();
-}
-
-void FreeSubsecs()
-{
-	for (unsigned int i = 0 ; i < lev_subsecs.size() ; i++)
-		UtilFree((void *) lev_subsecs[i]);
-
-	lev_subsecs.clear();
-}
-
-void FreeNodes()
-{
-	for (unsigned int i = 0 ; i < lev_nodes.size() ; i++)
-		UtilFree((void *) lev_nodes[i]);
-
-	lev_nodes.clear();
-}
-
-void FreeWallTips()
-{
-	for (unsigned int i = 0 ; i < lev_walltips.size() ; i++)
-		UtilFree((void *) lev_walltips[i]);
-
-	lev_walltips.clear();
-}
-
-
 /* ----- reading routines ------------------------------ */
 
-static void GetVertices(const Document &doc)
+void LevelBuilder::GetVertices(const Document &doc)
 {
 	for (int i = 0 ; i < doc.numVertices() ; i++)
 	{
@@ -920,7 +971,7 @@ static const u8_t *lev_v2_magic = (u8_t *) "gNd2";
 static const u8_t *lev_v5_magic = (u8_t *) "gNd5";
 
 
-void MarkOverflow(int flags)
+void LevelBuilder::MarkOverflow(int flags)
 {
 	// flags are ignored
 
@@ -928,11 +979,11 @@ void MarkOverflow(int flags)
 }
 
 
-static void PutVertices(const Instance &inst, const char *name, int do_gl)
+void LevelBuilder::PutVertices(const char *name, int do_gl)
 {
 	int count, i;
 
-	Lump_c *lump = CreateLevelLump(inst, name);
+	Lump_c *lump = CreateLevelLump(name);
 
 	for (i=0, count=0 ; i < num_vertices ; i++)
 	{
@@ -959,17 +1010,17 @@ static void PutVertices(const Instance &inst, const char *name, int do_gl)
 
 	if (! do_gl && count > 65534)
 	{
-		Failure(inst, "Number of vertices has overflowed.\n");
+		Failure("Number of vertices has overflowed.\n");
 		MarkOverflow(LIMIT_VERTEXES);
 	}
 }
 
 
-static void PutGLVertices(const Instance &inst, int do_v5)
+void LevelBuilder::PutGLVertices(int do_v5)
 {
 	int count, i;
 
-	Lump_c *lump = CreateLevelLump(inst, "GL_VERT");
+	Lump_c *lump = CreateLevelLump("GL_VERT");
 
 	if (do_v5)
 		lump->Write(lev_v5_magic, 4);
@@ -1016,7 +1067,7 @@ static inline u32_t VertexIndex_V5(const vertex_t *v)
 }
 
 
-static inline u32_t VertexIndex_XNOD(const vertex_t *v)
+u32_t LevelBuilder::VertexIndex_XNOD(const vertex_t *v) const
 {
 	if (v->is_new)
 		return (u32_t) (num_old_vert + v->index);
@@ -1025,11 +1076,11 @@ static inline u32_t VertexIndex_XNOD(const vertex_t *v)
 }
 
 
-static void PutSegs(const Instance &inst)
+void LevelBuilder::PutSegs()
 {
 	int i, count;
 
-	Lump_c *lump = CreateLevelLump(inst, "SEGS");
+	Lump_c *lump = CreateLevelLump("SEGS");
 
 	for (i=0, count=0 ; i < num_segs ; i++)
 	{
@@ -1062,17 +1113,17 @@ static void PutSegs(const Instance &inst)
 
 	if (count > 65534)
 	{
-		Failure(inst, "Number of segs has overflowed.\n");
+		Failure("Number of segs has overflowed.\n");
 		MarkOverflow(LIMIT_SEGS);
 	}
 }
 
 
-static void PutGLSegs(const Instance &inst)
+void LevelBuilder::PutGLSegs()
 {
 	int i, count;
 
-	Lump_c *lump = CreateLevelLump(inst, "GL_SEGS");
+	Lump_c *lump = CreateLevelLump("GL_SEGS");
 
 	for (i=0, count=0 ; i < num_segs ; i++)
 	{
@@ -1114,11 +1165,11 @@ static void PutGLSegs(const Instance &inst)
 }
 
 
-static void PutGLSegs_V5(const Instance &inst)
+void LevelBuilder::PutGLSegs_V5()
 {
 	int i, count;
 
-	Lump_c *lump = CreateLevelLump(inst, "GL_SEGS");
+	Lump_c *lump = CreateLevelLump("GL_SEGS");
 
 	for (i=0, count=0 ; i < num_segs ; i++)
 	{
@@ -1158,11 +1209,11 @@ static void PutGLSegs_V5(const Instance &inst)
 }
 
 
-static void PutSubsecs(const Instance &inst, const char *name, int do_gl)
+void LevelBuilder::PutSubsecs(const char *name, int do_gl)
 {
 	int i;
 
-	Lump_c * lump = CreateLevelLump(inst, name);
+	Lump_c * lump = CreateLevelLump(name);
 
 	for (i=0 ; i < num_subsecs ; i++)
 	{
@@ -1183,17 +1234,17 @@ static void PutSubsecs(const Instance &inst, const char *name, int do_gl)
 
 	if (num_subsecs > 32767)
 	{
-		Failure(inst, "Number of %s has overflowed.\n", do_gl ? "GL subsectors" : "subsectors");
+		Failure("Number of %s has overflowed.\n", do_gl ? "GL subsectors" : "subsectors");
 		MarkOverflow(do_gl ? LIMIT_GL_SSECT : LIMIT_SSECTORS);
 	}
 }
 
 
-static void PutGLSubsecs_V5(const Instance &inst)
+void LevelBuilder::PutGLSubsecs_V5()
 {
 	int i;
 
-	Lump_c *lump = CreateLevelLump(inst, "GL_SSECT");
+	Lump_c *lump = CreateLevelLump("GL_SSECT");
 
 	for (i=0 ; i < num_subsecs ; i++)
 	{
@@ -1214,9 +1265,7 @@ static void PutGLSubsecs_V5(const Instance &inst)
 }
 
 
-static int node_cur_index;
-
-static void PutOneNode(node_t *node, Lump_c *lump)
+void LevelBuilder::PutOneNode(node_t *node, Lump_c *lump)
 {
 	raw_node_t raw;
 
@@ -1269,7 +1318,7 @@ static void PutOneNode(node_t *node, Lump_c *lump)
 }
 
 
-static void PutOneNode_V5(node_t *node, Lump_c *lump)
+void LevelBuilder::PutOneNode_V5(node_t *node, Lump_c *lump)
 {
 	raw_v5_node_t raw;
 
@@ -1321,9 +1370,9 @@ static void PutOneNode_V5(node_t *node, Lump_c *lump)
 }
 
 
-void PutNodes(const Instance &inst, const char *name, int do_v5, node_t *root)
+void LevelBuilder::PutNodes(const char *name, int do_v5, node_t *root)
 {
-	Lump_c *lump = CreateLevelLump(inst, name);
+	Lump_c *lump = CreateLevelLump(name);
 
 	node_cur_index = 0;
 
@@ -1341,29 +1390,29 @@ void PutNodes(const Instance &inst, const char *name, int do_v5, node_t *root)
 
 	if (!do_v5 && node_cur_index > 32767)
 	{
-		Failure(inst, "Number of nodes has overflowed.\n");
+		Failure("Number of nodes has overflowed.\n");
 		MarkOverflow(LIMIT_NODES);
 	}
 }
 
 
-static void CheckLimits(bool& force_v5, bool& force_xnod, const Instance &inst)
+void LevelBuilder::CheckLimits(bool& force_v5, bool& force_xnod)
 {
 	if (inst.level.numSectors() > 65534)
 	{
-		Failure(inst, "Map has too many sectors.\n");
+		Failure("Map has too many sectors.\n");
 		MarkOverflow(LIMIT_SECTORS);
 	}
 
 	if (inst.level.numSidedefs() > 65534)
 	{
-		Failure(inst, "Map has too many sidedefs.\n");
+		Failure("Map has too many sidedefs.\n");
 		MarkOverflow(LIMIT_SIDEDEFS);
 	}
 
 	if (inst.level.numLinedefs() > 65534)
 	{
-		Failure(inst, "Map has too many linedefs.\n");
+		Failure("Map has too many linedefs.\n");
 		MarkOverflow(LIMIT_LINEDEFS);
 	}
 
@@ -1374,7 +1423,7 @@ static void CheckLimits(bool& force_v5, bool& force_xnod, const Instance &inst)
 			num_segs > 65534 ||
 			num_nodes > 32767)
 		{
-			Warning(inst, "Forcing V5 of GL-Nodes due to overflows.\n");
+			Warning("Forcing V5 of GL-Nodes due to overflows.\n");
 			force_v5 = true;
 		}
 	}
@@ -1386,7 +1435,7 @@ static void CheckLimits(bool& force_v5, bool& force_xnod, const Instance &inst)
 			num_segs > 32767 ||
 			num_nodes > 32767)
 		{
-			Warning(inst, "Forcing XNOD format nodes due to overflows.\n");
+			Warning("Forcing XNOD format nodes due to overflows.\n");
 			force_xnod = true;
 		}
 	}
@@ -1401,7 +1450,7 @@ struct seg_index_CMP_pred
 	}
 };
 
-void SortSegs()
+void LevelBuilder::SortSegs()
 {
 	// do a sanity check
 	for (int i = 0 ; i < num_segs ; i++)
@@ -1413,10 +1462,7 @@ void SortSegs()
 
 	// remove unwanted segs
 	while (lev_segs.size() > 0 && lev_segs.back()->index == SEG_IS_GARBAGE)
-	{
-		UtilFree((void *) lev_segs.back());
 		lev_segs.pop_back();
-	}
 }
 
 
@@ -1425,8 +1471,9 @@ void SortSegs()
 static const u8_t *lev_XNOD_magic = (u8_t *) "XNOD";
 static const u8_t *lev_XGL3_magic = (u8_t *) "XGL3";
 static const u8_t *lev_ZNOD_magic = (u8_t *) "ZNOD";
+static const u8_t *lev_ZGL3_magic = (u8_t *) "ZGL3";
 
-void PutZVertices()
+void LevelBuilder::PutZVertices()
 {
 	int count, i;
 
@@ -1458,7 +1505,7 @@ void PutZVertices()
 }
 
 
-void PutZSubsecs()
+void LevelBuilder::PutZSubsecs()
 {
 	int i;
 	int count;
@@ -1499,7 +1546,7 @@ void PutZSubsecs()
 }
 
 
-void PutZSegs()
+void LevelBuilder::PutZSegs()
 {
 	int i, count;
 	u32_t raw_num = LE_U32(num_segs);
@@ -1535,7 +1582,7 @@ void PutZSegs()
 }
 
 
-void PutXGL3Segs()
+void LevelBuilder::PutXGL3Segs()
 {
 	int i, count;
 	u32_t raw_num = LE_U32(num_segs);
@@ -1574,7 +1621,7 @@ void PutXGL3Segs()
 }
 
 
-static void PutOneZNode(node_t *node, bool do_xgl3)
+void LevelBuilder::PutOneZNode(node_t *node, bool do_xgl3)
 {
 	raw_v5_node_t raw;
 
@@ -1650,7 +1697,7 @@ static void PutOneZNode(node_t *node, bool do_xgl3)
 }
 
 
-void PutZNodes(node_t *root, bool do_xgl3)
+void LevelBuilder::PutZNodes(node_t *root, bool do_xgl3)
 {
 	u32_t raw_num = LE_U32(num_nodes);
 
@@ -1666,21 +1713,20 @@ void PutZNodes(node_t *root, bool do_xgl3)
 				node_cur_index, num_nodes);
 }
 
-static void SaveZDFormat(const Instance &inst, node_t *root_node)
+void LevelBuilder::SaveZDFormat(node_t *root_node)
 {
 	// leave SEGS and SSECTORS empty
-	CreateLevelLump(inst, "SEGS");
-	CreateLevelLump(inst, "SSECTORS");
+	CreateLevelLump("SEGS");
+	CreateLevelLump("SSECTORS");
 
-	Lump_c *lump = CreateLevelLump(inst, "NODES");
+	Lump_c *lump = CreateLevelLump("NODES");
 
 	if (cur_info->force_compress)
 		lump->Write(lev_ZNOD_magic, 4);
 	else
 		lump->Write(lev_XNOD_magic, 4);
 
-	// the ZLibXXX functions do no compression for XNOD format
-	ZLibBeginLump(lump);
+	ZLibBeginLump(lump, cur_info->force_compress);
 
 	PutZVertices();
 	PutZSubsecs();
@@ -1691,18 +1737,18 @@ static void SaveZDFormat(const Instance &inst, node_t *root_node)
 }
 
 
-static void SaveXGL3Format(const Instance &inst, node_t *root_node)
+void LevelBuilder::SaveXGL3Format(node_t *root_node)
 {
 	// WISH : compute a max_size
 
-	Lump_c *lump = CreateLevelLump(inst, "ZNODES");
-
-	lump->Write(lev_XGL3_magic, 4);
+	Lump_c *lump = CreateLevelLump("ZNODES");
 
-	// disable compression
-	cur_info->force_compress = false;
+	if (cur_info->force_compress)
+		lump->Write(lev_ZGL3_magic, 4);
+	else
+		lump->Write(lev_XGL3_magic, 4);
 
-	ZLibBeginLump(lump);
+	ZLibBeginLump(lump, cur_info->force_compress);
 
 	PutZVertices();
 	PutZSubsecs();
@@ -1715,14 +1761,11 @@ static void SaveXGL3Format(const Instance &inst, node_t *root_node)
 
 /* ----- whole-level routines --------------------------- */
 
-static void LoadLevel(const Instance &inst)
+void LevelBuilder::LoadLevel()
 {
-	Lump_c *LEV = inst.wad.master.edit_wad->GetLump(lev_current_start);
-
-	lev_current_name = LEV->Name();
 	lev_overflows = 0;
 
-	inst.GB_PrintMsg("Building nodes on %s\n", lev_current_name.c_str());
+	PrintMsg("Building nodes on %s\n", lev_current_name.c_str());
 
 	num_new_vert = 0;
 	num_real_lines = 0;
@@ -1752,29 +1795,31 @@ static void LoadLevel(const Instance &inst)
 	if (inst.loaded.levelFormat != MapFormat::doom)
 	{
 		// -JL- Find sectors containing polyobjs
-		DetectPolyobjSectors(inst);
+		DetectPolyobjSectors();
 	}
 }
 
 
-void FreeLevel(void)
+void LevelBuilder::FreeLevel()
 {
-	FreeVertices();
-	FreeSegs();
-	FreeSubsecs();
-	FreeNodes();
-	FreeWallTips();
-}
+	lev_vertices.clear();
+	lev_segs.clear();
+	lev_subsecs.clear();
+	lev_nodes.clear();
+	lev_walltips.clear();
+
+	quick_alloc_cuts = NULL;
 
-static Lump_c *FindLevelLump(const Instance &inst, const char *name);
+	arena.release();
+}
 
-static u32_t CalcGLChecksum(const Instance &inst)
+u32_t LevelBuilder::CalcGLChecksum()
 {
 	u32_t crc;
 
 	Adler32_Begin(&crc);
 
-	Lump_c *lump = FindLevelLump(inst, "VERTEXES");
+	Lump_c *lump = FindLevelLump("VERTEXES");
 
 	if (lump && lump->Length() > 0)
 	{
@@ -1788,7 +1833,7 @@ static u32_t CalcGLChecksum(const Instance &inst)
 		delete[] data;
 	}
 
-	lump = FindLevelLump(inst, "LINEDEFS");
+	lump = FindLevelLump("LINEDEFS");
 
 	if (lump && lump->Length() > 0)
 	{
@@ -1807,17 +1852,17 @@ static u32_t CalcGLChecksum(const Instance &inst)
 }
 
 
-inline static SString CalcOptionsString()
+SString LevelBuilder::CalcOptionsString() const
 {
 	return SString::printf("--cost %d%s", cur_info->factor, cur_info->fast ? " --fast" : "");
 }
 
 
-static void UpdateGLMarker(const Instance &inst, Lump_c *marker)
+void LevelBuilder::UpdateGLMarker(Lump_c *marker)
 {
 	// we *must* compute the checksum BEFORE (re)creating the lump
 	// [ otherwise we write data into the wrong part of the file ]
-	u32_t crc = CalcGLChecksum(inst);
+	u32_t crc = CalcGLChecksum();
 
 	// when original name is long, need to specify it here
 	if (lev_current_name.length() > 5)
@@ -1839,7 +1884,7 @@ static void UpdateGLMarker(const Instance &inst, Lump_c *marker)
 }
 
 
-static void AddMissingLump(const Instance &inst, const char *name, const char *after)
+void LevelBuilder::AddMissingLump(const char *name, const char *after)
 {
 	if (inst.wad.master.edit_wad->LevelLookupLump(lev_current_idx, name) >= 0)
 		return;
@@ -1849,7 +1894,7 @@ static void AddMissingLump(const Instance &inst, const char *name, const char *a
 	// if this happens, the level structure is very broken
 	if (exist < 0)
 	{
-		Warning(inst, "Missing %s lump -- level structure is broken\n", after);
+		Warning("Missing %s lump -- level structure is broken\n", after);
 
 		exist = inst.wad.master.edit_wad->LevelLastLump(lev_current_idx);
 	}
@@ -1859,9 +1904,7 @@ static void AddMissingLump(const Instance &inst, const char *name, const char *a
 	inst.wad.master.edit_wad->AddLump(name);
 }
 
-static Lump_c *CreateGLMarker(const Instance &inst);
-
-static build_result_e SaveLevel(node_t *root_node, const Instance &inst)
+build_result_e LevelBuilder::SaveLevel(node_t *root_node)
 {
 	// Note: root_node may be NULL
 
@@ -1869,11 +1912,11 @@ static build_result_e SaveLevel(node_t *root_node, const Instance &inst)
 	inst.wad.master.edit_wad->RemoveGLNodes(lev_current_idx);
 
 	// ensure all necessary level lumps are present
-	AddMissingLump(inst, "SEGS",     "VERTEXES");
-	AddMissingLump(inst, "SSECTORS", "SEGS");
-	AddMissingLump(inst, "NODES",    "SSECTORS");
-	AddMissingLump(inst, "REJECT",   "SECTORS");
-	AddMissingLump(inst, "BLOCKMAP", "REJECT");
+	AddMissingLump("SEGS",     "VERTEXES");
+	AddMissingLump("SSECTORS", "SEGS");
+	AddMissingLump("NODES",    "SSECTORS");
+	AddMissingLump("REJECT",   "SECTORS");
+	AddMissingLump("BLOCKMAP", "REJECT");
 
 	// user preferences
 	bool force_v5   = cur_info->force_v5;
@@ -1881,7 +1924,7 @@ static build_result_e SaveLevel(node_t *root_node, const Instance &inst)
 
 	// check for overflows...
 	// this sets the force_xxx vars if certain limits are breached
-	CheckLimits(force_v5, force_xnod, inst);
+	CheckLimits(force_v5, force_xnod);
 
 
 	/* --- GL Nodes --- */
@@ -1893,24 +1936,24 @@ static build_result_e SaveLevel(node_t *root_node, const Instance &inst)
 		SortSegs();
 
 		// create empty marker now, flesh it out later
-		gl_marker = CreateGLMarker(inst);
+		gl_marker = CreateGLMarker();
 
-		PutGLVertices(inst, force_v5);
+		PutGLVertices(force_v5);
 
 		if (force_v5)
-			PutGLSegs_V5(inst);
+			PutGLSegs_V5();
 		else
-			PutGLSegs(inst);
+			PutGLSegs();
 
 		if (force_v5)
-			PutGLSubsecs_V5(inst);
+			PutGLSubsecs_V5();
 		else
-			PutSubsecs(inst, "GL_SSECT", true);
+			PutSubsecs("GL_SSECT", true);
 
-		PutNodes(inst, "GL_NODES", force_v5, root_node);
+		PutNodes("GL_NODES", force_v5, root_node);
 
 		// -JL- Add empty PVS lump
-		CreateLevelLump(inst, "GL_PVS");
+		CreateLevelLump("GL_PVS");
 	}
 
 
@@ -1923,7 +1966,7 @@ static build_result_e SaveLevel(node_t *root_node, const Instance &inst)
 	{
 		SortSegs();
 
-		SaveZDFormat(inst, root_node);
+		SaveZDFormat(root_node);
 	}
 	else
 	{
@@ -1935,21 +1978,30 @@ static build_result_e SaveLevel(node_t *root_node, const Instance &inst)
 		// this also removes minisegs and degenerate segs
 		SortSegs();
 
-		PutVertices(inst, "VERTEXES", false);
+		PutVertices("VERTEXES", false);
 
-		PutSegs(inst);
-		PutSubsecs(inst, "SSECTORS", false);
-		PutNodes(inst, "NODES", false, root_node);
+		PutSegs();
+		PutSubsecs("SSECTORS", false);
+		PutNodes("NODES", false, root_node);
 	}
 
-	PutBlockmap(inst);
-	PutReject(inst);
+	auto start = std::chrono::steady_clock::now();
+
+	PutBlockmap();
+
+	stats.time_blockmap = SecondsSince(start);
+
+	start = std::chrono::steady_clock::now();
+
+	PutReject();
+
+	stats.time_reject = SecondsSince(start);
 
 	// keyword support (v5.0 of the specs).
 	// must be done *after* doing normal nodes (for proper checksum).
 	if (gl_marker)
 	{
-		UpdateGLMarker(inst, gl_marker);
+		UpdateGLMarker(gl_marker);
 	}
 
 	inst.wad.master.edit_wad->writeToDisk();
@@ -1957,7 +2009,7 @@ static build_result_e SaveLevel(node_t *root_node, const Instance &inst)
 	if (lev_overflows > 0)
 	{
 		cur_info->total_failed_maps++;
-		inst.GB_PrintMsg("FAILED with %d overflowed lumps\n", lev_overflows);
+		PrintMsg("FAILED with %d overflowed lumps\n", lev_overflows);
 
 		return BUILD_LumpOverflow;
 	}
@@ -1966,7 +2018,7 @@ static build_result_e SaveLevel(node_t *root_node, const Instance &inst)
 }
 
 
-static build_result_e SaveUDMF(const Instance &inst, node_t *root_node)
+build_result_e LevelBuilder::SaveUDMF(node_t *root_node)
 {
 	// remove any existing ZNODES lump
 	inst.wad.master.edit_wad->RemoveZNodes(lev_current_idx);
@@ -1975,7 +2027,7 @@ static build_result_e SaveUDMF(const Instance &inst, node_t *root_node)
 	{
 		SortSegs();
 
-		SaveXGL3Format(inst, root_node);
+		SaveXGL3Format(root_node);
 	}
 
 	inst.wad.master.edit_wad->writeToDisk();
@@ -1983,7 +2035,7 @@ static build_result_e SaveUDMF(const Instance &inst, node_t *root_node)
 	if (lev_overflows > 0)
 	{
 		cur_info->total_failed_maps++;
-		inst.GB_PrintMsg("FAILED with %d overflowed lumps\n", lev_overflows);
+		PrintMsg("FAILED with %d overflowed lumps\n", lev_overflows);
 
 		return BUILD_LumpOverflow;
 	}
@@ -1995,102 +2047,43 @@ static build_result_e SaveUDMF(const Instance &inst, node_t *root_node)
 //----------------------------------------------------------------------
 
 
-static Lump_c  *zout_lump;
-static z_stream zout_stream;
-static Bytef    zout_buffer[1024];
-
-
-void ZLibBeginLump(Lump_c *lump)
+void LevelBuilder::ZLibBeginLump(Lump_c *lump, bool compress)
 {
 	zout_lump = lump;
+	zout_compress = compress;
 
-	if (! cur_info->force_compress)
-		return;
-
-	zout_stream.zalloc = (alloc_func)0;
-	zout_stream.zfree  = (free_func)0;
-	zout_stream.opaque = (voidpf)0;
+	zout_data.clear();
 
-	if (Z_OK != deflateInit(&zout_stream, Z_DEFAULT_COMPRESSION))
-		FatalError("Trouble setting up zlib compression\n");
-
-	zout_stream.next_out  = zout_buffer;
-	zout_stream.avail_out = sizeof(zout_buffer);
+	// roughly the size of the ZDoom format nodes
+	zout_data.reserve(num_vertices * 8 + num_subsecs * 4 + num_segs * 17 + num_nodes * 32 + 64);
 }
 
 
-void ZLibAppendLump(const void *data, int length)
+void LevelBuilder::ZLibAppendLump(const void *data, int length)
 {
-	// ASSERT(zout_lump)
-	// ASSERT(length > 0)
-
-	if (! cur_info->force_compress)
-	{
-		zout_lump->Write(data, length);
-		return;
-	}
-
-	zout_stream.next_in  = (Bytef*)data;   // const override
-	zout_stream.avail_in = length;
+	const u8_t *bytes = static_cast<const u8_t *>(data);
 
-	while (zout_stream.avail_in > 0)
-	{
-		int err = deflate(&zout_stream, Z_NO_FLUSH);
-
-		if (err != Z_OK)
-			FatalError("Trouble compressing %d bytes (zlib)\n", length);
-
-		if (zout_stream.avail_out == 0)
-		{
-			zout_lump->Write(zout_buffer, sizeof(zout_buffer));
-
-			zout_stream.next_out  = zout_buffer;
-			zout_stream.avail_out = sizeof(zout_buffer);
-		}
-	}
+	zout_data.insert(zout_data.end(), bytes, bytes + length);
 }
 
 
-void ZLibFinishLump(void)
+void LevelBuilder::ZLibFinishLump()
 {
-	if (! cur_info->force_compress)
+	if (zout_compress)
 	{
-		zout_lump = NULL;
-		return;
-	}
-
-	int left_over;
-
-	// ASSERT(zout_stream.avail_out > 0)
-
-	zout_stream.next_in  = Z_NULL;
-	zout_stream.avail_in = 0;
+		std::vector<u8_t> packed = ParallelDeflate(zout_data.data(), zout_data.size(),
+												   cur_info->compress_level, TaskPool::global());
 
-	for (;;)
+		zout_lump->Write(packed.data(), (int)packed.size());
+	}
+	else
 	{
-		int err = deflate(&zout_stream, Z_FINISH);
-
-		if (err == Z_STREAM_END)
-			break;
-
-		if (err != Z_OK)
-			FatalError("Trouble finishing compression (zlib)\n");
-
-		if (zout_stream.avail_out == 0)
-		{
-			zout_lump->Write(zout_buffer, sizeof(zout_buffer));
-
-			zout_stream.next_out  = zout_buffer;
-			zout_stream.avail_out = sizeof(zout_buffer);
-		}
+		zout_lump->Write(zout_data.data(), (int)zout_data.size());
 	}
 
-	left_over = sizeof(zout_buffer) - zout_stream.avail_out;
-
-	if (left_over > 0)
-		zout_lump->Write(zout_buffer, left_over);
+	zout_data.clear();
+	zout_data.shrink_to_fit();
 
-	deflateEnd(&zout_stream);
 	zout_lump = NULL;
 }
 
@@ -2098,7 +2091,7 @@ void ZLibFinishLump(void)
 /* ---------------------------------------------------------------- */
 
 
-static Lump_c * FindLevelLump(const Instance &inst, const char *name)
+Lump_c * LevelBuilder::FindLevelLump(const char *name)
 {
 	int idx = inst.wad.master.edit_wad->LevelLookupLump(lev_current_idx, name);
 
@@ -2109,10 +2102,10 @@ static Lump_c * FindLevelLump(const Instance &inst, const char *name)
 }
 
 
-static Lump_c * CreateLevelLump(const Instance &inst, const char *name)
+Lump_c * LevelBuilder::CreateLevelLump(const char *name)
 {
 	// look for existing one
-	Lump_c *lump = FindLevelLump(inst, name);
+	Lump_c *lump = FindLevelLump(name);
 
 	if(!lump)
 	{
@@ -2133,7 +2126,7 @@ static Lump_c * CreateLevelLump(const Instance &inst, const char *name)
 }
 
 
-static Lump_c * CreateGLMarker(const Instance &inst)
+Lump_c * LevelBuilder::CreateGLMarker()
 {
 	SString name_buf;
 
@@ -2161,79 +2154,603 @@ static Lump_c * CreateGLMarker(const Instance &inst)
 // MAIN STUFF
 //------------------------------------------------------------------------
 
-nodebuildinfo_t * cur_info = NULL;
+LevelBuilder::LevelBuilder(nodebuildinfo_t *info, int lev_idx, const Instance &_inst) :
+	cur_info(info), inst(_inst), lev_current_idx(lev_idx)
+{
+	// without a level number, the tree is only built (for looking at)
+	// and nothing is saved.
+	if (lev_idx < 0)
+	{
+		lev_current_name = inst.loaded.levelName;
+		return;
+	}
+
+	// the name is looked up now, since saving an earlier level
+	// moves the lumps of this level around.
+	int header = inst.wad.master.edit_wad->LevelHeader(lev_idx);
+
+	lev_current_name = inst.wad.master.edit_wad->GetLump(header)->Name();
+}
 
 
-static build_result_e BuildLevel(nodebuildinfo_t *info, int lev_idx, const Instance &inst)
+LevelBuilder::~LevelBuilder()
 {
-	cur_info = info;
+	FreeLevel();
 
-	node_t *root_node  = NULL;
-	subsec_t *root_sub = NULL;
-	bbox_t root_bbox;
+	// clear some fake line flags
+	for(LineDef *linedef : inst.level.linedefs)
+		linedef->flags &= ~(MLF_IS_PRECIOUS | MLF_IS_OVERLAP);
+}
 
-	if (cur_info->cancelled)
-		return BUILD_Cancelled;
 
-	lev_current_idx   = lev_idx;
-	lev_current_start = inst.wad.master.edit_wad->LevelHeader(lev_idx);
+build_result_e LevelBuilder::Build()
+{
+	if (cur_info->cancelled)
+		return build_result = BUILD_Cancelled;
 
-	LoadLevel(inst);
+	LoadLevel();
 
 	InitBlockmap(inst.level);
 
+	build_result = BUILD_OK;
 
-	build_result_e ret = BUILD_OK;
+	stats.level_name = lev_current_name;
 
 	if (num_real_lines > 0)
 	{
+		auto start = std::chrono::steady_clock::now();
+
 		// create initial segs
-		seg_t *list = CreateSegs(inst);
+		seg_t *list = CreateSegs();
+
+		segs_total = num_segs;
+
+		stats.time_segs = SecondsSince(start);
+
+		start = std::chrono::steady_clock::now();
+
+		// the cached partitions are only reused with the same options
+		int cached = -1;
+
+		if (cache && ! cache->partitions.empty() &&
+			cache->level_name == lev_current_name &&
+			cache->factor == cur_info->factor &&
+			cache->fast == cur_info->fast &&
+			cache->axis_bias == cur_info->axis_bias)
+		{
+			cached = 0;
+		}
 
 		// recursively create nodes
-		ret = BuildNodes(list, &root_bbox, &root_node, &root_sub, 0, inst);
+		build_result = BuildNodes(list, &root_bbox, &root_node, &root_sub, 0, cached);
+
+		RemoveReplacedSegs();
+
+		// parts of the tree may have been built in parallel, hence the
+		// subsectors and new vertices are only numbered now.
+		for (int i = 0 ; i < num_subsecs ; i++)
+			lev_subsecs[i]->index = i;
+
+		for (vertex_t *vert : lev_vertices)
+			if (vert->is_new)
+				vert->index = num_new_vert++;
+
+		stats.time_tree = SecondsSince(start);
 	}
 
-	if (ret == BUILD_OK)
+	if (cache && build_result == BUILD_OK)
+		StoreCache();
+
+	return build_result;
+}
+
+
+tree_stats_t LevelBuilder::TreeStats() const
+{
+	tree_stats_t stats;
+
+	for (const seg_t *seg : lev_segs)
+		if (seg->linedef >= 0)
+			stats.real_segs++;
+
+	stats.all_segs = num_segs;
+	stats.nodes    = num_nodes;
+	stats.subsecs  = num_subsecs;
+	stats.vertices = num_old_vert + num_new_vert;
+
+	stats.height = root_node ? ComputeBspHeight(root_node) : 0;
+
+	// the original engine uses signed 16-bit numbers for all of these
+	stats.vanilla = (stats.real_segs <= 32767 &&
+					 stats.nodes     <= 32767 &&
+					 stats.subsecs   <= 32767 &&
+					 stats.vertices  <= 32767);
+
+	return stats;
+}
+
+
+bool BetterTree(const tree_stats_t &A, const tree_stats_t &B, build_goal_e goal)
+{
+	switch (goal)
+	{
+	case GOAL_FewestSegs:
+		return std::tie(A.real_segs, A.all_segs, A.height) <
+			   std::tie(B.real_segs, B.all_segs, B.height);
+
+	case GOAL_Shallowest:
+		return std::tie(A.height, A.real_segs, A.all_segs) <
+			   std::tie(B.height, B.real_segs, B.all_segs);
+
+	case GOAL_Vanilla:
+		if (A.vanilla != B.vanilla)
+			return A.vanilla;
+
+		return std::tie(A.real_segs, A.all_segs, A.height) <
+			   std::tie(B.real_segs, B.all_segs, B.height);
+
+	default:
+		return false;
+	}
+}
+
+
+int LevelBuilder::Progress() const
+{
+	if (segs_total == 0)
+		return 0;
+
+	// splitting segs makes more of them, hence this can overshoot
+	return std::min(99, (int)(100.0 * segs_finished / segs_total));
+}
+
+
+bool LevelBuilder::RelocateLevel()
+{
+	int lev_idx = inst.wad.master.edit_wad->LevelFind(lev_current_name);
+
+	if (lev_idx < 0)
+		return false;
+
+	lev_current_idx = lev_idx;
+	return true;
+}
+
+
+build_result_e LevelBuilder::Save()
+{
+	SYS_ASSERT(build_result == BUILD_OK);
+
+	PrintDetail("Built %d NODES, %d SSECTORS, %d SEGS, %d VERTEXES\n",
+				num_nodes, num_subsecs, num_segs, num_old_vert + num_new_vert);
+
+	if (cache)
+	{
+		PrintDetail("Partitions: %d reused from previous build, %d searched\n",
+				partitions_reused.load(), partitions_searched.load());
+	}
+
+	if (root_node)
+	{
+		PrintDetail("Heights of left and right subtrees = (%d,%d)\n",
+				ComputeBspHeight(root_node->r.node),
+				ComputeBspHeight(root_node->l.node));
+	}
+
+	auto start = std::chrono::steady_clock::now();
+
+	tree_stats_t tree = TreeStats();
+
+	stats.partitions_evaluated = partitions_evaluated;
+	stats.seg_splits    = seg_splits;
+	stats.time_picknode = picknode_nanos * 1e-9;
+	stats.height        = tree.height;
+
+	// nothing is freed before the end of the build (the subtrees which
+	// were thrown away are counted too), hence this is the peak.
+	stats.peak_memory = arena.bytesReserved() + arena_discarded;
+
+	stats.vertices = tree.vertices;
+	stats.segs     = tree.real_segs;
+	stats.subsecs  = tree.subsecs;
+	stats.nodes    = tree.nodes;
+	stats.sectors  = inst.level.numSectors();
+	stats.sidedefs = inst.level.numSidedefs();
+	stats.linedefs = inst.level.numLinedefs();
+
+	ClockwiseBspTree(inst.level);
+
+	build_result_e ret;
+
+	if (inst.loaded.levelFormat == MapFormat::udmf)
+		ret = SaveUDMF(root_node);
+	else
+		ret = SaveLevel(root_node);
+
+	stats.time_write = SecondsSince(start) - stats.time_blockmap - stats.time_reject;
+
+	return ret;
+}
+
+
+//------------------------------------------------------------------------
+// NODE CACHE
+//------------------------------------------------------------------------
+
+// this must be increased whenever a change to the node builder
+// changes what it writes for the same level and options.
+static const int NODE_CACHE_REVISION = 3;
+
+// the lumps which SaveLevel() and SaveUDMF() create or replace
+static bool IsNodeLump(const SString &name)
+{
+	static const char *const names[] =
 	{
-		PrintDetail("Built %d NODES, %d SSECTORS, %d SEGS, %d VERTEXES\n",
-					num_nodes, num_subsecs, num_segs, num_old_vert + num_new_vert);
+		"VERTEXES", "SEGS", "SSECTORS", "NODES", "REJECT", "BLOCKMAP", "ZNODES"
+	};
+
+	for (const char *node_name : names)
+		if (name == node_name)
+			return true;
+
+	return name.startsWith("GL_");
+}
+
+
+SString LevelBuilder::CacheKey() const
+{
+	NodeCacheKey key;
+
+	key.addString("Eureka " EUREKA_VERSION);
+	key.addInt(NODE_CACHE_REVISION);
+
+	// the options.  the evaluation kernel and number of jobs are not
+	// here, since they give the same result.
+	key.addInt(cur_info->factor);
+	key.addInt(cur_info->gl_nodes);
+	key.addInt(cur_info->do_blockmap);
+	key.addInt(cur_info->do_reject);
+	key.addInt(cur_info->los_reject);
+	key.addInt(cur_info->los_reject ? cur_info->reject_time : 0);
+	key.addInt(cur_info->fast);
+	key.addInt(cur_info->axis_bias);
+	key.addInt(cur_info->goal);
+	key.addInt(cur_info->goal != GOAL_None ? cur_info->strategy_time : 0);
+	key.addInt(cur_info->force_v5);
+	key.addInt(cur_info->force_xnod);
+	key.addInt(cur_info->force_compress);
+	key.addInt(cur_info->compress_level);
+
+	// the level itself
+	key.addString(lev_current_name);
+	key.addInt((int)inst.loaded.levelFormat);
+
+	const Document &doc = inst.level;
+
+	key.addInt(doc.numVertices());
+
+	for (const Vertex *V : doc.vertices)
+	{
+		key.addInt(V->raw_x.raw());
+		key.addInt(V->raw_y.raw());
+	}
+
+	// the whole linedef is used, since the GL marker has a checksum
+	// of the LINEDEFS lump.
+	key.addInt(doc.numLinedefs());
+
+	for (const LineDef *L : doc.linedefs)
+	{
+		const int fields[] =
+		{
+			L->start, L->end, L->right, L->left,
+			L->flags & ~(MLF_IS_PRECIOUS | MLF_IS_OVERLAP),
+			L->type, L->tag, L->arg2, L->arg3, L->arg4, L->arg5
+		};
+
+		for (int value : fields)
+			key.addInt(value);
+	}
+
+	key.addInt(doc.numSidedefs());
+
+	for (const SideDef *S : doc.sidedefs)
+		key.addInt(S->sector);
+
+	key.addInt(doc.numSectors());
+
+	// the things only matter for finding polyobjs, which depends on
+	// the game definitions too.
+	if (inst.loaded.levelFormat != MapFormat::doom)
+	{
+		key.addString(inst.loaded.gameName);
+		key.addString(inst.loaded.portName);
+
+		key.addInt(doc.numThings());
 
-		if (root_node)
+		for (const Thing *T : doc.things)
 		{
-			PrintDetail("Heights of left and right subtrees = (%d,%d)\n",
-					ComputeBspHeight(root_node->r.node),
-					ComputeBspHeight(root_node->l.node));
+			key.addInt(T->raw_x.raw());
+			key.addInt(T->raw_y.raw());
+			key.addInt(T->type);
+			key.addInt(T->angle);
 		}
+	}
+
+	return key.hex();
+}
 
-		ClockwiseBspTree(inst.level);
 
-		if (inst.loaded.levelFormat == MapFormat::udmf)
-			ret = SaveUDMF(inst, root_node);
-		else
-			ret = SaveLevel(root_node, inst);
+std::vector<NodeCache::Lump> LevelBuilder::CollectLumps()
+{
+	std::vector<NodeCache::Lump> lumps;
+
+	Wad_file *wad = inst.wad.master.edit_wad.get();
+
+	int start = wad->LevelHeader(lev_current_idx);
+	int last  = wad->LevelLastLump(lev_current_idx);
+
+	for (int i = start + 1 ; i <= last ; i++)
+	{
+		Lump_c *lump = wad->GetLump(i);
+
+		if (! IsNodeLump(lump->Name()))
+			continue;
+
+		NodeCache::Lump entry;
+
+		entry.name = lump->Name();
+
+		const u8_t *data = static_cast<const u8_t *>(lump->getData());
+
+		if (lump->Length() > 0)
+			entry.data.assign(data, data + lump->Length());
+
+		lumps.push_back(std::move(entry));
+	}
+
+	return lumps;
+}
+
+
+build_result_e LevelBuilder::SaveCached(const std::vector<NodeCache::Lump> &lumps)
+{
+	PrintMsg("Using the cached nodes of %s\n", lev_current_name.c_str());
+
+	Wad_file *wad = inst.wad.master.edit_wad.get();
+
+	// this follows SaveLevel() and SaveUDMF(), so the lumps end up in
+	// the same places as when the nodes are built.
+	if (inst.loaded.levelFormat == MapFormat::udmf)
+	{
+		wad->RemoveZNodes(lev_current_idx);
 	}
 	else
 	{
-		/* build was Cancelled by the user */
+		wad->RemoveGLNodes(lev_current_idx);
+
+		AddMissingLump("SEGS",     "VERTEXES");
+		AddMissingLump("SSECTORS", "SEGS");
+		AddMissingLump("NODES",    "SSECTORS");
+		AddMissingLump("REJECT",   "SECTORS");
+		AddMissingLump("BLOCKMAP", "REJECT");
 	}
 
-	FreeLevel();
-	FreeQuickAllocCuts();
+	bool have_marker = false;
 
-	// clear some fake line flags
-	for(LineDef *linedef : inst.level.linedefs)
-		linedef->flags &= ~(MLF_IS_PRECIOUS | MLF_IS_OVERLAP);
+	for (const NodeCache::Lump &entry : lumps)
+	{
+		Lump_c *lump;
 
-	return ret;
+		// the first GL lump is always the marker
+		if (entry.name.startsWith("GL_") && ! have_marker)
+		{
+			lump = CreateGLMarker();
+			have_marker = true;
+		}
+		else
+		{
+			lump = CreateLevelLump(entry.name.c_str());
+		}
+
+		if (! entry.data.empty())
+			lump->Write(entry.data.data(), (int)entry.data.size());
+	}
+
+	wad->writeToDisk();
+
+	return BUILD_OK;
+}
+
+
+int BuildStrategies(const std::vector<LevelBuilder *> &builders, build_goal_e goal,
+					int time_limit, const std::atomic<bool> &cancelled)
+{
+	int count = (int)builders.size();
+
+	SYS_ASSERT(count > 0);
+
+	std::vector<build_result_e> results(count, BUILD_Cancelled);
+	std::vector<std::exception_ptr> errors(count);
+
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(time_limit);
+
+	auto check_cancel = [&]()
+	{
+		bool too_late = (std::chrono::steady_clock::now() >= deadline);
+
+		for (int i = 0 ; i < count ; i++)
+			if (cancelled || (too_late && i > 0))
+				builders[i]->cur_info->cancelled = true;
+	};
+
+	check_cancel();
+
+	std::mutex mutex;
+	std::condition_variable cond;
+
+	int num_done = 0;
+
+	std::vector<std::thread> threads;
+
+	for (int i = 0 ; i < count ; i++)
+	{
+		threads.emplace_back([&, i]()
+		{
+			try
+			{
+				results[i] = builders[i]->Build();
+			}
+			catch (...)
+			{
+				errors[i] = std::current_exception();
+			}
+
+			std::lock_guard<std::mutex> lock(mutex);
+
+			num_done++;
+			cond.notify_all();
+		});
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+
+		while (num_done < count)
+		{
+			cond.wait_for(lock, std::chrono::milliseconds(50));
+
+			check_cancel();
+		}
+	}
+
+	for (std::thread &thread : threads)
+		thread.join();
+
+	if (errors[0])
+		std::rethrow_exception(errors[0]);
+
+	int best = -1;
+
+	tree_stats_t best_stats;
+
+	for (int i = 0 ; i < count ; i++)
+	{
+		if (errors[i] || results[i] != BUILD_OK)
+			continue;
+
+		tree_stats_t stats = builders[i]->TreeStats();
+
+		if (best < 0 || BetterTree(stats, best_stats, goal))
+		{
+			best = i;
+			best_stats = stats;
+		}
+	}
+
+	return best;
 }
 
 }  // namespace ajbsp
 
 
-build_result_e AJBSP_BuildLevel(nodebuildinfo_t *info, int lev_idx, const Instance &inst)
+std::vector<nodebuildstrategy_t> AJBSP_Strategies(const nodebuildinfo_t *info)
 {
-	return ajbsp::BuildLevel(info, lev_idx, inst);
+	std::vector<nodebuildstrategy_t> list;
+
+	auto add = [&list](const char *name, int factor, bool fast, bool axis_bias)
+	{
+		for (const nodebuildstrategy_t &other : list)
+			if (other.factor == factor && other.fast == fast && other.axis_bias == axis_bias)
+				return;
+
+		list.push_back({ name, factor, fast, axis_bias });
+	};
+
+	add("configured", info->factor, info->fast, info->axis_bias);
+
+	if (info->goal == GOAL_None)
+		return list;
+
+	// these are the same as the choices in the preferences
+	add("minimize splits", 29, false, true);
+	add("balance BSP tree", 2, false, true);
+
+	add("fewer splits", 17, false, true);
+	add("more balanced", 5, false, true);
+
+	// the same cost, but near-equal partitions are decided differently
+	add("no axis bias", info->factor, info->fast, ! info->axis_bias);
+
+	add("fast", info->factor, true, info->axis_bias);
+
+	return list;
+}
+
+
+std::unique_ptr<nodebuildinfo_t> AJBSP_StrategyInfo(const nodebuildinfo_t *info,
+													const nodebuildstrategy_t &strategy)
+{
+	auto result = std::make_unique<nodebuildinfo_t>();
+
+	result->gl_nodes	= info->gl_nodes;
+	result->do_blockmap	= info->do_blockmap;
+	result->do_reject	= info->do_reject;
+
+	result->los_reject	= info->los_reject;
+	result->reject_time	= info->reject_time;
+
+	result->warnings	= info->warnings;
+
+	result->force_v5		= info->force_v5;
+	result->force_xnod		= info->force_xnod;
+	result->force_compress	= info->force_compress;
+	result->compress_level	= info->compress_level;
+
+	result->kernel = info->kernel;
+
+	result->factor		= strategy.factor;
+	result->fast		= strategy.fast;
+	result->axis_bias	= strategy.axis_bias;
+
+	return result;
+}
+
+
+build_result_e AJBSP_BuildLevel(nodebuildinfo_t *info, int lev_idx, const Instance &inst,
+								nodebuildcache_t *cache, nodebuildstats_t *stats)
+{
+	ajbsp::LevelBuilder builder(info, lev_idx, inst);
+
+	builder.cache = cache;
+
+	build_result_e ret = builder.Build();
+
+	if (ret == BUILD_OK)
+		ret = builder.Save();
+
+	if (stats)
+		*stats = builder.stats;
+
+	return ret;
+}
+
+
+std::vector<nodebuildstats_t::limit_t> nodebuildstats_t::VanillaLimits() const
+{
+	// the engine reads most of these as signed 16-bit numbers, and the
+	// offsets in the blockmap too (hence a limit of 64 KB).
+	return
+	{
+		{ "vertices",   vertices,      32767 },
+		{ "segs",       segs,          32767 },
+		{ "subsectors", subsecs,       32767 },
+		{ "nodes",      nodes,         32767 },
+		{ "sectors",    sectors,       32767 },
+		{ "sidedefs",   sidedefs,      32767 },
+		{ "linedefs",   linedefs,      32767 },
+		{ "blockmap",   blockmap_size, 65536 },
+	};
 }
 
 //--- editor settings ---
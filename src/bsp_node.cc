@@ -41,11 +41,70 @@
 #include "Instance.h"
 #include "LineDef.h"
 #include "SideDef.h"
+#include "TaskPool.h"
 #include "Vertex.h"
 #include "bsp.h"
 
 #include "w_rawdef.h"
 
+#include <atomic>
+#include <unordered_map>
+#include <unordered_set>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define BSP_HAVE_SSE2  1
+#include <immintrin.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+// MSVC takes the AVX2 intrinsics anywhere
+#define BSP_TARGET_AVX2
+#else
+#define BSP_TARGET_AVX2  __attribute__((target("avx2")))
+#endif
+#endif
+
+
+#if BSP_HAVE_SSE2
+
+static bool CPU_HasAVX2()
+{
+#ifdef _MSC_VER
+	int regs[4];
+
+	__cpuid(regs, 0);
+
+	if (regs[0] < 7)
+		return false;
+
+	// the OS must save the AVX registers too
+	__cpuid(regs, 1);
+
+	if (! (regs[2] & (1 << 27)) || (_xgetbv(0) & 6) != 6)
+		return false;
+
+	__cpuidex(regs, 7, 0);
+
+	return (regs[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif
+
+
+eval_kernel_e BestEvalKernel()
+{
+#if BSP_HAVE_SSE2
+	static const bool has_avx2 = CPU_HasAVX2();
+
+	return has_avx2 ? EVAL_AVX2 : EVAL_SSE2;
+#else
+	return EVAL_Scalar;
+#endif
+}
+
 
 namespace ajbsp
 {
@@ -54,6 +113,24 @@ namespace ajbsp
 
 #define SEG_FAST_THRESHHOLD  200
 
+// how many seg distances are computed in one go
+#define EVAL_CHUNK  8
+
+// the number of bits set in the lowest 8 bits
+static inline int CountBits(unsigned x)
+{
+	x = x - ((x >> 1) & 0x55);
+	x = (x & 0x33) + ((x >> 2) & 0x33);
+
+	return (int)((x + (x >> 4)) & 0x0F);
+}
+
+// below this, evaluating the partitions in parallel is not worth it
+#define SEG_PARALLEL_THRESHHOLD  128
+
+// both halves of a node need this many segs to be built in parallel
+#define SUBTREE_PARALLEL_THRESHHOLD  256
+
 
 #define DEBUG_BUILDER  0
 #define DEBUG_SORTER   0
@@ -68,10 +145,7 @@ namespace ajbsp
 #define DIST_EPSILON  (1.0 / 1024.0)
 
 
-static int current_seg_index;
-
-
-typedef struct eval_info_s
+struct eval_info_t
 {
 	int cost;
 	int splits;
@@ -99,43 +173,34 @@ public:
 		else
 			mini_right++;
 	}
-}
-eval_info_t;
+};
 
 
-static intersection_t *quick_alloc_cuts = NULL;
+intersection_t *& LevelBuilder::QuickAllocCuts()
+{
+	return cur_subtree ? cur_subtree->quick_alloc_cuts : quick_alloc_cuts;
+}
 
 
-static intersection_t *NewIntersection(void)
+intersection_t *LevelBuilder::NewIntersection()
 {
 	intersection_t *cut;
+	intersection_t *& free_cuts = QuickAllocCuts();
 
-	if (quick_alloc_cuts)
+	if (free_cuts)
 	{
-		cut = quick_alloc_cuts;
-		quick_alloc_cuts = cut->next;
+		cut = free_cuts;
+		free_cuts = cut->next;
 	}
 	else
 	{
-		cut = (intersection_t *) UtilCalloc(sizeof(intersection_t));
+		cut = CurrentArena().alloc<intersection_t>();
 	}
 
 	return cut;
 }
 
 
-void FreeQuickAllocCuts(void)
-{
-	while (quick_alloc_cuts)
-	{
-		intersection_t *cut = quick_alloc_cuts;
-		quick_alloc_cuts = cut->next;
-
-		UtilFree(cut);
-	}
-}
-
-
 //
 // Fill in the fields 'angle', 'len', 'pdx', 'pdy', etc...
 //
@@ -170,7 +235,7 @@ void seg_t::Recompute()
 //       segs (except the one we are currently splitting) must exist
 //       on a singly-linked list somewhere.
 //
-static seg_t * SplitSeg(seg_t *old_seg, double x, double y, const Document &doc)
+seg_t * LevelBuilder::SplitSeg(seg_t *old_seg, double x, double y, const Document &doc)
 {
 	seg_t *new_seg;
 	vertex_t *new_vert;
@@ -183,6 +248,8 @@ static seg_t * SplitSeg(seg_t *old_seg, double x, double y, const Document &doc)
 		gLog.debugPrintf("Splitting Miniseg %p at (%1.1f,%1.1f)\n", old_seg, x, y);
 # endif
 
+	seg_splits.fetch_add(1, std::memory_order_relaxed);
+
 	new_vert = NewVertexFromSplitSeg(old_seg, x, y, doc);
 	new_seg  = NewSeg();
 
@@ -211,24 +278,51 @@ static seg_t * SplitSeg(seg_t *old_seg, double x, double y, const Document &doc)
 
 		new_seg->partner = NewSeg();
 
-		// copy seg info
-		// [ including the "next" field ]
-		new_seg->partner[0] = old_seg->partner[0];
+		SplitPartner(old_seg->partner, new_seg, new_vert);
+	}
+
+	return new_seg;
+}
+
 
-		// IMPORTANT: keep partner relationship valid.
-		new_seg->partner->partner = new_seg;
+void LevelBuilder::SplitPartner(seg_t *partner, seg_t *new_seg, vertex_t *new_vert)
+{
+	seg_t *new_partner = new_seg->partner;
 
-		old_seg->partner->start = new_vert;
-		new_seg->partner->end   = new_vert;
+	// the partner belongs to a subtree being built by another thread?
+	// then the split has to wait until that subtree is finished.
+	if (partner->owner != cur_subtree || partner->pending)
+	{
+		SYS_ASSERT(cur_subtree);
 
-		old_seg->partner->Recompute();
-		new_seg->partner->Recompute();
+		new_partner->pending = true;
 
-		// link it into list
-		old_seg->partner->next = new_seg->partner;
+		cur_subtree->partner_splits.push_back(partner_split_t { partner, new_seg, new_vert });
+		return;
 	}
 
-	return new_seg;
+	while (partner->replaced_by)
+		partner = partner->replaced_by;
+
+	// a copy of the partner is used elsewhere, which is now wrong
+	if (partner->lent)
+		partner->lent->stale = true;
+
+	// copy seg info
+	// [ including the "next" field ]
+	new_partner[0] = partner[0];
+
+	// IMPORTANT: keep partner relationship valid.
+	new_partner->partner = new_seg;
+
+	partner->start   = new_vert;
+	new_partner->end = new_vert;
+
+	partner->Recompute();
+	new_partner->Recompute();
+
+	// link it into list
+	partner->next = new_partner;
 }
 
 
@@ -274,7 +368,7 @@ static inline void ComputeIntersection(seg_t *seg, seg_t *part,
 }
 
 
-static void AddIntersection(intersection_t ** cut_list,
+void LevelBuilder::AddIntersection(intersection_t ** cut_list,
 		vertex_t *vert, seg_t *part, bool self_ref)
 {
 	bool open_before = VertexCheckOpen(vert, -part->pdx, -part->pdy);
@@ -344,7 +438,7 @@ static void AddIntersection(intersection_t ** cut_list,
 //
 // Returns true if a "bad seg" was found early.
 //
-static int EvalPartitionWorker(quadtree_c *tree, seg_t *part,
+int LevelBuilder::EvalPartitionWorker(quadtree_c *tree, seg_t *part,
 		int best_cost, eval_info_t *info, const Document &doc)
 {
 	double qnty;
@@ -376,9 +470,24 @@ static int EvalPartitionWorker(quadtree_c *tree, seg_t *part,
 
 	/* check partition against all Segs */
 
-	seg_t *check;
+	const seg_block_t &block = *tree->block;
 
-	for (check=tree->list ; check ; check=check->next)
+	const int *source_lines = block.source_line.data() + tree->block_first;
+	const int *linedefs = block.linedef.data() + tree->block_first;
+
+	// the distances are computed a few segs at a time, so that not
+	// much is wasted when a bad seg is found early.  They are not
+	// divided by the length of the partition yet.
+	double dist_a[EVAL_CHUNK];
+	double dist_b[EVAL_CHUNK];
+
+	// since 4 * p_length is exact, a seg which is found to be this far
+	// away would also pass the IFFY_LEN tests below.  dividing could
+	// only round a distance just below IFFY_LEN up to it, and such segs
+	// are checked properly.
+	double iffy_dist = IFFY_LEN * part->p_length;
+
+	for (int first = 0 ; first < tree->block_count ; first += EVAL_CHUNK)
 	{
 		// This is the heart of my pruning idea - it catches
 		// bad segs early on. Killough
@@ -386,130 +495,176 @@ static int EvalPartitionWorker(quadtree_c *tree, seg_t *part,
 		if (info->cost > best_cost)
 			return true;
 
-		/* get state of lines' relation to each other */
-		if (check->source_line == part->source_line)
+		int num = std::min(EVAL_CHUNK, tree->block_count - first);
+
+		unsigned right, left;
+
+		block.Distances(cur_info->kernel, part, tree->block_first + first, num, iffy_dist,
+						dist_a, dist_b, &right, &left);
+
+		unsigned same = 0;
+		unsigned real = 0;
+
+		for (int k = 0 ; k < num ; k++)
 		{
-			a = b = fa = fb = 0;
+			same |= (unsigned)(source_lines[first + k] == part->source_line) << k;
+			real |= (unsigned)(linedefs[first + k] >= 0) << k;
 		}
-		else
-		{
-			a = part->PerpDist(check->psx, check->psy);
-			b = part->PerpDist(check->pex, check->pey);
 
-			fa = fabs(a);
-			fb = fabs(b);
-		}
+		// segs which are well away from the partition do not change
+		// the cost, they only need to be counted.  Usually that is the
+		// whole chunk.
+		unsigned clean = (right | left) & ~same;
+
+		info->real_right += CountBits(right & clean &  real);
+		info->mini_right += CountBits(right & clean & ~real);
+		info->real_left  += CountBits(left  & clean &  real);
+		info->mini_left  += CountBits(left  & clean & ~real);
 
-		/* check for being on the same line */
-		if (fa <= DIST_EPSILON && fb <= DIST_EPSILON)
+		if (clean == (1u << num) - 1)
+			continue;
+
+		// the others are checked properly, in order
+		for (int k = 0 ; k < num ; k++)
 		{
-			// this seg runs along the same line as the partition.  Check
-			// whether it goes in the same direction or the opposite.
+			if (clean & (1u << k))
+				continue;
+
+			if (info->cost > best_cost)
+				return true;
+
+			int i = first + k;
+
+			int linedef = linedefs[i];
 
-			if (check->pdx*part->pdx + check->pdy*part->pdy < 0)
+			/* get state of lines' relation to each other */
+			if (source_lines[i] == part->source_line)
 			{
-				info->BumpLeft(check->linedef);
+				a = b = fa = fb = 0;
 			}
 			else
 			{
-				info->BumpRight(check->linedef);
-			}
-			continue;
-		}
+				// same as PerpDist()
+				a = dist_a[k] / part->p_length;
+				b = dist_b[k] / part->p_length;
 
-		// -AJA- check for passing through a vertex.  Normally this is fine
-		//       (even ideal), but the vertex could on a sector that we
-		//       DONT want to split, and the normal linedef-based checks
-		//       may fail to detect the sector being cut in half.  Thanks
-		//       to Janis Legzdinsh for spotting this obscure bug.
+				fa = fabs(a);
+				fb = fabs(b);
+			}
 
-		if (fa <= DIST_EPSILON || fb <= DIST_EPSILON)
-		{
-			if (check->linedef >= 0 && (doc.linedefs[check->linedef]->flags & MLF_IS_PRECIOUS))
-				info->cost += 40 * factor * PRECIOUS_MULTIPLY;
-		}
+			/* check for being on the same line */
+			if (fa <= DIST_EPSILON && fb <= DIST_EPSILON)
+			{
+				// this seg runs along the same line as the partition.  Check
+				// whether it goes in the same direction or the opposite.
+
+				const seg_t *check = block.segs[tree->block_first + i];
+
+				if (check->pdx*part->pdx + check->pdy*part->pdy < 0)
+				{
+					info->BumpLeft(linedef);
+				}
+				else
+				{
+					info->BumpRight(linedef);
+				}
+				continue;
+			}
 
-		/* check for right side */
-		if (a > -DIST_EPSILON && b > -DIST_EPSILON)
-		{
-			info->BumpRight(check->linedef);
+			// -AJA- check for passing through a vertex.  Normally this is fine
+			//       (even ideal), but the vertex could on a sector that we
+			//       DONT want to split, and the normal linedef-based checks
+			//       may fail to detect the sector being cut in half.  Thanks
+			//       to Janis Legzdinsh for spotting this obscure bug.
 
-			/* check for a near miss */
-			if ((a >= IFFY_LEN && b >= IFFY_LEN) ||
-				(a <= DIST_EPSILON && b >= IFFY_LEN) ||
-				(b <= DIST_EPSILON && a >= IFFY_LEN))
+			if (fa <= DIST_EPSILON || fb <= DIST_EPSILON)
 			{
-				continue;
+				if (linedef >= 0 && (doc.linedefs[linedef]->flags & MLF_IS_PRECIOUS))
+					info->cost += 40 * factor * PRECIOUS_MULTIPLY;
 			}
 
-			info->near_miss++;
+			/* check for right side */
+			if (a > -DIST_EPSILON && b > -DIST_EPSILON)
+			{
+				info->BumpRight(linedef);
 
-			// -AJA- near misses are bad, since they have the potential to
-			//       cause really short minisegs to be created in future
-			//       processing.  Thus the closer the near miss, the higher
-			//       the cost.
+				/* check for a near miss */
+				if ((a >= IFFY_LEN && b >= IFFY_LEN) ||
+					(a <= DIST_EPSILON && b >= IFFY_LEN) ||
+					(b <= DIST_EPSILON && a >= IFFY_LEN))
+				{
+					continue;
+				}
 
-			if (a <= DIST_EPSILON || b <= DIST_EPSILON)
-				qnty = IFFY_LEN / std::max(a, b);
-			else
-				qnty = IFFY_LEN / std::min(a, b);
+				info->near_miss++;
 
-			info->cost += (int) (100 * factor * (qnty * qnty - 1.0));
-			continue;
-		}
+				// -AJA- near misses are bad, since they have the potential to
+				//       cause really short minisegs to be created in future
+				//       processing.  Thus the closer the near miss, the higher
+				//       the cost.
 
-		/* check for left side */
-		if (a < DIST_EPSILON && b < DIST_EPSILON)
-		{
-			info->BumpLeft(check->linedef);
+				if (a <= DIST_EPSILON || b <= DIST_EPSILON)
+					qnty = IFFY_LEN / std::max(a, b);
+				else
+					qnty = IFFY_LEN / std::min(a, b);
 
-			/* check for a near miss */
-			if ((a <= -IFFY_LEN && b <= -IFFY_LEN) ||
-				(a >= -DIST_EPSILON && b <= -IFFY_LEN) ||
-				(b >= -DIST_EPSILON && a <= -IFFY_LEN))
-			{
+				info->cost += (int) (100 * factor * (qnty * qnty - 1.0));
 				continue;
 			}
 
-			info->near_miss++;
+			/* check for left side */
+			if (a < DIST_EPSILON && b < DIST_EPSILON)
+			{
+				info->BumpLeft(linedef);
 
-			// the closer the miss, the higher the cost (see note above)
-			if (a >= -DIST_EPSILON || b >= -DIST_EPSILON)
-				qnty = IFFY_LEN / -std::min(a, b);
-			else
-				qnty = IFFY_LEN / -std::max(a, b);
+				/* check for a near miss */
+				if ((a <= -IFFY_LEN && b <= -IFFY_LEN) ||
+					(a >= -DIST_EPSILON && b <= -IFFY_LEN) ||
+					(b >= -DIST_EPSILON && a <= -IFFY_LEN))
+				{
+					continue;
+				}
 
-			info->cost += (int) (70 * factor * (qnty * qnty - 1.0));
-			continue;
-		}
+				info->near_miss++;
 
-		// When we reach here, we have a and b non-zero and opposite sign,
-		// hence this seg will be split by the partition line.
+				// the closer the miss, the higher the cost (see note above)
+				if (a >= -DIST_EPSILON || b >= -DIST_EPSILON)
+					qnty = IFFY_LEN / -std::min(a, b);
+				else
+					qnty = IFFY_LEN / -std::max(a, b);
 
-		info->splits++;
+				info->cost += (int) (70 * factor * (qnty * qnty - 1.0));
+				continue;
+			}
 
-		// If the linedef associated with this seg has a tag >= 900, treat
-		// it as precious; i.e. don't split it unless all other options
-		// are exhausted.  This is used to protect deep water and invisible
-		// lifts/stairs from being messed up accidentally by splits.
+			// When we reach here, we have a and b non-zero and opposite sign,
+			// hence this seg will be split by the partition line.
 
-		if (check->linedef >= 0 && (doc.linedefs[check->linedef]->flags & MLF_IS_PRECIOUS))
-			info->cost += 100 * factor * PRECIOUS_MULTIPLY;
-		else
-			info->cost += 100 * factor;
+			info->splits++;
 
-		// -AJA- check if the split point is very close to one end, which
-		//       an undesirable situation (producing really short segs).
-		//       This is perhaps _one_ source of those darn slime trails.
-		//       Hence the name "IFFY segs", and a rather hefty surcharge.
+			// If the linedef associated with this seg has a tag >= 900, treat
+			// it as precious; i.e. don't split it unless all other options
+			// are exhausted.  This is used to protect deep water and invisible
+			// lifts/stairs from being messed up accidentally by splits.
 
-		if (fa < IFFY_LEN || fb < IFFY_LEN)
-		{
-			info->iffy++;
+			if (linedef >= 0 && (doc.linedefs[linedef]->flags & MLF_IS_PRECIOUS))
+				info->cost += 100 * factor * PRECIOUS_MULTIPLY;
+			else
+				info->cost += 100 * factor;
+
+			// -AJA- check if the split point is very close to one end, which
+			//       an undesirable situation (producing really short segs).
+			//       This is perhaps _one_ source of those darn slime trails.
+			//       Hence the name "IFFY segs", and a rather hefty surcharge.
+
+			if (fa < IFFY_LEN || fb < IFFY_LEN)
+			{
+				info->iffy++;
 
-			// the closer to the end, the higher the cost
-			qnty = IFFY_LEN / std::min(fa, fb);
-			info->cost += (int) (140 * factor * (qnty * qnty - 1.0));
+				// the closer to the end, the higher the cost
+				qnty = IFFY_LEN / std::min(fa, fb);
+				info->cost += (int) (140 * factor * (qnty * qnty - 1.0));
+			}
 		}
 	}
 
@@ -536,8 +691,10 @@ static int EvalPartitionWorker(quadtree_c *tree, seg_t *part,
 // Returns the computed cost, or a negative value if the seg should be
 // skipped altogether.
 //
-static int EvalPartition(quadtree_c *tree, seg_t *part, int best_cost, const Document &doc)
+int LevelBuilder::EvalPartition(quadtree_c *tree, seg_t *part, int best_cost, const Document &doc)
 {
+	partitions_evaluated.fetch_add(1, std::memory_order_relaxed);
+
 	eval_info_t info;
 
 	/* initialise info structure */
@@ -578,7 +735,7 @@ static int EvalPartition(quadtree_c *tree, seg_t *part, int best_cost, const Doc
 	//       partition lines that lie either purely horizontally or
 	//       purely vertically.
 
-	if (part->pdx != 0 && part->pdy != 0)
+	if (cur_info->axis_bias && part->pdx != 0 && part->pdy != 0)
 		info.cost += 25;
 
 # if DEBUG_PICKNODE
@@ -649,7 +806,7 @@ static void EvaluateFastWorker(quadtree_c *tree,
 }
 
 
-static seg_t *FindFastSeg(quadtree_c *tree, const Document &doc)
+seg_t *LevelBuilder::FindFastSeg(quadtree_c *tree, const Document &doc)
 {
 	seg_t *best_H = NULL;
 	seg_t *best_V = NULL;
@@ -684,7 +841,7 @@ static seg_t *FindFastSeg(quadtree_c *tree, const Document &doc)
 
 
 /* returns false if cancelled */
-static bool PickNodeWorker(quadtree_c *part_list,
+bool LevelBuilder::PickNodeWorker(quadtree_c *part_list,
 		quadtree_c *tree, seg_t ** best, int *best_cost, const Document &doc)
 {
 	// try each partition
@@ -730,10 +887,115 @@ static bool PickNodeWorker(quadtree_c *part_list,
 }
 
 
+static void CollectPartitionCandidates(quadtree_c *tree, std::vector<seg_t *> &candidates)
+{
+	for (seg_t *part=tree->list ; part ; part = part->next)
+	{
+		/* ignore minisegs as partition candidates */
+		if (part->linedef >= 0)
+			candidates.push_back(part);
+	}
+
+	for (int c=0 ; c < 2 ; c++)
+	{
+		if (tree->subs[c] && !tree->subs[c]->Empty())
+		{
+			CollectPartitionCandidates(tree->subs[c], candidates);
+		}
+	}
+}
+
+
+//
+// Same as PickNodeWorker(), but the candidates are split into chunks
+// which are evaluated on the task pool.  The lowest cost found so far
+// is shared between the chunks for pruning, and ties are resolved in
+// favor of the earliest candidate, hence the choice is exactly what
+// the serial search would make.
+//
+// returns false if cancelled.
+//
+bool LevelBuilder::PickNodeParallel(quadtree_c *tree, seg_t ** best,
+		int *best_cost, const Document &doc)
+{
+	std::vector<seg_t *> candidates;
+
+	CollectPartitionCandidates(tree, candidates);
+
+	if (candidates.empty())
+		return true;
+
+	TaskPool &pool = TaskPool::global();
+
+	int num_chunks = std::min((int)candidates.size(), (pool.numWorkers() + 1) * 4);
+
+	struct chunk_result_t
+	{
+		seg_t *best = NULL;
+		int cost = INT_MAX;
+	};
+
+	std::vector<chunk_result_t> results(num_chunks);
+
+	std::atomic<int> shared_cost(INT_MAX);
+
+	TaskGroup group(pool);
+
+	for (int c = 0 ; c < num_chunks ; c++)
+	{
+		size_t first = candidates.size() *  c      / num_chunks;
+		size_t last  = candidates.size() * (c + 1) / num_chunks;
+
+		group.run([&, c, first, last]()
+		{
+			chunk_result_t &res = results[c];
+
+			for (size_t k = first ; k < last ; k++)
+			{
+				if (cur_info->cancelled)
+					return;
+
+				int bound = std::min(res.cost, shared_cost.load());
+				int cost  = EvalPartition(tree, candidates[k], bound, doc);
+
+				// an equal cost found in a later chunk does not stop us,
+				// since this candidate comes first.
+				if (cost < 0 || cost >= res.cost || cost > shared_cost)
+					continue;
+
+				res.cost = cost;
+				res.best = candidates[k];
+
+				int old_cost = shared_cost.load();
+
+				while (cost < old_cost && ! shared_cost.compare_exchange_weak(old_cost, cost))
+				{ }
+			}
+		});
+	}
+
+	group.wait();
+
+	if (cur_info->cancelled)
+		return false;
+
+	for (const chunk_result_t &res : results)
+	{
+		if (res.best && res.cost < *best_cost)
+		{
+			(*best_cost) = res.cost;
+			(*best) = res.best;
+		}
+	}
+
+	return true;
+}
+
+
 //
 // Find the best seg in the seg_list to use as a partition line.
 //
-static seg_t *PickNode(quadtree_c *tree, int depth, const Document &doc)
+seg_t *LevelBuilder::PickNode(quadtree_c *tree, int depth, const Document &doc)
 {
 	seg_t *best=NULL;
 
@@ -766,7 +1028,14 @@ static seg_t *PickNode(quadtree_c *tree, int depth, const Document &doc)
 		}
 	}
 
-	if (! PickNodeWorker(tree, tree, &best, &best_cost, doc))
+	bool finished;
+
+	if (tree->real_num >= SEG_PARALLEL_THRESHHOLD && TaskPool::global().numWorkers() > 0)
+		finished = PickNodeParallel(tree, &best, &best_cost, doc);
+	else
+		finished = PickNodeWorker(tree, tree, &best, &best_cost, doc);
+
+	if (! finished)
 	{
 		/* hack here : BuildNodes will detect the cancellation */
 		return NULL;
@@ -800,7 +1069,7 @@ static seg_t *PickNode(quadtree_c *tree, int depth, const Document &doc)
 //       same logic when determining which segs should go left, right
 //       or be split.
 //
-static void DivideOneSeg(seg_t *seg, seg_t *part,
+void LevelBuilder::DivideOneSeg(seg_t *seg, seg_t *part,
 		seg_t **left_list, seg_t **right_list,
 		intersection_t ** cut_list, const Document &doc)
 {
@@ -884,7 +1153,7 @@ static void DivideOneSeg(seg_t *seg, seg_t *part,
 }
 
 
-static void SeparateSegs(quadtree_c *tree, seg_t *part,
+void LevelBuilder::SeparateSegs(quadtree_c *tree, seg_t *part,
 		seg_t **left_list, seg_t **right_list,
 		intersection_t ** cut_list, const Document &doc)
 {
@@ -944,7 +1213,7 @@ void FindLimits2(seg_t *list, bbox_t *bbox)
 }
 
 
-void AddMinisegs(intersection_t *cut_list, seg_t *part,
+void LevelBuilder::AddMinisegs(intersection_t *cut_list, seg_t *part,
 		seg_t **left_list, seg_t **right_list)
 {
 	if (! cut_list)
@@ -1033,13 +1302,15 @@ void AddMinisegs(intersection_t *cut_list, seg_t *part,
 	}
 
 	// free intersection structures into quick-alloc list
+	intersection_t *& free_cuts = QuickAllocCuts();
+
 	while (cut_list)
 	{
 		cur = cut_list;
 		cut_list = cur->next;
 
-		cur->next = quick_alloc_cuts;
-		quick_alloc_cuts = cur;
+		cur->next = free_cuts;
+		free_cuts = cur;
 	}
 }
 
@@ -1150,10 +1421,19 @@ void quadtree_c::VerifySide(seg_t *part, int side)
 #endif
 
 
-void node_t::SetPartition(const seg_t *part, const Instance &inst)
+void node_t::SetPartition(const seg_t *part, LevelBuilder &builder)
 {
+	const Instance &inst = builder.inst;
+
 	SYS_ASSERT(part->linedef >= 0);
 
+	part_line = part->linedef;
+
+	part_x1 = part->psx;
+	part_y1 = part->psy;
+	part_x2 = part->pex;
+	part_y2 = part->pey;
+
 	const LineDef *part_L = inst.level.linedefs[part->linedef];
 
 	if (part->side == 0)  /* right side */
@@ -1186,7 +1466,7 @@ void node_t::SetPartition(const seg_t *part, const Instance &inst)
 		{
 			if (((int)dx | (int)dy) & 1)
 			{
-				Warning(inst, "Loss of accuracy on VERY long node: "
+				builder.Warning("Loss of accuracy on VERY long node: "
 						"(%f,%f) -> (%f,%f)\n", x, y, x + dx, y+ dy);
 			}
 
@@ -1203,7 +1483,9 @@ quadtree_c::quadtree_c(int _x1, int _y1, int _x2, int _y2) :
 	x1(_x1), y1(_y1),
 	x2(_x2), y2(_y2),
 	real_num(0), mini_num(0),
-	list(NULL)
+	list(NULL),
+	block(NULL), block_first(0), block_count(0),
+	arrays(NULL)
 {
 	int dx = x2 - x1;
 	int dy = y2 - y1;
@@ -1231,6 +1513,8 @@ quadtree_c::~quadtree_c()
 {
 	if (subs[0] != NULL) delete subs[0];
 	if (subs[1] != NULL) delete subs[1];
+
+	delete arrays;
 }
 
 
@@ -1318,8 +1602,195 @@ void quadtree_c::ConvertToList(seg_t **_list)
 }
 
 
-static seg_t *CreateOneSeg(int line, vertex_t *start, vertex_t *end,
-		int sidedef, int what_side /* 0 or 1 */, const Instance &inst)
+static void FlattenBlock(quadtree_c *tree, seg_block_t *arrays)
+{
+	tree->block = arrays;
+	tree->block_first = arrays->Add(tree->list);
+	tree->block_count = arrays->count - tree->block_first;
+
+	if (tree->subs[0] != NULL)
+	{
+		FlattenBlock(tree->subs[0], arrays);
+		FlattenBlock(tree->subs[1], arrays);
+	}
+}
+
+
+void quadtree_c::Flatten()
+{
+	SYS_ASSERT(arrays == NULL);
+
+	arrays = new seg_block_t;
+
+	int total = real_num + mini_num;
+
+	arrays->sx.reserve(total);
+	arrays->sy.reserve(total);
+	arrays->ex.reserve(total);
+	arrays->ey.reserve(total);
+
+	arrays->source_line.reserve(total);
+	arrays->linedef.reserve(total);
+	arrays->segs.reserve(total);
+
+	FlattenBlock(this, arrays);
+}
+
+
+/* ----- seg block routines ------------------------------------ */
+
+int seg_block_t::Add(seg_t *list)
+{
+	int first = count;
+
+	for (seg_t *seg = list ; seg ; seg = seg->next)
+	{
+		sx.push_back(seg->psx);
+		sy.push_back(seg->psy);
+		ex.push_back(seg->pex);
+		ey.push_back(seg->pey);
+
+		source_line.push_back(seg->source_line);
+		linedef.push_back(seg->linedef);
+		segs.push_back(seg);
+
+		count++;
+	}
+
+	return first;
+}
+
+
+//
+// The vector versions do exactly the same operations as PerpDist()
+// (apart from the final division), in the same order, hence the
+// results are identical.  This would not hold if the compiler were
+// told to fuse multiplies and adds.
+//
+
+static inline void Distances_Scalar(const double *sx, const double *sy,
+		const double *ex, const double *ey, int i, int num, const seg_t *part,
+		double margin, double *a, double *b, unsigned &right, unsigned &left)
+{
+	for ( ; i < num ; i++)
+	{
+		a[i] = sx[i] * part->pdy - sy[i] * part->pdx + part->p_perp;
+		b[i] = ex[i] * part->pdy - ey[i] * part->pdx + part->p_perp;
+
+		right |= (unsigned)(a[i] >=  margin && b[i] >=  margin) << i;
+		left  |= (unsigned)(a[i] <= -margin && b[i] <= -margin) << i;
+	}
+}
+
+#if BSP_HAVE_SSE2
+
+static void Distances_SSE2(const double *sx, const double *sy,
+		const double *ex, const double *ey, int num, const seg_t *part,
+		double margin, double *a, double *b, unsigned &right, unsigned &left)
+{
+	__m128d pdx  = _mm_set1_pd(part->pdx);
+	__m128d pdy  = _mm_set1_pd(part->pdy);
+	__m128d perp = _mm_set1_pd(part->p_perp);
+
+	__m128d hi = _mm_set1_pd( margin);
+	__m128d lo = _mm_set1_pd(-margin);
+
+	int i = 0;
+
+	for ( ; i + 2 <= num ; i += 2)
+	{
+		__m128d da = _mm_sub_pd(_mm_mul_pd(_mm_loadu_pd(sx + i), pdy),
+								_mm_mul_pd(_mm_loadu_pd(sy + i), pdx));
+		__m128d db = _mm_sub_pd(_mm_mul_pd(_mm_loadu_pd(ex + i), pdy),
+								_mm_mul_pd(_mm_loadu_pd(ey + i), pdx));
+
+		da = _mm_add_pd(da, perp);
+		db = _mm_add_pd(db, perp);
+
+		_mm_storeu_pd(a + i, da);
+		_mm_storeu_pd(b + i, db);
+
+		right |= (unsigned)_mm_movemask_pd(_mm_and_pd(_mm_cmpge_pd(da, hi), _mm_cmpge_pd(db, hi))) << i;
+		left  |= (unsigned)_mm_movemask_pd(_mm_and_pd(_mm_cmple_pd(da, lo), _mm_cmple_pd(db, lo))) << i;
+	}
+
+	Distances_Scalar(sx, sy, ex, ey, i, num, part, margin, a, b, right, left);
+}
+
+BSP_TARGET_AVX2
+static void Distances_AVX2(const double *sx, const double *sy,
+		const double *ex, const double *ey, int num, const seg_t *part,
+		double margin, double *a, double *b, unsigned &right, unsigned &left)
+{
+	__m256d pdx  = _mm256_set1_pd(part->pdx);
+	__m256d pdy  = _mm256_set1_pd(part->pdy);
+	__m256d perp = _mm256_set1_pd(part->p_perp);
+
+	__m256d hi = _mm256_set1_pd( margin);
+	__m256d lo = _mm256_set1_pd(-margin);
+
+	int i = 0;
+
+	for ( ; i + 4 <= num ; i += 4)
+	{
+		__m256d da = _mm256_sub_pd(_mm256_mul_pd(_mm256_loadu_pd(sx + i), pdy),
+								   _mm256_mul_pd(_mm256_loadu_pd(sy + i), pdx));
+		__m256d db = _mm256_sub_pd(_mm256_mul_pd(_mm256_loadu_pd(ex + i), pdy),
+								   _mm256_mul_pd(_mm256_loadu_pd(ey + i), pdx));
+
+		da = _mm256_add_pd(da, perp);
+		db = _mm256_add_pd(db, perp);
+
+		_mm256_storeu_pd(a + i, da);
+		_mm256_storeu_pd(b + i, db);
+
+		right |= (unsigned)_mm256_movemask_pd(_mm256_and_pd(_mm256_cmp_pd(da, hi, _CMP_GE_OQ),
+															 _mm256_cmp_pd(db, hi, _CMP_GE_OQ))) << i;
+		left  |= (unsigned)_mm256_movemask_pd(_mm256_and_pd(_mm256_cmp_pd(da, lo, _CMP_LE_OQ),
+															 _mm256_cmp_pd(db, lo, _CMP_LE_OQ))) << i;
+	}
+
+	Distances_Scalar(sx, sy, ex, ey, i, num, part, margin, a, b, right, left);
+}
+
+#endif
+
+
+void seg_block_t::Distances(eval_kernel_e kernel, const seg_t *part, int first, int num,
+		double margin, double *a, double *b, unsigned *right, unsigned *left) const
+{
+	const double *sx = this->sx.data() + first;
+	const double *sy = this->sy.data() + first;
+	const double *ex = this->ex.data() + first;
+	const double *ey = this->ey.data() + first;
+
+	unsigned R = 0;
+	unsigned L = 0;
+
+	switch (kernel)
+	{
+#if BSP_HAVE_SSE2
+	case EVAL_AVX2:
+		Distances_AVX2(sx, sy, ex, ey, num, part, margin, a, b, R, L);
+		break;
+
+	case EVAL_SSE2:
+		Distances_SSE2(sx, sy, ex, ey, num, part, margin, a, b, R, L);
+		break;
+#endif
+
+	default:
+		Distances_Scalar(sx, sy, ex, ey, 0, num, part, margin, a, b, R, L);
+		break;
+	}
+
+	*right = R;
+	*left  = L;
+}
+
+
+seg_t *LevelBuilder::CreateOneSeg(int line, vertex_t *start, vertex_t *end,
+		int sidedef, int what_side /* 0 or 1 */)
 {
 	SideDef *sd = NULL;
 	if (sidedef >= 0)
@@ -1328,7 +1799,7 @@ static seg_t *CreateOneSeg(int line, vertex_t *start, vertex_t *end,
 	// check for bad sidedef
 	if (sd && !inst.level.isSector(sd->sector))
 	{
-		Warning(inst, "Bad sidedef on linedef #%d (Z_CheckHeap error)\n", line);
+		Warning("Bad sidedef on linedef #%d (Z_CheckHeap error)\n", line);
 	}
 
 	// handle overlapping vertices, pick a nominal one
@@ -1356,7 +1827,7 @@ static seg_t *CreateOneSeg(int line, vertex_t *start, vertex_t *end,
 // Initially create all segs, one for each linedef.
 // Must be called *after* InitBlockmap().
 //
-seg_t *CreateSegs(const Instance &inst)
+seg_t *LevelBuilder::CreateSegs()
 {
 	seg_t *list = NULL;
 
@@ -1377,22 +1848,22 @@ seg_t *CreateSegs(const Instance &inst)
 
 		// check for extremely long lines
 		if (line->CalcLength(inst.level) >= 30000)
-			Warning(inst, "Linedef #%d is VERY long, it may cause problems\n", i);
+			Warning("Linedef #%d is VERY long, it may cause problems\n", i);
 
 		if (line->right >= 0)
 		{
-			right = CreateOneSeg(i, lev_vertices[line->start], lev_vertices[line->end], line->right, 0, inst);
+			right = CreateOneSeg(i, lev_vertices[line->start], lev_vertices[line->end], line->right, 0);
 
 			ListAddSeg(&list, right);
 		}
 		else
 		{
-			Warning(inst, "Linedef #%d has no right sidedef!\n", i);
+			Warning("Linedef #%d has no right sidedef!\n", i);
 		}
 
 		if (line->left >= 0)
 		{
-			left = CreateOneSeg(i, lev_vertices[line->end], lev_vertices[line->start], line->left, 1, inst);
+			left = CreateOneSeg(i, lev_vertices[line->end], lev_vertices[line->start], line->left, 1);
 
 			ListAddSeg(&list, left);
 
@@ -1409,7 +1880,7 @@ seg_t *CreateSegs(const Instance &inst)
 		else
 		{
 			if (line->flags & MLF_TwoSided)
-				Warning(inst, "Linedef #%d is 2s but has no left sidedef\n", i);
+				Warning("Linedef #%d is 2s but has no left sidedef\n", i);
 		}
 	}
 
@@ -1422,6 +1893,7 @@ static quadtree_c *TreeFromSegList(seg_t *list, const bbox_t *bounds)
 	quadtree_c *tree = new quadtree_c(bounds->minx, bounds->miny, bounds->maxx, bounds->maxy);
 
 	tree->AddList(list);
+	tree->Flatten();
 
 	return tree;
 }
@@ -1607,7 +2079,7 @@ void subsec_t::SanityCheckHasRealSeg()
 }
 
 
-void subsec_t::RenumberSegs()
+void subsec_t::RenumberSegs(int &next_index)
 {
 	seg_t *seg;
 
@@ -1619,8 +2091,8 @@ void subsec_t::RenumberSegs()
 
 	for (seg=seg_list ; seg ; seg=seg->next)
 	{
-		seg->index = current_seg_index;
-		current_seg_index++;
+		seg->index = next_index;
+		next_index++;
 
 		seg_count++;
 
@@ -1635,12 +2107,14 @@ void subsec_t::RenumberSegs()
 //
 // Create a subsector from a list of segs.
 //
-static subsec_t *CreateSubsector(quadtree_c *tree)
+subsec_t *LevelBuilder::CreateSubsector(quadtree_c *tree)
 {
 	subsec_t *sub = NewSubsec();
 
-	// compute subsector's index
-	sub->index = num_subsecs - 1;
+	// the index is set once the whole tree has been built
+	sub->index = -1;
+
+	segs_finished += tree->real_num;
 
 	// copy segs into subsector
 	// [ assumes seg_list field is NULL ]
@@ -1687,8 +2161,65 @@ static void DebugShowSegs(seg_t *list)
 #endif
 
 
-build_result_e BuildNodes(seg_t *list, bbox_t *bounds /* output */,
-						  node_t ** N, subsec_t ** S, int depth, const Instance &inst)
+static bool IsLargeList(const seg_t *list)
+{
+	int count = 0;
+
+	for ( ; list ; list = list->next)
+		if (++count >= SUBTREE_PARALLEL_THRESHHOLD)
+			return true;
+
+	return false;
+}
+
+
+//
+// Checks whether building the left half could split a seg whose partner
+// is in the right half (only segs on the partition line can be like
+// that).  The right half would then be built again, hence there is no
+// point in building it in parallel.
+//
+static bool MaySplitSharedSegs(const seg_t *lefts, const seg_t *rights)
+{
+	std::unordered_set<const seg_t *> right_segs;
+
+	for (const seg_t *seg = rights ; seg ; seg = seg->next)
+		right_segs.insert(seg);
+
+	std::vector<const seg_t *> shared;
+
+	for (const seg_t *seg = lefts ; seg ; seg = seg->next)
+		if (seg->partner && right_segs.count(seg->partner) > 0)
+			shared.push_back(seg);
+
+	// the pieces of a split seg can be very slightly off its line
+	const double margin = DIST_EPSILON / 2;
+
+	// every partition in the left half lies along one of its real segs
+	for (const seg_t *part = lefts ; part && ! shared.empty() ; part = part->next)
+	{
+		if (part->linedef < 0)
+			continue;
+
+		for (const seg_t *seg : shared)
+		{
+			double a = part->PerpDist(seg->psx, seg->psy);
+			double b = part->PerpDist(seg->pex, seg->pey);
+
+			if (std::min(a, b) < margin - DIST_EPSILON &&
+				std::max(a, b) > DIST_EPSILON - margin)
+			{
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+
+build_result_e LevelBuilder::BuildNodes(seg_t *list, bbox_t *bounds /* output */,
+						  node_t ** N, subsec_t ** S, int depth, int cached)
 {
 	*N = NULL;
 	*S = NULL;
@@ -1708,7 +2239,28 @@ build_result_e BuildNodes(seg_t *list, bbox_t *bounds /* output */,
 
 
 	/* pick partition line  None indicates convexicity */
-	seg_t *part = PickNode(tree, depth, inst.level);
+	seg_t *part = NULL;
+
+	if (cached >= 0)
+		part = FindCachedPartition(tree, cached);
+
+	if (part == NULL)
+	{
+		// the halves are different now, nothing below is reused
+		cached = -1;
+
+		auto start = std::chrono::steady_clock::now();
+
+		part = PickNode(tree, depth, inst.level);
+		partitions_searched++;
+
+		picknode_nanos += std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now() - start).count();
+	}
+	else
+	{
+		partitions_reused++;
+	}
 
 	if (part == NULL)
 	{
@@ -1753,14 +2305,24 @@ build_result_e BuildNodes(seg_t *list, bbox_t *bounds /* output */,
 
 	AddMinisegs(cut_list, part, &lefts, &rights);
 
-	node->SetPartition(part, inst);
+	node->SetPartition(part, *this);
+
+	int cached_left  = (cached >= 0) ? cache->partitions[cached].left  : -1;
+	int cached_right = (cached >= 0) ? cache->partitions[cached].right : -1;
+
+	if (IsLargeList(lefts) && IsLargeList(rights) &&
+		TaskPool::global().numWorkers() > 0 &&
+		! MaySplitSharedSegs(lefts, rights))
+	{
+		return BuildSidesInParallel(node, lefts, rights, depth, cached_left, cached_right);
+	}
 
 # if DEBUG_BUILDER
 	gLog.debugPrintf("Build: Going LEFT\n");
 # endif
 
 	build_result_e ret;
-	ret = BuildNodes(lefts, &node->l.bounds, &node->l.node, &node->l.subsec, depth+1, inst);
+	ret = BuildNodes(lefts, &node->l.bounds, &node->l.node, &node->l.subsec, depth+1, cached_left);
 
 	if (ret != BUILD_OK)
 		return ret;
@@ -1769,7 +2331,7 @@ build_result_e BuildNodes(seg_t *list, bbox_t *bounds /* output */,
 	gLog.debugPrintf("Build: Going RIGHT\n");
 # endif
 
-	ret = BuildNodes(rights, &node->r.bounds, &node->r.node, &node->r.subsec, depth+1, inst);
+	ret = BuildNodes(rights, &node->r.bounds, &node->r.node, &node->r.subsec, depth+1, cached_right);
 
 # if DEBUG_BUILDER
 	gLog.debugPrintf("Build: DONE\n");
@@ -1779,7 +2341,350 @@ build_result_e BuildNodes(seg_t *list, bbox_t *bounds /* output */,
 }
 
 
-void ClockwiseBspTree(const Document &doc)
+//------------------------------------------------------------------------
+// CACHE : Reusing the partitions of the previous build.
+//------------------------------------------------------------------------
+
+static seg_t *FindSegInTree(quadtree_c *tree, const nodebuildcache_t::partition_t &P)
+{
+	for (seg_t *seg = tree->list ; seg ; seg = seg->next)
+	{
+		if (seg->linedef == P.linedef &&
+			seg->psx == P.x1 && seg->psy == P.y1 &&
+			seg->pex == P.x2 && seg->pey == P.y2)
+		{
+			return seg;
+		}
+	}
+
+	for (int c=0 ; c < 2 ; c++)
+	{
+		if (tree->subs[c] && !tree->subs[c]->Empty())
+		{
+			seg_t *seg = FindSegInTree(tree->subs[c], P);
+
+			if (seg)
+				return seg;
+		}
+	}
+
+	return NULL;
+}
+
+
+//
+// The seg must be exactly where it was, which is always the case when
+// nothing above it in the tree has changed.  Partitions above a change
+// are kept too, as long as they still have real segs on both sides.
+//
+seg_t *LevelBuilder::FindCachedPartition(quadtree_c *tree, int cached)
+{
+	seg_t *part = FindSegInTree(tree, cache->partitions[cached]);
+
+	if (part == NULL)
+		return NULL;
+
+	if (EvalPartition(tree, part, INT_MAX, inst.level) < 0)
+		return NULL;
+
+	return part;
+}
+
+
+static int StorePartitions(std::vector<nodebuildcache_t::partition_t> &list, const node_t *node)
+{
+	int index = (int)list.size();
+
+	list.push_back({ node->part_line,
+					 node->part_x1, node->part_y1,
+					 node->part_x2, node->part_y2, -1, -1 });
+
+	// the list may be re-allocated by these
+	int right = node->r.node ? StorePartitions(list, node->r.node) : -1;
+	int left  = node->l.node ? StorePartitions(list, node->l.node) : -1;
+
+	list[index].right = right;
+	list[index].left  = left;
+
+	return index;
+}
+
+
+void LevelBuilder::StoreCache()
+{
+	cache->partitions.clear();
+
+	cache->level_name = lev_current_name;
+	cache->factor = cur_info->factor;
+	cache->fast   = cur_info->fast;
+	cache->axis_bias = cur_info->axis_bias;
+
+	if (root_node)
+		StorePartitions(cache->partitions, root_node);
+}
+
+
+//------------------------------------------------------------------------
+// SUBTREES : Building both halves of a node at the same time.
+//------------------------------------------------------------------------
+
+thread_local subtree_t *LevelBuilder::cur_subtree = NULL;
+
+
+build_result_e LevelBuilder::BuildSidesInParallel(node_t *node, seg_t *lefts,
+		seg_t *rights, int depth, int cached_left, int cached_right)
+{
+	subtree_t right;
+
+	seg_t *copies = LendSegs(rights, right);
+
+	TaskGroup group;
+
+	group.run([&]()
+	{
+		subtree_t *saved = cur_subtree;
+		cur_subtree = &right;
+
+		try
+		{
+			right.result = BuildNodes(copies, &right.bounds, &right.node, &right.subsec,
+									  depth+1, cached_right);
+		}
+		catch (...)
+		{
+			right.error = std::current_exception();
+		}
+
+		cur_subtree = saved;
+	});
+
+	build_result_e ret = BUILD_OK;
+	std::exception_ptr error;
+
+	try
+	{
+		ret = BuildNodes(lefts, &node->l.bounds, &node->l.node, &node->l.subsec,
+						 depth+1, cached_left);
+	}
+	catch (...)
+	{
+		error = std::current_exception();
+	}
+
+	// the task stores any error itself
+	group.wait();
+
+	if (error || ret != BUILD_OK || right.stale)
+	{
+		DiscardSubtree(right, rights);
+
+		if (error)
+			std::rethrow_exception(error);
+
+		if (ret != BUILD_OK)
+			return ret;
+
+		// the left half has split some segs of the right half, so build
+		// it again from those (exactly like a serial build would).
+		return BuildNodes(rights, &node->r.bounds, &node->r.node, &node->r.subsec,
+						  depth+1, cached_right);
+	}
+
+	JoinSubtree(right);
+
+	node->r.bounds = right.bounds;
+	node->r.node   = right.node;
+	node->r.subsec = right.subsec;
+
+	if (right.error)
+		std::rethrow_exception(right.error);
+
+	return right.result;
+}
+
+
+//
+// Copies the segs of the list for use by the subtree, and returns the
+// new list.  The partners of the copies are copies too, except when
+// they are outside of the list.
+//
+seg_t *LevelBuilder::LendSegs(seg_t *list, subtree_t &sub)
+{
+	std::unordered_map<const seg_t *, seg_t *> copy_of;
+
+	seg_t *head = NULL;
+	seg_t *tail = NULL;
+
+	for (seg_t *seg = list ; seg ; seg = seg->next)
+	{
+		seg_t *copy = sub.arena.alloc<seg_t>();
+
+		copy[0] = seg[0];
+		copy->next  = NULL;
+		copy->owner = &sub;
+
+		seg->lent = &sub;
+
+		sub.segs.push_back(copy);
+		sub.lent.push_back(seg);
+		sub.copies.push_back(copy);
+
+		copy_of[seg] = copy;
+
+		if (tail)
+			tail->next = copy;
+		else
+			head = copy;
+
+		tail = copy;
+	}
+
+	for (seg_t *copy : sub.copies)
+	{
+		if (! copy->partner)
+			continue;
+
+		auto it = copy_of.find(copy->partner);
+
+		if (it != copy_of.end())
+			copy->partner = it->second;
+		else
+			sub.outer_copies.push_back(copy);
+	}
+
+	return head;
+}
+
+
+//
+// Adds everything created by the subtree to the current one (or to
+// the level), replaces the lent segs by their copies, and does the
+// postponed splits of partners.
+//
+void LevelBuilder::JoinSubtree(subtree_t &sub)
+{
+	for (size_t i = 0 ; i < sub.lent.size() ; i++)
+	{
+		seg_t *seg = sub.lent[i];
+
+		seg->lent  = NULL;
+		seg->index = SEG_IS_GARBAGE;
+		seg->replaced_by = sub.copies[i];
+	}
+
+	for (seg_t *seg : sub.segs)
+		seg->owner = cur_subtree;
+
+	auto append = [](auto &dest, auto &src)
+	{
+		dest.insert(dest.end(), src.begin(), src.end());
+		src.clear();
+	};
+
+	if (cur_subtree)
+	{
+		append(cur_subtree->vertices, sub.vertices);
+		append(cur_subtree->segs,     sub.segs);
+		append(cur_subtree->subsecs,  sub.subsecs);
+		append(cur_subtree->nodes,    sub.nodes);
+		append(cur_subtree->walltips, sub.walltips);
+	}
+	else
+	{
+		append(lev_vertices, sub.vertices);
+		append(lev_segs,     sub.segs);
+		append(lev_subsecs,  sub.subsecs);
+		append(lev_nodes,    sub.nodes);
+		append(lev_walltips, sub.walltips);
+	}
+
+	CurrentArena().take(sub.arena);
+
+	intersection_t *& free_cuts = QuickAllocCuts();
+
+	while (sub.quick_alloc_cuts)
+	{
+		intersection_t *cut = sub.quick_alloc_cuts;
+		sub.quick_alloc_cuts = cut->next;
+
+		cut->next = free_cuts;
+		free_cuts = cut;
+	}
+
+	// make the partners outside of the subtree point to the copies.
+	// when a partner is not ours either, the subtree which owns it
+	// will do this when it gets joined.
+	for (seg_t *copy : sub.outer_copies)
+	{
+		while (copy->replaced_by)
+			copy = copy->replaced_by;
+
+		seg_t *partner = copy->partner;
+
+		if (partner->owner != cur_subtree)
+			continue;
+
+		while (partner->replaced_by)
+			partner = partner->replaced_by;
+
+		copy->partner = partner;
+		partner->partner = copy;
+	}
+
+	for (const partner_split_t &split : sub.partner_splits)
+	{
+		seg_t *new_seg = split.new_seg;
+
+		while (new_seg->replaced_by)
+			new_seg = new_seg->replaced_by;
+
+		SplitPartner(split.partner, new_seg, split.vert);
+	}
+
+	for (const SString &message : sub.messages)
+		PrintMsg("%s", message.c_str());
+
+	if (cur_subtree)
+		cur_subtree->num_warnings += sub.num_warnings;
+	else
+		cur_info->total_warnings += sub.num_warnings;
+}
+
+
+void LevelBuilder::DiscardSubtree(subtree_t &sub, seg_t *lent_list)
+{
+	// this includes any segs added to the list since it was lent
+	for (seg_t *seg = lent_list ; seg ; seg = seg->next)
+		seg->lent = NULL;
+
+	arena_discarded += sub.arena.bytesReserved();
+
+	sub.vertices.clear();
+	sub.segs.clear();
+	sub.subsecs.clear();
+	sub.nodes.clear();
+	sub.walltips.clear();
+
+	sub.quick_alloc_cuts = NULL;
+
+	sub.arena.release();
+}
+
+
+void LevelBuilder::RemoveReplacedSegs()
+{
+	size_t count = 0;
+
+	// the replaced segs stay in the arena until the end
+	for (seg_t *seg : lev_segs)
+		if (! seg->replaced_by)
+			lev_segs[count++] = seg;
+
+	lev_segs.resize(count);
+}
+
+
+void LevelBuilder::ClockwiseBspTree(const Document &doc)
 {
 	current_seg_index = 0;
 
@@ -1788,7 +2693,7 @@ void ClockwiseBspTree(const Document &doc)
 		subsec_t *sub = lev_subsecs[i];
 
 		sub->ClockwiseOrder(doc);
-		sub->RenumberSegs();
+		sub->RenumberSegs(current_seg_index);
 
 		// do some sanity checks
 		sub->SanityCheckClosed();
@@ -1846,7 +2751,7 @@ void subsec_t::Normalise()
 }
 
 
-void NormaliseBspTree()
+void LevelBuilder::NormaliseBspTree()
 {
 	// unlinks all minisegs from each subsector
 
@@ -1857,12 +2762,12 @@ void NormaliseBspTree()
 		subsec_t *sub = lev_subsecs[i];
 
 		sub->Normalise();
-		sub->RenumberSegs();
+		sub->RenumberSegs(current_seg_index);
 	}
 }
 
 
-static void RoundOffVertices()
+void LevelBuilder::RoundOffVertices()
 {
 	for (int i = 0 ; i < num_vertices ; i++)
 	{
@@ -1879,7 +2784,7 @@ static void RoundOffVertices()
 }
 
 
-void subsec_t::RoundOff()
+void subsec_t::RoundOff(LevelBuilder &builder)
 {
 	// use head + tail to maintain same order of segs
 	seg_t *new_head = NULL;
@@ -1934,7 +2839,7 @@ void subsec_t::RoundOff()
 #   endif
 
 		// create a new vertex for this baby
-		last_real_degen->end = NewVertexDegenerate(
+		last_real_degen->end = builder.NewVertexDegenerate(
 				last_real_degen->start, last_real_degen->end);
 
 #   if DEBUG_SUBSEC
@@ -1987,7 +2892,7 @@ void subsec_t::RoundOff()
 }
 
 
-void RoundOffBspTree()
+void LevelBuilder::RoundOffBspTree()
 {
 	current_seg_index = 0;
 
@@ -1997,8 +2902,8 @@ void RoundOffBspTree()
 	{
 		subsec_t *sub = lev_subsecs[i];
 
-		sub->RoundOff();
-		sub->RenumberSegs();
+		sub->RoundOff(*this);
+		sub->RenumberSegs(current_seg_index);
 	}
 }
 
@@ -18,6 +18,7 @@
 //
 //------------------------------------------------------------------------
 
+#include "DuplicateFinder.h"
 #include "Errors.h"
 #include "Instance.h"
 #include "LineDef.h"
@@ -46,7 +47,33 @@ void PrintDetail(const char *fmt, ...)
 }
 
 
-void Failure(const Instance &inst, EUR_FORMAT_STRING(const char *fmt), ...)
+void LevelBuilder::PrintMsg(EUR_FORMAT_STRING(const char *fmt), ...)
+{
+	va_list args;
+
+	va_start(args, fmt);
+	SString message = SString::vprintf(fmt, args);
+	va_end(args);
+
+	if (cur_subtree)
+		cur_subtree->messages.push_back(message);
+	else if (defer_messages)
+		messages.push_back(message);
+	else
+		inst.GB_PrintMsg("%s", message.c_str());
+}
+
+
+void LevelBuilder::FlushMessages()
+{
+	for (const SString &message : messages)
+		inst.GB_PrintMsg("%s", message.c_str());
+
+	messages.clear();
+}
+
+
+void LevelBuilder::Failure(EUR_FORMAT_STRING(const char *fmt), ...)
 {
 	va_list args;
 
@@ -56,9 +83,12 @@ void Failure(const Instance &inst, EUR_FORMAT_STRING(const char *fmt), ...)
 	va_end(args);
 
 	if (cur_info->warnings)
-		inst.GB_PrintMsg("Failure: %s", message.c_str());
+		PrintMsg("Failure: %s", message.c_str());
 
-	cur_info->total_warnings++;
+	if (cur_subtree)
+		cur_subtree->num_warnings++;
+	else
+		cur_info->total_warnings++;
 
 #if DEBUG_ENABLED
 	gLog.debugPrintf("Failure: %s", message.c_str());
@@ -66,7 +96,7 @@ void Failure(const Instance &inst, EUR_FORMAT_STRING(const char *fmt), ...)
 }
 
 
-void Warning(const Instance &inst, EUR_FORMAT_STRING(const char *fmt), ...)
+void LevelBuilder::Warning(EUR_FORMAT_STRING(const char *fmt), ...)
 {
 	va_list args;
 
@@ -75,9 +105,12 @@ void Warning(const Instance &inst, EUR_FORMAT_STRING(const char *fmt), ...)
 	va_end(args);
 
 	if (cur_info->warnings)
-		inst.GB_PrintMsg("Warning: %s", message.c_str());
+		PrintMsg("Warning: %s", message.c_str());
 
-	cur_info->total_warnings++;
+	if (cur_subtree)
+		cur_subtree->num_warnings++;
+	else
+		cur_info->total_warnings++;
 
 #if DEBUG_ENABLED
 	gLog.debugPrintf("Warning: %s", message.c_str());
@@ -249,7 +282,7 @@ static void MarkPolyobjSector(int sector, const Document &doc)
 	}
 }
 
-static void MarkPolyobjPoint(double x, double y, const Instance &inst)
+void LevelBuilder::MarkPolyobjPoint(double x, double y)
 {
 	int i;
 	int inside_count = 0;
@@ -335,7 +368,7 @@ static void MarkPolyobjPoint(double x, double y, const Instance &inst)
 
 	if (best_match < 0)
 	{
-		Warning(inst, "Bad polyobj thing at (%1.0f,%1.0f).\n", x, y);
+		Warning("Bad polyobj thing at (%1.0f,%1.0f).\n", x, y);
 		return;
 	}
 
@@ -371,7 +404,7 @@ static void MarkPolyobjPoint(double x, double y, const Instance &inst)
 
 	if (sector < 0)
 	{
-		Warning(inst, "Invalid Polyobj thing at (%1.0f,%1.0f).\n", x, y);
+		Warning("Invalid Polyobj thing at (%1.0f,%1.0f).\n", x, y);
 		return;
 	}
 
@@ -382,7 +415,7 @@ static void MarkPolyobjPoint(double x, double y, const Instance &inst)
 //
 // Based on code courtesy of Janis Legzdinsh.
 //
-void DetectPolyobjSectors(const Instance &inst)
+void LevelBuilder::DetectPolyobjSectors()
 {
 	int i;
 
@@ -431,155 +464,63 @@ void DetectPolyobjSectors(const Instance &inst)
 		gLog.debugPrintf("Thing %d at (%1.0f,%1.0f) is a polyobj spawner.\n", i, x, y);
 #   endif
 
-		MarkPolyobjPoint(x, y, inst);
+		MarkPolyobjPoint(x, y);
 	}
 }
 
 
 /* ----- analysis routines ----------------------------- */
 
-static FFixedPoint VertexCompare(const Document &doc, const void *p1, const void *p2)
-{
-	int vert1 = static_cast<const u16_t *>(p1)[0];
-	int vert2 = static_cast<const u16_t *>(p2)[0];
-
-	if (vert1 == vert2)
-		return FFixedPoint{};
-
-	const Vertex *A = doc.vertices[vert1];
-	const Vertex *B = doc.vertices[vert2];
-
-	if (A->raw_x != B->raw_x)
-		return A->raw_x - B->raw_x;
-
-	return A->raw_y - B->raw_y;
-}
-
-
-void DetectOverlappingVertices(const Document &doc)
+void LevelBuilder::DetectOverlappingVertices(const Document &doc)
 {
 	SYS_ASSERT(num_vertices == doc.numVertices());
 
-	u16_t *array = new u16_t[num_vertices];
+	// vertices are added in order, so the "overlap" of each one is
+	// always the lowest numbered vertex at the same spot.
+	DuplicateFinder finder(num_vertices);
 
-	// sort array of indices
-	int i;
-	for (i=0 ; i < num_vertices ; i++)
-		array[i] = static_cast<u16_t>(i);
+	for (int i = 0 ; i < num_vertices ; i++)
+	{
+		const Vertex *V = doc.vertices[i];
 
-	std::sort(array, array + num_vertices, [&doc](u16_t left, u16_t right)
-		{
-			return VertexCompare(doc, &left, &right).raw() < 0;
-		});
+		int first = finder.add(i, DuplicateFinder::makeKey(V->raw_x, V->raw_y));
 
-	// now mark them off
-	for (i=0 ; i < num_vertices - 1 ; i++)
-	{
-		if (VertexCompare(doc, array + i, array + i + 1).raw() == 0)
+		if (first >= 0)
 		{
 			// found an overlap!
-
-			vertex_t *A = lev_vertices[array[i]];
-			vertex_t *B = lev_vertices[array[i+1]];
-
-			B->overlap = A->overlap ? A->overlap : A;
+			lev_vertices[i]->overlap = lev_vertices[first];
 		}
 	}
-
-	delete[] array;
-}
-
-
-static inline int LineVertexLowest(const Document &doc, const LineDef *L)
-{
-	// returns the "lowest" vertex (normally the left-most, but if the
-	// line is vertical, then the bottom-most) => 0 for start, 1 for end.
-
-	return ( L->Start(doc)->raw_x <  L->End(doc)->raw_x ||
-			(L->Start(doc)->raw_x == L->End(doc)->raw_x &&
-			 L->Start(doc)->raw_y <  L->End(doc)->raw_y)) ? 0 : 1;
-}
-
-static FFixedPoint LineStartCompare(const Document &doc, const void *p1, const void *p2)
-{
-	int line1 = ((const int *) p1)[0];
-	int line2 = ((const int *) p2)[0];
-
-	if (line1 == line2)
-		return FFixedPoint();
-
-	const LineDef *A = doc.linedefs[line1];
-	const LineDef *B = doc.linedefs[line2];
-
-	// determine left-most vertex of each line
-	const Vertex *C = LineVertexLowest(doc, A) ? A->End(doc) : A->Start(doc);
-	const Vertex *D = LineVertexLowest(doc, B) ? B->End(doc) : B->Start(doc);
-
-	if (C->raw_x != D->raw_x)
-		return C->raw_x - D->raw_x;
-
-	return C->raw_y - D->raw_y;
-}
-
-static FFixedPoint LineEndCompare(const Document &doc, const void *p1, const void *p2)
-{
-	int line1 = ((const int *) p1)[0];
-	int line2 = ((const int *) p2)[0];
-
-	if (line1 == line2)
-		return FFixedPoint{};
-
-	const LineDef *A = doc.linedefs[line1];
-	const LineDef *B = doc.linedefs[line2];
-
-	// determine right-most vertex of each line
-	const Vertex * C = LineVertexLowest(doc, A) ? A->Start(doc) : A->End(doc);
-	const Vertex * D = LineVertexLowest(doc, B) ? B->Start(doc) : B->End(doc);
-
-	if (C->raw_x != D->raw_x)
-		return C->raw_x - D->raw_x;
-
-	return C->raw_y - D->raw_y;
 }
 
 
 void DetectOverlappingLines(const Document &doc)
 {
 	// Algorithm:
-	//   Sort all lines by left-most vertex.
-	//   Overlapping lines will then be near each other in this set.
+	//   Hash all lines by both of their vertices, lowest one first.
+	//   Every line after the first one with the same key overlaps it.
 	//   Note: does not detect partially overlapping lines.
 
-	int i;
-	int *array = (int *)UtilCalloc(doc.numLinedefs() * sizeof(int));
+	DuplicateFinder finder(doc.numLinedefs());
 	int count = 0;
 
-	// sort array of indices
-	for (i=0 ; i < doc.numLinedefs(); i++)
-		array[i] = i;
-
-	std::sort(array, array + doc.numLinedefs(), [&doc](int left, int right)
-		{
-			return LineStartCompare(doc, &left, &right).raw() < 0;
-		});
-
-	for (i=0 ; i < doc.numLinedefs() - 1 ; i++)
+	for (int i = 0 ; i < doc.numLinedefs() ; i++)
 	{
-		int j;
+		LineDef *L = doc.linedefs[i];
 
-		for (j = i+1 ; j < doc.numLinedefs(); j++)
-		{
-			if (LineStartCompare(doc, array + i, array + j).raw() != 0)
-				break;
+		const Vertex *C = L->Start(doc);
+		const Vertex *D = L->End(doc);
 
-			if (LineEndCompare(doc, array + i, array + j).raw() == 0)
-			{
-				// found an overlap !
+		// the "lowest" vertex is normally the left-most, but if the
+		// line is vertical, then the bottom-most.
+		if (C->raw_x > D->raw_x || (C->raw_x == D->raw_x && C->raw_y > D->raw_y))
+			std::swap(C, D);
 
-				LineDef *L = doc.linedefs[array[j]];
-				L->flags |= MLF_IS_OVERLAP;
-				count++;
-			}
+		if (finder.add(i, DuplicateFinder::makeKey(C->raw_x, C->raw_y, D->raw_x, D->raw_y)) >= 0)
+		{
+			// found an overlap !
+			L->flags |= MLF_IS_OVERLAP;
+			count++;
 		}
 	}
 
@@ -587,8 +528,6 @@ void DetectOverlappingLines(const Document &doc)
 	{
 		PrintDetail("Detected %d overlapped linedefs\n", count);
 	}
-
-	UtilFree(array);
 }
 
 
@@ -597,7 +536,7 @@ void DetectOverlappingLines(const Document &doc)
 // smallest degrees between two angles before being considered equal
 #define ANG_EPSILON  (1.0 / 1024.0)
 
-static void VertexAddWallTip(vertex_t *vert, double dx, double dy,
+void LevelBuilder::VertexAddWallTip(vertex_t *vert, double dx, double dy,
 		int open_left, int open_right)
 {
 	if (vert->overlap)
@@ -638,7 +577,7 @@ static void VertexAddWallTip(vertex_t *vert, double dx, double dy,
 }
 
 
-void CalculateWallTips(const Document &doc)
+void LevelBuilder::CalculateWallTips(const Document &doc)
 {
 	int i;
 
@@ -678,7 +617,7 @@ void CalculateWallTips(const Document &doc)
 }
 
 
-vertex_t *NewVertexFromSplitSeg(seg_t *seg, double x, double y, const Document &doc)
+vertex_t *LevelBuilder::NewVertexFromSplitSeg(seg_t *seg, double x, double y, const Document &doc)
 {
 	vertex_t *vert = NewVertex();
 
@@ -686,8 +625,8 @@ vertex_t *NewVertexFromSplitSeg(seg_t *seg, double x, double y, const Document &
 	vert->y = y;
 	vert->is_new = true;
 
-	vert->index = num_new_vert;
-	num_new_vert++;
+	// the index is set once the whole tree has been built
+	vert->index = -1;
 
 	// compute wall-tip info
 	if (seg->linedef < 0 || doc.linedefs[seg->linedef]->TwoSided())
@@ -709,7 +648,7 @@ vertex_t *NewVertexFromSplitSeg(seg_t *seg, double x, double y, const Document &
 }
 
 
-vertex_t *NewVertexDegenerate(vertex_t *start, vertex_t *end)
+vertex_t *LevelBuilder::NewVertexDegenerate(vertex_t *start, vertex_t *end)
 {
 	// this is only called when rounding off the BSP tree and
 	// all the segs are degenerate (zero length), hence we need
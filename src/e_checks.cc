@@ -24,6 +24,7 @@
 //
 //------------------------------------------------------------------------
 
+#include "DuplicateFinder.h"
 #include "Errors.h"
 #include "Instance.h"
 #include "main.h"
@@ -54,6 +55,87 @@
 
 #define CAMERA_PEST  32000
 
+
+//
+// The detectors of the "Check Map" dialogs.  They are shared with the
+// --check mode (ChecksModule::collectProblems), hence their category,
+// severity and messages are kept in one table: check_detectors[].
+//
+enum check_detector_e
+{
+	CHK_OverlapVertices,
+	CHK_DanglingVertices,
+	CHK_UnusedVertices,
+
+	CHK_UnclosedSectors,
+	CHK_MismatchedSectors,
+	CHK_BadCeilSectors,
+	CHK_UnknownSectorTypes,
+	CHK_SharedSideDefs,
+	CHK_UnusedSectors,
+	CHK_UnusedSideDefs,
+
+	CHK_ZeroLenLineDefs,
+	CHK_OverlapLineDefs,
+	CHK_CrossingLineDefs,
+	CHK_UnknownLineTypes,
+	CHK_MissingRightSide,
+	CHK_ManualDoors,
+	CHK_LackImpass,
+	CHK_Bad2SFlag,
+
+	CHK_UnknownThings,
+	CHK_StuckThings,
+	CHK_ThingsInVoid,
+	CHK_DuplicateThings,
+	CHK_UnspawnableThings,
+
+	CHK_UnknownTextures,
+	CHK_UnknownFlats,
+	CHK_MedusaTextures,
+	CHK_MissingTextures,
+	CHK_TransparentTextures,
+	CHK_DupSwitches,
+
+	CHK_MissingTags,
+	CHK_UnmatchedLineDefs,
+	CHK_UnmatchedSectors,
+	CHK_BeastMarks,
+
+	NUM_CHECK_DETECTORS
+};
+
+struct check_detector_t
+{
+	const char *category;	// "vertices", "sectors", "linedefs", ...
+	int severity;			// 1 = minor, 2 = major
+
+	const char *ok_message;
+	const char *problem_format;	// given the number returned by find()
+
+	// puts the offending objects into the selection, and returns the
+	// number to show in the message (not always how many objects).
+	int (*find)(selection_c &sel, Instance &inst);
+
+	// when present, the detector is skipped unless this is true
+	bool (*applies)(const Instance &inst);
+};
+
+static const check_detector_t &GetDetector(check_detector_e what);
+
+//
+// The player and deathmatch start lines of the things check.  An empty
+// message means there is nothing to show.
+//
+struct check_line_t
+{
+	SString message;
+	int severity = 0;
+};
+
+static void Things_CheckStarts(const Instance &inst, check_line_t &players, check_line_t &deathmatch);
+
+
 //------------------------------------------------------------------------
 
 class UI_Check_base : public UI_Escapable_Window
@@ -85,6 +167,13 @@ public:
 		const char *button2 = NULL, Fl_Callback *cb2 = NULL,
 		const char *button3 = NULL, Fl_Callback *cb3 = NULL);
 
+	// runs a detector and adds its line, the buttons only being shown
+	// when something was found.
+	void AddDetector(check_detector_e what, Instance &inst, int W,
+		const char *button1, Fl_Callback *cb1,
+		const char *button2 = NULL, Fl_Callback *cb2 = NULL,
+		const char *button3 = NULL, Fl_Callback *cb3 = NULL);
+
 	CheckResult  Run();
 
 	int WorstSeverity() const { return worst_severity; }
@@ -234,6 +323,31 @@ void UI_Check_base::AddLine(
 }
 
 
+void UI_Check_base::AddDetector(check_detector_e what, Instance &inst, int W,
+		 const char *button1, Fl_Callback *cb1,
+		 const char *button2, Fl_Callback *cb2,
+		 const char *button3, Fl_Callback *cb3)
+{
+	const check_detector_t &det = GetDetector(what);
+
+	if (det.applies && ! det.applies(inst))
+		return;
+
+	selection_c sel;
+
+	int count = det.find(sel, inst);
+
+	if (sel.empty())
+	{
+		AddLine(det.ok_message);
+		return;
+	}
+
+	AddLine(SString::printf(det.problem_format, count), det.severity, W,
+	        button1, cb1, button2, cb2, button3, cb3);
+}
+
+
 CheckResult UI_Check_base::Run()
 {
 	set_modal();
@@ -306,23 +420,6 @@ static void Vertex_ShowDanglers(Instance &inst)
 }
 
 
-struct vertex_X_CMP_pred
-{
-	const Document &doc;
-	explicit vertex_X_CMP_pred(const Document &doc) : doc(doc)
-	{
-	}
-
-	inline bool operator() (int A, int B) const
-	{
-		const Vertex *V1 = doc.vertices[A];
-		const Vertex *V2 = doc.vertices[B];
-
-		return V1->raw_x < V2->raw_x;
-	}
-};
-
-
 void Vertex_FindOverlaps(selection_c& sel, const Document &doc)
 {
 	// NOTE: when two or more vertices share the same coordinates,
@@ -333,32 +430,15 @@ void Vertex_FindOverlaps(selection_c& sel, const Document &doc)
 	if (doc.numVertices() < 2)
 		return;
 
-	// sort the vertices into order of the 'X' value.
-	// hence any overlapping vertices will be near each other.
-
-	std::vector<int> sorted_list(doc.numVertices(), 0);
+	DuplicateFinder finder(doc.numVertices());
 
-	for (int i = 0 ; i < doc.numVertices(); i++)
-		sorted_list[i] = i;
-
-	std::sort(sorted_list.begin(), sorted_list.end(), vertex_X_CMP_pred(doc));
-
-#define VERT_K  doc.vertices[sorted_list[k]]
-#define VERT_N  doc.vertices[sorted_list[n]]
-
-	for (int k = 0 ; k < doc.numVertices(); k++)
+	for (int n = 0 ; n < doc.numVertices(); n++)
 	{
-		for (int n = k + 1 ; n < doc.numVertices() && VERT_N->raw_x == VERT_K->raw_x ; n++)
-		{
-			if (VERT_N->raw_y == VERT_K->raw_y)
-			{
-				sel.set(sorted_list[k]);
-			}
-		}
-	}
+		const Vertex *V = doc.vertices[n];
 
-#undef VERT_K
-#undef VERT_N
+		if (finder.add(n, DuplicateFinder::makeKey(V->raw_x, V->raw_y)) >= 0)
+			sel.set(n);
+	}
 }
 
 
@@ -529,51 +609,18 @@ CheckResult ChecksModule::checkVertices(int min_severity) const
 {
 	UI_Check_Vertices *dialog = new UI_Check_Vertices(min_severity > 0, inst);
 
-	selection_c  sel;
-
-	SString check_message;
-
 	for (;;)
 	{
-		Vertex_FindOverlaps(sel, doc);
-
-		if (sel.empty())
-			dialog->AddLine("No overlapping vertices");
-		else
-		{
-			check_message = SString::printf("%d overlapping vertices", sel.count_obj());
-
-			dialog->AddLine(check_message.c_str(), 2, 210,
-			                "Show",  &UI_Check_Vertices::action_highlight,
-			                "Merge", &UI_Check_Vertices::action_merge);
-		}
+		dialog->AddDetector(CHK_OverlapVertices, inst, 210,
+		                    "Show",  &UI_Check_Vertices::action_highlight,
+		                    "Merge", &UI_Check_Vertices::action_merge);
 
+		dialog->AddDetector(CHK_DanglingVertices, inst, 210,
+		                    "Show",  &UI_Check_Vertices::action_show_danglers);
 
-		Vertex_FindDanglers(sel, doc);
-
-		if (sel.empty())
-			dialog->AddLine("No dangling vertices");
-		else
-		{
-			check_message = SString::printf("%d dangling vertices", sel.count_obj());
-
-			dialog->AddLine(check_message, 2, 210,
-			                "Show",  &UI_Check_Vertices::action_show_danglers);
-		}
-
-
-		Vertex_FindUnused(sel, doc);
-
-		if (sel.empty())
-			dialog->AddLine("No unused vertices");
-		else
-		{
-			check_message = SString::printf("%d unused vertices", sel.count_obj());
-
-			dialog->AddLine(check_message, 1, 210,
-			                "Show",   &UI_Check_Vertices::action_show_unused,
-			                "Remove", &UI_Check_Vertices::action_remove);
-		}
+		dialog->AddDetector(CHK_UnusedVertices, inst, 210,
+		                    "Show",   &UI_Check_Vertices::action_show_unused,
+		                    "Remove", &UI_Check_Vertices::action_remove);
 
 
 		// in "ALL" mode, just continue if not too severe
@@ -1204,112 +1251,37 @@ CheckResult ChecksModule::checkSectors(int min_severity) const
 {
 	UI_Check_Sectors *dialog = new UI_Check_Sectors(min_severity > 0, inst);
 
-	selection_c  sel, other;
-
-	std::map<int, int> types;
-	SString check_message;
-
 	for (;;)
 	{
-		Sectors_FindUnclosed(sel, other, doc);
+		dialog->AddDetector(CHK_UnclosedSectors, inst, 220,
+		                    "Show",  &UI_Check_Sectors::action_show_unclosed,
+		                    "Verts", &UI_Check_Sectors::action_show_un_verts);
 
-		if (sel.empty())
-			dialog->AddLine("No unclosed sectors");
-		else
-		{
-			check_message = SString::printf("%d unclosed sectors", sel.count_obj());
-
-			dialog->AddLine(check_message, 2, 220,
-			                "Show",  &UI_Check_Sectors::action_show_unclosed,
-			                "Verts", &UI_Check_Sectors::action_show_un_verts);
-		}
+		dialog->AddDetector(CHK_MismatchedSectors, inst, 220,
+		                    "Show",  &UI_Check_Sectors::action_show_mismatch,
+		                    "Lines", &UI_Check_Sectors::action_show_mis_lines);
 
-
-		Sectors_FindMismatches(sel, other, doc);
-
-		if (sel.empty())
-			dialog->AddLine("No mismatched sectors");
-		else
-		{
-			check_message = SString::printf("%d mismatched sectors", sel.count_obj());
-
-			dialog->AddLine(check_message, 2, 220,
-			                "Show",  &UI_Check_Sectors::action_show_mismatch,
-			                "Lines", &UI_Check_Sectors::action_show_mis_lines);
-		}
-
-
-		Sectors_FindBadCeil(sel, doc);
-
-		if (sel.empty())
-			dialog->AddLine("No sectors with ceil < floor");
-		else
-		{
-			check_message = SString::printf("%d sectors with ceil < floor", sel.count_obj());
-
-			dialog->AddLine(check_message, 2, 220,
-			                "Show", &UI_Check_Sectors::action_show_ceil,
-			                "Fix",  &UI_Check_Sectors::action_fix_ceil);
-		}
+		dialog->AddDetector(CHK_BadCeilSectors, inst, 220,
+		                    "Show", &UI_Check_Sectors::action_show_ceil,
+		                    "Fix",  &UI_Check_Sectors::action_fix_ceil);
 
 		dialog->AddGap(10);
 
 
-		Sectors_FindUnknown(sel, types, inst);
+		dialog->AddDetector(CHK_UnknownSectorTypes, inst, 220,
+		                    "Show",   &UI_Check_Sectors::action_show_unknown,
+		                    "Log",    &UI_Check_Sectors::action_log_unknown,
+		                    "Clear",  &UI_Check_Sectors::action_clear_unknown);
 
-		if (sel.empty())
-			dialog->AddLine("No unknown sector types");
-		else
-		{
-			check_message = SString::printf("%d unknown sector types", (int)types.size());
+		dialog->AddDetector(CHK_SharedSideDefs, inst, 200,
+		                    "Show",   &UI_Check_Sectors::action_show_packed,
+		                    "Unpack", &UI_Check_Sectors::action_unpack);
 
-			dialog->AddLine(check_message, 2, 220,
-			                "Show",   &UI_Check_Sectors::action_show_unknown,
-			                "Log",    &UI_Check_Sectors::action_log_unknown,
-			                "Clear",  &UI_Check_Sectors::action_clear_unknown);
-		}
+		dialog->AddDetector(CHK_UnusedSectors, inst, 170,
+		                    "Remove", &UI_Check_Sectors::action_remove);
 
-
-		SideDefs_FindPacking(sel, other, doc);
-
-		if (sel.empty())
-			dialog->AddLine("No shared sidedefs");
-		else
-		{
-			int approx_num = sel.count_obj();
-
-			check_message = SString::printf("%d shared sidedefs", approx_num);
-
-			dialog->AddLine(check_message, 1, 200,
-			                "Show",   &UI_Check_Sectors::action_show_packed,
-			                "Unpack", &UI_Check_Sectors::action_unpack);
-		}
-
-
-		Sectors_FindUnused(sel, doc);
-
-		if (sel.empty())
-			dialog->AddLine("No unused sectors");
-		else
-		{
-			check_message = SString::printf("%d unused sectors", sel.count_obj());
-
-			dialog->AddLine(check_message, 1, 170,
-			                "Remove", &UI_Check_Sectors::action_remove);
-		}
-
-
-		SideDefs_FindUnused(sel, doc);
-
-		if (sel.empty())
-			dialog->AddLine("No unused sidedefs");
-		else
-		{
-			check_message = SString::printf("%d unused sidedefs", sel.count_obj());
-
-			dialog->AddLine(check_message, 1, 170,
-			                "Remove", &UI_Check_Sectors::action_remove_sidedefs);
-		}
+		dialog->AddDetector(CHK_UnusedSideDefs, inst, 170,
+		                    "Remove", &UI_Check_Sectors::action_remove_sidedefs);
 
 
 		// in "ALL" mode, just continue if not too severe
@@ -1434,6 +1406,49 @@ static int Things_FindStarts(int *dm_num, const Document &doc)
 }
 
 
+static void Things_CheckStarts(const Instance &inst, check_line_t &players, check_line_t &deathmatch)
+{
+	if (inst.conf.features.no_need_players)
+	{
+		players.message = "Player starts not needed, no check done";
+		return;
+	}
+
+	int dm_num;
+	int mask = Things_FindStarts(&dm_num, inst.level);
+
+	if (! (mask & 1))
+		players = { "Player 1 start is missing!", 2 };
+	else if (! (mask & 2))
+		players = { "Player 2 start is missing", 1 };
+	else if (! (mask & 4))
+		players = { "Player 3 start is missing", 1 };
+	else if (! (mask & 8))
+		players = { "Player 4 start is missing", 1 };
+	else
+		players = { "Found all 4 player starts", 0 };
+
+	if (dm_num == 0)
+	{
+		deathmatch = { "Map is missing deathmatch starts", 1 };
+	}
+	else if (dm_num < inst.conf.miscInfo.min_dm_starts)
+	{
+		deathmatch = { SString::printf("Found %d deathmatch starts -- need at least %d", dm_num,
+						inst.conf.miscInfo.min_dm_starts), 1 };
+	}
+	else if (dm_num > inst.conf.miscInfo.max_dm_starts)
+	{
+		deathmatch = { SString::printf("Found %d deathmatch starts -- maximum is %d", dm_num,
+						inst.conf.miscInfo.max_dm_starts), 2 };
+	}
+	else
+	{
+		deathmatch = { SString::printf("Found %d deathmatch starts -- OK", dm_num), 0 };
+	}
+}
+
+
 static void Things_FindInVoid(selection_c& list, const Instance &inst)
 {
 	list.change_type(ObjType::things);
@@ -1496,6 +1511,52 @@ static void Things_RemoveInVoid(Instance &inst)
 }
 
 
+void Things_FindDuplicates(selection_c& list, const Document &doc)
+{
+	// NOTE: when two or more things of the same type share the same
+	//       spot, only the second and subsequent ones are stored.
+
+	list.change_type(ObjType::things);
+
+	DuplicateFinder finder(doc.numThings());
+
+	for (int n = 0 ; n < doc.numThings() ; n++)
+	{
+		const Thing *T = doc.things[n];
+
+		DuplicateFinder::Key key = DuplicateFinder::makeKey(T->raw_x, T->raw_y);
+		key[2] = T->type;
+
+		if (finder.add(n, key) >= 0)
+			list.set(n);
+	}
+}
+
+
+static void Things_ShowDuplicates(Instance &inst)
+{
+	if (inst.edit.mode != ObjType::things)
+		inst.Editor_ChangeMode('t');
+
+	Things_FindDuplicates(*inst.edit.Selected, inst.level);
+
+	inst.GoToErrors();
+}
+
+
+static void Things_RemoveDuplicates(Instance &inst)
+{
+	selection_c sel;
+
+	Things_FindDuplicates(sel, inst.level);
+
+	EditOperation op(inst.level.basis);
+	op.setMessage("removed duplicated things");
+
+	inst.level.objects.del(op, sel);
+}
+
+
 // returns true if the game engine ALWAYS spawns this thing
 // (i.e. the skill-flags and mode-flags are ignored).
 static bool TH_always_spawned(const Instance &inst, int type)
@@ -1762,7 +1823,98 @@ static inline bool LD_is_blocking(const LineDef *L, const Document &doc)
 }
 
 
-static bool ThingStuckInWall(const Thing *T, int r, char group, const Document &doc)
+//
+// A coarse bucket grid used by the stuck-thing checks.  Each entry is
+// stored in every cell which its bounding box touches, so any two
+// overlapping boxes are guaranteed to share at least one cell and a
+// query only needs to visit the cells under its own box.
+//
+class StuckGrid
+{
+public:
+	StuckGrid(double min_x, double min_y, double max_x, double max_y,
+			  double cell_size, int num_ids) : cell_size(cell_size),
+			  origin_x(min_x), origin_y(min_y), stamps(num_ids, 0)
+	{
+		// keep the grid a sane size on huge (UDMF) maps
+		while ((max_x - min_x) / this->cell_size * (max_y - min_y) / this->cell_size > MAX_CELLS)
+			this->cell_size *= 2;
+
+		cols = (int)floor((max_x - min_x) / this->cell_size) + 1;
+		rows = (int)floor((max_y - min_y) / this->cell_size) + 1;
+
+		cells.resize((size_t)cols * rows);
+	}
+
+	void Add(int id, double x1, double y1, double x2, double y2)
+	{
+		int cx1 = CellX(x1), cy1 = CellY(y1);
+		int cx2 = CellX(x2), cy2 = CellY(y2);
+
+		for (int cy = cy1 ; cy <= cy2 ; cy++)
+		for (int cx = cx1 ; cx <= cx2 ; cx++)
+			cells[(size_t)cy * cols + cx].push_back(id);
+	}
+
+	//
+	// calls func(id) once for every entry sharing a cell with the box.
+	// the func can return true to stop the search early.
+	//
+	template<typename F>
+	void Query(double x1, double y1, double x2, double y2, F func)
+	{
+		current_stamp++;
+
+		int cx1 = CellX(x1), cy1 = CellY(y1);
+		int cx2 = CellX(x2), cy2 = CellY(y2);
+
+		for (int cy = cy1 ; cy <= cy2 ; cy++)
+		for (int cx = cx1 ; cx <= cx2 ; cx++)
+		{
+			for (int id : cells[(size_t)cy * cols + cx])
+			{
+				if (stamps[id] == current_stamp)
+					continue;
+
+				stamps[id] = current_stamp;
+
+				if (func(id))
+					return;
+			}
+		}
+	}
+
+private:
+	static constexpr double MAX_CELLS = 1 << 20;
+
+	double cell_size;
+	double origin_x, origin_y;
+
+	int cols = 0, rows = 0;
+
+	std::vector<std::vector<int>> cells;
+
+	// used to visit each entry only once per query
+	std::vector<int> stamps;
+	int current_stamp = 0;
+
+	int CellX(double x) const
+	{
+		return clamp(0, (int)floor((x - origin_x) / cell_size), cols - 1);
+	}
+
+	int CellY(double y) const
+	{
+		return clamp(0, (int)floor((y - origin_y) / cell_size), rows - 1);
+	}
+};
+
+
+//
+// when line_grid is NULL, every linedef in the map is checked.
+//
+static bool ThingStuckInWall(const Thing *T, int r, char group, const Document &doc,
+							 StuckGrid *line_grid)
 {
 	// only check players and monsters
 	if (! (group == 'p' || group == 'm'))
@@ -1780,25 +1932,147 @@ static bool ThingStuckInWall(const Thing *T, int r, char group, const Document &
 	double x2 = T->x() + r;
 	double y2 = T->y() + r;
 
-	for (int n = 0 ; n < doc.numLinedefs(); n++)
+	if (! line_grid)
+	{
+		for (int n = 0 ; n < doc.numLinedefs(); n++)
+		{
+			const LineDef *L = doc.linedefs[n];
+
+			if (! LD_is_blocking(L, doc))
+				continue;
+
+			if (doc.objects.lineTouchesBox(n, x1, y1, x2, y2))
+				return true;
+		}
+
+		return false;
+	}
+
+	bool stuck = false;
+
+	// the grid only contains blocking lines
+	line_grid->Query(x1, y1, x2, y2, [&](int n)
+	{
+		stuck = doc.objects.lineTouchesBox(n, x1, y1, x2, y2);
+		return stuck;
+	});
+
+	return stuck;
+}
+
+
+void Things_FindStuckies(selection_c& list, const Instance &inst)
+{
+	list.change_type(ObjType::things);
+
+	const Document &doc = inst.level;
+
+	std::vector<int> blockers;
+	std::vector<int> sizes;
+
+	CollectBlockingThings(blockers, sizes, inst);
+
+	if (blockers.empty())
+		return;
+
+	// the monster step adjustment never shrinks a thing below 4 units,
+	// hence the bucket boxes must be at least that big too.
+	int max_r = 4;
+
+	double min_x = +9e9, min_y = +9e9;
+	double max_x = -9e9, max_y = -9e9;
+
+	for (int n = 0 ; n < (int)blockers.size() ; n++)
+	{
+		const Thing *T = doc.things[blockers[n]];
+
+		sizes[n] = std::max(4, sizes[n]);
+		max_r = std::max(max_r, sizes[n]);
+
+		min_x = std::min(min_x, T->x() - sizes[n]);
+		min_y = std::min(min_y, T->y() - sizes[n]);
+		max_x = std::max(max_x, T->x() + sizes[n]);
+		max_y = std::max(max_y, T->y() + sizes[n]);
+	}
+
+	StuckGrid thing_grid(min_x, min_y, max_x, max_y, 2 * max_r, (int)blockers.size());
+
+	for (int n = 0 ; n < (int)blockers.size() ; n++)
+	{
+		const Thing *T = doc.things[blockers[n]];
+		int r = sizes[n];
+
+		thing_grid.Add(n, T->x() - r, T->y() - r, T->x() + r, T->y() + r);
+	}
+
+	// lines can only be found by a thing's box when their bounding box
+	// overlaps it, so ones outside the things' area are never needed.
+	StuckGrid line_grid(min_x, min_y, max_x, max_y, 128, doc.numLinedefs());
+
+	for (int n = 0 ; n < doc.numLinedefs() ; n++)
 	{
 		const LineDef *L = doc.linedefs[n];
 
 		if (! LD_is_blocking(L, doc))
 			continue;
 
-		if (doc.objects.lineTouchesBox(n, x1, y1, x2, y2))
-			return true;
+		double lx1 = std::min(L->Start(doc)->x(), L->End(doc)->x());
+		double ly1 = std::min(L->Start(doc)->y(), L->End(doc)->y());
+		double lx2 = std::max(L->Start(doc)->x(), L->End(doc)->x());
+		double ly2 = std::max(L->Start(doc)->y(), L->End(doc)->y());
+
+		if (lx2 < min_x || lx1 > max_x || ly2 < min_y || ly1 > max_y)
+			continue;
+
+		line_grid.Add(n, lx1, ly1, lx2, ly2);
 	}
 
-	return false;
+	for (int n = 0 ; n < (int)blockers.size() ; n++)
+	{
+		const Thing *T = doc.things[blockers[n]];
+
+		const thingtype_t &info = M_GetThingType(inst.conf, T->type);
+
+		if (ThingStuckInWall(T, info.radius, info.group, doc, &line_grid))
+		{
+			list.set(blockers[n]);
+			continue;
+		}
+
+		int r = sizes[n];
+
+		// like the exhaustive check, only things *after* this one are
+		// tested here (ThingStuckInThing is not quite symmetrical).
+		thing_grid.Query(T->x() - r, T->y() - r, T->x() + r, T->y() + r, [&](int n2)
+		{
+			if (n2 <= n)
+				return false;
+
+			const Thing *T2 = doc.things[blockers[n2]];
+
+			const thingtype_t &info2 = M_GetThingType(inst.conf, T2->type);
+
+			if (! ThingStuckInThing(inst, T, &info, T2, &info2))
+				return false;
+
+			list.set(blockers[n]);
+			return true;
+		});
+	}
 }
 
 
-static void Things_FindStuckies(selection_c& list, const Instance &inst)
+//
+// the exhaustive version of Things_FindStuckies(), which checks every
+// pair of things and every thing against every line.  Kept around as
+// the reference for testing the faster one.
+//
+void Things_FindStuckiesSlow(selection_c& list, const Instance &inst)
 {
 	list.change_type(ObjType::things);
 
+	const Document &doc = inst.level;
+
 	std::vector<int> blockers;
 	std::vector<int> sizes;
 
@@ -1806,16 +2080,16 @@ static void Things_FindStuckies(selection_c& list, const Instance &inst)
 
 	for (int n = 0 ; n < (int)blockers.size() ; n++)
 	{
-		const Thing *T = inst.level.things[blockers[n]];
+		const Thing *T = doc.things[blockers[n]];
 
 		const thingtype_t &info = M_GetThingType(inst.conf, T->type);
 
-		if (ThingStuckInWall(T, info.radius, info.group, inst.level))
+		if (ThingStuckInWall(T, info.radius, info.group, doc, NULL))
 			list.set(blockers[n]);
 
 		for (int n2 = n + 1 ; n2 < (int)blockers.size() ; n2++)
 		{
-			const Thing *T2 = inst.level.things[blockers[n2]];
+			const Thing *T2 = doc.things[blockers[n2]];
 
 			const thingtype_t &info2 = M_GetThingType(inst.conf, T2->type);
 
@@ -1843,7 +2117,7 @@ class UI_Check_Things : public UI_Check_base
 {
 public:
 	UI_Check_Things(bool all_mode, Instance &inst) :
-		UI_Check_base(520, 316, all_mode, "Check : Things",
+		UI_Check_base(520, 346, all_mode, "Check : Things",
 				      "Thing test results"), inst(inst)
 	{ }
 
@@ -1884,6 +2158,20 @@ public:
 		dialog->user_action = CheckResult::tookAction;
 	}
 
+	static void action_show_dups(Fl_Widget *w, void *data)
+	{
+		UI_Check_Things *dialog = (UI_Check_Things *)data;
+		Things_ShowDuplicates(dialog->inst);
+		dialog->user_action = CheckResult::highlight;
+	}
+
+	static void action_remove_dups(Fl_Widget *w, void *data)
+	{
+		UI_Check_Things *dialog = (UI_Check_Things *)data;
+		Things_RemoveDuplicates(dialog->inst);
+		dialog->user_action = CheckResult::tookAction;
+	}
+
 	static void action_show_stuck(Fl_Widget *w, void *data)
 	{
 		UI_Check_Things *dialog = (UI_Check_Things *)data;
@@ -1914,113 +2202,41 @@ CheckResult ChecksModule::checkThings(int min_severity) const
 {
 	UI_Check_Things *dialog = new UI_Check_Things(min_severity > 0, inst);
 
-	selection_c  sel;
-
-	std::map<int, int> types;
-	SString check_message;
-
 	for (;;)
 	{
-		Things_FindUnknown(sel, types, inst);
-
-		if (sel.empty())
-			dialog->AddLine("No unknown thing types");
-		else
-		{
-			check_message = SString::printf("%d unknown things", (int)types.size());
+		dialog->AddDetector(CHK_UnknownThings, inst, 200,
+		                    "Show",   &UI_Check_Things::action_show_unknown,
+		                    "Log",    &UI_Check_Things::action_log_unknown,
+		                    "Remove", &UI_Check_Things::action_remove_unknown);
 
-			dialog->AddLine(check_message, 2, 200,
-			                "Show",   &UI_Check_Things::action_show_unknown,
-			                "Log",    &UI_Check_Things::action_log_unknown,
-			                "Remove", &UI_Check_Things::action_remove_unknown);
-		}
-
-
-		Things_FindStuckies(sel, inst);
-
-		if (sel.empty())
-			dialog->AddLine("No stuck actors");
-		else
-		{
-			check_message = SString::printf("%d stuck actors", sel.count_obj());
-
-			dialog->AddLine(check_message, 2, 200,
-			                "Show",  &UI_Check_Things::action_show_stuck);
-		}
+		dialog->AddDetector(CHK_StuckThings, inst, 200,
+		                    "Show",  &UI_Check_Things::action_show_stuck);
 
+		dialog->AddDetector(CHK_ThingsInVoid, inst, 200,
+		                    "Show",   &UI_Check_Things::action_show_void,
+		                    "Remove", &UI_Check_Things::action_remove_void);
 
-		Things_FindInVoid(sel, inst);
+		dialog->AddDetector(CHK_DuplicateThings, inst, 200,
+		                    "Show",   &UI_Check_Things::action_show_dups,
+		                    "Remove", &UI_Check_Things::action_remove_dups);
 
-		if (sel.empty())
-			dialog->AddLine("No things in the void");
-		else
-		{
-			check_message = SString::printf("%d things in the void", sel.count_obj());
-
-			dialog->AddLine(check_message, 1, 200,
-			                "Show",   &UI_Check_Things::action_show_void,
-			                "Remove", &UI_Check_Things::action_remove_void);
-		}
-
-
-		Things_FindDuds(inst, sel);
-
-		if (sel.empty())
-			dialog->AddLine("No unspawnable things -- skill flags are OK");
-		else
-		{
-			check_message = SString::printf("%d unspawnable things", sel.count_obj());
-			dialog->AddLine(check_message, 1, 200,
-			                "Show", &UI_Check_Things::action_show_duds,
-			                "Fix",  &UI_Check_Things::action_fix_duds);
-		}
+		dialog->AddDetector(CHK_UnspawnableThings, inst, 200,
+		                    "Show", &UI_Check_Things::action_show_duds,
+		                    "Fix",  &UI_Check_Things::action_fix_duds);
 
 
 		dialog->AddGap(10);
 
 
-		int dm_num, mask;
+		check_line_t players, deathmatch;
 
-		mask = Things_FindStarts(&dm_num, doc);
+		Things_CheckStarts(inst, players, deathmatch);
 
-		if (inst.conf.features.no_need_players)
-			dialog->AddLine("Player starts not needed, no check done");
-		else if (! (mask & 1))
-			dialog->AddLine("Player 1 start is missing!", 2);
-		else if (! (mask & 2))
-			dialog->AddLine("Player 2 start is missing", 1);
-		else if (! (mask & 4))
-			dialog->AddLine("Player 3 start is missing", 1);
-		else if (! (mask & 8))
-			dialog->AddLine("Player 4 start is missing", 1);
-		else
-			dialog->AddLine("Found all 4 player starts");
+		if (players.message.good())
+			dialog->AddLine(players.message, players.severity);
 
-		if (inst.conf.features.no_need_players)
-		{
-			// leave a blank space
-		}
-		else if (dm_num == 0)
-		{
-			dialog->AddLine("Map is missing deathmatch starts", 1);
-		}
-		else if (dm_num < inst.conf.miscInfo.min_dm_starts)
-		{
-			check_message = SString::printf("Found %d deathmatch starts -- need at least %d", dm_num,
-				inst.conf.miscInfo.min_dm_starts);
-			dialog->AddLine(check_message, 1);
-		}
-		else if (dm_num > inst.conf.miscInfo.max_dm_starts)
-		{
-			check_message = SString::printf("Found %d deathmatch starts -- maximum is %d", dm_num,
-				inst.conf.miscInfo.max_dm_starts);
-			dialog->AddLine(check_message, 2);
-		}
-		else
-		{
-			check_message = SString::printf("Found %d deathmatch starts -- OK", dm_num);
-			dialog->AddLine(check_message);
-		}
+		if (deathmatch.message.good())
+			dialog->AddLine(deathmatch.message, deathmatch.severity);
 
 
 		// in "ALL" mode, just continue if not too severe
@@ -2402,17 +2618,6 @@ static int linedef_pos_cmp(int A, int B, const Document &doc)
 }
 
 
-struct linedef_pos_CMP_pred
-{
-	const Document &doc;
-
-	inline bool operator() (int A, int B) const
-	{
-		return linedef_pos_cmp(A, B, doc) < 0;
-	}
-};
-
-
 struct linedef_minx_CMP_pred
 {
 	const Document &doc;
@@ -2439,29 +2644,31 @@ static void LineDefs_FindOverlaps(selection_c& lines, const Document &doc)
 	if (doc.numLinedefs() < 2)
 		return;
 
-	int n;
-
-	// sort linedefs by their position.  overlapping lines will end up
-	// adjacent to each other after the sort.
-	std::vector<int> sorted_list(doc.numLinedefs(), 0);
-
-	for (n = 0 ; n < doc.numLinedefs(); n++)
-		sorted_list[n] = n;
-
-	std::sort(sorted_list.begin(), sorted_list.end(), linedef_pos_CMP_pred{ doc });
+	// the key matches what linedef_pos_cmp() considers equal
+	DuplicateFinder finder(doc.numLinedefs());
 
-	for (n = 0 ; n < doc.numLinedefs() - 1 ; n++)
+	for (int n = 0 ; n < doc.numLinedefs(); n++)
 	{
-		int ld1 = sorted_list[n];
-		int ld2 = sorted_list[n + 1];
+		const LineDef *L = doc.linedefs[n];
 
 		// ignore zero-length lines
-		if (doc.linedefs[ld2]->IsZeroLength(doc))
+		if (L->IsZeroLength(doc))
 			continue;
 
+		int x1 = static_cast<int>(L->Start(doc)->x());
+		int y1 = static_cast<int>(L->Start(doc)->y());
+		int x2 = static_cast<int>(L->End(doc)->x());
+		int y2 = static_cast<int>(L->End(doc)->y());
+
+		if (x1 > x2 || (x1 == x2 && y1 > y2))
+		{
+			std::swap(x1, x2);
+			std::swap(y1, y2);
+		}
+
 		// only the second (or third, etc) linedef is stored
-		if (linedef_pos_cmp(ld1, ld2, doc) == 0)
-			lines.set(ld2);
+		if (finder.add(n, { x1, y1, x2, y2 }) >= 0)
+			lines.set(n);
 	}
 }
 
@@ -2805,125 +3012,41 @@ CheckResult ChecksModule::checkLinedefs(int min_severity) const
 {
 	UI_Check_LineDefs *dialog = new UI_Check_LineDefs(min_severity > 0, inst);
 
-	selection_c  sel, other;
-
-	std::map<int, int> types;
-
-	SString check_buffer;
-
 	for (;;)
 	{
-		LineDefs_FindZeroLen(sel, doc);
-
-		if (sel.empty())
-			dialog->AddLine("No zero-length linedefs");
-		else
-		{
-			check_buffer = SString::printf("%d zero-length linedefs", sel.count_obj());
-
-			dialog->AddLine(check_buffer, 2, 220,
-			                "Show",   &UI_Check_LineDefs::action_show_zero,
-			                "Remove", &UI_Check_LineDefs::action_remove_zero);
-		}
-
+		dialog->AddDetector(CHK_ZeroLenLineDefs, inst, 220,
+		                    "Show",   &UI_Check_LineDefs::action_show_zero,
+		                    "Remove", &UI_Check_LineDefs::action_remove_zero);
 
-		LineDefs_FindOverlaps(sel, doc);
+		dialog->AddDetector(CHK_OverlapLineDefs, inst, 220,
+		                    "Show",   &UI_Check_LineDefs::action_show_overlap,
+		                    "Remove", &UI_Check_LineDefs::action_remove_overlap);
 
-		if (sel.empty())
-			dialog->AddLine("No overlapping linedefs");
-		else
-		{
-			check_buffer = SString::printf("%d overlapping linedefs", sel.count_obj());
-
-			dialog->AddLine(check_buffer, 2, 220,
-			                "Show",   &UI_Check_LineDefs::action_show_overlap,
-			                "Remove", &UI_Check_LineDefs::action_remove_overlap);
-		}
-
-
-		LineDefs_FindCrossings(sel, doc);
-
-		if (sel.empty())
-			dialog->AddLine("No criss-crossing linedefs");
-		else
-		{
-			check_buffer = SString::printf("%d criss-crossing linedefs", sel.count_obj());
-
-			dialog->AddLine(check_buffer, 2, 220,
-			                "Show", &UI_Check_LineDefs::action_show_crossing);
-		}
+		dialog->AddDetector(CHK_CrossingLineDefs, inst, 220,
+		                    "Show", &UI_Check_LineDefs::action_show_crossing);
 
 		dialog->AddGap(10);
 
 
-		LineDefs_FindUnknown(sel, types, inst);
-
-		if (sel.empty())
-			dialog->AddLine("No unknown line types");
-		else
-		{
-			check_buffer = SString::printf("%d unknown line types", (int)types.size());
-
-			dialog->AddLine(check_buffer, 1, 210,
-			                "Show",   &UI_Check_LineDefs::action_show_unknown,
-			                "Log",    &UI_Check_LineDefs::action_log_unknown,
-			                "Clear",  &UI_Check_LineDefs::action_clear_unknown);
-		}
-
-
-		LineDefs_FindMissingRight(sel, doc);
-
-		if (sel.empty())
-			dialog->AddLine("No linedefs without a right side");
-		else
-		{
-			check_buffer = SString::printf("%d linedefs without right side", sel.count_obj());
-
-			dialog->AddLine(check_buffer, 2, 300,
-			                "Show", &UI_Check_LineDefs::action_show_mis_right);
-		}
-
-
-		LineDefs_FindManualDoors(sel, inst);
-
-		if (sel.empty())
-			dialog->AddLine("No manual doors on 1S linedefs");
-		else
-		{
-			check_buffer = SString::printf("%d manual doors on 1S linedefs", sel.count_obj());
-
-			dialog->AddLine(check_buffer, 2, 300,
-			                "Show", &UI_Check_LineDefs::action_show_manual_doors,
-			                "Fix",  &UI_Check_LineDefs::action_fix_manual_doors);
-		}
-
-
-		LineDefs_FindLackImpass(sel, doc);
+		dialog->AddDetector(CHK_UnknownLineTypes, inst, 210,
+		                    "Show",   &UI_Check_LineDefs::action_show_unknown,
+		                    "Log",    &UI_Check_LineDefs::action_log_unknown,
+		                    "Clear",  &UI_Check_LineDefs::action_clear_unknown);
 
-		if (sel.empty())
-			dialog->AddLine("No non-blocking one-sided linedefs");
-		else
-		{
-			check_buffer = SString::printf("%d non-blocking one-sided linedefs", sel.count_obj());
-
-			dialog->AddLine(check_buffer, 1, 300,
-			                "Show", &UI_Check_LineDefs::action_show_lack_impass,
-			                "Fix",  &UI_Check_LineDefs::action_fix_lack_impass);
-		}
+		dialog->AddDetector(CHK_MissingRightSide, inst, 300,
+		                    "Show", &UI_Check_LineDefs::action_show_mis_right);
 
+		dialog->AddDetector(CHK_ManualDoors, inst, 300,
+		                    "Show", &UI_Check_LineDefs::action_show_manual_doors,
+		                    "Fix",  &UI_Check_LineDefs::action_fix_manual_doors);
 
-		LineDefs_FindBad2SFlag(sel, doc);
+		dialog->AddDetector(CHK_LackImpass, inst, 300,
+		                    "Show", &UI_Check_LineDefs::action_show_lack_impass,
+		                    "Fix",  &UI_Check_LineDefs::action_fix_lack_impass);
 
-		if (sel.empty())
-			dialog->AddLine("No linedefs with wrong 2S flag");
-		else
-		{
-			check_buffer = SString::printf("%d linedefs with wrong 2S flag", sel.count_obj());
-
-			dialog->AddLine(check_buffer, 1, 300,
-			                "Show", &UI_Check_LineDefs::action_show_bad_2s_flag,
-			                "Fix",  &UI_Check_LineDefs::action_fix_bad_2s_flag);
-		}
+		dialog->AddDetector(CHK_Bad2SFlag, inst, 300,
+		                    "Show", &UI_Check_LineDefs::action_show_bad_2s_flag,
+		                    "Fix",  &UI_Check_LineDefs::action_fix_bad_2s_flag);
 
 
 		// in "ALL" mode, just continue if not too severe
@@ -3334,61 +3457,21 @@ CheckResult ChecksModule::checkTags(int min_severity) const
 {
 	UI_Check_Tags *dialog = new UI_Check_Tags(min_severity > 0, inst);
 
-	selection_c  sel;
 	SString check_buffer;
 
 	for (;;)
 	{
-		Tags_FindMissingTags(sel, inst);
-
-		if (sel.empty())
-			dialog->AddLine("No linedefs missing a needed tag");
-		else
-		{
-			check_buffer = SString::printf("%d linedefs missing a needed tag", sel.count_obj());
-
-			dialog->AddLine(check_buffer, 2, 320,
-			                "Show", &UI_Check_Tags::action_show_missing_tag);
-		}
-
-
-		Tags_FindUnmatchedLineDefs(sel, doc);
-
-		if (sel.empty())
-			dialog->AddLine("No tagged linedefs w/o a matching sector");
-		else
-		{
-			check_buffer = SString::printf("%d tagged linedefs w/o a matching sector", sel.count_obj());
-
-			dialog->AddLine(check_buffer, 2, 350,
-			                "Show", &UI_Check_Tags::action_show_unmatch_line);
-		}
-
-
-		Tags_FindUnmatchedSectors(sel, inst);
-
-		if (sel.empty())
-			dialog->AddLine("No tagged sectors w/o a matching linedef");
-		else
-		{
-			check_buffer = SString::printf("%d tagged sectors w/o a matching linedef", sel.count_obj());
-
-			dialog->AddLine(check_buffer, 1, 350,
-			                "Show", &UI_Check_Tags::action_show_unmatch_sec);
-		}
-
+		dialog->AddDetector(CHK_MissingTags, inst, 320,
+		                    "Show", &UI_Check_Tags::action_show_missing_tag);
 
-		Tags_FindBeastMarks(sel, inst);
+		dialog->AddDetector(CHK_UnmatchedLineDefs, inst, 350,
+		                    "Show", &UI_Check_Tags::action_show_unmatch_line);
 
-		if (sel.empty())
-			dialog->AddLine("No sectors with tag 666 or 667 used on the wrong map");
-		else
-		{
-			check_buffer = SString::printf("%d sectors have an invalid 666/667 tag", sel.count_obj());
+		dialog->AddDetector(CHK_UnmatchedSectors, inst, 350,
+		                    "Show", &UI_Check_Tags::action_show_unmatch_sec);
 
-			dialog->AddLine(check_buffer, 1, 350,
-			                "Show", &UI_Check_Tags::action_show_beast_marks);
-		}
+		dialog->AddDetector(CHK_BeastMarks, inst, 350,
+		                    "Show", &UI_Check_Tags::action_show_beast_marks);
 
 		dialog->AddGap(10);
 
@@ -3560,7 +3643,7 @@ static bool is_transparent(const Instance &inst, const SString &tex)
 	if (! img)
 		return false;
 
-	// note : this is slow
+	// cached in the image, so this is cheap
 	return img->has_transparent();
 }
 
@@ -4242,104 +4325,38 @@ CheckResult ChecksModule::checkTextures(int min_severity) const
 {
 	UI_Check_Textures *dialog = new UI_Check_Textures(min_severity > 0, inst);
 
-	selection_c  sel;
-
-	std::map<SString, int> names;
-	SString check_buffer;
-
 	for (;;)
 	{
-		Textures_FindUnknownTex(sel, names, inst);
-
-		if (sel.empty())
-			dialog->AddLine("No unknown textures");
-		else
-		{
-			check_buffer = SString::printf("%d unknown textures", (int)names.size());
-
-			dialog->AddLine(check_buffer, 2, 200,
-			                "Show", &UI_Check_Textures::action_show_unk_tex,
-			                "Log",  &UI_Check_Textures::action_log_unk_tex,
-			                "Fix",  &UI_Check_Textures::action_fix_unk_tex);
-		}
-
-
-		Textures_FindUnknownFlat(sel, names, inst);
-
-		if (sel.empty())
-			dialog->AddLine("No unknown flats");
-		else
-		{
-			check_buffer = SString::printf("%d unknown flats", (int)names.size());
-
-			dialog->AddLine(check_buffer, 2, 200,
-			                "Show", &UI_Check_Textures::action_show_unk_flat,
-			                "Log",  &UI_Check_Textures::action_log_unk_flat,
-			                "Fix",  &UI_Check_Textures::action_fix_unk_flat);
-		}
-
-
-		if (! inst.conf.features.medusa_fixed)
-		{
-			Textures_FindMedusa(sel, names, inst);
+		dialog->AddDetector(CHK_UnknownTextures, inst, 200,
+		                    "Show", &UI_Check_Textures::action_show_unk_tex,
+		                    "Log",  &UI_Check_Textures::action_log_unk_tex,
+		                    "Fix",  &UI_Check_Textures::action_fix_unk_tex);
 
-			if (sel.empty())
-				dialog->AddLine("No textures causing Medusa Effect");
-			else
-			{
-				check_buffer = SString::printf("%d Medusa textures", (int)names.size());
+		dialog->AddDetector(CHK_UnknownFlats, inst, 200,
+		                    "Show", &UI_Check_Textures::action_show_unk_flat,
+		                    "Log",  &UI_Check_Textures::action_log_unk_flat,
+		                    "Fix",  &UI_Check_Textures::action_fix_unk_flat);
 
-				dialog->AddLine(check_buffer, 2, 200,
-								"Show", &UI_Check_Textures::action_show_medusa,
-								"Log",  &UI_Check_Textures::action_log_medusa,
-								"Fix",  &UI_Check_Textures::action_remove_medusa);
-			}
-		}
+		dialog->AddDetector(CHK_MedusaTextures, inst, 200,
+		                    "Show", &UI_Check_Textures::action_show_medusa,
+		                    "Log",  &UI_Check_Textures::action_log_medusa,
+		                    "Fix",  &UI_Check_Textures::action_remove_medusa);
 
 		dialog->AddGap(10);
 
 
-		Textures_FindMissing(inst, sel);
-
-		if (sel.empty())
-			dialog->AddLine("No missing textures on walls");
-		else
-		{
-			check_buffer = SString::printf("%d missing textures on walls", sel.count_obj());
-
-			dialog->AddLine(check_buffer, 1, 275,
-			                "Show", &UI_Check_Textures::action_show_missing,
-			                "Fix",  &UI_Check_Textures::action_fix_missing);
-		}
-
-
-		Textures_FindTransparent(inst, sel, names);
-
-		if (sel.empty())
-			dialog->AddLine("No transparent textures on solids");
-		else
-		{
-			check_buffer = SString::printf("%d transparent textures on solids", sel.count_obj());
-
-			dialog->AddLine(check_buffer, 1, 275,
-			                "Show", &UI_Check_Textures::action_show_transparent,
-			                "Fix",  &UI_Check_Textures::action_fix_transparent,
-			                "Log",  &UI_Check_Textures::action_log_transparent);
-		}
-
+		dialog->AddDetector(CHK_MissingTextures, inst, 275,
+		                    "Show", &UI_Check_Textures::action_show_missing,
+		                    "Fix",  &UI_Check_Textures::action_fix_missing);
 
-		Textures_FindDupSwitches(sel, doc);
+		dialog->AddDetector(CHK_TransparentTextures, inst, 275,
+		                    "Show", &UI_Check_Textures::action_show_transparent,
+		                    "Fix",  &UI_Check_Textures::action_fix_transparent,
+		                    "Log",  &UI_Check_Textures::action_log_transparent);
 
-		if (sel.empty())
-			dialog->AddLine("No non-animating switch textures");
-		else
-		{
-			check_buffer = SString::printf("%d non-animating switch textures", sel.count_obj());
-
-			dialog->AddLine(check_buffer, 1, 275,
-			                "Show", &UI_Check_Textures::action_show_dup_switch,
-			                "Fix",  &UI_Check_Textures::action_fix_dup_switch);
-		}
+		dialog->AddDetector(CHK_DupSwitches, inst, 275,
+		                    "Show", &UI_Check_Textures::action_show_dup_switch,
+		                    "Fix",  &UI_Check_Textures::action_fix_dup_switch);
 
 
 		if (dialog->WorstSeverity() < min_severity)
@@ -4365,6 +4382,151 @@ CheckResult ChecksModule::checkTextures(int min_severity) const
 }
 
 
+//------------------------------------------------------------------------
+//  DETECTOR TABLE
+//------------------------------------------------------------------------
+
+static int Sectors_CountUnknown(selection_c &sel, Instance &inst)
+{
+	std::map<int, int> types;
+	Sectors_FindUnknown(sel, types, inst);
+	return (int)types.size();
+}
+
+static int LineDefs_CountUnknown(selection_c &sel, Instance &inst)
+{
+	std::map<int, int> types;
+	LineDefs_FindUnknown(sel, types, inst);
+	return (int)types.size();
+}
+
+static int Things_CountUnknown(selection_c &sel, Instance &inst)
+{
+	std::map<int, int> types;
+	Things_FindUnknown(sel, types, inst);
+	return (int)types.size();
+}
+
+static int Textures_CountUnknownTex(selection_c &sel, Instance &inst)
+{
+	std::map<SString, int> names;
+	Textures_FindUnknownTex(sel, names, inst);
+	return (int)names.size();
+}
+
+static int Textures_CountUnknownFlat(selection_c &sel, Instance &inst)
+{
+	std::map<SString, int> names;
+	Textures_FindUnknownFlat(sel, names, inst);
+	return (int)names.size();
+}
+
+static int Textures_CountMedusa(selection_c &sel, Instance &inst)
+{
+	std::map<SString, int> names;
+	Textures_FindMedusa(sel, names, inst);
+	return (int)names.size();
+}
+
+static int Textures_CountTransparent(selection_c &sel, Instance &inst)
+{
+	std::map<SString, int> names;
+	Textures_FindTransparent(inst, sel, names);
+	return sel.count_obj();
+}
+
+
+// the detectors which only need to count the objects they find
+#define COUNT_OBJECTS(find_call)  \
+	[](selection_c &sel, Instance &inst) { find_call; return sel.count_obj(); }
+
+static const check_detector_t check_detectors[NUM_CHECK_DETECTORS] =
+{
+	{ "vertices", 2, "No overlapping vertices", "%d overlapping vertices",
+	  COUNT_OBJECTS(Vertex_FindOverlaps(sel, inst.level)) },
+	{ "vertices", 2, "No dangling vertices", "%d dangling vertices",
+	  COUNT_OBJECTS(Vertex_FindDanglers(sel, inst.level)) },
+	{ "vertices", 1, "No unused vertices", "%d unused vertices",
+	  COUNT_OBJECTS(Vertex_FindUnused(sel, inst.level)) },
+
+	{ "sectors", 2, "No unclosed sectors", "%d unclosed sectors",
+	  COUNT_OBJECTS(selection_c verts; Sectors_FindUnclosed(sel, verts, inst.level)) },
+	{ "sectors", 2, "No mismatched sectors", "%d mismatched sectors",
+	  COUNT_OBJECTS(selection_c lines; Sectors_FindMismatches(sel, lines, inst.level)) },
+	{ "sectors", 2, "No sectors with ceil < floor", "%d sectors with ceil < floor",
+	  COUNT_OBJECTS(Sectors_FindBadCeil(sel, inst.level)) },
+	{ "sectors", 2, "No unknown sector types", "%d unknown sector types",
+	  Sectors_CountUnknown },
+	{ "sectors", 1, "No shared sidedefs", "%d shared sidedefs",
+	  COUNT_OBJECTS(selection_c lines; SideDefs_FindPacking(sel, lines, inst.level)) },
+	{ "sectors", 1, "No unused sectors", "%d unused sectors",
+	  COUNT_OBJECTS(Sectors_FindUnused(sel, inst.level)) },
+	{ "sectors", 1, "No unused sidedefs", "%d unused sidedefs",
+	  COUNT_OBJECTS(SideDefs_FindUnused(sel, inst.level)) },
+
+	{ "linedefs", 2, "No zero-length linedefs", "%d zero-length linedefs",
+	  COUNT_OBJECTS(LineDefs_FindZeroLen(sel, inst.level)) },
+	{ "linedefs", 2, "No overlapping linedefs", "%d overlapping linedefs",
+	  COUNT_OBJECTS(LineDefs_FindOverlaps(sel, inst.level)) },
+	{ "linedefs", 2, "No criss-crossing linedefs", "%d criss-crossing linedefs",
+	  COUNT_OBJECTS(LineDefs_FindCrossings(sel, inst.level)) },
+	{ "linedefs", 1, "No unknown line types", "%d unknown line types",
+	  LineDefs_CountUnknown },
+	{ "linedefs", 2, "No linedefs without a right side", "%d linedefs without right side",
+	  COUNT_OBJECTS(LineDefs_FindMissingRight(sel, inst.level)) },
+	{ "linedefs", 2, "No manual doors on 1S linedefs", "%d manual doors on 1S linedefs",
+	  COUNT_OBJECTS(LineDefs_FindManualDoors(sel, inst)) },
+	{ "linedefs", 1, "No non-blocking one-sided linedefs", "%d non-blocking one-sided linedefs",
+	  COUNT_OBJECTS(LineDefs_FindLackImpass(sel, inst.level)) },
+	{ "linedefs", 1, "No linedefs with wrong 2S flag", "%d linedefs with wrong 2S flag",
+	  COUNT_OBJECTS(LineDefs_FindBad2SFlag(sel, inst.level)) },
+
+	{ "things", 2, "No unknown thing types", "%d unknown things",
+	  Things_CountUnknown },
+	{ "things", 2, "No stuck actors", "%d stuck actors",
+	  COUNT_OBJECTS(Things_FindStuckies(sel, inst)) },
+	{ "things", 1, "No things in the void", "%d things in the void",
+	  COUNT_OBJECTS(Things_FindInVoid(sel, inst)) },
+	{ "things", 1, "No duplicated things", "%d duplicated things",
+	  COUNT_OBJECTS(Things_FindDuplicates(sel, inst.level)) },
+	{ "things", 1, "No unspawnable things -- skill flags are OK", "%d unspawnable things",
+	  COUNT_OBJECTS(Things_FindDuds(inst, sel)) },
+
+	{ "textures", 2, "No unknown textures", "%d unknown textures",
+	  Textures_CountUnknownTex },
+	{ "textures", 2, "No unknown flats", "%d unknown flats",
+	  Textures_CountUnknownFlat },
+	{ "textures", 2, "No textures causing Medusa Effect", "%d Medusa textures",
+	  Textures_CountMedusa,
+	  [](const Instance &inst) { return ! inst.conf.features.medusa_fixed; } },
+	{ "textures", 1, "No missing textures on walls", "%d missing textures on walls",
+	  COUNT_OBJECTS(Textures_FindMissing(inst, sel)) },
+	{ "textures", 1, "No transparent textures on solids", "%d transparent textures on solids",
+	  Textures_CountTransparent },
+	{ "textures", 1, "No non-animating switch textures", "%d non-animating switch textures",
+	  COUNT_OBJECTS(Textures_FindDupSwitches(sel, inst.level)) },
+
+	{ "tags", 2, "No linedefs missing a needed tag", "%d linedefs missing a needed tag",
+	  COUNT_OBJECTS(Tags_FindMissingTags(sel, inst)) },
+	{ "tags", 2, "No tagged linedefs w/o a matching sector", "%d tagged linedefs w/o a matching sector",
+	  COUNT_OBJECTS(Tags_FindUnmatchedLineDefs(sel, inst.level)) },
+	{ "tags", 1, "No tagged sectors w/o a matching linedef", "%d tagged sectors w/o a matching linedef",
+	  COUNT_OBJECTS(Tags_FindUnmatchedSectors(sel, inst)) },
+	{ "tags", 1, "No sectors with tag 666 or 667 used on the wrong map", "%d sectors have an invalid 666/667 tag",
+	  COUNT_OBJECTS(Tags_FindBeastMarks(sel, inst)) },
+};
+
+#undef COUNT_OBJECTS
+
+
+static const check_detector_t &GetDetector(check_detector_e what)
+{
+	SYS_ASSERT(0 <= what && what < NUM_CHECK_DETECTORS);
+
+	return check_detectors[what];
+}
+
+
 //------------------------------------------------------------------------
 
 
@@ -4410,6 +4572,65 @@ void ChecksModule::checkAll(bool major_stuff) const
 }
 
 
+static void addProblem(std::vector<CheckProblem> &problems, const char *category,
+					   int severity, const SString &message, const selection_c *objects)
+{
+	CheckProblem problem;
+
+	problem.category = category;
+	problem.severity = severity;
+	problem.message  = message;
+
+	if (objects)
+	{
+		problem.type = objects->what_type();
+
+		for (sel_iter_c it(*objects) ; !it.done() ; it.next())
+			problem.objects.push_back(*it);
+	}
+
+	problems.push_back(std::move(problem));
+}
+
+
+//
+// Batch mode version of checkAll(): runs the same detectors as the
+// check dialogs, but records what was found instead of showing it.
+//
+void ChecksModule::collectProblems(std::vector<CheckProblem> &problems) const
+{
+	for (int n = 0 ; n < NUM_CHECK_DETECTORS ; n++)
+	{
+		const check_detector_t &det = check_detectors[n];
+
+		if (det.applies && ! det.applies(inst))
+			continue;
+
+		selection_c sel;
+
+		int count = det.find(sel, inst);
+
+		if (sel.notempty())
+			addProblem(problems, det.category, det.severity, SString::printf(det.problem_format, count), &sel);
+
+		// the starts are not tied to any object, and come last in the
+		// things dialog
+		if (n == CHK_UnspawnableThings)
+		{
+			check_line_t players, deathmatch;
+
+			Things_CheckStarts(inst, players, deathmatch);
+
+			if (players.severity > 0)
+				addProblem(problems, "things", players.severity, players.message, nullptr);
+
+			if (deathmatch.severity > 0)
+				addProblem(problems, "things", deathmatch.severity, deathmatch.message, nullptr);
+		}
+	}
+}
+
+
 void Instance::CMD_MapCheck()
 {
 	SString what = EXEC_Param[0];
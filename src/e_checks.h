@@ -30,6 +30,8 @@
 #include "DocumentModule.h"
 #include "ui_window.h"
 
+#include <vector>
+
 // the CHECK_xxx functions return the following values:
 enum class CheckResult
 {
@@ -40,6 +42,18 @@ enum class CheckResult
 	tookAction		// [internal use : user took some action]
 };
 
+//
+// A problem found by ChecksModule::collectProblems()
+//
+struct CheckProblem
+{
+	SString category;	// "vertices", "sectors", "linedefs", ...
+	SString message;
+	int severity = 0;	// 1 = minor, 2 = major
+	ObjType type = ObjType::things;
+	std::vector<int> objects;	// empty when not tied to any object
+};
+
 //
 // The map checking module
 //
@@ -57,6 +71,8 @@ public:
 	void tagsApplyNewValue(int new_tag);
 	void tagsUsedRange(int *min_tag, int *max_tag) const;
 
+	void collectProblems(std::vector<CheckProblem> &problems) const;
+
 private:
 	void checkAll(bool majorStuff) const;
 
@@ -72,6 +88,12 @@ private:
 
 int findFreeTag(const Instance &inst, bool forsector);
 
+void Vertex_FindOverlaps(selection_c& sel, const Document &doc);
+
+void Things_FindDuplicates(selection_c& list, const Document &doc);
+void Things_FindStuckies(selection_c& list, const Instance &inst);
+void Things_FindStuckiesSlow(selection_c& list, const Instance &inst);
+
 #endif  /* __EUREKA_E_CHECKS_H__ */
 
 //--- editor settings ---
@@ -1394,6 +1394,10 @@ static editor_command_t  command_table[] =
 		/* keywords */ "all major vertices sectors linedefs things textures tags current"
 	},
 
+	{	"VanillaHeatmap", "Misc",
+		&Instance::CMD_VanillaHeatmap
+	},
+
 
 	/* ----- 2D canvas ----- */
 
@@ -1492,6 +1496,14 @@ static editor_command_t  command_table[] =
 		&Instance::CMD_DeleteMap
 	},
 
+	{	"CompactWad",  "File",
+		&Instance::CMD_CompactWad
+	},
+
+	{	"RestoreBackup",  "File",
+		&Instance::CMD_RestoreBackup
+	},
+
 	{	"Quit",  "File",
 		&Instance::CMD_Quit
 	},
@@ -407,6 +407,8 @@ void Instance::MapStuff_NotifyBegin()
 	moved_vertex_count =  0;
 
 	sound_propagation_invalid = true;
+
+	vanilla_heat.reset();
 }
 
 void Instance::MapStuff_NotifyInsert(ObjType type, int objnum)
@@ -38,6 +38,7 @@
 #include "r_render.h"
 #include "Sector.h"
 #include "SideDef.h"
+#include "UnionFind.h"
 #include "w_rawdef.h"
 
 #include "ui_window.h"
@@ -231,50 +232,56 @@ void Instance::CMD_LIN_SelectPath()
 
 #define PLAYER_STEP_H	24
 
-static bool GrowContiguousSectors(const Instance &inst, selection_c &seen)
+//
+// The flags of the SEC_SelectGroup command, which decide whether a
+// two-sided linedef joins its sectors into a single group.
+//
+struct sector_match_t
 {
-	// returns TRUE when some new sectors got added
-
-	bool changed = false;
+	bool can_walk;
+	bool allow_doors;
 
-	bool can_walk    = inst.Exec_HasFlag("/can_walk");
-	bool allow_doors = inst.Exec_HasFlag("/doors");
+	bool do_floor_h;
+	bool do_floor_tex;
+	bool do_ceil_h;
+	bool do_ceil_tex;
 
-	bool do_floor_h   = inst.Exec_HasFlag("/floor_h");
-	bool do_floor_tex = inst.Exec_HasFlag("/floor_tex");
-	bool do_ceil_h    = inst.Exec_HasFlag("/ceil_h");
-	bool do_ceil_tex  = inst.Exec_HasFlag("/ceil_tex");
+	bool do_light;
+	bool do_tag;
+	bool do_special;
 
-	bool do_light   = inst.Exec_HasFlag("/light");
-	bool do_tag     = inst.Exec_HasFlag("/tag");
-	bool do_special = inst.Exec_HasFlag("/special");
-
-	for (const LineDef *L : inst.level.linedefs)
+	explicit sector_match_t(const Instance &inst)
 	{
-		if (! L->TwoSided())
-			continue;
+		can_walk    = inst.Exec_HasFlag("/can_walk");
+		allow_doors = inst.Exec_HasFlag("/doors");
 
-		int sec1 = L->Right(inst.level)->sector;
-		int sec2 = L-> Left(inst.level)->sector;
+		do_floor_h   = inst.Exec_HasFlag("/floor_h");
+		do_floor_tex = inst.Exec_HasFlag("/floor_tex");
+		do_ceil_h    = inst.Exec_HasFlag("/ceil_h");
+		do_ceil_tex  = inst.Exec_HasFlag("/ceil_tex");
 
-		if (sec1 == sec2)
-			continue;
+		do_light   = inst.Exec_HasFlag("/light");
+		do_tag     = inst.Exec_HasFlag("/tag");
+		do_special = inst.Exec_HasFlag("/special");
+	}
 
-		Sector *S1 = inst.level.sectors[sec1];
-		Sector *S2 = inst.level.sectors[sec2];
+	bool Joins(const Instance &inst, const LineDef *L) const
+	{
+		const Sector *S1 = inst.level.sectors[L->Right(inst.level)->sector];
+		const Sector *S2 = inst.level.sectors[L-> Left(inst.level)->sector];
 
 		// skip closed doors
 		if (! allow_doors && (S1->floorh >= S1->ceilh || S2->floorh >= S2->ceilh))
-			continue;
+			return false;
 
 		if (can_walk)
 		{
 			if (L->flags & MLF_Blocking)
-				continue;
+				return false;
 
 			// too big a step?
 			if (abs(S1->floorh - S2->floorh) > PLAYER_STEP_H)
-				continue;
+				return false;
 
 			// player wouldn't fit vertically?
 			int f_max = std::max(S1->floorh, S2->floorh);
@@ -284,37 +291,25 @@ static bool GrowContiguousSectors(const Instance &inst, selection_c &seen)
 			{
 				// ... but allow doors
 				if (! (allow_doors && (S1->floorh == S1->ceilh || S2->floorh == S2->ceilh)))
-					continue;
+					return false;
 			}
 		}
 
 		/* perform match */
 
-		if (do_floor_h && (S1->floorh != S2->floorh)) continue;
-		if (do_ceil_h  && (S1->ceilh  != S2->ceilh))  continue;
-
-		if (do_floor_tex && (S1->floor_tex != S2->floor_tex)) continue;
-		if (do_ceil_tex  && (S1->ceil_tex  != S2->ceil_tex))  continue;
-
-		if (do_light   && (S1->light != S2->light)) continue;
-		if (do_tag     && (S1->tag   != S2->tag  )) continue;
-		if (do_special && (S1->type  != S2->type))  continue;
+		if (do_floor_h && (S1->floorh != S2->floorh)) return false;
+		if (do_ceil_h  && (S1->ceilh  != S2->ceilh))  return false;
 
-		// check if only one of the sectors is part of current set
-		// (doing this _AFTER_ the matches since this can be a bit slow)
-		bool got1 = seen.get(sec1);
-		bool got2 = seen.get(sec2);
+		if (do_floor_tex && (S1->floor_tex != S2->floor_tex)) return false;
+		if (do_ceil_tex  && (S1->ceil_tex  != S2->ceil_tex))  return false;
 
-		if (got1 == got2)
-			continue;
-
-		seen.set(got1 ? sec2 : sec1);
+		if (do_light   && (S1->light != S2->light)) return false;
+		if (do_tag     && (S1->tag   != S2->tag  )) return false;
+		if (do_special && (S1->type  != S2->type))  return false;
 
-		changed = true;
+		return true;
 	}
-
-	return changed;
-}
+};
 
 
 //
@@ -338,13 +333,22 @@ void Instance::CMD_SEC_SelectGroup()
 	if (!fresh_sel && edit.Selected->get(start_sec))
 		unset_them = true;
 
-	selection_c seen(ObjType::sectors);
+	sector_match_t match(*this);
+
+	UnionFind groups(level.numSectors());
 
-	seen.set(start_sec);
+	level.secmod.groupConnectedSectors(groups, [&](const LineDef &L)
+	{
+		return match.Joins(*this, &L);
+	});
+
+	selection_c seen(ObjType::sectors);
 
-	while (GrowContiguousSectors(*this, seen))
-	{ }
+	int start_group = groups.find(start_sec);
 
+	for (int s = 0 ; s < level.numSectors() ; s++)
+		if (groups.find(s) == start_group)
+			seen.set(s);
 
 	Editor_ClearErrorMode();
 
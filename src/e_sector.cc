@@ -42,6 +42,7 @@
 #include "e_objects.h"
 #include "e_sector.h"
 #include "e_vertex.h"
+#include "UnionFind.h"
 #include "Vertex.h"
 
 #include "ui_window.h"
@@ -285,6 +286,32 @@ void SectorModule::linedefsBetweenSectors(selection_c *list, int sec1, int sec2)
 }
 
 
+void SectorModule::groupConnectedSectors(UnionFind &groups,
+		const std::function<bool(const LineDef &)> &joins) const
+{
+	for (const LineDef *L : doc.linedefs)
+	{
+		if (! (L->Left(doc) && L->Right(doc)))
+			continue;
+
+		int sec1 = L->Right(doc)->sector;
+		int sec2 = L->Left(doc) ->sector;
+
+		if (sec1 == sec2 || ! doc.isSector(sec1) || ! doc.isSector(sec2))
+			continue;
+
+		// already in the same group?
+		if (groups.connected(sec1, sec2))
+			continue;
+
+		if (joins && ! joins(*L))
+			continue;
+
+		groups.merge(sec1, sec2);
+	}
+}
+
+
 void SectorModule::replaceSectorRefs(EditOperation &op, int old_sec, int new_sec) const
 {
 	for (int i = 0 ; i < doc.numSidedefs() ; i++)
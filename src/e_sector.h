@@ -29,6 +29,11 @@
 
 #include "DocumentModule.h"
 
+#include <functional>
+
+class LineDef;
+class UnionFind;
+
 class lineloop_c
 {
 public:
@@ -128,6 +133,11 @@ public:
 	void sectorsAdjustLight(int delta) const;
 	void safeRaiseLower(EditOperation &op, int sec, int parts, int dz) const;
 
+	// puts the sectors joined by two-sided linedefs into the same group.
+	// when 'joins' is given, only the linedefs it accepts are used.
+	void groupConnectedSectors(UnionFind &groups,
+			const std::function<bool(const LineDef &)> &joins = nullptr) const;
+
 private:
 	friend class lineloop_c;
 
@@ -97,6 +97,9 @@ const img_pixel_t *Img_c::buf() const
 //
 img_pixel_t *Img_c::wbuf()
 {
+	// caller may modify the pixels
+	props_valid = false;
+
 	return pixels;
 }
 
@@ -106,6 +109,8 @@ img_pixel_t *Img_c::wbuf()
 //
 void Img_c::clear()
 {
+	props_valid = false;
+
 	if (pixels)
 	{
 		img_pixel_t *dest = pixels;
@@ -126,6 +131,8 @@ void Img_c::resize(int new_width, int new_height)
 	if (new_width == w && new_height == h)
 		return;
 
+	props_valid = false;
+
 	// unallocate old buffer
 	if (pixels)
 	{
@@ -293,21 +300,118 @@ Img_c * Img_c::color_remap(int src1, int src2, int targ1, int targ2) const
 }
 
 
-bool Img_c::has_transparent() const
+void Img_c::update_properties() const
 {
+	if (props_valid)
+		return;
+
+	props = Properties();
+
 	int W = width();
 	int H = height();
 
 	const img_pixel_t *src = buf();
 
+	int index_counts[256] = {};
+
 	for (int y = 0 ; y < H ; y++)
 	for (int x = 0 ; x < W ; x++)
 	{
-		if (src[y * W + x] == TRANS_PIXEL)
-			return true;
+		img_pixel_t pix = src[y * W + x];
+
+		if (pix == TRANS_PIXEL)
+		{
+			props.has_transparent = true;
+			continue;
+		}
+
+		if (props.opaque_count == 0)
+		{
+			props.opaque_x1 = props.opaque_x2 = x;
+			props.opaque_y1 = props.opaque_y2 = y;
+		}
+		else
+		{
+			props.opaque_x1 = std::min(props.opaque_x1, x);
+			props.opaque_x2 = std::max(props.opaque_x2, x);
+			props.opaque_y2 = y;
+		}
+
+		props.opaque_count++;
+
+		if (pix & IS_RGB_PIXEL)
+		{
+			props.rgb_sum[0] += IMG_PIXEL_RED(pix)   << 3;
+			props.rgb_sum[1] += IMG_PIXEL_GREEN(pix) << 3;
+			props.rgb_sum[2] += IMG_PIXEL_BLUE(pix)  << 3;
+		}
+		else
+		{
+			index_counts[pix & 255]++;
+		}
+	}
+
+	for (int i = 0 ; i < 256 ; i++)
+		if (index_counts[i] > 0)
+			props.index_counts.emplace_back(static_cast<byte>(i), index_counts[i]);
+
+	props.is_opaque = ! is_null() && ! props.has_transparent;
+
+	props_valid = true;
+}
+
+
+const Img_c::Properties &Img_c::properties() const
+{
+	update_properties();
+
+	return props;
+}
+
+
+bool Img_c::has_transparent() const
+{
+	return properties().has_transparent;
+}
+
+
+rgb_color_t Img_c::average_color(const Palette &pal) const
+{
+	const Properties &P = properties();
+
+	if (P.opaque_count == 0)
+		return RGB_MAKE(0, 0, 0);
+
+	double r = P.rgb_sum[0];
+	double g = P.rgb_sum[1];
+	double b = P.rgb_sum[2];
+
+	for (const std::pair<byte, int> &entry : P.index_counts)
+	{
+		rgb_color_t col = pal.pixelToRGB(entry.first);
+
+		r += RGB_RED(col)   * (double)entry.second;
+		g += RGB_GREEN(col) * (double)entry.second;
+		b += RGB_BLUE(col)  * (double)entry.second;
 	}
 
-	return false;
+	return RGB_MAKE((int)(r / P.opaque_count + 0.5),
+					(int)(g / P.opaque_count + 0.5),
+					(int)(b / P.opaque_count + 0.5));
+}
+
+
+bool Img_c::opaque_bbox(int *x1, int *y1, int *x2, int *y2) const
+{
+	const Properties &P = properties();
+
+	if (P.opaque_count == 0)
+		return false;
+
+	*x1 = P.opaque_x1;  *y1 = P.opaque_y1;
+	*x2 = P.opaque_x2;  *y2 = P.opaque_y2;
+
+	return true;
 }
 
 
@@ -29,6 +29,9 @@
 
 #include "im_color.h"
 
+#include <utility>
+#include <vector>
+
 #ifdef NO_OPENGL
 typedef unsigned int GLuint;
 #else
@@ -61,6 +64,28 @@ struct WadData;
 
 class Img_c
 {
+public:
+	//
+	// Properties derived from the pixels.  These are computed once and
+	// cached, until the pixels are modified again (via wbuf() etc).
+	//
+	struct Properties
+	{
+		bool has_transparent = false;	// some pixel is TRANS_PIXEL
+		bool is_opaque = false;			// no TRANS_PIXEL at all, and not null
+
+		// bounding box of the opaque pixels, empty (x1 > x2) when none
+		int opaque_x1 = 0;
+		int opaque_y1 = 0;
+		int opaque_x2 = -1;
+		int opaque_y2 = -1;
+
+		// enough to get the average color for any palette
+		int opaque_count = 0;
+		long long rgb_sum[3] = {};	// of RGB pixels, 8-bit components
+		std::vector<std::pair<byte, int>> index_counts;	// of palette pixels
+	};
+
 private:
 	img_pixel_t *pixels = nullptr;
 
@@ -70,6 +95,9 @@ private:
 	// texture identifier for OpenGL, 0 if not uploaded yet
 	GLuint gl_tex = 0;
 
+	mutable Properties props;
+	mutable bool props_valid = false;
+
 public:
 	 Img_c() = default;
 	 Img_c(int width, int height, bool _dummy = false);
@@ -117,8 +145,25 @@ public:
 
 	Img_c * color_remap(int src1, int src2, int targ1, int targ2) const;
 
+	const Properties &properties() const;
+
+	// compute the properties now, so that later queries (possibly
+	// from several threads) only read them.
+	void update_properties() const;
+
 	bool has_transparent() const;
 
+	bool is_opaque() const
+	{
+		return properties().is_opaque;
+	}
+
+	// the average color of the opaque pixels, black if there are none
+	rgb_color_t average_color(const Palette &pal) const;
+
+	// returns false if there are no opaque pixels
+	bool opaque_bbox(int *x1, int *y1, int *x2, int *y2) const;
+
 	// upload to OpenGL, overwriting 'gl_tex' field.
 	void load_gl(const WadData &wad);
 
@@ -0,0 +1,167 @@
+//------------------------------------------------------------------------
+//  SHA-256 HASH
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#include "lib_sha256.h"
+
+#include <string.h>
+
+static const uint32_t K[64] =
+{
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static inline uint32_t RotateRight(uint32_t x, int n)
+{
+	return (x >> n) | (x << (32 - n));
+}
+
+
+void sha256_c::Reset()
+{
+	state[0] = 0x6a09e667;
+	state[1] = 0xbb67ae85;
+	state[2] = 0x3c6ef372;
+	state[3] = 0xa54ff53a;
+	state[4] = 0x510e527f;
+	state[5] = 0x9b05688c;
+	state[6] = 0x1f83d9ab;
+	state[7] = 0x5be0cd19;
+
+	total = 0;
+	buffered = 0;
+}
+
+
+void sha256_c::Transform(const uint8_t *block)
+{
+	uint32_t w[64];
+
+	for (int i = 0 ; i < 16 ; i++)
+	{
+		w[i] = ((uint32_t)block[i * 4] << 24) | ((uint32_t)block[i * 4 + 1] << 16) |
+			   ((uint32_t)block[i * 4 + 2] << 8) | (uint32_t)block[i * 4 + 3];
+	}
+
+	for (int i = 16 ; i < 64 ; i++)
+	{
+		uint32_t s0 = RotateRight(w[i - 15], 7) ^ RotateRight(w[i - 15], 18) ^ (w[i - 15] >> 3);
+		uint32_t s1 = RotateRight(w[i - 2], 17) ^ RotateRight(w[i - 2], 19) ^ (w[i - 2] >> 10);
+
+		w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+	}
+
+	uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+	uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+
+	for (int i = 0 ; i < 64 ; i++)
+	{
+		uint32_t S1 = RotateRight(e, 6) ^ RotateRight(e, 11) ^ RotateRight(e, 25);
+		uint32_t ch = (e & f) ^ (~e & g);
+		uint32_t t1 = h + S1 + ch + K[i] + w[i];
+
+		uint32_t S0 = RotateRight(a, 2) ^ RotateRight(a, 13) ^ RotateRight(a, 22);
+		uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+		uint32_t t2 = S0 + maj;
+
+		h = g;
+		g = f;
+		f = e;
+		e = d + t1;
+		d = c;
+		c = b;
+		b = a;
+		a = t1 + t2;
+	}
+
+	state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+	state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+
+sha256_c &sha256_c::AddBlock(const void *vdata, size_t len)
+{
+	auto data = static_cast<const uint8_t *>(vdata);
+
+	total += len;
+
+	// top up a partly filled block first
+	if (buffered > 0)
+	{
+		size_t count = 64 - buffered;
+
+		if (count > len)
+			count = len;
+
+		memcpy(buffer + buffered, data, count);
+
+		buffered += (int)count;
+		data += count;
+		len  -= count;
+
+		if (buffered < 64)
+			return *this;
+
+		Transform(buffer);
+		buffered = 0;
+	}
+
+	for ( ; len >= 64 ; data += 64, len -= 64)
+		Transform(data);
+
+	memcpy(buffer, data, len);
+	buffered = (int)len;
+
+	return *this;
+}
+
+
+SString sha256_c::Finish()
+{
+	uint64_t bits = total * 8;
+
+	// a one bit, zeros up to the last 8 bytes of a block, and the length
+	static const uint8_t padding[64] = { 0x80 };
+
+	AddBlock(padding, (buffered < 56) ? 56 - buffered : 120 - buffered);
+
+	uint8_t length[8];
+
+	for (int i = 0 ; i < 8 ; i++)
+		length[i] = (uint8_t)(bits >> (56 - i * 8));
+
+	AddBlock(length, 8);
+
+	SString result;
+
+	for (int i = 0 ; i < 8 ; i++)
+		result += SString::printf("%08x", state[i]);
+
+	return result;
+}
+
+//--- editor settings ---
+// vi:ts=4:sw=4:noexpandtab
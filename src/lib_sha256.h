@@ -0,0 +1,65 @@
+//------------------------------------------------------------------------
+//  SHA-256 HASH
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+//
+//  This is SHA-256 as described in FIPS 180-4.  It is meant for telling
+//  whether two pieces of data are the same by their hashes alone, where
+//  a weaker hash (like the Adler-32 one) could let different data match.
+//
+//------------------------------------------------------------------------
+
+#ifndef __EUREKA_LIB_SHA256_H__
+#define __EUREKA_LIB_SHA256_H__
+
+#include "m_strings.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+class sha256_c
+{
+public:
+	sha256_c()
+	{
+		Reset();
+	}
+
+	void Reset();
+
+	sha256_c &AddBlock(const void *data, size_t len);
+
+	// the hash of everything added so far, as 64 lower-case hex digits.
+	// Nothing more can be added afterwards, until Reset().
+	SString Finish();
+
+private:
+	void Transform(const uint8_t *block);
+
+	uint32_t state[8];
+
+	uint64_t total;		// bytes added so far
+
+	uint8_t buffer[64];
+	int buffered;
+};
+
+#endif  /* __EUREKA_LIB_SHA256_H__ */
+
+//--- editor settings ---
+// vi:ts=4:sw=4:noexpandtab
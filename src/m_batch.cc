@@ -0,0 +1,407 @@
+//------------------------------------------------------------------------
+//  BATCH MAP CHECKING
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+//
+//  This implements the --check command line mode, which loads every
+//  map of a wad and runs the same detectors as the "Check Map" dialogs,
+//  printing the results as JSON or CSV.  No window is ever opened.
+//
+//------------------------------------------------------------------------
+
+#include "Errors.h"
+#include "Instance.h"
+#include "main.h"
+
+#include "bsp.h"
+#include "e_checks.h"
+#include "m_batch.h"
+#include "w_wad.h"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+
+//
+// A single map being checked.  Each one gets its own Instance, so the
+// detectors can run on several maps at the same time.
+//
+struct BatchLevel
+{
+	SString name;
+	int lev_num = -1;
+
+	std::unique_ptr<Instance> inst;
+
+	SString error;	// non-empty if the map failed to load
+	std::vector<CheckProblem> problems;
+};
+
+
+static void CollectLevels(const Instance &inst, const Wad_file *wad,
+						  std::vector<BatchLevel> &levels)
+{
+	const SString &wanted = inst.loaded.levelName;
+
+	if (wanted.good())
+	{
+		int lev_num = isdigit(wanted[0]) ? wad->LevelFindByNumber(atoi(wanted)) :
+					  wad->LevelFind(wanted);
+		if (lev_num < 0)
+			ThrowException("No such map: %s\n", wanted.c_str());
+
+		levels.emplace_back();
+		levels.back().lev_num = lev_num;
+	}
+	else
+	{
+		for (int lev_num = 0 ; lev_num < wad->LevelCount() ; lev_num++)
+		{
+			levels.emplace_back();
+			levels.back().lev_num = lev_num;
+		}
+	}
+
+	if (levels.empty())
+		ThrowException("No levels found in %s\n", wad->PathName().c_str());
+
+	for (BatchLevel &level : levels)
+		level.name = wad->GetLump(wad->LevelHeader(level.lev_num))->Name().asUpper();
+}
+
+
+//
+// Loading is done sequentially, since it interns strings into the
+// shared string table.  The detectors only read it afterwards.
+//
+static void LoadLevels(const Instance &inst, Wad_file *wad, std::vector<BatchLevel> &levels)
+{
+	for (BatchLevel &level : levels)
+	{
+		gLog.printf("Loading map : %s\n", level.name.c_str());
+
+		level.inst = std::make_unique<Instance>();
+		level.inst->loaded = inst.loaded;
+		level.inst->loaded.levelName = level.name;
+
+		try
+		{
+			level.inst->LoadLevelNum(wad, level.lev_num);
+		}
+		catch (const std::exception &e)
+		{
+			level.error = e.what();
+			level.inst.reset();
+
+			gLog.printf("Failed to load %s: %s\n", level.name.c_str(), e.what());
+		}
+	}
+}
+
+
+static void RunChecks(std::vector<BatchLevel> &levels)
+{
+	std::atomic<size_t> next_level(0);
+
+	auto worker = [&levels, &next_level]()
+	{
+		for (;;)
+		{
+			size_t index = next_level++;
+			if (index >= levels.size())
+				return;
+
+			BatchLevel &level = levels[index];
+			if (! level.inst)
+				continue;
+
+			try
+			{
+				level.inst->level.checks.collectProblems(level.problems);
+			}
+			catch (const std::exception &e)
+			{
+				level.error = e.what();
+			}
+		}
+	};
+
+	unsigned num_threads = std::thread::hardware_concurrency();
+	num_threads = clamp(1u, num_threads, (unsigned)levels.size());
+
+	gLog.printf("Checking %d maps using %u threads\n", (int)levels.size(), num_threads);
+
+	std::vector<std::thread> threads;
+
+	for (unsigned i = 1 ; i < num_threads ; i++)
+		threads.emplace_back(worker);
+
+	worker();
+
+	for (std::thread &thread : threads)
+		thread.join();
+}
+
+
+//------------------------------------------------------------------------
+//  REPORT OUTPUT
+//------------------------------------------------------------------------
+
+static SString JsonString(const SString &str)
+{
+	SString result = "\"";
+
+	for (char ch : str)
+	{
+		switch (ch)
+		{
+			case '"':  result += "\\\""; break;
+			case '\\': result += "\\\\"; break;
+			case '\n': result += "\\n";  break;
+			case '\t': result += "\\t";  break;
+
+			default:
+				if ((unsigned char)ch < 32)
+					result += SString::printf("\\u%04x", (unsigned char)ch);
+				else
+					result += ch;
+				break;
+		}
+	}
+
+	return result + "\"";
+}
+
+
+static SString CsvString(const SString &str)
+{
+	if (str.find_first_of(",\"\n") == std::string::npos)
+		return str;
+
+	SString result = "\"";
+
+	for (char ch : str)
+	{
+		if (ch == '"')
+			result += "\"\"";
+		else
+			result += ch;
+	}
+
+	return result + "\"";
+}
+
+
+static void WriteJsonReport(FILE *fp, const std::vector<BatchLevel> &levels)
+{
+	fprintf(fp, "{\n");
+	fprintf(fp, "  \"wad\": %s,\n", JsonString(global::check_wad).c_str());
+	fprintf(fp, "  \"levels\": [");
+
+	for (size_t i = 0 ; i < levels.size() ; i++)
+	{
+		const BatchLevel &level = levels[i];
+
+		fprintf(fp, "%s\n    {\n", i > 0 ? "," : "");
+		fprintf(fp, "      \"name\": %s,\n", JsonString(level.name).c_str());
+
+		if (level.error.good())
+			fprintf(fp, "      \"error\": %s,\n", JsonString(level.error).c_str());
+
+		fprintf(fp, "      \"problems\": [");
+
+		for (size_t k = 0 ; k < level.problems.size() ; k++)
+		{
+			const CheckProblem &problem = level.problems[k];
+
+			fprintf(fp, "%s\n        { \"category\": %s, \"severity\": \"%s\", \"message\": %s",
+					k > 0 ? "," : "",
+					JsonString(problem.category).c_str(),
+					problem.severity >= 2 ? "major" : "minor",
+					JsonString(problem.message).c_str());
+
+			if (! problem.objects.empty())
+			{
+				fprintf(fp, ", \"type\": \"%s\", \"objects\": [", NameForObjectType(problem.type, true));
+
+				for (size_t n = 0 ; n < problem.objects.size() ; n++)
+					fprintf(fp, "%s%d", n > 0 ? ", " : "", problem.objects[n]);
+
+				fprintf(fp, "]");
+			}
+
+			fprintf(fp, " }");
+		}
+
+		fprintf(fp, "%s]\n    }", level.problems.empty() ? "" : "\n      ");
+	}
+
+	fprintf(fp, "\n  ]\n}\n");
+}
+
+
+void M_WriteNodeStats(FILE *fp, const SString &wad_name,
+					  const std::vector<nodebuildstats_t> &levels)
+{
+	fprintf(fp, "{\n");
+	fprintf(fp, "  \"wad\": %s,\n", JsonString(wad_name).c_str());
+	fprintf(fp, "  \"levels\": [");
+
+	for (size_t i = 0 ; i < levels.size() ; i++)
+	{
+		const nodebuildstats_t &level = levels[i];
+
+		fprintf(fp, "%s\n    {\n", i > 0 ? "," : "");
+		fprintf(fp, "      \"name\": %s,\n", JsonString(level.level_name).c_str());
+
+		fprintf(fp, "      \"seconds\": { \"segs\": %.4f, \"tree\": %.4f, \"picknode\": %.4f, "
+				"\"blockmap\": %.4f, \"reject\": %.4f, \"write\": %.4f },\n",
+				level.time_segs, level.time_tree, level.time_picknode,
+				level.time_blockmap, level.time_reject, level.time_write);
+
+		fprintf(fp, "      \"partitions_evaluated\": %lld,\n", level.partitions_evaluated);
+		fprintf(fp, "      \"seg_splits\": %d,\n", level.seg_splits);
+		fprintf(fp, "      \"height\": %d,\n", level.height);
+		fprintf(fp, "      \"peak_memory\": %zu,\n", level.peak_memory);
+		fprintf(fp, "      \"limits\": [");
+
+		std::vector<nodebuildstats_t::limit_t> limits = level.VanillaLimits();
+
+		for (size_t k = 0 ; k < limits.size() ; k++)
+		{
+			fprintf(fp, "%s\n        { \"name\": \"%s\", \"count\": %d, \"limit\": %d }",
+					k > 0 ? "," : "", limits[k].name, limits[k].count, limits[k].limit);
+		}
+
+		fprintf(fp, "\n      ]\n    }");
+	}
+
+	fprintf(fp, "\n  ]\n}\n");
+}
+
+
+static void WriteCsvReport(FILE *fp, const std::vector<BatchLevel> &levels)
+{
+	fprintf(fp, "map,category,severity,message,type,objects\n");
+
+	for (const BatchLevel &level : levels)
+	{
+		if (level.error.good())
+		{
+			fprintf(fp, "%s,load,major,%s,,\n", CsvString(level.name).c_str(),
+					CsvString(level.error).c_str());
+		}
+
+		for (const CheckProblem &problem : level.problems)
+		{
+			SString objects;
+
+			for (int n : problem.objects)
+			{
+				if (objects.good())
+					objects += ' ';
+				objects += SString::printf("%d", n);
+			}
+
+			fprintf(fp, "%s,%s,%s,%s,%s,%s\n",
+					CsvString(level.name).c_str(),
+					CsvString(problem.category).c_str(),
+					problem.severity >= 2 ? "major" : "minor",
+					CsvString(problem.message).c_str(),
+					problem.objects.empty() ? "" : NameForObjectType(problem.type, true),
+					objects.c_str());
+		}
+	}
+}
+
+
+//
+// Checks all maps (or the one given with --map) of the already opened
+// edit wad, writing the report to the given file.  Returns 0 when no
+// major problems were found, 1 otherwise.  Errors which prevent checking
+// are thrown, and end up as exit code 2.
+//
+int M_BatchCheck(Instance &inst, FILE *fp)
+{
+	bool want_csv = global::check_format.noCaseEqual("csv");
+
+	if (! want_csv && ! global::check_format.noCaseEqual("json"))
+		ThrowException("Unknown report format: %s\n", global::check_format.c_str());
+
+	Wad_file *wad = inst.wad.master.edit_wad.get();
+	SYS_ASSERT(wad);
+
+	std::vector<BatchLevel> levels;
+
+	CollectLevels(inst, wad, levels);
+	LoadLevels(inst, wad, levels);
+
+	// the game config can depend on the map format and UDMF namespace,
+	// so base it on the first map which loaded (like the editor does).
+	for (const BatchLevel &level : levels)
+	{
+		if (level.inst)
+		{
+			inst.loaded.levelName     = level.name;
+			inst.loaded.levelFormat   = level.inst->loaded.levelFormat;
+			inst.loaded.udmfNamespace = level.inst->loaded.udmfNamespace;
+			break;
+		}
+	}
+
+	inst.Main_LoadResources(inst.loaded);
+
+	for (BatchLevel &level : levels)
+	{
+		if (! level.inst)
+			continue;
+
+		level.inst->conf = inst.conf;
+		level.inst->wad  = inst.wad;
+
+		level.inst->loaded.gameName     = inst.loaded.gameName;
+		level.inst->loaded.portName     = inst.loaded.portName;
+		level.inst->loaded.resourceList = inst.loaded.resourceList;
+	}
+
+	RunChecks(levels);
+
+	if (want_csv)
+		WriteCsvReport(fp, levels);
+	else
+		WriteJsonReport(fp, levels);
+
+	fflush(fp);
+
+	bool major = false;
+
+	for (const BatchLevel &level : levels)
+	{
+		if (level.error.good())
+			major = true;
+
+		for (const CheckProblem &problem : level.problems)
+			if (problem.severity >= 2)
+				major = true;
+	}
+
+	return major ? 1 : 0;
+}
+
+//--- editor settings ---
+// vi:ts=4:sw=4:noexpandtab
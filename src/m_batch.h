@@ -0,0 +1,45 @@
+//------------------------------------------------------------------------
+//  BATCH MAP CHECKING
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#ifndef __EUREKA_M_BATCH_H__
+#define __EUREKA_M_BATCH_H__
+
+#include <stdio.h>
+
+#include <vector>
+
+class Instance;
+class SString;
+struct nodebuildstats_t;
+
+// checks the maps of the opened edit wad (the --check mode).
+int M_BatchCheck(Instance &inst, FILE *fp);
+
+// builds the nodes of the opened edit wad (in m_nodes.cc).
+int M_BatchBuildNodes(Instance &inst, int jobs);
+
+// writes the statistics of building the nodes of a wad as JSON.
+void M_WriteNodeStats(FILE *fp, const SString &wad_name,
+					  const std::vector<nodebuildstats_t> &levels);
+
+#endif  /* __EUREKA_M_BATCH_H__ */
+
+//--- editor settings ---
+// vi:ts=4:sw=4:noexpandtab
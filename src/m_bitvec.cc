@@ -29,11 +29,78 @@
 
 #include "m_bitvec.h"
 
+#include <algorithm>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+
+//
+// bit twiddling helpers, using the compiler intrinsics when possible.
+// CountTrailingZeros and HighestBit must not be given zero.
+//
+static inline int PopCount(uint64_t w)
+{
+#if defined(__GNUC__)
+	return __builtin_popcountll(w);
+#elif defined(_MSC_VER) && defined(_M_X64)
+	return (int)__popcnt64(w);
+#else
+	w = w - ((w >> 1) & 0x5555555555555555ULL);
+	w = (w & 0x3333333333333333ULL) + ((w >> 2) & 0x3333333333333333ULL);
+	w = (w + (w >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+	return (int)((w * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+static inline int CountTrailingZeros(uint64_t w)
+{
+#if defined(__GNUC__)
+	return __builtin_ctzll(w);
+#elif defined(_MSC_VER) && defined(_M_X64)
+	unsigned long index;
+	_BitScanForward64(&index, w);
+	return (int)index;
+#else
+	int n = 0;
+	while (! (w & 1))
+	{
+		w >>= 1;
+		n++;
+	}
+	return n;
+#endif
+}
+
+static inline int HighestBit(uint64_t w)
+{
+#if defined(__GNUC__)
+	return 63 - __builtin_clzll(w);
+#elif defined(_MSC_VER) && defined(_M_X64)
+	unsigned long index;
+	_BitScanReverse64(&index, w);
+	return (int)index;
+#else
+	int n = 0;
+	while (w >>= 1)
+		n++;
+	return n;
+#endif
+}
+
+// mask with bits <lo> to <hi> (inclusive) set, both in 0..63
+static inline uint64_t RangeMask(int lo, int hi)
+{
+	uint64_t mask = (hi == 63) ? ~0ULL : ((1ULL << (hi + 1)) - 1);
+
+	return mask & ~((1ULL << lo) - 1);
+}
+
 
 bitvec_c::bitvec_c(int n_elements) : num_elem(n_elements)
 {
-	int total = (num_elem / 8) + 1;
-	data.resize(total);
+	data.resize(getWordCount());
 	clear_all();
 }
 
@@ -41,25 +108,18 @@ void bitvec_c::resize(int n_elements)
 {
 	SYS_ASSERT(n_elements > 0);
 
-	int old_elem  = num_elem;
-	int new_total = (n_elements / 8) + 1;
+	num_elem = n_elements;
 
-	// don't bother re-allocating unless shrinking by a large amount
-	if (num_elem / 2 < n_elements && n_elements < num_elem)
-	{
-		num_elem = n_elements;
-		return;
-	}
+	// new words are zero, and the bits past the old top already were
+	data.resize(getWordCount());
 
-	num_elem = n_elements;
-	data.resize(new_total);
+	clearTail();
+}
 
-	// make sure the bits near the old top are clear
-	for (int i = 0 ; i < 8 ; i++)
-	{
-		if (old_elem + i < num_elem)
-			raw_clear(old_elem + i);
-	}
+
+void bitvec_c::clearTail()
+{
+	data.back() &= (1ULL << (num_elem & 63)) - 1;
 }
 
 
@@ -118,25 +178,136 @@ void bitvec_c::frob(int n, BitOp op)
 }
 
 
+void bitvec_c::frob_range(int n1, int n2, BitOp op)
+{
+	SYS_ASSERT(n1 >= 0);
+
+	if (op == BitOp::remove)
+		n2 = std::min(n2, num_elem - 1);
+	else if (n2 >= num_elem)
+		resize(std::max(n2 + 1, num_elem * 3 / 2 + 16));
+
+	if (n1 > n2)
+		return;
+
+	int w1 = n1 >> 6;
+	int w2 = n2 >> 6;
+
+	for (int w = w1 ; w <= w2 ; w++)
+	{
+		uint64_t mask = RangeMask(w == w1 ? (n1 & 63) : 0, w == w2 ? (n2 & 63) : 63);
+
+		switch (op)
+		{
+			case BitOp::add: data[w] |= mask; break;
+			case BitOp::remove: data[w] &= ~mask; break;
+			default: data[w] ^= mask; break;
+		}
+	}
+}
+
+
 void bitvec_c::set_all()
 {
-	// Note: this will set some extra bits (over num_elem).
-	//       the get() functions (etc) make sure to never use them.
+	for (uint64_t &w : data)
+		w = ~0ULL;
 
-	memset(data.data(), 0xff, data.size());
+	clearTail();
 }
 
 
 void bitvec_c::clear_all()
 {
-	memset(data.data(), 0, data.size());
+	std::fill(data.begin(), data.end(), 0);
 }
 
 
 void bitvec_c::toggle_all()
 {
-	for(byte &b : data)
-		b ^= 0xff;
+	for (uint64_t &w : data)
+		w = ~w;
+
+	clearTail();
+}
+
+
+int bitvec_c::count() const
+{
+	int total = 0;
+
+	for (uint64_t w : data)
+		total += PopCount(w);
+
+	return total;
+}
+
+
+int bitvec_c::find_next(int n) const
+{
+	SYS_ASSERT(n >= 0);
+
+	if (n >= num_elem)
+		return -1;
+
+	int w = n >> 6;
+
+	// ignore the bits below <n> in the first word
+	uint64_t bits = data[w] & ~((1ULL << (n & 63)) - 1);
+
+	for (;;)
+	{
+		if (bits)
+			return (w << 6) + CountTrailingZeros(bits);
+
+		if (++w >= (int)data.size())
+			return -1;
+
+		bits = data[w];
+	}
+}
+
+
+int bitvec_c::find_last() const
+{
+	for (int w = (int)data.size() - 1 ; w >= 0 ; w--)
+	{
+		if (data[w])
+			return (w << 6) + HighestBit(data[w]);
+	}
+
+	return -1;
+}
+
+
+void bitvec_c::merge(const bitvec_c& other)
+{
+	if (other.num_elem > num_elem)
+		resize(other.num_elem);
+
+	for (size_t w = 0 ; w < other.data.size() ; w++)
+		data[w] |= other.data[w];
+}
+
+
+void bitvec_c::unmerge(const bitvec_c& other)
+{
+	size_t total = std::min(data.size(), other.data.size());
+
+	for (size_t w = 0 ; w < total ; w++)
+		data[w] &= ~other.data[w];
+}
+
+
+void bitvec_c::intersect(const bitvec_c& other)
+{
+	size_t total = std::min(data.size(), other.data.size());
+
+	for (size_t w = 0 ; w < total ; w++)
+		data[w] &= other.data[w];
+
+	// the other vector is zero past its end
+	for (size_t w = total ; w < data.size() ; w++)
+		data[w] = 0;
 }
 
 
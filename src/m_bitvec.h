@@ -28,6 +28,7 @@
 #define __EUREKA_M_BITVEC_H__
 
 #include "sys_type.h"
+#include <stdint.h>
 #include <vector>
 
 enum class BitOp
@@ -45,9 +46,13 @@ class bitvec_c
 	// was infinitely sized and all bits past the end are zero.  When
 	// setting a bit past the end, it will automatically resize itself.
 	//
+	// The bits are stored in 64-bit words, and bits past the current
+	// size are always kept as zero, so whole words can be counted and
+	// combined without checking each bit.
+	//
 
 private:
-	std::vector<byte> data;
+	std::vector<uint64_t> data;
 	int num_elem;
 
 public:
@@ -65,41 +70,59 @@ public:
 	void toggle(int n);		// Toggle bit <n>
 
 	void frob(int n, BitOp op);
+	void frob_range(int n1, int n2, BitOp op);
 
 	void set_all();
 	void clear_all();
 	void toggle_all();
 
+	// number of bits which are 1
+	int count() const;
+
+	// returns the first one bit at or after <n>, or -1 if none
+	int find_next(int n) const;
+
+	// returns the highest one bit, or -1 if none
+	int find_last() const;
+
+	// whole-vector operations: these are OR, AND-NOT and AND
+	void merge(const bitvec_c& other);
+	void unmerge(const bitvec_c& other);
+	void intersect(const bitvec_c& other);
+
 private:
 	/* NOTE : these functions do no range checking! */
 
 	inline bool raw_get(int n) const
 	{
-		return !!(data[n >> 3] & (1 << (n & 7)));
+		return !!(data[n >> 6] & (1ULL << (n & 63)));
 	}
 
 	inline void raw_set(int n)
 	{
-		data[n >> 3] |= (1 << (n & 7));
+		data[n >> 6] |= (1ULL << (n & 63));
 	}
 
 	inline void raw_clear(int n)
 	{
-		data[n >> 3] &= ~(1 << (n & 7));
+		data[n >> 6] &= ~(1ULL << (n & 63));
 	}
 
 	inline void raw_toggle(int n)
 	{
-		data[n >> 3] ^= (1 << (n & 7));
+		data[n >> 6] ^= (1ULL << (n & 63));
 	}
 
-	inline int getByteCount() const
+	inline int getWordCount() const
 	{
-		return num_elem / 8 + 1;
+		return num_elem / 64 + 1;
 	}
 
 	// this preserves existing elements
 	void resize(int n_elements);
+
+	// clears the unused bits past num_elem in the last word
+	void clearTail();
 };
 
 
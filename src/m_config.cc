@@ -169,6 +169,24 @@ static const opt_desc_t options[] =
 		&global::Quiet
 	},
 
+	{	"check",
+		0,
+        OptType::string,
+		OptFlag_pass1,
+		"Check all maps in a wad, print a report and exit",
+		"<file>",
+		&global::check_wad
+	},
+
+	{	"build-nodes",
+		0,
+        OptType::string,
+		OptFlag_pass1,
+		"Build the nodes of all maps in a wad and exit",
+		"<file>",
+		&global::build_nodes_wad
+	},
+
 	//
 	// Normal options from here on....
 	//
@@ -209,6 +227,60 @@ static const opt_desc_t options[] =
 		&gInstance.loaded.portName	// TODO: same deal
 	},
 
+	{	"map",
+		0,
+        OptType::string,
+		OptFlag_warp,
+		"Select level to check or build (with --check or --build-nodes)",
+		"<map>",
+		&gInstance.loaded.levelName
+	},
+
+	{	"report",
+		0,
+        OptType::string,
+		0,
+		"Report format for --check: json or csv",
+		"<fmt>",
+		&global::check_format
+	},
+
+	{	"output",
+		"o",
+        OptType::string,
+		0,
+		"Output wad for --build-nodes (default is the input wad)",
+		"<file>",
+		&global::build_nodes_output
+	},
+
+	{	"fast",
+		0,
+        OptType::boolean,
+		0,
+		"Build the nodes quickly (with --build-nodes)",
+		NULL,
+		&global::build_nodes_fast
+	},
+
+	{	"factor",
+		0,
+        OptType::integer,
+		0,
+		"Seg split factor for building nodes (with --build-nodes)",
+		"<num>",
+		&global::build_nodes_factor
+	},
+
+	{	"jobs",
+		"j",
+        OptType::integer,
+		0,
+		"Number of threads for building nodes (with --build-nodes)",
+		"<num>",
+		&global::build_nodes_jobs
+	},
+
 	{	"warp",
 		"w",
         OptType::string,
@@ -310,6 +382,24 @@ static const opt_desc_t options[] =
 		&config::bsp_warnings
 	},
 
+	{	"bsp_los_reject",
+		0,
+        OptType::boolean,
+		OptFlag_preference,
+		"Node building: use line-of-sight for the REJECT lump",
+		NULL,
+		&config::bsp_los_reject
+	},
+
+	{	"bsp_reject_time",
+		0,
+        OptType::integer,
+		OptFlag_preference,
+		"Node building: time limit (in seconds) for the line-of-sight REJECT",
+		NULL,
+		&config::bsp_reject_time
+	},
+
 	{	"bsp_split_factor",
 		0,
         OptType::integer,
@@ -319,6 +409,24 @@ static const opt_desc_t options[] =
 		&config::bsp_split_factor
 	},
 
+	{	"bsp_goal",
+		0,
+        OptType::integer,
+		OptFlag_preference,
+		"Node building: try several strategies and keep the (1) fewest segs, (2) shallowest tree, (3) vanilla limits",
+		NULL,
+		&config::bsp_goal
+	},
+
+	{	"bsp_strategy_time",
+		0,
+        OptType::integer,
+		OptFlag_preference,
+		"Node building: time limit (in seconds) for each of the strategies",
+		NULL,
+		&config::bsp_strategy_time
+	},
+
 	{	"bsp_gl_nodes",
 		0,
         OptType::boolean,
@@ -355,6 +463,33 @@ static const opt_desc_t options[] =
 		&config::bsp_compressed
 	},
 
+	{	"bsp_compress_level",
+		0,
+        OptType::integer,
+		OptFlag_preference,
+		"Node building: zlib compression level, from 1 (fastest) to 9 (smallest)",
+		NULL,
+		&config::bsp_compress_level
+	},
+
+	{	"bsp_stats_json",
+		0,
+        OptType::boolean,
+		OptFlag_preference,
+		"Node building: write the statistics of building all nodes as JSON, next to the wad",
+		NULL,
+		&config::bsp_stats_json
+	},
+
+	{	"bsp_cache_size",
+		0,
+        OptType::integer,
+		OptFlag_preference,
+		"Node building: megabytes of built nodes to keep for unchanged maps (0 to disable)",
+		NULL,
+		&config::bsp_cache_size
+	},
+
 	{	"default_gamma",
 		0,
         OptType::integer,
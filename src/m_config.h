@@ -107,12 +107,19 @@ extern rgb_color_t transparent_col;
 extern bool bsp_on_save;
 extern bool bsp_fast;
 extern bool bsp_warnings;
+extern bool bsp_los_reject;
+extern int  bsp_reject_time;
 extern int  bsp_split_factor;
+extern int  bsp_goal;
+extern int  bsp_strategy_time;
 
 extern bool bsp_gl_nodes;
 extern bool bsp_force_v5;
 extern bool bsp_force_zdoom;
 extern bool bsp_compressed;
+extern int  bsp_compress_level;
+extern bool bsp_stats_json;
+extern int  bsp_cache_size;
 }
 
 enum class CommandLinePass
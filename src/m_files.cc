@@ -18,6 +18,7 @@
 //
 //------------------------------------------------------------------------
 
+#include "BackupStore.h"
 #include "Errors.h"
 #include "Instance.h"
 #include "main.h"
@@ -1046,56 +1047,13 @@ int config::backup_max_files = 30;
 int config::backup_max_space = 60;  // MB
 
 
-struct backup_scan_data_t
+SString M_BackupDir(const SString &wad_path)
 {
-	int low;
-	int high;
-};
-
-
-static void backup_scan_file(const SString &name, int flags, void *priv_dat)
-{
-	backup_scan_data_t * data = (backup_scan_data_t *)priv_dat;
-
-	if (flags & SCAN_F_Hidden)
-		return;
-
-	if (flags & SCAN_F_IsDir)
-		return;
-
-	if (! isdigit(name[0]))
-		return;
-
-	int num = atoi(name);
-
-	data->low  = std::min(data->low,  num);
-	data->high = std::max(data->high, num);
-}
-
-
-inline static SString Backup_Name(const SString &dir_name, int slot)
-{
-	return SString::printf("%s/%d.wad", dir_name.c_str(), slot);
-}
-
-
-static void Backup_Prune(const SString &dir_name, int b_low, int b_high, int wad_size)
-{
-	// Note: the logic here for checking space is very crude, it assumes
-	//       all existing backups have the same size as the currrent wad.
-
-	// do calculations in KB units
-	wad_size = wad_size / 1024 + 1;
-
-	int backup_num = 2 + config::backup_max_space * 1024 / wad_size;
+	// convert wad filename to a directory name in $cache_dir/backups
 
-	if (backup_num > config::backup_max_files)
-		backup_num = config::backup_max_files;
+	SString filename = global::cache_dir + "/backups/" + fl_filename_name(wad_path.c_str());
 
-	for ( ; b_low <= b_high - backup_num + 1 ; b_low++)
-	{
-		FileDelete(Backup_Name(dir_name, b_low));
-	}
+	return ReplaceExtension(filename, NULL);
 }
 
 
@@ -1105,52 +1063,25 @@ void M_BackupWad(Wad_file *wad)
 	if (config::backup_max_files <= 0 || config::backup_max_space <= 0)
 		return;
 
-	// convert wad filename to a directory name in $cache_dir/backups
-
-	SString filename = global::cache_dir + "/backups/" + fl_filename_name(wad->PathName().c_str());
-	SString dir_name = ReplaceExtension(filename, NULL);
+	SString dir_name = M_BackupDir(wad->PathName());
 
 	gLog.debugPrintf("dir_name for backup: '%s'\n", dir_name.c_str());
 
-	// create the directory if it doesn't already exist
-	// (this will fail if it DOES already exist, but that's OK)
-	FileMakeDir(dir_name);
-
-	// scan directory to determine lowest and highest numbers in use
-	backup_scan_data_t  scan_data;
+	// only the lumps which no earlier backup has are written
+	BackupStore store(dir_name);
 
-	scan_data.low  = (1 << 30);
-	scan_data.high = 0;
+	int number = store.store(*wad);
 
-	if (ScanDirectory(dir_name, backup_scan_file, &scan_data) < 0)
+	if (number < 0)
 	{
 		// Hmmm, show a dialog ??
-		gLog.printf("WARNING: backup failed (cannot scan dir)\n");
+		gLog.printf("WARNING: backup failed (cannot write to %s)\n", dir_name.c_str());
 		return;
 	}
 
-	int b_low  = scan_data.low;
-	int b_high = scan_data.high;
-
-	if (b_low < b_high)
-	{
-		int wad_size = wad->TotalSize();
-
-		Backup_Prune(dir_name, b_low, b_high, wad_size);
-	}
-
-	// actually back-up the file
-
-	SString dest_name = Backup_Name(dir_name, b_high + 1);
-
-	if (! wad->Backup(dest_name.c_str()))
-	{
-		// Hmmm, show a dialog ??
-		gLog.printf("WARNING: backup failed (cannot copy file)\n");
-		return;
-	}
+	store.prune(config::backup_max_files, (uint64_t)config::backup_max_space << 20);
 
-	gLog.printf("Backed up wad to: %s\n", dest_name.c_str());
+	gLog.printf("Backed up wad as version %d in: %s\n", number, dir_name.c_str());
 }
 
 //--- editor settings ---
@@ -43,6 +43,9 @@ SString M_CollectGamesForMenu(int *exist_val, const char *exist_name);
 void M_ValidateGivenFiles();
 int  M_FindGivenFile(const char *filename);
 
+// where the backups of the given wad are kept
+SString M_BackupDir(const SString &wad_path);
+
 void M_BackupWad(Wad_file *wad);
 
 
@@ -25,6 +25,7 @@
 //
 //------------------------------------------------------------------------
 
+#include "BackupStore.h"
 #include "Errors.h"
 #include "Instance.h"
 #include "main.h"
@@ -72,6 +73,8 @@ void MasterDir::RemoveEditWad()
 
 void Instance::ReplaceEditWad(const std::shared_ptr<Wad_file> &new_wad)
 {
+	FinishBackgroundNodes();
+
 	wad.master.RemoveEditWad();
 
 	wad.master.edit_wad = new_wad;
@@ -209,6 +212,9 @@ void Instance::CMD_NewProject()
 	if (! Main_ConfirmQuit("create a new project"))
 		return;
 
+	// the new file may replace the current one
+	FinishBackgroundNodes();
+
 
 	/* first, ask for the output file */
 
@@ -1000,6 +1006,8 @@ void Instance::LoadLevelNum(Wad_file *wad, int lev_num)
 	CalculateLevelBounds();
 	Subdiv_InvalidateAll();
 
+	vanilla_heat.reset();
+
 	MadeChanges = false;
 }
 
@@ -1505,6 +1513,10 @@ void Instance::EmptyLump(const char *name) const
 
 void Instance::SaveLevel(const SString &level)
 {
+	// nodes for an older version of this level are not needed anymore,
+	// but the nodes of another level must be saved before going on.
+	FinishBackgroundNodes(BuildingNodesFor(level));
+
 	// set global level name now (for debugging code)
 	loaded.levelName = level.asUpper();
 
@@ -1829,6 +1841,8 @@ void Instance::CMD_CopyMap()
 
 void Instance::CMD_RenameMap()
 {
+	FinishBackgroundNodes();
+
 	if (!wad.master.edit_wad)
 	{
 		DLG_Notify("Cannot rename a map unless editing a PWAD.");
@@ -1901,6 +1915,8 @@ void Instance::CMD_RenameMap()
 
 void Instance::CMD_DeleteMap()
 {
+	FinishBackgroundNodes();
+
 	if (!wad.master.edit_wad)
 	{
 		DLG_Notify("Cannot delete a map unless editing a PWAD.");
@@ -1960,5 +1976,121 @@ void Instance::CMD_DeleteMap()
 	}
 }
 
+
+void Instance::CMD_CompactWad()
+{
+	FinishBackgroundNodes();
+
+	if (!wad.master.edit_wad)
+	{
+		DLG_Notify("Cannot compact unless editing a PWAD.");
+		return;
+	}
+
+	if (wad.master.edit_wad->IsReadOnly())
+	{
+		DLG_Notify("Cannot compact the PWAD : file is read-only.");
+		return;
+	}
+
+	// saving in place leaves the space of the replaced lumps behind
+	int wasted = wad.master.edit_wad->wastedSpace();
+
+	gLog.printf("Compacting %s (%d bytes unused)...\n",
+				wad.master.edit_wad->PathName().c_str(), wasted);
+
+	try
+	{
+		wad.master.edit_wad->compactToDisk();
+	}
+	catch(const WadWriteException &e)
+	{
+		DLG_ShowError(false, "%s", e.what());
+		return;
+	}
+
+	Status_Set("Compacted, %d KB freed", (wasted + 1023) / 1024);
+}
+
+
+void Instance::CMD_RestoreBackup()
+{
+	if (!wad.master.edit_wad)
+	{
+		DLG_Notify("Cannot restore a backup unless editing a PWAD.");
+		return;
+	}
+
+	BackupStore store(M_BackupDir(wad.master.edit_wad->PathName()));
+
+	std::vector<BackupStore::Version> versions = store.versions();
+
+	if (versions.empty())
+	{
+		DLG_Notify("There are no backups of the current PWAD.");
+		return;
+	}
+
+	int number;
+	{
+		auto dialog = std::make_unique<UI_ChooseBackup>(versions);
+
+		number = dialog->Run();
+	}
+
+	// cancelled?
+	if (number < 0)
+		return;
+
+	Fl_Native_File_Chooser chooser;
+
+	chooser.title("Pick file to restore the backup into");
+	chooser.type(Fl_Native_File_Chooser::BROWSE_SAVE_FILE);
+	chooser.options(Fl_Native_File_Chooser::SAVEAS_CONFIRM);
+	chooser.filter("Wads\t*.wad");
+	chooser.directory(Main_FileOpFolder().c_str());
+
+	switch (chooser.show())
+	{
+		case -1:
+			DLG_Notify("Unable to restore the backup:\n\n%s", chooser.errmsg());
+			return;
+
+		case 1:
+			gLog.printf("Restore Backup: cancelled by user\n");
+			return;
+
+		default:
+			break;  // OK
+	}
+
+	// if extension is missing then add ".wad"
+	SString filename = chooser.filename();
+
+	const char *pos = fl_filename_ext(filename.c_str());
+	if(!*pos)
+		filename += ".wad";
+
+	// the backup goes into a new file, never over one we have open
+	if (wad.master.MasterDir_HaveFilename(filename))
+	{
+		DLG_Notify("Unable to restore the backup:\n\nFile already in use");
+		return;
+	}
+
+	ReportedResult result = store.restore(number, filename);
+
+	if (! result.success)
+	{
+		DLG_Notify("Unable to restore the backup:\n\n%s", result.message.c_str());
+		return;
+	}
+
+	gLog.printf("Restored backup %d of %s into: %s\n", number,
+				wad.master.edit_wad->PathName().c_str(), filename.c_str());
+
+	Status_Set("Restored backup %d", number);
+}
+
 //--- editor settings ---
 // vi:ts=4:sw=4:noexpandtab
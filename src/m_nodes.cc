@@ -21,6 +21,8 @@
 #include "Errors.h"
 #include "Instance.h"
 #include "main.h"
+#include "lib_file.h"
+#include "m_batch.h"
 #include "m_config.h"
 #include "m_loadsave.h"
 #include "e_main.h"
@@ -29,19 +31,38 @@
 #include "ui_window.h"
 
 #include "bsp.h"
+#include "NodeCache.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
 
 
 // config items
 bool config::bsp_on_save	= true;
 bool config::bsp_fast		= false;
 bool config::bsp_warnings	= false;
+bool config::bsp_los_reject	= false;
+int  config::bsp_reject_time	= 30;
 
 int  config::bsp_split_factor	= DEFAULT_FACTOR;
 
+int  config::bsp_goal			= GOAL_None;
+int  config::bsp_strategy_time	= 60;
+
 bool config::bsp_gl_nodes		= true;
 bool config::bsp_force_v5		= false;
 bool config::bsp_force_zdoom	= false;
 bool config::bsp_compressed		= false;
+int  config::bsp_compress_level	= 6;
+
+bool config::bsp_stats_json		= false;
+int  config::bsp_cache_size		= 64;
 
 
 #define NODE_PROGRESS_COLOR  fl_color_cube(2,6,2)
@@ -280,6 +301,8 @@ void Instance::GB_PrintMsg(EUR_FORMAT_STRING(const char *str), ...) const
 
 	if (nodeialog)
 		nodeialog->Print(message_buf.c_str());
+	else if (global::build_nodes_wad.good())
+		fputs(message_buf.c_str(), stdout);
 
 	gLog.printf("BSP: %s", message_buf.c_str());
 }
@@ -293,9 +316,16 @@ static void PrepareInfo(nodebuildinfo_t *info)
 	info->fast		= config::bsp_fast;
 	info->warnings	= config::bsp_warnings;
 
+	info->goal			= (build_goal_e)clamp(0, config::bsp_goal, (int)GOAL_Vanilla);
+	info->strategy_time	= clamp(1, config::bsp_strategy_time, 3600);
+
+	info->los_reject	= config::bsp_los_reject;
+	info->reject_time	= clamp(1, config::bsp_reject_time, 3600);
+
 	info->force_v5			= config::bsp_force_v5;
 	info->force_xnod		= config::bsp_force_zdoom;
 	info->force_compress	= config::bsp_compressed;
+	info->compress_level	= clamp(1, config::bsp_compress_level, 9);
 
 	info->total_failed_maps		= 0;
 	info->total_warnings		= 0;
@@ -305,7 +335,189 @@ static void PrepareInfo(nodebuildinfo_t *info)
 }
 
 
-build_result_e Instance::BuildAllNodes(nodebuildinfo_t *info)
+//
+// Shows where the time went when building a level, and the counts
+// which are the closest to the limits of the original engine.
+//
+static void PrintBuildStats(const Instance &inst, const nodebuildstats_t &stats)
+{
+	inst.GB_PrintMsg("Took %.2f sec: tree %.2f (partitions %.2f), segs %.2f,\n",
+					 stats.time_segs + stats.time_tree + stats.time_blockmap +
+					 stats.time_reject + stats.time_write,
+					 stats.time_tree, stats.time_picknode, stats.time_segs);
+
+	inst.GB_PrintMsg("    blockmap %.2f, reject %.2f, writing %.2f\n",
+					 stats.time_blockmap, stats.time_reject, stats.time_write);
+
+	inst.GB_PrintMsg("Evaluated %lld partitions, %d splits, depth %d, %zu KB\n",
+					 stats.partitions_evaluated, stats.seg_splits, stats.height,
+					 stats.peak_memory / 1024);
+
+	std::vector<nodebuildstats_t::limit_t> limits = stats.VanillaLimits();
+
+	std::stable_sort(limits.begin(), limits.end(),
+		[](const nodebuildstats_t::limit_t &A, const nodebuildstats_t::limit_t &B)
+		{
+			return (double)A.count / A.limit > (double)B.count / B.limit;
+		});
+
+	SString line = "Vanilla limits:";
+
+	for (size_t i = 0 ; i < 3 ; i++)
+	{
+		line += SString::printf("%s %s %d%%", i > 0 ? "," : "", limits[i].name,
+								(int)(100.0 * limits[i].count / limits[i].limit));
+	}
+
+	inst.GB_PrintMsg("%s\n", line.c_str());
+}
+
+
+//
+// Loads a level into a new Instance, so that its nodes can be built
+// on another thread.  This must be done on the main thread, since
+// loading interns strings into the shared string table.
+//
+static std::unique_ptr<Instance> LoadLevelCopy(const Instance &inst, Wad_file *wad, int lev_idx)
+{
+	auto copy = std::make_unique<Instance>();
+
+	copy->conf   = inst.conf;
+	copy->loaded = inst.loaded;
+	copy->wad.master = inst.wad.master;
+
+	copy->LoadLevelNum(wad, lev_idx);
+
+	return copy;
+}
+
+
+//
+// One of the strategies tried for a level, with its own options and
+// its own copy of the level.
+//
+struct NodeBuildAttempt
+{
+	const char *name;
+
+	std::unique_ptr<nodebuildinfo_t> info;
+	std::unique_ptr<Instance> inst;
+	std::unique_ptr<ajbsp::LevelBuilder> builder;
+};
+
+
+//
+// A single level being built by BuildAllNodes().  Each one is loaded
+// into its own Instance, which allows the BSP trees to be created by
+// several threads at once.
+//
+struct NodeBuildJob
+{
+	std::unique_ptr<Instance> inst;
+	std::unique_ptr<ajbsp::LevelBuilder> builder;
+
+	// with a build goal, the strategies to try.  The best one is moved
+	// into the fields above, along with its options.
+	std::vector<NodeBuildAttempt> attempts;
+
+	std::unique_ptr<nodebuildinfo_t> chosen_info;
+	const char *chosen_name = NULL;
+
+	// the name of the level in the NodeCache.  When the lumps are
+	// found there, nothing is built.
+	SString cache_key;
+	std::vector<NodeCache::Lump> cached_lumps;
+	bool from_cache = false;
+
+	build_result_e result = BUILD_OK;
+	std::exception_ptr error;
+
+	// protected by the mutex of NodeBuildQueue
+	bool done = false;
+
+	build_result_e BuildAttempts(const nodebuildinfo_t *info)
+	{
+		std::vector<ajbsp::LevelBuilder *> builders;
+
+		for (NodeBuildAttempt &attempt : attempts)
+			builders.push_back(attempt.builder.get());
+
+		int best = ajbsp::BuildStrategies(builders, info->goal, info->strategy_time, info->cancelled);
+
+		// when none of them finished, the first one is kept anyway,
+		// since the main thread flushes the messages of its builder.
+		NodeBuildAttempt &chosen = attempts[std::max(best, 0)];
+
+		inst    = std::move(chosen.inst);
+		builder = std::move(chosen.builder);
+
+		if (best < 0)
+			return BUILD_Cancelled;
+
+		chosen_info = std::move(chosen.info);
+		chosen_name = chosen.name;
+
+		// the others are freed on the main thread
+		return BUILD_OK;
+	}
+};
+
+
+struct NodeBuildQueue
+{
+	std::vector<NodeBuildJob> jobs;
+
+	const nodebuildinfo_t *info = NULL;
+
+	std::atomic<size_t> next_job{ 0 };
+
+	std::mutex mutex;
+	std::condition_variable cond;
+
+	void Worker()
+	{
+		for (;;)
+		{
+			size_t index = next_job++;
+			if (index >= jobs.size())
+				return;
+
+			NodeBuildJob &job = jobs[index];
+
+			if (job.from_cache)
+				continue;
+
+			try
+			{
+				if (job.attempts.empty())
+					job.result = job.builder->Build();
+				else
+					job.result = job.BuildAttempts(info);
+			}
+			catch (...)
+			{
+				job.error = std::current_exception();
+			}
+
+			std::lock_guard<std::mutex> lock(mutex);
+
+			job.done = true;
+			cond.notify_all();
+		}
+	}
+
+	// returns true once the job has finished
+	bool WaitFor(const NodeBuildJob &job, int millisec)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+
+		return cond.wait_for(lock, std::chrono::milliseconds(millisec),
+							 [&job]() { return job.done; });
+	}
+};
+
+
+build_result_e Instance::BuildAllNodes(nodebuildinfo_t *info, int only_level)
 {
 	gLog.printf("\n");
 
@@ -313,38 +525,217 @@ build_result_e Instance::BuildAllNodes(nodebuildinfo_t *info)
 
 	SYS_ASSERT(1 <= info->factor && info->factor <= 32);
 
-	int num_levels = wad.master.edit_wad->LevelCount();
+	Wad_file *edit_wad = wad.master.edit_wad.get();
+
+	int first_level = 0;
+	int num_levels  = edit_wad->LevelCount();
+
+	if (only_level >= 0)
+	{
+		first_level = only_level;
+		num_levels  = 1;
+	}
+
 	SYS_ASSERT(num_levels > 0);
 
 	GB_PrintMsg("\n");
 
-	nodeialog->SetProg(0);
+	if (nodeialog)
+		nodeialog->SetProg(0);
+
+	NodeBuildQueue queue;
 
-	build_result_e ret;
+	queue.jobs.resize(num_levels);
+	queue.info = info;
 
-	// loop over each level in the wad
+	std::vector<nodebuildstrategy_t> strategies = AJBSP_Strategies(info);
+
+	if (strategies.size() > 1)
+		GB_PrintMsg("Trying %d strategies for each map\n", (int)strategies.size());
+
+	std::unique_ptr<NodeCache> lump_cache;
+
+	if (config::bsp_cache_size > 0 && ! global::cache_dir.empty())
+	{
+		lump_cache = std::make_unique<NodeCache>(global::cache_dir + "/nodes",
+												 (uint64_t)config::bsp_cache_size << 20);
+	}
+
+	int num_cached = 0;
+
+	// load every level into its own Instance (one for each strategy).
+	// This is done here and not by the workers, since loading interns
+	// strings into the shared string table.
 	for (int n = 0 ; n < num_levels ; n++)
 	{
-		// load level
-		LoadLevelNum(wad.master.edit_wad.get(), n);
+		NodeBuildJob &job = queue.jobs[n];
 
-		ret = AJBSP_BuildLevel(info, n, *this);
+		job.inst = LoadLevelCopy(*this, edit_wad, first_level + n);
 
-		// don't fail on maps with overflows
-		// [ Note that 'total_failed_maps' keeps a tally of these ]
-		if (ret == BUILD_LumpOverflow)
-			ret = BUILD_OK;
+		job.builder = std::make_unique<ajbsp::LevelBuilder>(info, first_level + n, *job.inst);
+		job.builder->defer_messages = true;
 
-		if (ret != BUILD_OK)
-			break;
+		if (lump_cache)
+		{
+			job.cache_key  = job.builder->CacheKey();
+			job.from_cache = lump_cache->load(job.cache_key, job.cached_lumps);
+		}
+
+		if (job.from_cache)
+		{
+			// the workers skip it
+			job.done = true;
+			num_cached++;
+			continue;
+		}
+
+		if (strategies.size() == 1)
+			continue;
+
+		// the copy loaded above becomes the first attempt
+		job.builder.reset();
+
+		for (const nodebuildstrategy_t &strategy : strategies)
+		{
+			NodeBuildAttempt attempt;
+
+			attempt.name = strategy.name;
+			attempt.info = AJBSP_StrategyInfo(info, strategy);
+			attempt.inst = job.inst ? std::move(job.inst) : LoadLevelCopy(*this, edit_wad, first_level + n);
+
+			attempt.builder = std::make_unique<ajbsp::LevelBuilder>(attempt.info.get(), first_level + n,
+																	*attempt.inst);
+			attempt.builder->defer_messages = true;
+
+			job.attempts.push_back(std::move(attempt));
+		}
+	}
+
+	unsigned num_threads = (info->jobs > 0) ? (unsigned)info->jobs : std::thread::hardware_concurrency();
+	num_threads = clamp(1u, num_threads, (unsigned)std::max(1, num_levels - num_cached));
+
+	gLog.printf("Building nodes for %d maps using %u threads\n", num_levels - num_cached, num_threads);
+
+	std::vector<std::thread> threads;
+
+	for (unsigned i = 0 ; i < num_threads ; i++)
+		threads.emplace_back(&NodeBuildQueue::Worker, &queue);
+
+	// the levels are saved in order, as soon as each one is ready.
+	// that keeps the output identical to building them one by one.
+	build_result_e ret = BUILD_OK;
+
+	std::exception_ptr failure;
+
+	std::vector<nodebuildstats_t> all_stats;
+
+	try
+	{
+		for (int n = 0 ; n < num_levels ; n++)
+		{
+			NodeBuildJob &job = queue.jobs[n];
+
+			while (! queue.WaitFor(job, 50))
+			{
+				if (nodeialog)
+				{
+					Fl::check();
+
+					if (nodeialog->WantCancel())
+						info->cancelled = true;
+				}
+			}
+
+			if (job.error)
+				std::rethrow_exception(job.error);
+
+			job.builder->FlushMessages();
+			job.builder->defer_messages = false;
+
+			ret = job.result;
+
+			if (job.from_cache)
+			{
+				ret = job.builder->SaveCached(job.cached_lumps);
+			}
+			else if (ret == BUILD_OK)
+			{
+				ret = job.builder->Save();
+
+				// maps which overflowed are not kept, hence they are
+				// reported as failed every time.
+				if (ret == BUILD_OK && lump_cache)
+					lump_cache->store(job.cache_key, job.builder->CollectLumps());
+			}
+
+			if (job.chosen_info)
+			{
+				GB_PrintMsg("Kept the '%s' strategy\n", job.chosen_name);
+
+				info->total_failed_maps += job.chosen_info->total_failed_maps;
+				info->total_warnings    += job.chosen_info->total_warnings;
+			}
+
+			if (! job.from_cache && (ret == BUILD_OK || ret == BUILD_LumpOverflow))
+			{
+				PrintBuildStats(*this, job.builder->stats);
+
+				all_stats.push_back(job.builder->stats);
+			}
+
+			// free the memory of this level
+			job.builder.reset();
+			job.inst.reset();
+			job.attempts.clear();
+
+			// don't fail on maps with overflows
+			// [ Note that 'total_failed_maps' keeps a tally of these ]
+			if (ret == BUILD_LumpOverflow)
+				ret = BUILD_OK;
+
+			if (ret != BUILD_OK)
+				break;
+
+			if (nodeialog)
+			{
+				nodeialog->SetProg(100 * (n + 1) / num_levels);
+
+				if (nodeialog->WantCancel())
+					info->cancelled = true;
+			}
+		}
+	}
+	catch (...)
+	{
+		failure = std::current_exception();
+	}
+
+	// stop any levels still being built
+	if (ret != BUILD_OK || failure)
+		info->cancelled = true;
+
+	for (std::thread &thread : threads)
+		thread.join();
+
+	if (failure)
+		std::rethrow_exception(failure);
+
+	if (ret == BUILD_OK && config::bsp_stats_json)
+	{
+		SString filename = ReplaceExtension(edit_wad->PathName(), "nodestats.json");
 
-		nodeialog->SetProg(100 * (n + 1) / num_levels);
+		FILE *fp = fopen(filename.c_str(), "w");
 
-		Fl::check();
+		if (fp)
+		{
+			M_WriteNodeStats(fp, edit_wad->PathName(), all_stats);
+			fclose(fp);
 
-		if (nodeialog->WantCancel())
+			GB_PrintMsg("\nWrote the statistics to %s\n", GetBaseName(filename).c_str());
+		}
+		else
 		{
-			nb_info->cancelled = true;
+			GB_PrintMsg("\nCannot create %s\n", filename.c_str());
 		}
 	}
 
@@ -354,11 +745,11 @@ build_result_e Instance::BuildAllNodes(nodebuildinfo_t *info)
 
 		if (info->total_failed_maps == 0)
 			GB_PrintMsg("All maps built successfully, %d warnings\n",
-						info->total_warnings);
+						info->total_warnings.load());
 		else
 			GB_PrintMsg("%d failed maps, %d warnings\n",
-						info->total_failed_maps,
-						info->total_warnings);
+						info->total_failed_maps.load(),
+						info->total_warnings.load());
 	}
 	else if (ret == BUILD_Cancelled)
 	{
@@ -376,27 +767,200 @@ build_result_e Instance::BuildAllNodes(nodebuildinfo_t *info)
 }
 
 
+//
+// The nodes of a saved level, being built on another thread from a
+// copy of the level.  The editor stays usable in the meantime, and
+// the node lumps are added to the wad when they are ready.
+//
+struct BackgroundNodeJob : public BackgroundNodeBuild
+{
+	nodebuildinfo_t info;
+
+	NodeBuildJob job;
+
+	std::thread thread;
+	std::atomic<bool> done{ false };
+
+	~BackgroundNodeJob() override
+	{
+		info.cancelled = true;
+
+		if (thread.joinable())
+			thread.join();
+	}
+};
+
+
 void Instance::BuildNodesAfterSave(int lev_idx)
 {
 	nodeialog = NULL;
 
-	nb_info = new nodebuildinfo_t;
+	// without a window, there is nothing to keep interactive
+	if (! main_win)
+	{
+		nb_info = new nodebuildinfo_t;
 
-	PrepareInfo(nb_info);
+		PrepareInfo(nb_info);
 
-	build_result_e ret = AJBSP_BuildLevel(nb_info, lev_idx, *this);
+		build_result_e ret = AJBSP_BuildLevel(nb_info, lev_idx, *this, &node_cache);
 
-	// TODO : maybe print # of serious/minor warnings
+		// TODO : maybe print # of serious/minor warnings
 
-	if (ret != BUILD_OK)
-		gLog.printf("NODES FAILED TO FAILED.\n");
+		if (ret != BUILD_OK)
+			gLog.printf("NODES FAILED TO FAILED.\n");
+
+		delete nb_info;
+		return;
+	}
+
+	FinishBackgroundNodes(true);
+
+	auto bg = std::make_unique<BackgroundNodeJob>();
+
+	PrepareInfo(&bg->info);
+
+	// the copy is loaded from the saved lumps
+	NodeBuildJob &job = bg->job;
+
+	job.inst = LoadLevelCopy(*this, wad.master.edit_wad.get(), lev_idx);
+
+	job.builder = std::make_unique<ajbsp::LevelBuilder>(&bg->info, lev_idx, *job.inst);
+	job.builder->defer_messages = true;
+	job.builder->cache = &node_cache;
+
+	bg->level_name = loaded.levelName;
+
+	BackgroundNodeJob *raw = bg.get();
+
+	bg->thread = std::thread([raw]()
+	{
+		try
+		{
+			raw->job.result = raw->job.builder->Build();
+		}
+		catch (...)
+		{
+			raw->job.error = std::current_exception();
+		}
+
+		raw->done = true;
+	});
+
+	bg_nodes = std::move(bg);
+}
+
+
+bool Instance::BuildingNodesFor(const SString &level) const
+{
+	return bg_nodes && bg_nodes->level_name.noCaseEqual(level);
+}
+
+
+//
+// Called regularly by the main loop, to show the progress of the
+// background build and to save the nodes once it has finished.
+//
+void Instance::CheckBackgroundNodes()
+{
+	if (! bg_nodes)
+		return;
+
+	const auto *bg = static_cast<const BackgroundNodeJob *>(bg_nodes.get());
+
+	if (bg->done)
+	{
+		FinishBackgroundNodes();
+		return;
+	}
+
+	Status_Set("Building nodes for %s: %d%%", bg->level_name.c_str(),
+			   bg->job.builder->Progress());
+}
+
+
+//
+// Waits for the background build (if any) to finish and saves its
+// nodes.  With 'cancel', it is stopped instead and nothing is saved.
+// This must be done before anything else can write to the wad.
+//
+void Instance::FinishBackgroundNodes(bool cancel)
+{
+	if (! bg_nodes)
+		return;
+
+	std::unique_ptr<BackgroundNodeJob> bg(static_cast<BackgroundNodeJob *>(bg_nodes.release()));
+
+	if (cancel)
+		bg->info.cancelled = true;
+	else if (! bg->done)
+		gLog.printf("Waiting for the nodes of %s...\n", bg->level_name.c_str());
+
+	bg->thread.join();
+
+	NodeBuildJob &job = bg->job;
+
+	if (cancel)
+	{
+		gLog.printf("Cancelled building the nodes of %s\n", bg->level_name.c_str());
+		return;
+	}
+
+	job.builder->FlushMessages();
+	job.builder->defer_messages = false;
+
+	build_result_e ret = job.result;
 
-	delete nb_info;
+	SString problem;
+
+	if (job.error)
+	{
+		try
+		{
+			std::rethrow_exception(job.error);
+		}
+		catch (const std::exception &e)
+		{
+			problem = e.what();
+		}
+		catch (...)
+		{
+			problem = "unknown error";
+		}
+	}
+	else if (ret == BUILD_OK)
+	{
+		// the wad may have been closed, or the level renamed or deleted
+		if (job.inst->wad.master.edit_wad != wad.master.edit_wad || ! job.builder->RelocateLevel())
+			problem = "the level is gone";
+		else
+			ret = job.builder->Save();
+
+		if (ret == BUILD_OK || ret == BUILD_LumpOverflow)
+			PrintBuildStats(*this, job.builder->stats);
+	}
+
+	if (! problem.empty())
+	{
+		gLog.printf("Building nodes of %s FAILED: %s\n", bg->level_name.c_str(), problem.c_str());
+		Status_Set("Building nodes FAILED");
+	}
+	else if (ret == BUILD_OK || ret == BUILD_LumpOverflow)
+	{
+		Status_Set("Saved %s and its nodes", bg->level_name.c_str());
+	}
+	else
+	{
+		gLog.printf("Building nodes of %s FAILED: %s\n", bg->level_name.c_str(), build_ErrorString(ret));
+		Status_Set("Building nodes FAILED");
+	}
 }
 
 
 void Instance::CMD_BuildAllNodes()
 {
+	// all of the nodes will be built again
+	FinishBackgroundNodes(true);
+
 	if (!wad.master.edit_wad)
 	{
 		DLG_Notify("Cannot build nodes unless you are editing a PWAD.");
@@ -494,5 +1058,71 @@ void Instance::CMD_BuildAllNodes()
 }
 
 
+//
+// The --build-nodes mode: builds the nodes of every map (or the one
+// given with --map) of the already opened edit wad, printing what
+// happens to stdout.  Returns 0 when every map was built, 1 when some
+// of them overflowed, and 2 when building failed.
+//
+int M_BatchBuildNodes(Instance &inst, int jobs)
+{
+	Wad_file *wad = inst.wad.master.edit_wad.get();
+	SYS_ASSERT(wad);
+
+	if (wad->LevelCount() == 0)
+		ThrowException("No levels found in %s\n", wad->PathName().c_str());
+
+	int only_level = -1;
+
+	const SString &wanted = inst.loaded.levelName;
+
+	if (wanted.good())
+	{
+		only_level = isdigit(wanted[0]) ? wad->LevelFindByNumber(atoi(wanted)) :
+					 wad->LevelFind(wanted);
+		if (only_level < 0)
+			ThrowException("No such map: %s\n", wanted.c_str());
+	}
+
+	// the game config can depend on the map format, hence base it on
+	// the first map to build (like the editor does).
+	int first = std::max(0, only_level);
+
+	inst.loaded.levelName   = wad->GetLump(wad->LevelHeader(first))->Name().asUpper();
+	inst.loaded.levelFormat = wad->LevelFormat(first);
+
+	inst.Main_LoadResources(inst.loaded);
+
+	nodebuildinfo_t info;
+
+	PrepareInfo(&info);
+
+	// there is nobody to ask for these
+	info.warnings = true;
+	info.jobs = jobs;
+
+	// the command line options, which are not saved as preferences
+	if (global::build_nodes_fast)
+		info.fast = true;
+
+	if (global::build_nodes_factor > 0)
+		info.factor = clamp(1, global::build_nodes_factor, 31);
+
+	auto start = std::chrono::steady_clock::now();
+
+	build_result_e ret = inst.BuildAllNodes(&info, only_level);
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	printf("Took %.2f seconds\n", seconds);
+	fflush(stdout);
+
+	if (ret != BUILD_OK)
+		return 2;
+
+	return (info.total_failed_maps > 0) ? 1 : 0;
+}
+
+
 //--- editor settings ---
 // vi:ts=4:sw=4:noexpandtab
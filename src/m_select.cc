@@ -30,6 +30,8 @@
 
 #include "m_select.h"
 
+#include <vector>
+
 
 //#define NEED_SLOW_CLEAR
 
@@ -255,10 +257,95 @@ void selection_c::frob(int n, BitOp op)
 
 void selection_c::frob_range(int n1, int n2, BitOp op)
 {
-	for ( ; n1 <= n2 ; n1++)
+	if (n1 > n2)
+		return;
+
+	if (! extended && ! bv && op != BitOp::remove && count + (n2 - n1 + 1) > MAX_STORE_SEL)
+		ConvertToBitvec();
+
+	if (extended)
 	{
-		frob(n1, op);
+		FrobRangeExtended(n1, n2, op);
+		return;
 	}
+
+	if (! bv)
+	{
+		for ( ; n1 <= n2 ; n1++)
+		{
+			frob(n1, op);
+		}
+		return;
+	}
+
+	// for a bit vector, operate on whole words at a time
+	bool was_empty = empty();
+
+	bv->frob_range(n1, n2, op);
+
+	count  = bv->count();
+	maxobj = bv->find_last();
+
+	if (was_empty && op != BitOp::remove)
+		first_obj = n1;
+	else if (first_obj >= 0 && ! bv->get(first_obj))
+		first_obj = -1;
+}
+
+
+void selection_c::FrobRangeExtended(int n1, int n2, BitOp op)
+{
+	if (op == BitOp::remove)
+		n2 = std::min(n2, ext_size - 1);
+	else
+	{
+		while (n2 >= ext_size)
+			ResizeExtended(ext_size * 2);
+	}
+
+	bool was_empty = empty();
+
+	int first_set = -1;
+	int last_set  = -1;
+
+	for (int n = n1 ; n <= n2 ; n++)
+	{
+		byte old_value = extended[n];
+		byte new_value;
+
+		switch (op)
+		{
+			case BitOp::add: new_value = 1; break;
+			case BitOp::remove: new_value = 0; break;
+			default: new_value = old_value ? 0 : 1; break;
+		}
+
+		extended[n] = new_value;
+
+		if (new_value)
+		{
+			if (! old_value)
+				count++;
+
+			if (first_set < 0)
+				first_set = n;
+			last_set = n;
+		}
+		else if (old_value)
+		{
+			count--;
+		}
+	}
+
+	if (was_empty && first_set >= 0)
+		first_obj = first_set;
+	else if (first_obj >= 0 && extended[first_obj] == 0)
+		first_obj = -1;
+
+	if (last_set > maxobj)
+		maxobj = last_set;
+	else if (maxobj >= 0 && extended[maxobj] == 0)
+		RecomputeMaxObj();
 }
 
 
@@ -273,42 +360,63 @@ void selection_c::merge(const selection_c& other)
 			set_ext(i, get_ext(i) | value);
 		}
 	}
-	else if (other.bv || other.extended)
+	else if (other.bv && ! extended)
 	{
-		for (int i = 0 ; i <= other.maxobj ; i++)
-			if (other.get(i) && !get(i))
-				set(i);
+		bool was_empty = empty();
+
+		if (! bv)
+			ConvertToBitvec();
+
+		bv->merge(*other.bv);
+
+		count  = bv->count();
+		maxobj = std::max(maxobj, other.maxobj);
+
+		if (was_empty)
+			first_obj = bv->find_next(0);
 	}
 	else
 	{
-		for (int i = 0 ; i < other.count ; i++)
-			if (!get(other.objs[i]))
-				set(other.objs[i]);
+		for (sel_iter_c it(other) ; !it.done() ; it.next())
+			if (! get(*it))
+				set(*it);
 	}
 }
 
 
 void selection_c::unmerge(const selection_c& other)
 {
-	if (other.bv || other.extended)
+	if (bv && other.bv)
 	{
-		for (int i = 0 ; i <= other.maxobj ; i++)
-			if (other.get(i))
-				clear(i);
+		bv->unmerge(*other.bv);
+		RecountBitvec();
 	}
 	else
 	{
-		for (int i = 0 ; i < other.count ; i++)
-			clear(other.objs[i]);
+		for (sel_iter_c it(other) ; !it.done() ; it.next())
+			clear(*it);
 	}
 }
 
 
 void selection_c::intersect(const selection_c& other)
 {
-	for (int i = 0 ; i <= maxobj ; i++)
-		if (get(i) && !other.get(i))
-			clear(i);
+	if (bv && other.bv)
+	{
+		bv->intersect(*other.bv);
+		RecountBitvec();
+		return;
+	}
+
+	// cannot clear objects while iterating, so collect them first
+	std::vector<int> unwanted;
+
+	for (sel_iter_c it(this) ; !it.done() ; it.next())
+		if (! other.get(*it))
+			unwanted.push_back(*it);
+
+	for (int n : unwanted)
+		clear(n);
 }
 
 
@@ -351,6 +459,18 @@ void selection_c::ConvertToBitvec()
 }
 
 
+void selection_c::RecountBitvec()
+{
+	SYS_ASSERT(bv);
+
+	count  = bv->count();
+	maxobj = bv->find_last();
+
+	if (first_obj >= 0 && ! bv->get(first_obj))
+		first_obj = -1;
+}
+
+
 void selection_c::RecomputeMaxObj()
 {
 	maxobj = -1;
@@ -369,15 +489,7 @@ void selection_c::RecomputeMaxObj()
 	}
 	else if (bv)
 	{
-		// search backwards so we can early out
-		for (int i = bv->size()-1 ; i >= 0 ; i--)
-		{
-			if (bv->get(i))
-			{
-				maxobj = i;
-				break;
-			}
-		}
+		maxobj = bv->find_last();
 	}
 	else
 	{
@@ -510,9 +622,10 @@ void sel_iter_c::next()
 	}
 	else if (sel->bv)
 	{
-		// this could be optimised....
-		while (pos < sel->bv->size() && !sel->bv->get(pos))
-			pos++;
+		pos = sel->bv->find_next(pos);
+
+		if (pos < 0)
+			pos = sel->bv->size();
 	}
 }
 
@@ -121,6 +121,8 @@ public:
 private:
 	void ConvertToBitvec();
 	void RecomputeMaxObj();
+	void RecountBitvec();
+	void FrobRangeExtended(int n1, int n2, BitOp op);
 	void ResizeExtended(int new_size);
 };
 
@@ -347,6 +347,9 @@ void Instance::CMD_TestMap()
 			return;
 	}
 
+	// the port needs the nodes
+	FinishBackgroundNodes();
+
 
 	// check if we know the executable path, if not then ask
 	port_path_info_t *info = M_QueryPortPath(QueryName(loaded.portName,
@@ -26,6 +26,7 @@
 
 #include "Errors.h"
 #include "Instance.h"
+#include "TaskPool.h"
 #include "main.h"
 
 #include <time.h>
@@ -33,6 +34,8 @@
 #include <stdexcept>
 
 #include "im_color.h"
+#include "lib_file.h"
+#include "m_batch.h"
 #include "m_config.h"
 #include "m_game.h"
 #include "m_files.h"
@@ -123,6 +126,15 @@ static ProgressStatus init_progress;
 int global::show_help     = 0;
 int global::show_version  = 0;
 
+SString global::check_wad;
+SString global::check_format = "json";
+
+SString global::build_nodes_wad;
+SString global::build_nodes_output;
+int     global::build_nodes_jobs = 0;
+bool    global::build_nodes_fast = false;
+int     global::build_nodes_factor = 0;
+
 
 static void RemoveSingleNewlines(SString &buffer)
 {
@@ -181,7 +193,7 @@ void FatalError(EUR_FORMAT_STRING(const char *fmt), ...)
 		init_progress = ProgressStatus::early;
 	}
 #ifdef WIN32
-	else
+	else if (global::check_wad.empty() && global::build_nodes_wad.empty())
 	{
 		MessageBox(NULL, buffer.c_str(), "Eureka : Error",
 		           MB_ICONEXCLAMATION | MB_OK |
@@ -423,6 +435,10 @@ static bool DetermineIWAD(Instance &inst)
 	{
 		inst.loaded.iwadName = inst.M_PickDefaultIWAD();
 
+		if (inst.loaded.iwadName.empty() &&
+			(!global::check_wad.empty() || !global::build_nodes_wad.empty()))
+			ThrowException("Cannot find an IWAD, use --iwad to specify one\n");
+
 		if (inst.loaded.iwadName.empty())
 		{
 			// show the "Missing IWAD!" dialog.
@@ -817,6 +833,8 @@ void Main_Loop()
 		// TODO: handle these in a better way
 
 		// TODO: HANDLE ALL INSTANCES
+		gInstance.CheckBackgroundNodes();
+
 		gInstance.main_win->UpdateTitle(gInstance.MadeChanges ? '*' : 0);
 
 		gInstance.main_win->scroll->UpdateBounds();
@@ -1067,6 +1085,117 @@ static void ShowTime()
 }
 
 
+//
+// the --check mode: validate every map of a wad without any GUI
+// and print a report.  Returns the process exit code.
+//
+static int Main_BatchCheck(Instance &inst)
+{
+	M_LoadRecent();
+	M_LookForIWADs();
+
+	if (! Wad_file::Validate(global::check_wad))
+		ThrowException("Invalid or missing wad: %s\n", global::check_wad.c_str());
+
+	inst.wad.master.Pwad_name = global::check_wad;
+	inst.wad.master.edit_wad = Wad_file::Open(global::check_wad, WadOpenMode::read);
+	if (!inst.wad.master.edit_wad)
+		ThrowException("Cannot load pwad: %s\n", global::check_wad.c_str());
+
+	inst.wad.master.MasterDir_Add(inst.wad.master.edit_wad);
+
+	// dialogs are disabled in batch mode, so this cannot be cancelled
+	inst.M_ParseEurekaLump(inst.wad.master.edit_wad.get(), true /* keep_cmd_line_args */);
+
+	if (! DetermineIWAD(inst))
+		return 2;
+
+	DeterminePort(inst);
+
+	return M_BatchCheck(inst, stdout);
+}
+
+
+//
+// the --build-nodes mode: build the nodes of a wad without any GUI,
+// either in place or into a copy given by --output.  Returns the
+// process exit code.
+//
+static int Main_BatchBuildNodes(Instance &inst)
+{
+	M_LoadRecent();
+	M_LookForIWADs();
+
+	const SString &in_name = global::build_nodes_wad;
+
+	if (! Wad_file::Validate(in_name))
+		ThrowException("Invalid or missing wad: %s\n", in_name.c_str());
+
+	// the IWAD is found before anything is written, since the EUREKA
+	// lump of the input wad can name it.
+	{
+		std::shared_ptr<Wad_file> in_wad = Wad_file::Open(in_name, WadOpenMode::read);
+		if (!in_wad)
+			ThrowException("Cannot load pwad: %s\n", in_name.c_str());
+
+		inst.M_ParseEurekaLump(in_wad.get(), true /* keep_cmd_line_args */);
+	}
+
+	if (! DetermineIWAD(inst))
+		return 2;
+
+	DeterminePort(inst);
+
+	SString out_name = global::build_nodes_output.good() ? global::build_nodes_output : in_name;
+
+	bool is_copy = (GetAbsolutePath(out_name) != GetAbsolutePath(in_name));
+
+	if (is_copy && ! FileCopy(in_name, out_name))
+		ThrowException("Cannot create %s: %s\n", out_name.c_str(),
+					   GetErrorMessage(errno).c_str());
+
+	// a copy whose nodes could not be built (e.g. with a bad --map)
+	// is not left behind.
+	auto discardCopy = [&inst, is_copy, &out_name]()
+	{
+		if (! is_copy)
+			return;
+
+		inst.wad.master.MasterDir_CloseAll();
+		inst.wad.master.edit_wad.reset();
+
+		FileDelete(out_name);
+	};
+
+	int result;
+
+	try
+	{
+		inst.wad.master.Pwad_name = out_name;
+		inst.wad.master.edit_wad = Wad_file::Open(out_name, WadOpenMode::append);
+		if (!inst.wad.master.edit_wad || inst.wad.master.edit_wad->IsReadOnly())
+			ThrowException("Cannot write to pwad: %s\n", out_name.c_str());
+
+		inst.wad.master.MasterDir_Add(inst.wad.master.edit_wad);
+
+		if (global::build_nodes_jobs > 0)
+			TaskPool::setGlobalThreads(global::build_nodes_jobs);
+
+		result = M_BatchBuildNodes(inst, global::build_nodes_jobs);
+	}
+	catch (const std::exception &)
+	{
+		discardCopy();
+		throw;
+	}
+
+	if (result == 2)
+		discardCopy();
+
+	return result;
+}
+
+
 //
 //  the program starts here
 //
@@ -1092,6 +1221,10 @@ int main(int argc, char *argv[])
 			return 0;
 		}
 
+		// the report goes to stdout, keep it clean
+		if (!global::check_wad.empty() || !global::build_nodes_wad.empty())
+			global::Quiet = true;
+
 		init_progress = ProgressStatus::early;
 
 
@@ -1122,6 +1255,26 @@ int main(int argc, char *argv[])
 		// and command line arguments will override both
 		M_ParseCommandLine(argc - 1, argv + 1, CommandLinePass::normal);
 
+		if (!global::check_wad.empty())
+		{
+			int result = Main_BatchCheck(gInstance);
+
+			gInstance.wad.master.MasterDir_CloseAll();
+			gLog.close();
+
+			return result;
+		}
+
+		if (!global::build_nodes_wad.empty())
+		{
+			int result = Main_BatchBuildNodes(gInstance);
+
+			gInstance.wad.master.MasterDir_CloseAll();
+			gLog.close();
+
+			return result;
+		}
+
 		// TODO: create a new instance
 		gInstance.Editor_Init();
 
@@ -1222,6 +1375,9 @@ int main(int argc, char *argv[])
 	quit:
 		/* that's all folks! */
 
+		// the nodes of the last save are still wanted
+		gInstance.FinishBackgroundNodes();
+
 		gLog.printf("Quit\n");
 
 		init_progress = ProgressStatus::nothing;
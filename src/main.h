@@ -146,6 +146,15 @@ namespace global
 {
 	extern int   show_help;		// Print usage message and exit.
 	extern int   show_version;	// Print version info and exit.
+
+	extern SString check_wad;		// Check all maps in this wad and exit (no GUI).
+	extern SString check_format;	// Report format for the above: "json" or "csv".
+
+	extern SString build_nodes_wad;		// Build the nodes of this wad and exit (no GUI).
+	extern SString build_nodes_output;	// Where to save the above, empty for in place.
+	extern int     build_nodes_jobs;	// Threads to use for the above, 0 for all cores.
+	extern bool    build_nodes_fast;	// Build the above quickly, whatever the preferences say.
+	extern int     build_nodes_factor;	// Seg split factor for the above, 0 for the preference.
 }
 
 
@@ -0,0 +1,1301 @@
+//------------------------------------------------------------------------
+//  VANILLA RENDERER LIMITS
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+//
+//  This walks the BSP tree the way R_RenderBSPNode() in the DOOM
+//  renderer does, repeating the bits of R_AddLine, R_StoreWallRange
+//  and R_RenderSegLoop which decide how many visplanes, drawsegs and
+//  openings a view needs.  Nothing is drawn, and floating point is
+//  used in place of fixed point, hence the counts can be off by one
+//  here and there, but the overflows show up in the same places.
+//
+//------------------------------------------------------------------------
+
+#include "Instance.h"
+
+#include "bsp.h"
+#include "LineDef.h"
+#include "m_game.h"
+#include "r_vanilla.h"
+#include "Sector.h"
+#include "SideDef.h"
+#include "TaskPool.h"
+#include "w_rawdef.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+
+double vanilla_counts_t::Load() const
+{
+	double load = visplanes / (double)VANILLA_MAXVISPLANES;
+
+	load = std::max(load, drawsegs / (double)VANILLA_MAXDRAWSEGS);
+	load = std::max(load, openings / (double)VANILLA_MAXOPENINGS);
+
+	return load;
+}
+
+
+void vanilla_counts_t::Merge(const vanilla_counts_t &other)
+{
+	visplanes = std::max(visplanes, other.visplanes);
+	drawsegs  = std::max(drawsegs,  other.drawsegs);
+	openings  = std::max(openings,  other.openings);
+}
+
+
+namespace
+{
+
+// binary angles, as used by the DOOM renderer
+typedef uint32_t bam_t;
+
+const bam_t BAM_45  = 0x20000000;
+const bam_t BAM_90  = 0x40000000;
+const bam_t BAM_180 = 0x80000000;
+const bam_t BAM_270 = 0xc0000000;
+
+// the full screen view (with the status bar) at 320x200
+const int    SCREEN_W   = 320;
+const int    VIEW_H     = 168;
+const double CENTER_X   = 160.0;
+const double CENTER_Y   = 84.0;
+const double PROJECTION = 160.0;
+
+// the eye is this far above the floor, and the player needs this
+// much room to stand somewhere.
+const int VIEW_HEIGHT   = 41;
+const int PLAYER_HEIGHT = 56;
+
+// how many directions are looked in from each point
+const int NUM_ANGLES = 8;
+
+// the grid is made coarser until it has no more cells than this
+const int MAX_CELLS = 16384;
+
+// the flat number of the sky
+const int SKY_PIC = -1;
+
+
+const int FINEANGLES  = 8192;
+const int FINESHIFT  = 19;
+const int SLOPERANGE = 2048;
+
+
+bam_t ToBam(double radians)
+{
+	return (bam_t)(int64_t)llround(radians * (2147483648.0 / M_PI));
+}
+
+
+//
+// The lookup tables of the renderer, which decide which columns an
+// angle ends up in, made the same way as R_InitTextureMapping().
+//
+struct vtables_t
+{
+	bam_t  tantoangle[SLOPERANGE + 1];
+	double finesine[FINEANGLES];
+
+	int   viewangletox[FINEANGLES / 2];
+	bam_t xtoviewangle[SCREEN_W + 1];
+
+	bam_t clipangle;
+
+	vtables_t()
+	{
+		for (int i = 0 ; i <= SLOPERANGE ; i++)
+			tantoangle[i] = ToBam(atan(i / (double)SLOPERANGE));
+
+		for (int i = 0 ; i < FINEANGLES ; i++)
+			finesine[i] = sin((i + 0.5) * 2 * M_PI / FINEANGLES);
+
+		double focal = CENTER_X / FineTangent(FINEANGLES / 4 + FINEANGLES / 8);
+
+		for (int i = 0 ; i < FINEANGLES / 2 ; i++)
+		{
+			double t = FineTangent(i);
+
+			if (t > 2)
+				viewangletox[i] = -1;
+			else if (t < -2)
+				viewangletox[i] = SCREEN_W + 1;
+			else
+				viewangletox[i] = clamp(-1, (int)ceil(CENTER_X - t * focal), SCREEN_W + 1);
+		}
+
+		// the angle of each column is the first angle which maps to it
+		for (int x = 0 ; x <= SCREEN_W ; x++)
+		{
+			int i = 0;
+
+			while (viewangletox[i] > x)
+				i++;
+
+			xtoviewangle[x] = ((bam_t)i << FINESHIFT) - BAM_90;
+		}
+
+		for (int i = 0 ; i < FINEANGLES / 2 ; i++)
+			viewangletox[i] = clamp(0, viewangletox[i], SCREEN_W);
+
+		clipangle = xtoviewangle[0];
+	}
+
+	static double FineTangent(int i)
+	{
+		return tan((i - FINEANGLES / 4 + 0.5) * 2 * M_PI / FINEANGLES);
+	}
+
+	double Sine(bam_t angle) const
+	{
+		return finesine[angle >> FINESHIFT];
+	}
+
+	static int SlopeDiv(double num, double den)
+	{
+		if (den < 1.0 / 128.0)
+			return SLOPERANGE;
+
+		return std::min((int)(num * SLOPERANGE / den), SLOPERANGE);
+	}
+
+	// same as R_PointToAngle2(), one octant at a time
+	bam_t PointToAngle(double x, double y) const
+	{
+		if (x == 0 && y == 0)
+			return 0;
+
+		if (x >= 0)
+		{
+			if (y >= 0)
+			{
+				if (x > y)
+					return tantoangle[SlopeDiv(y, x)];
+
+				return BAM_90 - 1 - tantoangle[SlopeDiv(x, y)];
+			}
+
+			y = -y;
+
+			if (x > y)
+				return (bam_t)0 - tantoangle[SlopeDiv(y, x)];
+
+			return BAM_270 + tantoangle[SlopeDiv(x, y)];
+		}
+
+		x = -x;
+
+		if (y >= 0)
+		{
+			if (x > y)
+				return BAM_180 - 1 - tantoangle[SlopeDiv(y, x)];
+
+			return BAM_90 + tantoangle[SlopeDiv(x, y)];
+		}
+
+		y = -y;
+
+		if (x > y)
+			return BAM_180 + tantoangle[SlopeDiv(y, x)];
+
+		return BAM_270 - 1 - tantoangle[SlopeDiv(x, y)];
+	}
+};
+
+
+const vtables_t &Tables()
+{
+	static const vtables_t tables;
+
+	return tables;
+}
+
+
+struct vsector_t
+{
+	int floorh, ceilh;
+	int floorpic, ceilpic;
+	int light;
+};
+
+struct vseg_t
+{
+	double x1, y1;
+	double x2, y2;
+
+	bam_t angle;
+
+	// minisegs are only used to find the subsector a point is in
+	bool real;
+
+	int front;
+	int back;	// -1 unless the linedef is two-sided
+
+	// which textures the front sidedef has
+	bool upper, mid, lower;
+};
+
+struct vsubsec_t
+{
+	int first_seg;
+	int seg_count;
+
+	int sector;
+};
+
+// the children are node numbers, or ~N for subsector N
+struct vnode_t
+{
+	double x, y;
+	double dx, dy;
+
+	// top, bottom, left, right -- the order DOOM uses
+	double bbox[2][4];
+
+	int child[2];
+};
+
+
+//
+// The level, in the shape the renderer sees it.
+//
+struct vlevel_t
+{
+	std::vector<vsector_t> sectors;
+	std::vector<vseg_t>    segs;
+	std::vector<vsubsec_t> subsecs;
+	std::vector<vnode_t>   nodes;
+
+	int root = -1;
+
+	void AddSeg(const Instance &inst, const ajbsp::seg_t *seg)
+	{
+		vseg_t V;
+
+		V.x1 = seg->start->x;
+		V.y1 = seg->start->y;
+		V.x2 = seg->end->x;
+		V.y2 = seg->end->y;
+
+		V.angle = ToBam(atan2(V.y2 - V.y1, V.x2 - V.x1));
+
+		V.real  = false;
+		V.front = V.back = -1;
+		V.upper = V.mid = V.lower = false;
+
+		if (seg->linedef >= 0 && ! seg->is_degenerate)
+		{
+			const LineDef *L = inst.level.linedefs[seg->linedef];
+
+			int front_sd = seg->side ? L->left  : L->right;
+			int back_sd  = seg->side ? L->right : L->left;
+
+			if (front_sd >= 0)
+			{
+				const SideDef *SD = inst.level.sidedefs[front_sd];
+
+				V.real  = true;
+				V.front = SD->sector;
+
+				V.upper = ! is_null_tex(SD->UpperTex());
+				V.mid   = ! is_null_tex(SD->MidTex());
+				V.lower = ! is_null_tex(SD->LowerTex());
+
+				if ((L->flags & MLF_TwoSided) && back_sd >= 0)
+					V.back = inst.level.sidedefs[back_sd]->sector;
+			}
+		}
+
+		segs.push_back(V);
+	}
+
+	int AddSubsec(const Instance &inst, const ajbsp::subsec_t *sub)
+	{
+		vsubsec_t S;
+
+		S.first_seg = (int)segs.size();
+		S.sector    = -1;
+
+		for (const ajbsp::seg_t *seg = sub->seg_list ; seg ; seg = seg->next)
+		{
+			AddSeg(inst, seg);
+
+			// like the engine, the first seg decides the sector
+			if (S.sector < 0 && segs.back().real)
+				S.sector = segs.back().front;
+		}
+
+		S.seg_count = (int)segs.size() - S.first_seg;
+
+		subsecs.push_back(S);
+
+		return ~((int)subsecs.size() - 1);
+	}
+
+	int AddChild(const Instance &inst, const ajbsp::child_t &child)
+	{
+		if (child.node)
+			return AddNode(inst, child.node);
+
+		return AddSubsec(inst, child.subsec);
+	}
+
+	int AddNode(const Instance &inst, const ajbsp::node_t *node)
+	{
+		int index = (int)nodes.size();
+
+		nodes.emplace_back();
+
+		vnode_t N;
+
+		N.x  = node->x;
+		N.y  = node->y;
+		N.dx = node->dx;
+		N.dy = node->dy;
+
+		const ajbsp::bbox_t *boxes[2] = { &node->r.bounds, &node->l.bounds };
+
+		for (int c = 0 ; c < 2 ; c++)
+		{
+			N.bbox[c][0] = boxes[c]->maxy;
+			N.bbox[c][1] = boxes[c]->miny;
+			N.bbox[c][2] = boxes[c]->minx;
+			N.bbox[c][3] = boxes[c]->maxx;
+		}
+
+		N.child[0] = AddChild(inst, node->r);
+		N.child[1] = AddChild(inst, node->l);
+
+		nodes[index] = N;
+
+		return index;
+	}
+
+	void AddSectors(const Instance &inst)
+	{
+		for (const Sector *S : inst.level.sectors)
+		{
+			vsector_t V;
+
+			V.floorh   = S->floorh;
+			V.ceilh    = S->ceilh;
+			V.floorpic = inst.is_sky(S->FloorTex()) ? SKY_PIC : S->floor_tex.get();
+			V.ceilpic  = inst.is_sky(S->CeilTex())  ? SKY_PIC : S->ceil_tex.get();
+			V.light    = S->light;
+
+			sectors.push_back(V);
+		}
+	}
+
+	// same as R_PointOnSide(), 0 is the front (right) side
+	static int PointOnSide(double x, double y, const vnode_t &node)
+	{
+		double left  = node.dy * (x - node.x);
+		double right = (y - node.y) * node.dx;
+
+		return (right < left) ? 0 : 1;
+	}
+
+	// returns the sector which a player standing at this spot would be
+	// in, or -1 when it is outside of the level.
+	int PointSector(double x, double y) const
+	{
+		int num = root;
+
+		while (num >= 0)
+			num = nodes[num].child[PointOnSide(x, y, nodes[num])];
+
+		const vsubsec_t &sub = subsecs[~num];
+
+		// the segs go clockwise, so the point must be on the right
+		// of all of them to be inside.
+		for (int i = 0 ; i < sub.seg_count ; i++)
+		{
+			const vseg_t &seg = segs[sub.first_seg + i];
+
+			double cross = (seg.x2 - seg.x1) * (y - seg.y1) - (seg.y2 - seg.y1) * (x - seg.x1);
+
+			if (cross > 0.001)
+				return -1;
+		}
+
+		return sub.sector;
+	}
+};
+
+
+struct visplane_t
+{
+	int height;
+	int pic;
+	int light;
+
+	int minx, maxx;
+
+	// 0xff where nothing has been marked yet
+	uint8_t top[SCREEN_W];
+};
+
+struct cliprange_t
+{
+	int first;
+	int last;
+};
+
+
+//
+// The state of the renderer for one view.  Every thread has its own.
+//
+class VanillaView
+{
+public:
+	explicit VanillaView(const vlevel_t &_lev) : lev(_lev), T(Tables())
+	{
+	}
+
+	vanilla_counts_t Render(double x, double y, int z, bam_t angle)
+	{
+		view_x = x;
+		view_y = y;
+		view_z = z;
+		view_angle = angle;
+
+		// R_ClearClipSegs
+		solidsegs.clear();
+		solidsegs.push_back({ -0x7fffffff, -1 });
+		solidsegs.push_back({ SCREEN_W, 0x7fffffff });
+
+		// R_ClearPlanes
+		for (int i = 0 ; i < SCREEN_W ; i++)
+		{
+			floorclip[i]   = VIEW_H;
+			ceilingclip[i] = -1;
+		}
+
+		num_planes = 0;
+
+		counts = vanilla_counts_t();
+
+		RenderBSPNode(lev.root);
+
+		counts.visplanes = num_planes;
+
+		return counts;
+	}
+
+private:
+	const vlevel_t &lev;
+	const vtables_t &T;
+
+	double view_x, view_y;
+	int    view_z;
+	bam_t  view_angle;
+
+	std::vector<cliprange_t> solidsegs;
+
+	int floorclip[SCREEN_W];
+	int ceilingclip[SCREEN_W];
+
+	// the planes are kept between views, to save allocating them
+	std::vector<visplane_t> planes;
+	int num_planes = 0;
+
+	int floorplane;
+	int ceilingplane;
+
+	const vseg_t *curline;
+	const vsector_t *frontsector;
+	const vsector_t *backsector;
+
+	vanilla_counts_t counts;
+
+	bam_t PointToAngle(double x, double y) const
+	{
+		return T.PointToAngle(x - view_x, y - view_y);
+	}
+
+	// for an angle relative to the view, within the clip angles
+	int AngleToX(bam_t angle) const
+	{
+		return T.viewangletox[(bam_t)(angle + BAM_90) >> FINESHIFT];
+	}
+
+	int FindPlane(int height, int pic, int light)
+	{
+		if (pic == SKY_PIC)
+		{
+			height = 0;
+			light  = 0;
+		}
+
+		for (int i = 0 ; i < num_planes ; i++)
+		{
+			const visplane_t &P = planes[i];
+
+			if (P.height == height && P.pic == pic && P.light == light)
+				return i;
+		}
+
+		return NewPlane(height, pic, light, SCREEN_W, -1);
+	}
+
+	int NewPlane(int height, int pic, int light, int minx, int maxx)
+	{
+		if (num_planes == (int)planes.size())
+			planes.emplace_back();
+
+		visplane_t &P = planes[num_planes];
+
+		P.height = height;
+		P.pic    = pic;
+		P.light  = light;
+		P.minx   = minx;
+		P.maxx   = maxx;
+
+		memset(P.top, 0xff, sizeof(P.top));
+
+		return num_planes++;
+	}
+
+	int CheckPlane(int pl, int start, int stop)
+	{
+		visplane_t &P = planes[pl];
+
+		int intrl = std::max(start, P.minx);
+		int intrh = std::min(stop,  P.maxx);
+
+		int x;
+
+		for (x = intrl ; x <= intrh ; x++)
+			if (P.top[x] != 0xff)
+				break;
+
+		if (x > intrh)
+		{
+			P.minx = std::min(start, P.minx);
+			P.maxx = std::max(stop,  P.maxx);
+			return pl;
+		}
+
+		// the columns are in use, so make a new visplane
+		return NewPlane(P.height, P.pic, P.light, start, stop);
+	}
+
+	double ScaleAt(int x, double distance, bam_t normal_angle) const
+	{
+		bam_t anglea = BAM_90 + T.xtoviewangle[x];
+		bam_t angleb = BAM_90 + T.xtoviewangle[x] + view_angle - normal_angle;
+
+		double num = PROJECTION * T.Sine(angleb);
+		double den = distance * T.Sine(anglea);
+
+		if (den > num / 65536.0)
+			return clamp(1.0 / 256.0, num / den, 64.0);
+
+		return 64.0;
+	}
+
+	void StoreWallRange(int start, int stop)
+	{
+		const vseg_t &seg = *curline;
+
+		counts.drawsegs++;
+
+		bam_t normal_angle = seg.angle + BAM_90;
+
+		// the distance to the line
+		double len = hypot(seg.x2 - seg.x1, seg.y2 - seg.y1);
+
+		double distance = fabs((seg.x2 - seg.x1) * (view_y - seg.y1) -
+							   (seg.y2 - seg.y1) * (view_x - seg.x1)) / std::max(len, 1e-6);
+
+		double scale1 = ScaleAt(start, distance, normal_angle);
+		double scale2 = scale1;
+		double scalestep = 0;
+
+		if (stop > start)
+		{
+			scale2 = ScaleAt(stop, distance, normal_angle);
+			scalestep = (scale2 - scale1) / (stop - start);
+		}
+
+		const vsector_t *front = frontsector;
+		const vsector_t *back  = backsector;
+
+		double worldtop    = front->ceilh  - view_z;
+		double worldbottom = front->floorh - view_z;
+		double worldhigh = 0;
+		double worldlow  = 0;
+
+		bool midtexture = false;
+		bool toptexture = false;
+		bool bottomtexture = false;
+		bool maskedtexture = false;
+
+		bool markfloor, markceiling;
+
+		bool sil_top = false;
+		bool sil_bottom = false;
+
+		// whether the sprite clipping uses a fixed array
+		bool sprtopclip = false;
+		bool sprbottomclip = false;
+
+		if (! back)
+		{
+			midtexture = seg.mid;
+			markfloor = markceiling = true;
+
+			sil_top = sil_bottom = true;
+			sprtopclip = sprbottomclip = true;
+		}
+		else
+		{
+			if (front->floorh > back->floorh || back->floorh > view_z)
+				sil_bottom = true;
+
+			if (front->ceilh < back->ceilh || back->ceilh < view_z)
+				sil_top = true;
+
+			if (back->ceilh <= front->floorh)
+			{
+				sprbottomclip = true;
+				sil_bottom = true;
+			}
+
+			if (back->floorh >= front->ceilh)
+			{
+				sprtopclip = true;
+				sil_top = true;
+			}
+
+			worldhigh = back->ceilh  - view_z;
+			worldlow  = back->floorh - view_z;
+
+			// hack to allow height changes in outdoor areas
+			if (front->ceilpic == SKY_PIC && back->ceilpic == SKY_PIC)
+				worldtop = worldhigh;
+
+			markfloor = (worldlow != worldbottom ||
+						 back->floorpic != front->floorpic ||
+						 back->light != front->light);
+
+			markceiling = (worldhigh != worldtop ||
+						   back->ceilpic != front->ceilpic ||
+						   back->light != front->light);
+
+			// closed door
+			if (back->ceilh <= front->floorh || back->floorh >= front->ceilh)
+				markceiling = markfloor = true;
+
+			toptexture    = (worldhigh < worldtop)    && seg.upper;
+			bottomtexture = (worldlow  > worldbottom) && seg.lower;
+
+			if (seg.mid)
+			{
+				maskedtexture = true;
+				counts.openings += stop + 1 - start;
+			}
+		}
+
+		// a plane on the wrong side of the view plane is invisible
+		if (front->floorh >= view_z)
+			markfloor = false;
+
+		if (front->ceilh <= view_z && front->ceilpic != SKY_PIC)
+			markceiling = false;
+
+		// (only possible when the sidedefs of a subsector disagree)
+		if (floorplane < 0)
+			markfloor = false;
+
+		if (ceilingplane < 0)
+			markceiling = false;
+
+		if (markceiling)
+			ceilingplane = CheckPlane(ceilingplane, start, stop);
+
+		if (markfloor)
+			floorplane = CheckPlane(floorplane, start, stop);
+
+		// R_RenderSegLoop
+		double scale = scale1;
+
+		for (int x = start ; x <= stop ; x++, scale += scalestep)
+		{
+			double topfrac    = CENTER_Y - worldtop    * scale;
+			double bottomfrac = CENTER_Y - worldbottom * scale;
+
+			int yl = std::max((int)ceil(topfrac), ceilingclip[x] + 1);
+
+			if (markceiling)
+			{
+				int top    = ceilingclip[x] + 1;
+				int bottom = std::min(yl - 1, floorclip[x] - 1);
+
+				if (top <= bottom)
+					planes[ceilingplane].top[x] = (uint8_t)top;
+			}
+
+			int yh = std::min((int)floor(bottomfrac), floorclip[x] - 1);
+
+			if (markfloor)
+			{
+				int top    = std::max(yh + 1, ceilingclip[x] + 1);
+				int bottom = floorclip[x] - 1;
+
+				if (top <= bottom)
+					planes[floorplane].top[x] = (uint8_t)top;
+			}
+
+			if (midtexture)
+			{
+				ceilingclip[x] = VIEW_H;
+				floorclip[x]   = -1;
+				continue;
+			}
+
+			if (toptexture)
+			{
+				int mid = std::min((int)floor(CENTER_Y - worldhigh * scale), floorclip[x] - 1);
+
+				ceilingclip[x] = (mid >= yl) ? mid : yl - 1;
+			}
+			else if (markceiling)
+			{
+				ceilingclip[x] = yl - 1;
+			}
+
+			if (bottomtexture)
+			{
+				int mid = std::max((int)ceil(CENTER_Y - worldlow * scale), ceilingclip[x] + 1);
+
+				floorclip[x] = (mid <= yh) ? mid : yh + 1;
+			}
+			else if (markfloor)
+			{
+				floorclip[x] = yh + 1;
+			}
+		}
+
+		// the sprite clipping of the silhouettes
+		if ((sil_top || maskedtexture) && ! sprtopclip)
+			counts.openings += stop + 1 - start;
+
+		if ((sil_bottom || maskedtexture) && ! sprbottomclip)
+			counts.openings += stop + 1 - start;
+	}
+
+	void ClipSolidWallSegment(int first, int last)
+	{
+		size_t start = 0;
+
+		while (solidsegs[start].last < first - 1)
+			start++;
+
+		if (first < solidsegs[start].first)
+		{
+			if (last < solidsegs[start].first - 1)
+			{
+				// entirely visible, insert a new clip range
+				StoreWallRange(first, last);
+				solidsegs.insert(solidsegs.begin() + start, { first, last });
+				return;
+			}
+
+			StoreWallRange(first, solidsegs[start].first - 1);
+			solidsegs[start].first = first;
+		}
+
+		if (last <= solidsegs[start].last)
+			return;
+
+		size_t next = start;
+
+		while (last >= solidsegs[next + 1].first - 1)
+		{
+			StoreWallRange(solidsegs[next].last + 1, solidsegs[next + 1].first - 1);
+			next++;
+
+			if (last <= solidsegs[next].last)
+			{
+				solidsegs[start].last = solidsegs[next].last;
+				goto crunch;
+			}
+		}
+
+		StoreWallRange(solidsegs[next].last + 1, last);
+		solidsegs[start].last = last;
+
+crunch:
+		// remove the ranges which the new one covers
+		if (next != start)
+			solidsegs.erase(solidsegs.begin() + start + 1, solidsegs.begin() + next + 1);
+	}
+
+	void ClipPassWallSegment(int first, int last)
+	{
+		size_t start = 0;
+
+		while (solidsegs[start].last < first - 1)
+			start++;
+
+		if (first < solidsegs[start].first)
+		{
+			if (last < solidsegs[start].first - 1)
+			{
+				StoreWallRange(first, last);
+				return;
+			}
+
+			StoreWallRange(first, solidsegs[start].first - 1);
+		}
+
+		if (last <= solidsegs[start].last)
+			return;
+
+		while (last >= solidsegs[start + 1].first - 1)
+		{
+			StoreWallRange(solidsegs[start].last + 1, solidsegs[start + 1].first - 1);
+			start++;
+
+			if (last <= solidsegs[start].last)
+				return;
+		}
+
+		StoreWallRange(solidsegs[start].last + 1, last);
+	}
+
+	// clips the angles of a span against the field of view, returning
+	// false when it is completely outside.
+	bool ClipAngles(bam_t &angle1, bam_t &angle2, bam_t span) const
+	{
+		const bam_t clipangle = T.clipangle;
+
+		bam_t tspan = angle1 + clipangle;
+
+		if (tspan > 2 * clipangle)
+		{
+			tspan -= 2 * clipangle;
+
+			if (tspan >= span)
+				return false;
+
+			angle1 = clipangle;
+		}
+
+		tspan = clipangle - angle2;
+
+		if (tspan > 2 * clipangle)
+		{
+			tspan -= 2 * clipangle;
+
+			if (tspan >= span)
+				return false;
+
+			angle2 = (bam_t)0 - clipangle;
+		}
+
+		return true;
+	}
+
+	void AddLine(const vseg_t &seg)
+	{
+		bam_t angle1 = PointToAngle(seg.x1, seg.y1);
+		bam_t angle2 = PointToAngle(seg.x2, seg.y2);
+
+		// back side, or seen edge on
+		bam_t span = angle1 - angle2;
+
+		if (span >= BAM_180)
+			return;
+
+		angle1 -= view_angle;
+		angle2 -= view_angle;
+
+		if (! ClipAngles(angle1, angle2, span))
+			return;
+
+		int x1 = AngleToX(angle1);
+		int x2 = AngleToX(angle2);
+
+		// too small to cover a column
+		if (x1 == x2)
+			return;
+
+		curline = &seg;
+		backsector = (seg.back >= 0) ? &lev.sectors[seg.back] : NULL;
+
+		if (! backsector ||
+			backsector->ceilh <= frontsector->floorh ||
+			backsector->floorh >= frontsector->ceilh)
+		{
+			ClipSolidWallSegment(x1, x2 - 1);
+			return;
+		}
+
+		if (backsector->ceilh == frontsector->ceilh &&
+			backsector->floorh == frontsector->floorh)
+		{
+			// the line is invisible when nothing changes across it
+			if (backsector->ceilpic  == frontsector->ceilpic &&
+				backsector->floorpic == frontsector->floorpic &&
+				backsector->light    == frontsector->light && ! seg.mid)
+			{
+				return;
+			}
+		}
+
+		ClipPassWallSegment(x1, x2 - 1);
+	}
+
+	bool CheckBBox(const double *box) const
+	{
+		static const int checkcoord[12][4] =
+		{
+			{ 3, 0, 2, 1 },
+			{ 3, 0, 2, 0 },
+			{ 3, 1, 2, 0 },
+			{ 0, 0, 0, 0 },
+			{ 2, 0, 2, 1 },
+			{ 0, 0, 0, 0 },
+			{ 3, 1, 3, 0 },
+			{ 0, 0, 0, 0 },
+			{ 2, 0, 3, 1 },
+			{ 2, 1, 3, 1 },
+			{ 2, 1, 3, 0 },
+			{ 0, 0, 0, 0 }
+		};
+
+		int boxx, boxy;
+
+		if (view_x <= box[2])
+			boxx = 0;
+		else if (view_x < box[3])
+			boxx = 1;
+		else
+			boxx = 2;
+
+		if (view_y >= box[0])
+			boxy = 0;
+		else if (view_y > box[1])
+			boxy = 1;
+		else
+			boxy = 2;
+
+		int boxpos = (boxy << 2) + boxx;
+
+		// inside the box
+		if (boxpos == 5)
+			return true;
+
+		const int *coord = checkcoord[boxpos];
+
+		bam_t angle1 = PointToAngle(box[coord[0]], box[coord[1]]) - view_angle;
+		bam_t angle2 = PointToAngle(box[coord[2]], box[coord[3]]) - view_angle;
+
+		bam_t span = angle1 - angle2;
+
+		// sitting on a line
+		if (span >= BAM_180)
+			return true;
+
+		if (! ClipAngles(angle1, angle2, span))
+			return false;
+
+		int sx1 = AngleToX(angle1);
+		int sx2 = AngleToX(angle2);
+
+		if (sx1 == sx2)
+			return false;
+
+		sx2--;
+
+		size_t start = 0;
+
+		while (solidsegs[start].last < sx2)
+			start++;
+
+		// completely hidden behind solid walls?
+		return ! (sx1 >= solidsegs[start].first && sx2 <= solidsegs[start].last);
+	}
+
+	void Subsector(const vsubsec_t &sub)
+	{
+		if (sub.sector < 0)
+			return;
+
+		frontsector = &lev.sectors[sub.sector];
+
+		floorplane = ceilingplane = -1;
+
+		if (frontsector->floorh < view_z)
+			floorplane = FindPlane(frontsector->floorh, frontsector->floorpic, frontsector->light);
+
+		if (frontsector->ceilh > view_z || frontsector->ceilpic == SKY_PIC)
+			ceilingplane = FindPlane(frontsector->ceilh, frontsector->ceilpic, frontsector->light);
+
+		for (int i = 0 ; i < sub.seg_count ; i++)
+		{
+			const vseg_t &seg = lev.segs[sub.first_seg + i];
+
+			if (seg.real)
+				AddLine(seg);
+		}
+	}
+
+	void RenderBSPNode(int num)
+	{
+		// the tree is walked front to back, a side only when some of
+		// its bounding box is not hidden yet.
+		while (num >= 0)
+		{
+			const vnode_t &node = lev.nodes[num];
+
+			int side = vlevel_t::PointOnSide(view_x, view_y, node);
+
+			RenderBSPNode(node.child[side]);
+
+			if (! CheckBBox(node.bbox[side ^ 1]))
+				return;
+
+			num = node.child[side ^ 1];
+		}
+
+		Subsector(lev.subsecs[~num]);
+	}
+};
+
+
+// the worst view of a row of cells
+struct worst_view_t
+{
+	vanilla_counts_t counts;
+
+	double x = 0;
+	double y = 0;
+	int angle = 0;
+};
+
+
+void ScanRow(const vlevel_t &lev, vanilla_heatmap_t &heat, int row, worst_view_t &worst,
+			 int &num_views)
+{
+	VanillaView view(lev);
+
+	double y = heat.origin_y + (row + 0.5) * heat.cell_size;
+
+	for (int col = 0 ; col < heat.width ; col++)
+	{
+		double x = heat.origin_x + (col + 0.5) * heat.cell_size;
+
+		int sec = lev.PointSector(x, y);
+
+		if (sec < 0)
+			continue;
+
+		const vsector_t &S = lev.sectors[sec];
+
+		if (S.ceilh - S.floorh < PLAYER_HEIGHT)
+			continue;
+
+		vanilla_counts_t &cell = heat.cells[row * heat.width + col];
+
+		for (int a = 0 ; a < NUM_ANGLES ; a++)
+		{
+			vanilla_counts_t counts = view.Render(x, y, S.floorh + VIEW_HEIGHT, (bam_t)a * BAM_45);
+
+			cell.Merge(counts);
+
+			if (counts.Load() > worst.counts.Load())
+			{
+				worst.counts = counts;
+				worst.x = x;
+				worst.y = y;
+				worst.angle = a * 360 / NUM_ANGLES;
+			}
+
+			num_views++;
+		}
+	}
+}
+
+
+// makes the tree with the node builder (with its fastest options),
+// returns false when it could not be built.
+bool MakeLevel(const Instance &inst, vlevel_t &lev)
+{
+	nodebuildinfo_t info;
+
+	info.fast = true;
+	info.gl_nodes = false;
+
+	ajbsp::LevelBuilder builder(&info, -1, inst);
+
+	builder.defer_messages = true;
+
+	if (builder.Build() != BUILD_OK)
+		return false;
+
+	lev.AddSectors(inst);
+
+	if (builder.RootNode())
+		lev.root = lev.AddNode(inst, builder.RootNode());
+	else if (builder.RootSubsec())
+		lev.root = lev.AddSubsec(inst, builder.RootSubsec());
+	else
+		return false;
+
+	return true;
+}
+
+}	// namespace
+
+
+bool R_ScanVanillaLimits(const Instance &inst, vanilla_heatmap_t &heat)
+{
+	auto start_time = std::chrono::steady_clock::now();
+
+	heat = vanilla_heatmap_t();
+
+	vlevel_t lev;
+
+	if (! MakeLevel(inst, lev))
+		return false;
+
+	// the grid of viewpoints
+	int x1 = (int)floor(inst.Map_bound1.x);
+	int y1 = (int)floor(inst.Map_bound1.y);
+	int x2 = (int)ceil(inst.Map_bound2.x);
+	int y2 = (int)ceil(inst.Map_bound2.y);
+
+	for (;;)
+	{
+		heat.width  = (x2 - x1) / heat.cell_size + 1;
+		heat.height = (y2 - y1) / heat.cell_size + 1;
+
+		if (heat.width * heat.height <= MAX_CELLS)
+			break;
+
+		heat.cell_size += 32;
+	}
+
+	heat.origin_x = x1;
+	heat.origin_y = y1;
+
+	heat.cells.assign(heat.width * heat.height, vanilla_counts_t());
+
+	std::vector<worst_view_t> row_worst(heat.height);
+	std::vector<int> row_views(heat.height, 0);
+
+	TaskGroup group;
+
+	for (int row = 0 ; row < heat.height ; row++)
+	{
+		group.run([&lev, &heat, &row_worst, &row_views, row]()
+		{
+			ScanRow(lev, heat, row, row_worst[row], row_views[row]);
+		});
+	}
+
+	group.wait();
+
+	for (int row = 0 ; row < heat.height ; row++)
+	{
+		const worst_view_t &W = row_worst[row];
+
+		if (W.counts.Load() > heat.worst.Load())
+		{
+			heat.worst = W.counts;
+			heat.worst_x = W.x;
+			heat.worst_y = W.y;
+			heat.worst_angle = W.angle;
+		}
+
+		heat.num_views += row_views[row];
+	}
+
+	heat.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+	return true;
+}
+
+
+bool R_CountVanillaView(const Instance &inst, double x, double y, double angle,
+						vanilla_counts_t &counts)
+{
+	vlevel_t lev;
+
+	if (! MakeLevel(inst, lev))
+		return false;
+
+	int sec = lev.PointSector(x, y);
+
+	if (sec < 0)
+		return false;
+
+	VanillaView view(lev);
+
+	counts = view.Render(x, y, lev.sectors[sec].floorh + VIEW_HEIGHT, ToBam(angle * M_PI / 180.0));
+
+	return true;
+}
+
+
+void Instance::CMD_VanillaHeatmap()
+{
+	if (vanilla_heat)
+	{
+		vanilla_heat.reset();
+
+		Status_Set("Vanilla limits hidden");
+		RedrawMap();
+		return;
+	}
+
+	auto heat = std::make_unique<vanilla_heatmap_t>();
+
+	if (! R_ScanVanillaLimits(*this, *heat))
+	{
+		Beep("Cannot check the vanilla limits of this level");
+		return;
+	}
+
+	const vanilla_counts_t &W = heat->worst;
+
+	gLog.printf("Vanilla limits: %d views in %1.2f seconds, worst at (%d %d) angle %d\n",
+				heat->num_views, heat->seconds, (int)heat->worst_x, (int)heat->worst_y,
+				heat->worst_angle);
+	gLog.printf("    visplanes %d/%d, drawsegs %d/%d, openings %d/%d\n",
+				W.visplanes, VANILLA_MAXVISPLANES, W.drawsegs, VANILLA_MAXDRAWSEGS,
+				W.openings, VANILLA_MAXOPENINGS);
+
+	Status_Set("Worst view: %d visplanes, %d drawsegs, %d openings at (%d %d)",
+			   W.visplanes, W.drawsegs, W.openings, (int)heat->worst_x, (int)heat->worst_y);
+
+	vanilla_heat = std::move(heat);
+
+	RedrawMap();
+}
+
+//--- editor settings ---
+// vi:ts=4:sw=4:noexpandtab
@@ -0,0 +1,95 @@
+//------------------------------------------------------------------------
+//  VANILLA RENDERER LIMITS
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#ifndef __EUREKA_R_VANILLA_H__
+#define __EUREKA_R_VANILLA_H__
+
+#include <vector>
+
+class Instance;
+
+// the fixed sizes of the arrays in the DOOM renderer
+#define VANILLA_MAXVISPLANES  128
+#define VANILLA_MAXDRAWSEGS   256
+#define VANILLA_MAXOPENINGS   (320 * 64)
+
+
+struct vanilla_counts_t
+{
+	int visplanes = 0;
+	int drawsegs  = 0;
+	int openings  = 0;
+
+	// how close the worst of these is to its limit, where 1.0 is
+	// exactly at the limit.
+	double Load() const;
+
+	// keeps the larger of each count
+	void Merge(const vanilla_counts_t &other);
+};
+
+
+//
+// The worst counts seen from the viewpoints in each cell of a grid
+// over the level, made by R_ScanVanillaLimits().
+//
+struct vanilla_heatmap_t
+{
+	// the map coordinate of the lower left corner, and the size of
+	// each (square) cell.
+	int origin_x = 0;
+	int origin_y = 0;
+	int cell_size = 64;
+
+	int width  = 0;
+	int height = 0;
+
+	// one for each cell, row by row from the bottom.  the cells where
+	// nobody can stand are all zero.
+	std::vector<vanilla_counts_t> cells;
+
+	// the worst view of the whole level
+	vanilla_counts_t worst;
+
+	double worst_x = 0;
+	double worst_y = 0;
+	int worst_angle = 0;
+
+	int num_views = 0;
+	double seconds = 0;
+};
+
+
+// looks from a grid of points over the level (in several directions
+// from each one), counting what the DOOM renderer would use for each
+// view.  Returns false if the level has no nodes to traverse.
+bool R_ScanVanillaLimits(const Instance &inst, vanilla_heatmap_t &heat);
+
+// counts what the DOOM renderer would use for a single view, with the
+// eye above the floor at (x, y), looking in the given direction (in
+// degrees).  Returns false if the level has no nodes to traverse, or
+// the spot is outside of it.
+bool R_CountVanillaView(const Instance &inst, double x, double y, double angle,
+						vanilla_counts_t &counts);
+
+#endif  /* __EUREKA_R_VANILLA_H__ */
+
+//--- editor settings ---
+// vi:ts=4:sw=4:noexpandtab
@@ -433,6 +433,9 @@ void UI_Canvas::DrawMap()
 			DrawGrid_Dotty();
 	}
 
+	if (inst.vanilla_heat)
+		DrawVanillaHeat();
+
 	if (global::Debugging)
 		DrawMapBounds();
 
@@ -636,6 +639,45 @@ void UI_Canvas::DrawMapBounds()
 }
 
 
+//
+//  show where the vanilla renderer comes near its limits: yellow
+//  from half way, turning red once a limit is reached.
+//
+void UI_Canvas::DrawVanillaHeat()
+{
+	const vanilla_heatmap_t &heat = *inst.vanilla_heat;
+
+	for (int row = 0 ; row < heat.height ; row++)
+	for (int col = 0 ; col < heat.width  ; col++)
+	{
+		double load = heat.cells[row * heat.width + col].Load();
+
+		if (load < 0.5)
+			continue;
+
+		double x1 = heat.origin_x + col * heat.cell_size;
+		double y1 = heat.origin_y + row * heat.cell_size;
+		double x2 = x1 + heat.cell_size;
+		double y2 = y1 + heat.cell_size;
+
+		if (! Vis(x1, y1, x2, y2))
+			continue;
+
+		if (load >= 1.0)
+			RenderColor(fl_rgb_color(224, 0, 0));
+		else
+			RenderColor(fl_rgb_color(224, static_cast<uchar>(224 - (load - 0.5) * 320), 0));
+
+		int sx1 = SCREENX(x1);
+		int sy1 = SCREENY(y2);
+		int sx2 = SCREENX(x2);
+		int sy2 = SCREENY(y1);
+
+		RenderRect(sx1, sy1, sx2 - sx1, sy2 - sy1);
+	}
+}
+
+
 //
 //  the apparent radius of a vertex, in pixels
 //
@@ -123,6 +123,7 @@ private:
 	void DrawAxes(Fl_Color col);
 
 	void DrawMapBounds();
+	void DrawVanillaHeat();
 	void DrawVertices();
 	void DrawLinedefs();
 	void DrawThings();
@@ -73,6 +73,13 @@ static int DialogShowAndRun(
 	const SString &link_url = NULL,
 	const std::vector<SString> *labels = NULL)
 {
+	// never open a window in batch mode, just log it
+	if (!global::check_wad.empty())
+	{
+		gLog.printf("%s: %s\n", title.c_str(), message.c_str());
+		return -1;
+	}
+
 	DialogContext context = {};
 	context.result = -1;
 
@@ -651,6 +651,115 @@ void UI_OpenMap::LoadFile()
 }
 
 
+//------------------------------------------------------------------------
+
+UI_ChooseBackup::UI_ChooseBackup(const std::vector<BackupStore::Version> &_versions) :
+	UI_Escapable_Window(420, 385, "Restore Backup"),
+	versions(_versions.rbegin(), _versions.rend())
+{
+	resizable(NULL);
+
+	callback(close_callback, this);
+
+	Fl_Box *title = new Fl_Box(20, 10, w() - 40, 30, "Choose the version to restore:");
+	title->align(FL_ALIGN_LEFT | FL_ALIGN_INSIDE);
+
+	list = new Fl_Hold_Browser(20, 45, w() - 40, 260);
+	list->textfont(FL_COURIER);
+	list->has_scrollbar(Fl_Browser_::VERTICAL);
+	list->callback(list_callback, this);
+
+	for (const BackupStore::Version &version : versions)
+	{
+		char date[64] = "";
+
+		const struct tm *calend_time = localtime(&version.time);
+		if (calend_time)
+			strftime(date, sizeof(date), "%Y/%m/%d %H:%M", calend_time);
+
+		SString line = SString::printf("%4d  %-16s %8llu KB", version.number, date,
+									   (unsigned long long)(version.wadSize + 1023) / 1024);
+
+		list->add(line.c_str());
+	}
+
+	{
+		int bottom_y = 320;
+
+		Fl_Group* o = new Fl_Group(0, bottom_y, 420, 65);
+		o->box(FL_FLAT_BOX);
+		o->color(WINDOW_BG, WINDOW_BG);
+
+		ok_but = new Fl_Return_Button(260, bottom_y + 17, 100, 35, "Restore");
+		ok_but->labelfont(FL_HELVETICA_BOLD);
+		ok_but->callback(ok_callback, this);
+		ok_but->deactivate();
+
+		Fl_Button *cancel = new Fl_Button(75, bottom_y + 17, 100, 35, "Cancel");
+		cancel->callback(close_callback, this);
+
+		o->end();
+	}
+
+	end();
+}
+
+
+int UI_ChooseBackup::Run()
+{
+	set_modal();
+
+	show();
+
+	while (action == Action::none)
+	{
+		Fl::wait(0.2);
+	}
+
+	if (action == Action::cancel || list->value() < 1)
+		return -1;
+
+	return versions[list->value() - 1].number;
+}
+
+
+void UI_ChooseBackup::close_callback(Fl_Widget *w, void *data)
+{
+	UI_ChooseBackup * that = (UI_ChooseBackup *)data;
+
+	that->action = Action::cancel;
+}
+
+
+void UI_ChooseBackup::ok_callback(Fl_Widget *w, void *data)
+{
+	UI_ChooseBackup * that = (UI_ChooseBackup *)data;
+
+	if (that->list->value() > 0)
+		that->action = Action::accept;
+	else
+		fl_beep();
+}
+
+
+void UI_ChooseBackup::list_callback(Fl_Widget *w, void *data)
+{
+	UI_ChooseBackup * that = (UI_ChooseBackup *)data;
+
+	if (that->list->value() < 1)
+	{
+		that->ok_but->deactivate();
+		return;
+	}
+
+	that->ok_but->activate();
+
+	// a double click picks it straight away
+	if (Fl::event_clicks() > 0)
+		that->action = Action::accept;
+}
+
+
 //------------------------------------------------------------------------
 
 #define STARTUP_MSG  "No IWADs could be found."
@@ -21,6 +21,8 @@
 #ifndef __EUREKA_UI_FILE_H__
 #define __EUREKA_UI_FILE_H__
 
+#include "BackupStore.h"
+
 class UI_ChooseMap : public UI_Escapable_Window
 {
 private:
@@ -137,6 +139,43 @@ private:
 };
 
 
+//------------------------------------------------------------------------
+
+class UI_ChooseBackup : public UI_Escapable_Window
+{
+private:
+	Fl_Hold_Browser *list;
+
+	Fl_Return_Button *ok_but;
+
+	// newest first, like the lines of the list
+	std::vector<BackupStore::Version> versions;
+
+	enum class Action
+	{
+		none,
+		cancel,
+		accept
+	};
+
+	Action action = Action::none;
+
+public:
+	explicit UI_ChooseBackup(const std::vector<BackupStore::Version> &_versions);
+	virtual ~UI_ChooseBackup()
+	{
+	}
+
+	// returns the number of the chosen version, or -1 if cancelled
+	int Run();
+
+private:
+	static void    ok_callback(Fl_Widget *, void *);
+	static void close_callback(Fl_Widget *, void *);
+	static void  list_callback(Fl_Widget *, void *);
+};
+
+
 //------------------------------------------------------------------------
 
 class UI_ProjectSetup : public UI_Escapable_Window
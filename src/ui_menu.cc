@@ -79,6 +79,16 @@ static void file_do_delete(Fl_Widget *w, void * data)
 	static_cast<Instance *>(data)->ExecuteCommand("DeleteMap");
 }
 
+static void file_do_compact(Fl_Widget *w, void * data)
+{
+	static_cast<Instance *>(data)->ExecuteCommand("CompactWad");
+}
+
+static void file_do_restore_backup(Fl_Widget *w, void * data)
+{
+	static_cast<Instance *>(data)->ExecuteCommand("RestoreBackup");
+}
+
 static void file_do_load_given(Fl_Widget *w, void *data)
 {
 	const char *filename = (const char *) data;
@@ -357,6 +367,11 @@ static void checks_do_tags(Fl_Widget *w, void * data)
 	static_cast<Instance *>(data)->ExecuteCommand("MapCheck", "tags");
 }
 
+static void checks_do_vanilla(Fl_Widget *w, void * data)
+{
+	static_cast<Instance *>(data)->ExecuteCommand("VanillaHeatmap");
+}
+
 
 //------------------------------------------------------------------------
 //  TOOLS MENU
@@ -434,6 +449,8 @@ static std::unordered_map<void(*)(Fl_Widget *, void *), MenuCommand> s_menu_comm
 	{file_do_copy_map, {"CopyMap"} },
 	{file_do_rename, {"RenameMap"} },
 	{file_do_delete, {"DeleteMap"} },
+	{file_do_compact, {"CompactWad"} },
+	{file_do_restore_backup, {"RestoreBackup"} },
 	// given and recent don't have direct commands
 	{file_do_quit, {"Quit"} },
 
@@ -487,6 +504,7 @@ static std::unordered_map<void(*)(Fl_Widget *, void *), MenuCommand> s_menu_comm
 	{checks_do_things, {"MapCheck", {"things"}} },
 	{checks_do_textures, {"MapCheck", {"textures"}} },
 	{checks_do_tags, {"MapCheck", {"tags"}} },
+	{checks_do_vanilla, {"VanillaHeatmap"} },
 
 	{tools_do_preferences, {"PreferenceDialog"} },
 	{tools_do_build_nodes, {"BuildAllNodes"} },
@@ -535,6 +553,8 @@ static Fl_Menu_Item menu_items[] =
 		{ "&Copy Map",    0,  FCAL file_do_copy_map },
 		{ "Rename Map",   0,  FCAL file_do_rename },
 		{ "Delete Map",   0,  FCAL file_do_delete },
+		{ "Compact WAD",  0,  FCAL file_do_compact },
+		{ "Restore Backup...",  0,  FCAL file_do_restore_backup },
 
 		{ "", 0, 0, 0, FL_MENU_DIVIDER|FL_MENU_INACTIVE },
 
@@ -641,6 +661,10 @@ static Fl_Menu_Item menu_items[] =
 
 		{ "Te&xtures",     0, FCAL checks_do_textures },
 		{ "Ta&gs",         0, FCAL checks_do_tags },
+
+		{ "", 0, 0, 0, FL_MENU_DIVIDER|FL_MENU_INACTIVE },
+
+		{ "Vanilla &Limits",  0, FCAL checks_do_vanilla },
 		{ 0 },
 
 	{ "&Tools", 0, 0, 0, FL_SUBMENU },
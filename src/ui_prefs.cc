@@ -716,8 +716,10 @@ public:
 	Fl_Check_Button *nod_on_save;
 	Fl_Check_Button *nod_fast;
 	Fl_Check_Button *nod_warn;
+	Fl_Check_Button *nod_los_reject;
 
 	Fl_Choice *nod_factor;
+	Fl_Choice *nod_goal;
 
 	Fl_Check_Button *nod_gl_nodes;
 	Fl_Check_Button *nod_force_v5;
@@ -1068,6 +1070,8 @@ UI_Preferences::UI_Preferences() :
 		}
 		{ nod_warn = new Fl_Check_Button(50, 140, 220, 30, " Warning messages in the logs");
 		}
+		{ nod_los_reject = new Fl_Check_Button(50, 170, 440, 30, " Line-of-sight REJECT   (slower, helps vanilla engines)");
+		}
 
 		{ Fl_Box* o = new Fl_Box(25, 205, 250, 30, "Advanced BSP Settings");
 		  o->labelfont(FL_BOLD);
@@ -1086,6 +1090,9 @@ UI_Preferences::UI_Preferences() :
 		{ nod_factor = new Fl_Choice(160, 345, 180, 30, "Seg split logic: ");
 		  nod_factor->add("NORMAL|Minimize Splits|Balance BSP Tree");
 		}
+		{ nod_goal = new Fl_Choice(160, 380, 180, 30, "Build all nodes: ");
+		  nod_goal->add("Single Build|Fewest Segs|Shallowest Tree|Vanilla Limits");
+		}
 		o->end();
 	  }
 
@@ -1527,6 +1534,7 @@ void UI_Preferences::LoadValues()
 	nod_on_save->value(config::bsp_on_save ? 1 : 0);
 	nod_fast->value(config::bsp_fast ? 1 : 0);
 	nod_warn->value(config::bsp_warnings ? 1 : 0);
+	nod_los_reject->value(config::bsp_los_reject ? 1 : 0);
 
 	if (config::bsp_split_factor < 7)
 		nod_factor->value(2);	// Balanced BSP tree
@@ -1535,6 +1543,8 @@ void UI_Preferences::LoadValues()
 	else
 		nod_factor->value(0);	// NORMAL
 
+	nod_goal->value(clamp(0, config::bsp_goal, 3));
+
 	nod_gl_nodes->value(config::bsp_gl_nodes ? 1 : 0);
 	nod_force_v5->value(config::bsp_force_v5 ? 1 : 0);
 	nod_force_zdoom->value(config::bsp_force_zdoom ? 1 : 0);
@@ -1664,6 +1674,7 @@ void UI_Preferences::SaveValues()
 	config::bsp_on_save = nod_on_save->value() ? true : false;
 	config::bsp_fast = nod_fast->value() ? true : false;
 	config::bsp_warnings = nod_warn->value() ? true : false;
+	config::bsp_los_reject = nod_los_reject->value() ? true : false;
 
 	if (nod_factor->value() == 1)			// Minimize Splits
 		config::bsp_split_factor = 29;
@@ -1672,6 +1683,8 @@ void UI_Preferences::SaveValues()
 	else
 		config::bsp_split_factor = 11;
 
+	config::bsp_goal = nod_goal->value();
+
 	config::bsp_gl_nodes = nod_gl_nodes->value() ? true : false;
 	config::bsp_force_v5 = nod_force_v5->value() ? true : false;
 	config::bsp_force_zdoom = nod_force_zdoom->value() ? true : false;
@@ -78,6 +78,9 @@ void ImageSet::W_AddTexture(const SString &name, Img_c *img, bool is_medusa)
 	}
 
 	medusa_textures[tex_str] = is_medusa ? 1 : 0;
+
+	// the map checks query this a lot
+	img->update_properties();
 }
 
 
@@ -517,6 +520,8 @@ void ImageSet::W_AddFlat(const SString &name, Img_c *img)
 	{
 		flats[flat_str] = img;
 	}
+
+	img->update_properties();
 }
 
 
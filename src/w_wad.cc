@@ -31,6 +31,7 @@
 
 #include "Errors.h"
 #include "lib_adler.h"
+#include "lib_sha256.h"
 #include "m_files.h"
 #include "SafeOutFile.h"
 #include "w_rawdef.h"
@@ -38,6 +39,12 @@
 
 #include <assert.h>
 
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
 // UDMF support is unfinished and hence disabled by default.
 bool global::udmf_testing = false;
 
@@ -65,6 +72,21 @@ const char *WadNamespaceString(WadNamespace ns)
 }
 
 
+bool W_PackLumpName(const SString &name, int64_t &packed) noexcept
+{
+	if (name.length() > 8)
+		return false;
+
+	char buffer[8] = {};
+
+	for (size_t i = 0 ; i < name.length() ; i++)
+		buffer[i] = static_cast<char>(toupper(static_cast<unsigned char>(name[i])));
+
+	memcpy(&packed, buffer, 8);
+	return true;
+}
+
+
 //------------------------------------------------------------------------
 //  LUMP Handling
 //------------------------------------------------------------------------
@@ -75,6 +97,8 @@ Lump_c::Lump_c(const SString &_nam)
 	name = _nam.asUpper();
 	if(name.length() > 8)
 		name.erase(8, std::string::npos);
+
+	W_PackLumpName(name, mName8);
 }
 
 void Lump_c::Rename(const char *new_name)
@@ -82,6 +106,48 @@ void Lump_c::Rename(const char *new_name)
 	name = SString(new_name).asUpper();
 	if(name.length() > 8)
 		name.erase(8, std::string::npos);
+
+	W_PackLumpName(name, mName8);
+}
+
+
+void Lump_c::MapTo(const std::shared_ptr<MappedFile> &mapping, int offset, int length)
+{
+	mData.clear();
+	mData.shrink_to_fit();
+
+	mMapping = mapping;
+	mMapped = mapping->data() + offset;
+	mMappedLength = length;
+}
+
+
+void Lump_c::Unshare()
+{
+	mDiskOffset = -1;
+
+	if (! mMapping)
+		return;
+
+	mData.assign(mMapped, mMapped + mMappedLength);
+
+	mMapping.reset();
+	mMapped = nullptr;
+	mMappedLength = 0;
+}
+
+
+const SString &Lump_c::ContentHash() const
+{
+	if (mContentHash.empty())
+	{
+		sha256_c hash;
+		hash.AddBlock(Bytes(), Length());
+
+		mContentHash = hash.Finish();
+	}
+
+	return mContentHash;
 }
 
 
@@ -90,20 +156,20 @@ void Lump_c::Seek(int offset) noexcept
 	mPos = offset;
 	if(mPos < 0)
 		mPos = 0;
-	else if(mPos > (int)mData.size())
-		mPos = (int)mData.size();
+	else if(mPos > Length())
+		mPos = Length();
 }
 
 
 bool Lump_c::Read(void *data, int len) noexcept
 {
 	bool result = true;
-	if(mPos + len > (int)mData.size())
+	if(mPos + len > Length())
 	{
 		result = false;
-		len = (int)mData.size() - mPos;
+		len = Length() - mPos;
 	}
-	memcpy(data, mData.data() + mPos, len);
+	memcpy(data, Bytes() + mPos, len);
 	mPos += len;
 	return result;
 }
@@ -113,13 +179,15 @@ bool Lump_c::Read(void *data, int len) noexcept
 //
 bool Lump_c::GetLine(SString &string) noexcept
 {
-	if(mPos >= (int)mData.size())
+	if(mPos >= Length())
 		return false;	// EOF
 
+	const byte *data = Bytes();
+
 	string.clear();
-	for(; mPos < (int)mData.size(); ++mPos)
+	for(; mPos < Length(); ++mPos)
 	{
-		string.push_back(static_cast<char>(mData[mPos]));
+		string.push_back(static_cast<char>(data[mPos]));
 		if(string.back() == '\n')
 		{
 			++mPos;
@@ -132,6 +200,8 @@ bool Lump_c::GetLine(SString &string) noexcept
 void Lump_c::Write(const void *vdata, int len)
 {
 	auto data = static_cast<const byte *>(vdata);
+	Unshare();
+	mContentHash.clear();
 	mData.insert(mData.begin() + mPos, data, data + len);
 	mPos += len;
 }
@@ -155,6 +225,8 @@ void Lump_c::Printf(EUR_FORMAT_STRING(const char *msg), ...)
 //
 size_t Lump_c::writeData(FILE *f, int len)
 {
+	Unshare();
+	mContentHash.clear();
 	mData.insert(mData.begin() + mPos, len, 0);
 	size_t actualRead = fread(mData.data() + mPos, 1, len, f);
 	if((int)actualRead < len)
@@ -166,20 +238,6 @@ size_t Lump_c::writeData(FILE *f, int len)
 	return actualRead;
 }
 
-//
-// Returns the name coded into 8 bytes
-//
-int64_t Lump_c::getName8() const noexcept
-{
-	union
-	{
-		char cbuf[8];
-		int64_t cint;
-	} buffer;
-	strncpy(buffer.cbuf, Name().c_str(), 8);
-	return buffer.cint;
-}
-
 //------------------------------------------------------------------------
 //  WAD Reading Interface
 //------------------------------------------------------------------------
@@ -246,7 +304,23 @@ retry:
 		ThrowException("Error determining WAD size.\n");
 	}
 
-	if (! w->ReadDirectory(fp, total_size))
+	// the lumps of a read-only file are only read when they are used.
+	// A file we write to is read in whole, since it may be changed by
+	// something else (or by us) while we hold on to it.
+	std::shared_ptr<MappedFile> mapping;
+
+	if (mode == WadOpenMode::read)
+	{
+		mapping = MappedFile::open(filename);
+
+		if (mapping && mapping->size() != (size_t)total_size)
+			mapping.reset();
+
+		if (! mapping)
+			gLog.printf("Cannot map the file, reading it all in.\n");
+	}
+
+	if (! w->ReadDirectory(fp, total_size, mapping))
 	{
 		gLog.printf("Open wad failed (reading directory)\n");
 		fclose(fp);
@@ -353,37 +427,97 @@ Lump_c * Wad_file::GetLump(int index) const noexcept
 }
 
 
-Lump_c * Wad_file::FindLump(const SString &name) const noexcept
+void Wad_file::DirectoryChanged() noexcept
 {
-	for (auto it = directory.rbegin(); it != directory.rend(); ++it)
-		if (it->lump->name.noCaseEqual(name))
-			return it->lump.get();
+	static std::atomic<uint64_t> last_generation{ 0 };
 
-	return nullptr;  // not found
+	index_valid = false;
+	generation = ++last_generation;
 }
 
-int Wad_file::FindLumpNum(const SString &name) const noexcept
+
+void Wad_file::UpdateIndex() const
 {
-	for (int k = NumLumps() - 1 ; k >= 0 ; k--)
-		if (directory[k].lump->name.noCaseEqual(name))
-			return k;
+	if (index_valid)
+		return;
 
-	return -1;  // not found
+	std::lock_guard<std::mutex> lock(index_mutex);
+
+	// another thread may have made it in the meantime
+	if (index_valid)
+		return;
+
+	last_by_name.clear();
+	first_in_ns.clear();
+
+	last_by_name.reserve(directory.size());
+	first_in_ns.reserve(directory.size());
+
+	for (int k = 0 ; k < NumLumps() ; k++)
+	{
+		const LumpRef &ref = directory[k];
+
+		int64_t name = ref.lump->getName8();
+
+		last_by_name[name] = k;
+		first_in_ns.emplace(LumpKey{ name, ref.ns }, k);
+	}
+
+	index_valid = true;
+}
+
+
+const std::unordered_map<LumpKey, int, LumpKeyHash> &Wad_file::NamespaceIndex() const
+{
+	UpdateIndex();
+
+	return first_in_ns;
+}
+
+
+Lump_c * Wad_file::FindLump(const SString &name) const
+{
+	int k = FindLumpNum(name);
+
+	return (k >= 0) ? directory[k].lump.get() : nullptr;
+}
+
+int Wad_file::FindLumpNum(const SString &name) const
+{
+	int64_t key;
+
+	if (! W_PackLumpName(name, key))
+		return -1;
+
+	UpdateIndex();
+
+	auto it = last_by_name.find(key);
+
+	if (it == last_by_name.end())
+		return -1;  // not found
+
+	return it->second;
 }
 
 
 int Wad_file::LevelLookupLump(int lev_num, const char *name) const noexcept
 {
+	int64_t key;
+
+	if (! W_PackLumpName(name, key))
+		return -1;
+
 	int start = LevelHeader(lev_num);
 
 	// determine how far past the level marker (MAP01 etc) to search
 	int finish = LevelLastLump(lev_num);
 
+	// a level has only a few lumps, so they are simply compared
 	for (int k = start+1 ; k <= finish ; k++)
 	{
 		SYS_ASSERT(0 <= k && k < NumLumps());
 
-		if (directory[k].lump->name.noCaseEqual(name))
+		if (directory[k].lump->getName8() == key)
 			return k;
 	}
 
@@ -507,20 +641,38 @@ MapFormat Wad_file::LevelFormat(int lev_num) const noexcept
 }
 
 
-Lump_c * Wad_file::FindLumpInNamespace(const SString &name, WadNamespace group) const noexcept
+Lump_c * Wad_file::FindLumpInNamespace(const SString &name, WadNamespace group) const
 {
-	for(const LumpRef &lumpRef : directory)
-	{
-		if(lumpRef.ns != group || !lumpRef.lump->name.noCaseEqual(name))
-			continue;
-		return lumpRef.lump.get();
-	}
+	int64_t key;
+
+	if (! W_PackLumpName(name, key))
+		return nullptr;
+
+	UpdateIndex();
+
+	auto it = first_in_ns.find(LumpKey{ key, group });
+
+	if (it == first_in_ns.end())
+		return nullptr; // not found!
+
+	return directory[it->second].lump.get();
+}
+
 
-	return nullptr; // not found!
+//
+// The time the file was last written, or the minimum when unknown
+//
+static std::filesystem::file_time_type W_FileTime(const SString &path)
+{
+	std::error_code ec;
+
+	auto time = std::filesystem::last_write_time(std::filesystem::u8path(path.c_str()), ec);
+
+	return ec ? std::filesystem::file_time_type::min() : time;
 }
 
 
-bool Wad_file::ReadDirectory(FILE *fp, int total_size)
+bool Wad_file::ReadDirectory(FILE *fp, int total_size, const std::shared_ptr<MappedFile> &mapping)
 {
 	rewind(fp);
 
@@ -551,6 +703,9 @@ bool Wad_file::ReadDirectory(FILE *fp, int total_size)
 
 	directory.reserve(dir_count);
 
+	disk = DiskLayout();
+	disk.used.reserve(dir_count + 1);
+
 	for (int _ = 0 ; _ < dir_count ; _++)
 	{
 		raw_wad_entry_t entry;
@@ -584,6 +739,14 @@ bool Wad_file::ReadDirectory(FILE *fp, int total_size)
 			}
 
 			if(l_length > 0)
+				disk.used.emplace_back(l_start, l_length);
+
+			if(l_length > 0 && mapping)
+			{
+				lump->MapTo(mapping, l_start, l_length);
+				lump->mDiskOffset = l_start;
+			}
+			else if(l_length > 0)
 			{
 				long curpos = ftell(fp);
 				if(curpos < 0)
@@ -605,6 +768,7 @@ bool Wad_file::ReadDirectory(FILE *fp, int total_size)
 					return false;
 				}
 				lump->Seek();	// reset the insertion point
+				lump->mDiskOffset = l_start;
 				if(fseek(fp, curpos, SEEK_SET) < 0)
 				{
 					gLog.printf("%s: fseek back failed with error %d\n",
@@ -618,6 +782,15 @@ bool Wad_file::ReadDirectory(FILE *fp, int total_size)
 		lumpRef.lump.reset(lump);
 		directory.push_back(std::move(lumpRef));
 	}
+
+	if (dir_count > 0)
+		disk.used.emplace_back(dir_start, dir_count * (int)sizeof(raw_wad_entry_t));
+
+	disk.size = total_size;
+	disk.num_lumps = dir_count;
+	disk.dir_start = dir_start;
+	disk.time = W_FileTime(filename);
+
 	return true;
 }
 
@@ -783,6 +956,8 @@ void Wad_file::ProcessNamespaces()
 
 	if (active != WadNamespace::Global)
 		gLog.printf("WARNING: Missing %s_END marker (at EOF)\n", WadNamespaceString(active));
+
+	DirectoryChanged();
 }
 
 
@@ -790,6 +965,49 @@ void Wad_file::ProcessNamespaces()
 //  WAD Writing Interface
 //------------------------------------------------------------------------
 
+//
+// Returns the parts of the file (after the header) which none of the
+// given regions cover, in order.
+//
+static std::vector<std::pair<int, int>> W_FreeRegions(std::vector<std::pair<int, int>> used, int size)
+{
+	std::sort(used.begin(), used.end());
+
+	std::vector<std::pair<int, int>> result;
+
+	int pos = (int)sizeof(raw_wad_header_t);
+
+	for (const std::pair<int, int> &region : used)
+	{
+		if (region.first > pos)
+			result.emplace_back(pos, region.first - pos);
+
+		pos = std::max(pos, region.first + region.second);
+	}
+
+	if (size > pos)
+		result.emplace_back(pos, size - pos);
+
+	return result;
+}
+
+
+//
+// Makes sure what has been written so far is really on the disk
+//
+static bool W_SyncFile(FILE *fp)
+{
+	if (fflush(fp) != 0)
+		return false;
+
+#ifdef _WIN32
+	return _commit(_fileno(fp)) == 0;
+#else
+	return fsync(fileno(fp)) == 0;
+#endif
+}
+
+
 //
 // Writes the content to disk now
 //
@@ -801,14 +1019,260 @@ void Wad_file::writeToDisk() noexcept(false)
 					   filename.c_str());
 	}
 
-	// Write to our path now
-	writeToPath(filename);
+	if (! writeInPlace())
+		rewriteToDisk();
 
 	// reset the insertion point
 	insert_point = -1;
 }
 
 
+void Wad_file::compactToDisk() noexcept(false)
+{
+	if(IsReadOnly())
+	{
+		ThrowException("Cannot overwrite a read-only file (%s)!",
+					   filename.c_str());
+	}
+
+	rewriteToDisk();
+
+	insert_point = -1;
+}
+
+
+int Wad_file::wastedSpace() const noexcept
+{
+	int total = 0;
+
+	for (const std::pair<int, int> &region : W_FreeRegions(disk.used, disk.size))
+		total += region.second;
+
+	return total;
+}
+
+
+void Wad_file::rewriteToDisk() noexcept(false)
+{
+	// Write to our path now
+	writeToPath(filename);
+
+	// writeToPath() puts the lumps one after another
+	std::vector<int> offsets;
+	offsets.reserve(directory.size());
+
+	int offset = (int)sizeof(raw_wad_header_t);
+
+	for(const LumpRef &ref : directory)
+	{
+		offsets.push_back(offset);
+		offset += ref.lump->Length();
+	}
+
+	RecordLayout(offsets, offset, offset + NumLumps() * (int)sizeof(raw_wad_entry_t));
+}
+
+
+//
+// The lumps which did not change since the file was read or written
+// are left where they are.  The others go into the smallest free region
+// which fits, or at the end, followed by the new directory.  Only when
+// all that has reached the disk, the header is changed to point at the
+// new directory, so a crash at any point leaves a valid file behind.
+//
+bool Wad_file::writeInPlace() noexcept(false)
+{
+	if (disk.size <= 0)
+		return false;
+
+	// when none of the lumps on disk can stay, a new file is smaller
+	bool keeps_any = false;
+
+	for (const LumpRef &ref : directory)
+		if (ref.lump->Length() > 0 && ref.lump->mDiskOffset >= 0)
+			keeps_any = true;
+
+	if (! keeps_any)
+		return false;
+
+	// TODO: #55 unicode
+	FILE *fp = fopen(filename.c_str(), "r+b");
+
+	if (! fp)
+		return false;
+
+	// make sure the file is still the one we know.  One rewritten by
+	// something else at the same size only differs in its time.
+	raw_wad_header_t header;
+
+	if (W_FileTime(filename) != disk.time ||
+		fseek(fp, 0, SEEK_END) != 0 || ftell(fp) != disk.size ||
+		fseek(fp, 0, SEEK_SET) != 0 || fread(&header, sizeof(header), 1, fp) != 1 ||
+		LE_S32(header.num_entries) != disk.num_lumps ||
+		LE_S32(header.dir_start) != disk.dir_start)
+	{
+		gLog.printf("WAD file %s was changed by something else, writing it again.\n",
+					filename.c_str());
+		fclose(fp);
+		return false;
+	}
+
+	std::vector<std::pair<int, int>> holes = W_FreeRegions(disk.used, disk.size);
+
+	// new stuff is added where the last used region ends
+	int end = disk.size;
+
+	if (! holes.empty() && holes.back().first + holes.back().second == disk.size)
+	{
+		end = holes.back().first;
+		holes.pop_back();
+	}
+
+	auto allocate = [&holes, &end](int length)
+	{
+		int best = -1;
+
+		for (int i = 0 ; i < (int)holes.size() ; i++)
+			if (holes[i].second >= length && (best < 0 || holes[i].second < holes[best].second))
+				best = i;
+
+		if (best < 0)
+		{
+			int offset = end;
+			end += length;
+			return offset;
+		}
+
+		int offset = holes[best].first;
+
+		holes[best].first  += length;
+		holes[best].second -= length;
+
+		return offset;
+	};
+
+	std::vector<int> offsets(directory.size(), 0);
+	std::vector<int> changed;
+
+	for (int k = 0 ; k < NumLumps() ; k++)
+	{
+		const Lump_c *lump = directory[k].lump.get();
+
+		if (lump->Length() == 0)
+			continue;
+
+		if (lump->mDiskOffset >= 0)
+			offsets[k] = lump->mDiskOffset;
+		else
+			changed.push_back(k);
+	}
+
+	// placing the biggest lumps first wastes less of the holes
+	std::stable_sort(changed.begin(), changed.end(), [this](int A, int B)
+	{
+		return directory[A].lump->Length() > directory[B].lump->Length();
+	});
+
+	int written = 0;
+
+	for (int k : changed)
+	{
+		offsets[k] = allocate(directory[k].lump->Length());
+		written += directory[k].lump->Length();
+	}
+
+	std::vector<raw_wad_entry_t> entries(directory.size());
+
+	for (int k = 0 ; k < NumLumps() ; k++)
+	{
+		const Lump_c *lump = directory[k].lump.get();
+
+		entries[k].pos  = LE_U32((uint32_t)offsets[k]);
+		entries[k].size = LE_U32((uint32_t)lump->Length());
+
+		int64_t name = lump->getName8();
+		memcpy(entries[k].name, &name, 8);
+	}
+
+	int dir_size  = NumLumps() * (int)sizeof(raw_wad_entry_t);
+	int dir_start = dir_size > 0 ? allocate(dir_size) : disk.dir_start;
+
+	auto write_at = [fp](int offset, const void *data, int length)
+	{
+		return fseek(fp, offset, SEEK_SET) == 0 &&
+			   fwrite(data, 1, length, fp) == (size_t)length;
+	};
+
+	bool ok = true;
+
+	for (int k : changed)
+	{
+		const Lump_c *lump = directory[k].lump.get();
+
+		if (ok)
+			ok = write_at(offsets[k], lump->getData(), lump->Length());
+	}
+
+	if (ok && dir_size > 0)
+		ok = write_at(dir_start, entries.data(), dir_size);
+
+	// everything the new header points at must be on disk before it
+	ok = ok && W_SyncFile(fp);
+
+	if (ok)
+	{
+		memcpy(header.ident, kind == WadKind::IWAD ? "IWAD" : "PWAD", 4);
+
+		header.num_entries = LE_U32((uint32_t)NumLumps());
+		header.dir_start   = LE_U32((uint32_t)dir_start);
+
+		ok = write_at(0, &header, (int)sizeof(header)) && W_SyncFile(fp);
+	}
+
+	int error = errno;
+
+	fclose(fp);
+
+	if (! ok)
+	{
+		throw WadWriteException(SString::printf("Failed writing WAD to file '%s': %s",
+			filename.c_str(), GetErrorMessage(error).c_str()));
+	}
+
+	gLog.printf("Wrote %d changed lumps (%d bytes) into %s\n", (int)changed.size(), written,
+				filename.c_str());
+
+	RecordLayout(offsets, dir_start, std::max(end, disk.size));
+
+	return true;
+}
+
+
+void Wad_file::RecordLayout(const std::vector<int> &offsets, int dir_start, int size)
+{
+	disk = DiskLayout();
+
+	disk.size = size;
+	disk.num_lumps = NumLumps();
+	disk.dir_start = dir_start;
+	disk.time = W_FileTime(filename);
+
+	for (int k = 0 ; k < NumLumps() ; k++)
+		if (directory[k].lump->Length() > 0)
+			disk.used.emplace_back(offsets[k], directory[k].lump->Length());
+
+	if (NumLumps() > 0)
+		disk.used.emplace_back(dir_start, NumLumps() * (int)sizeof(raw_wad_entry_t));
+
+	for (int k = 0 ; k < NumLumps() ; k++)
+	{
+		Lump_c *lump = directory[k].lump.get();
+
+		lump->mDiskOffset = lump->Length() > 0 ? offsets[k] : -1;
+	}
+}
+
+
 void Wad_file::RenameLump(int index, const char *new_name)
 {
 	SYS_ASSERT(0 <= index && index < NumLumps());
@@ -817,6 +1281,8 @@ void Wad_file::RenameLump(int index, const char *new_name)
 	SYS_ASSERT(lump);
 
 	lump->Rename(new_name);
+
+	DirectoryChanged();
 }
 
 
@@ -1050,19 +1516,62 @@ bool Wad_file::Backup(const char *new_filename)
 //------------------------------------------------------------------------
 
 //
-// find a lump in any loaded wad (later ones tried first),
-// returning NULL if not found.
+// brings the index of every loaded wad up to date.  Each wad has
+// a new generation after any change, so comparing them is enough
+// to tell whether the index is stale.
 //
-Lump_c *MasterDir::W_FindGlobalLump(const SString &name) const
+void MasterDir::UpdateIndex() const
 {
-	for (int i = (int)dir.size()-1 ; i >= 0 ; i--)
+	bool stale = indexed_wads.size() != dir.size();
+
+	for (size_t i = 0 ; ! stale && i < dir.size() ; i++)
 	{
-		Lump_c *L = dir[i]->FindLumpInNamespace(name, WadNamespace::Global);
-		if (L)
-			return L;
+		stale = indexed_wads[i].first != dir[i].get() ||
+				indexed_wads[i].second != dir[i]->Generation();
 	}
 
-	return NULL;  // not found
+	if (! stale)
+		return;
+
+	index.clear();
+	indexed_wads.clear();
+
+	// later wads replace the lumps of earlier ones
+	for (const std::shared_ptr<Wad_file> &wad : dir)
+	{
+		for (const auto &entry : wad->NamespaceIndex())
+			index[entry.first] = wad->GetLump(entry.second);
+
+		indexed_wads.emplace_back(wad.get(), wad->Generation());
+	}
+}
+
+
+Lump_c *MasterDir::FindLump(const SString &name, WadNamespace ns) const
+{
+	int64_t key;
+
+	if (! W_PackLumpName(name, key))
+		return NULL;
+
+	UpdateIndex();
+
+	auto it = index.find(LumpKey{ key, ns });
+
+	if (it == index.end())
+		return NULL;  // not found
+
+	return it->second;
+}
+
+
+//
+// find a lump in any loaded wad (later ones tried first),
+// returning NULL if not found.
+//
+Lump_c *MasterDir::W_FindGlobalLump(const SString &name) const
+{
+	return FindLump(name, WadNamespace::Global);
 }
 
 //
@@ -1071,14 +1580,7 @@ Lump_c *MasterDir::W_FindGlobalLump(const SString &name) const
 //
 Lump_c *MasterDir::W_FindSpriteLump(const SString &name) const
 {
-	for (int i = (int)dir.size()-1 ; i >= 0 ; i--)
-	{
-		Lump_c *L = dir[i]->FindLumpInNamespace(name, WadNamespace::Sprites);
-		if (L)
-			return L;
-	}
-
-	return NULL;  // not found
+	return FindLump(name, WadNamespace::Sprites);
 }
 
 
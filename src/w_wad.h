@@ -29,8 +29,13 @@
 
 #include "Errors.h"
 #include "main.h"
+#include "MappedFile.h"
 
+#include <atomic>
+#include <filesystem>
 #include <memory>
+#include <mutex>
+#include <unordered_map>
 
 class Wad_file;
 
@@ -71,19 +76,74 @@ public:
 
 const char *WadNamespaceString(WadNamespace ns);
 
+//
+// A lump name and namespace, as used for looking lumps up.  The name
+// is packed like in the wad directory: upper case and padded with
+// zeros to 8 bytes.
+//
+struct LumpKey
+{
+	int64_t name;
+	WadNamespace ns;
+
+	bool operator== (const LumpKey &other) const noexcept
+	{
+		return name == other.name && ns == other.ns;
+	}
+};
+
+struct LumpKeyHash
+{
+	size_t operator() (const LumpKey &key) const noexcept
+	{
+		uint64_t h = ((uint64_t)key.name + (uint64_t)key.ns) * 0x9e3779b97f4a7c15ULL;
+
+		return (size_t)(h ^ (h >> 32));
+	}
+};
+
+// packs a name for looking it up.  Returns false when no lump can
+// have that name (it is longer than 8 characters).
+bool W_PackLumpName(const SString &name, int64_t &packed) noexcept;
+
 class Lump_c
 {
 friend class Wad_file;
 
 private:
 	SString name;
+	int64_t mName8 = 0;	// the packed name
 
 	std::vector<byte> mData;
 	int mPos = 0;	// insertion point for reading or writing
 
+	// a lump which was read from a mapped (read-only) wad file refers
+	// to the mapping, and mData is empty.
+	std::shared_ptr<MappedFile> mMapping;
+	const byte *mMapped = nullptr;
+	int mMappedLength = 0;
+
+	// where the contents are in the file on disk, until they change.
+	// -1 when they are not there.
+	int mDiskOffset = -1;
+
+	// made when first asked for
+	mutable SString mContentHash;
+
 	// constructor is private
 	explicit Lump_c(const SString &_nam);
 
+	void MapTo(const std::shared_ptr<MappedFile> &mapping, int offset, int length);
+
+	// makes a private copy of the data, and forgets where it is on
+	// disk, before it gets changed
+	void Unshare();
+
+	const byte *Bytes() const noexcept
+	{
+		return mMapping ? mMapped : mData.data();
+	}
+
 public:
 	const SString &Name() const noexcept
 	{
@@ -91,7 +151,7 @@ public:
 	}
 	int Length() const
 	{
-		return (int)mData.size();
+		return mMapping ? mMappedLength : (int)mData.size();
 	}
 
 	// do not call this directly, use Wad_file::RenameLump()
@@ -123,8 +183,11 @@ public:
     //
     void clearData()
     {
+        mMapping.reset();
         mData.clear();
         mPos = 0;
+        mDiskOffset = -1;
+        mContentHash.clear();
     }
 
 	//
@@ -132,10 +195,17 @@ public:
 	//
 	const void *getData() const noexcept
 	{
-		return mData.data();
+		return Bytes();
+	}
+
+	int64_t getName8() const noexcept
+	{
+		return mName8;
 	}
 
-	int64_t getName8() const noexcept;
+	// the SHA-256 of the contents (64 hex digits), which tells whether
+	// two lumps are the same.  It is kept until the lump gets changed.
+	const SString &ContentHash() const;
 
 private:
 	// deliberately don't implement these
@@ -170,10 +240,41 @@ private:
 	// when >= 0, the next added lump is placed _before_ this
 	int insert_point = -1;
 
+	// the lookup tables of the directory, made again after it has
+	// changed.  'last_by_name' has the last lump of each name, and
+	// 'first_in_ns' the first one of each name in each namespace.
+	mutable std::mutex index_mutex;
+	mutable std::atomic<bool> index_valid{ false };
+	mutable std::unordered_map<int64_t, int> last_by_name;
+	mutable std::unordered_map<LumpKey, int, LumpKeyHash> first_in_ns;
+
+	// a new number after each change to the directory, which no other
+	// wad ever had.
+	uint64_t generation = 0;
+
+	// what the file on disk holds, as of the last time it was read or
+	// written.  'used' has the (offset, length) of each lump and of the
+	// directory, the rest of the file is free.  'size' is zero when the
+	// file is not known.
+	struct DiskLayout
+	{
+		int size = 0;
+		int num_lumps = 0;
+		int dir_start = 0;
+
+		std::vector<std::pair<int, int>> used;
+
+		// a file changed by something else has another time
+		std::filesystem::file_time_type time;
+	};
+
+	DiskLayout disk;
+
 	// constructor is private
 	Wad_file(const SString &_name, WadOpenMode _mode) :
 	   filename(_name), mode(_mode)
 	{
+		DirectoryChanged();
 	}
 
 public:
@@ -216,11 +317,12 @@ public:
 		return static_cast<int>(directory.size());
 	}
 	Lump_c * GetLump(int index) const noexcept;
-	Lump_c * FindLump(const SString &name) const noexcept;
-	int FindLumpNum(const SString &name) const noexcept;
+	// these (re)build the index of the lump names when it is out of date
+	Lump_c * FindLump(const SString &name) const;
+	int FindLumpNum(const SString &name) const;
 
 	Lump_c * FindLumpInNamespace(const SString &name, WadNamespace group)
-			const noexcept;
+			const;
 
 	int LevelCount() const noexcept
 	{
@@ -245,8 +347,18 @@ public:
 	// returns true if successful, false on error.
 	bool Backup(const char *new_filename);
 
+	// saves the changes.  When the file on disk is the one last read
+	// or written, only the changed lumps and the directory are written
+	// into it, otherwise it is written again.
 	void writeToDisk() noexcept(false);
 
+	// writes the whole file again, dropping the unused space left by
+	// saving in place.
+	void compactToDisk() noexcept(false);
+
+	// bytes in the file on disk which no lump refers to
+	int wastedSpace() const noexcept;
+
 	// change name of a lump (can be a level marker too)
 	void RenameLump(int index, const char *new_name);
 
@@ -288,18 +400,44 @@ public:
 		return directory;
 	}
 
+	// changes whenever lumps are added, removed or renamed
+	uint64_t Generation() const noexcept
+	{
+		return generation;
+	}
+
+	// the first lump of each name in each namespace (as indices)
+	const std::unordered_map<LumpKey, int, LumpKeyHash> &NamespaceIndex() const;
+
 private:
 	static std::shared_ptr<Wad_file> Create(const SString &filename,
 											WadOpenMode mode);
 
-	// read the existing directory.
-	bool ReadDirectory(FILE *fp, int totalSize);
+	// read the existing directory.  With a mapping of the file, the
+	// lumps refer to it instead of being read in, which is only done
+	// for the files which are never written.
+	bool ReadDirectory(FILE *fp, int totalSize, const std::shared_ptr<MappedFile> &mapping);
+
+	// remembers where the lumps (and directory) of the file which has
+	// just been written are.
+	void RecordLayout(const std::vector<int> &offsets, int dir_start, int size);
+
+	// returns false (having written nothing) when the file cannot be
+	// updated in place.
+	bool writeInPlace() noexcept(false);
+
+	void rewriteToDisk() noexcept(false);
 
 	void DetectLevels();
 	void ProcessNamespaces();
 
 	void FixLevelGroup(int index, int num_added, int num_removed);
 
+	void DirectoryChanged() noexcept;
+
+	// makes the lookup tables if they are out of date
+	void UpdateIndex() const;
+
 	void writeToPath(const SString &path) const noexcept(false);
 
 private:
@@ -0,0 +1,114 @@
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#include "Arena.h"
+#include "gtest/gtest.h"
+
+#include <cstdint>
+#include <set>
+
+namespace
+{
+
+struct Thing
+{
+	double x, y;
+	int flags;
+	char name[13];
+};
+
+}	// namespace
+
+TEST(Arena, GivesZeroedAlignedMemory)
+{
+	Arena arena(256);
+
+	std::set<Thing *> seen;
+
+	for (int i = 0 ; i < 100 ; i++)
+	{
+		Thing *T = arena.alloc<Thing>();
+
+		ASSERT_EQ((uintptr_t)T % alignof(std::max_align_t), 0u);
+		ASSERT_EQ(T->x, 0.0);
+		ASSERT_EQ(T->flags, 0);
+		ASSERT_EQ(T->name[12], 0);
+
+		ASSERT_TRUE(seen.insert(T).second);
+
+		// scribble over it, which must not touch the other ones
+		T->x = i;
+		T->flags = -1;
+	}
+
+	int i = 0;
+	for (Thing *T : seen)
+		i += (T->flags == -1);
+
+	ASSERT_EQ(i, 100);
+	ASSERT_GE(arena.bytesUsed(), 100 * sizeof(Thing));
+	ASSERT_GE(arena.bytesReserved(), arena.bytesUsed());
+}
+
+TEST(Arena, BigAllocations)
+{
+	Arena arena(64);
+
+	char *small = static_cast<char *>(arena.alloc(10));
+	char *big   = static_cast<char *>(arena.alloc(1000));
+
+	for (int i = 0 ; i < 1000 ; i++)
+		ASSERT_EQ(big[i], 0);
+
+	big[999] = 'x';
+	small[0] = 'y';
+
+	ASSERT_GE(arena.bytesReserved(), 1064u);
+}
+
+TEST(Arena, TakeAndRelease)
+{
+	Arena a(128);
+	Arena b(128);
+
+	Thing *T = b.alloc<Thing>();
+	T->flags = 42;
+
+	a.alloc(100);
+
+	size_t total = a.bytesReserved() + b.bytesReserved();
+
+	a.take(b);
+
+	ASSERT_EQ(b.bytesReserved(), 0u);
+	ASSERT_EQ(b.bytesUsed(), 0u);
+	ASSERT_EQ(a.bytesReserved(), total);
+
+	// still alive, and both arenas carry on working
+	ASSERT_EQ(T->flags, 42);
+
+	ASSERT_EQ(a.alloc<Thing>()->flags, 0);
+	ASSERT_EQ(b.alloc<Thing>()->flags, 0);
+
+	a.release();
+
+	ASSERT_EQ(a.bytesReserved(), 0u);
+	ASSERT_EQ(a.bytesUsed(), 0u);
+
+	ASSERT_EQ(a.alloc<Thing>()->flags, 0);
+}
@@ -0,0 +1,246 @@
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#include "BackupStore.h"
+#include "w_wad.h"
+#include "testUtils/TempDirContext.hpp"
+#ifdef None	// fix pollution
+#undef None
+#endif
+#include "gtest/gtest.h"
+
+#include <filesystem>
+
+class BackupStoreTest : public TempDirContext
+{
+protected:
+	void SetUp() override
+	{
+		TempDirContext::SetUp();
+
+		mBackupDir = getChildPath("backups");
+		mDeleteList.push(mBackupDir);
+	}
+
+	void TearDown() override
+	{
+		// the directories come before what they hold
+		std::error_code ec;
+
+		for (const auto &entry : std::filesystem::recursive_directory_iterator(mBackupDir.c_str(), ec))
+			mDeleteList.push(entry.path().u8string().c_str());
+
+		TempDirContext::TearDown();
+	}
+
+	std::shared_ptr<Wad_file> makeWad()
+	{
+		auto wad = Wad_file::Open(getChildPath("dummy.wad"), WadOpenMode::write);
+
+		wad->AddLump("MAP01");
+		wad->AddLump("THINGS")->Write(std::vector<uint8_t>(1000, 1).data(), 1000);
+		wad->AddLump("LINEDEFS")->Write(std::vector<uint8_t>(2000, 2).data(), 2000);
+		wad->AddLump("NAME %1")->Printf("odd");
+
+		return wad;
+	}
+
+	int countLumpFiles() const
+	{
+		int count = 0;
+		std::error_code ec;
+
+		for (const auto &entry : std::filesystem::recursive_directory_iterator((mBackupDir + "/lumps").c_str(), ec))
+			if (entry.is_regular_file(ec))
+				count++;
+
+		return count;
+	}
+
+	SString mBackupDir;
+};
+
+
+TEST_F(BackupStoreTest, StoreAndRestore)
+{
+	BackupStore store(mBackupDir);
+
+	ASSERT_TRUE(store.versions().empty());
+
+	auto wad = makeWad();
+
+	ASSERT_EQ(store.store(*wad), 1);
+	ASSERT_EQ(countLumpFiles(), 3);
+
+	// only the changed lump is added
+	wad->GetLump(1)->Printf("more");
+
+	ASSERT_EQ(store.store(*wad), 2);
+	ASSERT_EQ(countLumpFiles(), 4);
+
+	std::vector<BackupStore::Version> versions = store.versions();
+
+	ASSERT_EQ(versions.size(), 2);
+	ASSERT_EQ(versions[0].number, 1);
+	ASSERT_EQ(versions[0].numLumps, 4);
+	ASSERT_EQ(versions[0].wadSize, 12 + 3003 + 4 * 16);
+	ASSERT_EQ(versions[1].number, 2);
+	ASSERT_EQ(versions[1].wadSize, 12 + 3007 + 4 * 16);
+
+	SString path = getChildPath("restored.wad");
+
+	ASSERT_TRUE(store.restore(1, path).success);
+	mDeleteList.push(path);
+
+	auto read = Wad_file::Open(path, WadOpenMode::read);
+	ASSERT_TRUE(read);
+	ASSERT_EQ(read->NumLumps(), 4);
+	ASSERT_EQ(read->GetLump(0)->Name(), "MAP01");
+	ASSERT_EQ(read->GetLump(0)->Length(), 0);
+	ASSERT_EQ(read->GetLump(1)->Length(), 1000);
+	ASSERT_EQ(read->GetLump(1)->ContentHash(), makeWad()->GetLump(1)->ContentHash());
+	ASSERT_EQ(read->GetLump(2)->Length(), 2000);
+	ASSERT_EQ(read->GetLump(3)->Name(), "NAME %1");
+	ASSERT_FALSE(memcmp(read->GetLump(3)->getData(), "odd", 3));
+	read.reset();
+
+	ASSERT_TRUE(store.restore(2, path).success);
+
+	read = Wad_file::Open(path, WadOpenMode::read);
+	ASSERT_TRUE(read);
+	ASSERT_EQ(read->GetLump(1)->Length(), 1004);
+	ASSERT_EQ(read->GetLump(1)->ContentHash(), wad->GetLump(1)->ContentHash());
+
+	ASSERT_FALSE(store.restore(3, path).success);
+}
+
+
+TEST_F(BackupStoreTest, PruneByRealSize)
+{
+	BackupStore store(mBackupDir);
+
+	auto wad = makeWad();
+
+	// each version adds 1000 bytes, the rest is shared
+	for (int i = 0 ; i < 6 ; i++)
+	{
+		wad->GetLump(1)->Printf("%d", i);
+		ASSERT_EQ(store.store(*wad), i + 1);
+	}
+
+	ASSERT_EQ(countLumpFiles(), 2 + 6);
+
+	// room for the lumps of three versions, and their manifests
+	store.prune(30, 2000 + 3 * 1010 + 3 * 400);
+
+	std::vector<BackupStore::Version> versions = store.versions();
+
+	ASSERT_EQ(versions.size(), 3);
+	ASSERT_EQ(versions[0].number, 4);
+	ASSERT_EQ(countLumpFiles(), 2 + 3);
+	ASSERT_LE(store.totalSize(), 2000 + 3 * 1010 + 3 * 400);
+
+	// the kept versions are still whole
+	SString path = getChildPath("restored.wad");
+
+	ASSERT_TRUE(store.restore(4, path).success);
+	mDeleteList.push(path);
+
+	// the count limit, and the two newest always stay
+	store.prune(2, 1);
+
+	versions = store.versions();
+
+	ASSERT_EQ(versions.size(), 2);
+	ASSERT_EQ(versions[0].number, 5);
+	ASSERT_EQ(versions[1].number, 6);
+	ASSERT_EQ(countLumpFiles(), 2 + 2);
+}
+
+
+
+TEST_F(BackupStoreTest, PruneKeepsLumpsOfUnreadableVersion)
+{
+	BackupStore store(mBackupDir);
+
+	auto wad = makeWad();
+
+	for (int i = 0 ; i < 3 ; i++)
+	{
+		wad->GetLump(1)->Printf("%d", i);
+		ASSERT_EQ(store.store(*wad), i + 1);
+	}
+
+	ASSERT_EQ(countLumpFiles(), 2 + 3);
+
+	// the newest manifest gets damaged
+	FILE *fp = fopen((mBackupDir + "/3.manifest").c_str(), "wb");
+	ASSERT_NE(fp, nullptr);
+	ASSERT_GE(fputs("garbage\n", fp), 0);
+	ASSERT_EQ(fclose(fp), 0);
+
+	store.prune(2, 1 << 20);
+
+	std::error_code ec;
+
+	ASSERT_FALSE(std::filesystem::exists((mBackupDir + "/1.manifest").c_str(), ec));
+	ASSERT_TRUE(std::filesystem::exists((mBackupDir + "/2.manifest").c_str(), ec));
+	ASSERT_TRUE(std::filesystem::exists((mBackupDir + "/3.manifest").c_str(), ec));
+
+	// its lumps are not known, so they all stay
+	ASSERT_EQ(countLumpFiles(), 2 + 3);
+}
+
+TEST_F(BackupStoreTest, OldCopies)
+{
+	BackupStore store(mBackupDir);
+
+	auto wad = makeWad();
+
+	// a whole copy, as older versions made them
+	ASSERT_TRUE(std::filesystem::create_directories(mBackupDir.c_str()));
+	ASSERT_TRUE(wad->Backup((mBackupDir + "/7.wad").c_str()));
+
+	std::vector<BackupStore::Version> versions = store.versions();
+
+	ASSERT_EQ(versions.size(), 1);
+	ASSERT_EQ(versions[0].number, 7);
+	ASSERT_EQ(versions[0].numLumps, -1);
+	ASSERT_EQ(versions[0].wadSize, 12 + 3003 + 4 * 16);
+
+	ASSERT_EQ(store.store(*wad), 8);
+
+	SString path = getChildPath("restored.wad");
+
+	ASSERT_TRUE(store.restore(7, path).success);
+	mDeleteList.push(path);
+
+	auto read = Wad_file::Open(path, WadOpenMode::read);
+	ASSERT_TRUE(read);
+	ASSERT_EQ(read->NumLumps(), 4);
+	ASSERT_EQ(read->GetLump(2)->ContentHash(), wad->GetLump(2)->ContentHash());
+	read.reset();
+
+	// pruned like the others
+	store.prune(1, 1 << 20);
+
+	versions = store.versions();
+
+	ASSERT_EQ(versions.size(), 1);
+	ASSERT_EQ(versions[0].number, 8);
+}
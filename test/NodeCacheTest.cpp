@@ -0,0 +1,165 @@
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#include "NodeCache.h"
+#include "testUtils/TempDirContext.hpp"
+#include "gtest/gtest.h"
+
+#include <filesystem>
+
+class NodeCacheTest : public TempDirContext
+{
+protected:
+	void SetUp() override
+	{
+		TempDirContext::SetUp();
+
+		mCacheDir = getChildPath("nodes");
+		mDeleteList.push(mCacheDir);
+	}
+
+	void TearDown() override
+	{
+		// whatever entries are left, the eviction decides which
+		std::error_code ec;
+
+		for (const auto &entry : std::filesystem::directory_iterator(mCacheDir.c_str(), ec))
+			mDeleteList.push(entry.path().u8string().c_str());
+
+		TempDirContext::TearDown();
+	}
+
+	static std::vector<NodeCache::Lump> makeLumps(int size, uint8_t fill)
+	{
+		std::vector<NodeCache::Lump> lumps(3);
+
+		lumps[0].name = "SEGS";
+		lumps[0].data.assign(size, fill);
+
+		lumps[1].name = "GL_MAP01";
+
+		lumps[2].name = "GL_NODES";
+		lumps[2].data.assign(size / 2, (uint8_t)(fill + 1));
+
+		return lumps;
+	}
+
+	SString mCacheDir;
+};
+
+
+TEST(NodeCacheKey, DependsOnEverything)
+{
+	NodeCacheKey a, b, c, d;
+
+	a.addString("MAP01");
+	a.addInt(7);
+
+	b.addString("MAP01");
+	b.addInt(8);
+
+	c.addString("MAP0");
+	c.addString("1");
+	c.addInt(7);
+
+	d.addString("MAP01");
+	d.addInt(7);
+
+	ASSERT_EQ(a.hex().length(), 64);
+	ASSERT_EQ(a.hex(), d.hex());
+	ASSERT_NE(a.hex(), b.hex());
+	ASSERT_NE(a.hex(), c.hex());
+}
+
+
+TEST_F(NodeCacheTest, StoreAndLoad)
+{
+	NodeCache cache(mCacheDir, 1 << 20);
+
+	std::vector<NodeCache::Lump> lumps;
+
+	ASSERT_FALSE(cache.load("0123", lumps));
+
+	ASSERT_TRUE(cache.store("0123", makeLumps(1000, 5)));
+	ASSERT_TRUE(cache.load("0123", lumps));
+
+	ASSERT_EQ(lumps.size(), 3);
+	ASSERT_EQ(lumps[0].name, "SEGS");
+	ASSERT_EQ(lumps[0].data, std::vector<uint8_t>(1000, 5));
+	ASSERT_EQ(lumps[1].name, "GL_MAP01");
+	ASSERT_TRUE(lumps[1].data.empty());
+	ASSERT_EQ(lumps[2].name, "GL_NODES");
+	ASSERT_EQ(lumps[2].data, std::vector<uint8_t>(500, 6));
+
+	ASSERT_GT(cache.totalSize(), 1500);
+}
+
+
+TEST_F(NodeCacheTest, DamagedEntryIsAMiss)
+{
+	NodeCache cache(mCacheDir, 1 << 20);
+
+	ASSERT_TRUE(cache.store("abcd", makeLumps(100, 1)));
+
+	SString path = mCacheDir + "/abcd.nodes";
+
+	FILE *fp = fopen(path.c_str(), "r+b");
+	ASSERT_NE(fp, nullptr);
+	ASSERT_EQ(fseek(fp, 40, SEEK_SET), 0);
+	ASSERT_NE(fputc(0xEE, fp), EOF);
+	ASSERT_EQ(fclose(fp), 0);
+
+	std::vector<NodeCache::Lump> lumps;
+
+	ASSERT_FALSE(cache.load("abcd", lumps));
+	ASSERT_TRUE(lumps.empty());
+}
+
+
+TEST_F(NodeCacheTest, OldestEntriesAreEvicted)
+{
+	// room for about three entries
+	NodeCache cache(mCacheDir, 3 * 1600);
+
+	ASSERT_TRUE(cache.store("aaaa", makeLumps(1000, 1)));
+	ASSERT_TRUE(cache.store("bbbb", makeLumps(1000, 2)));
+	ASSERT_TRUE(cache.store("cccc", makeLumps(1000, 3)));
+
+	// make the times distinct, then use the first entry again
+	using clock = std::filesystem::file_time_type::clock;
+
+	std::filesystem::last_write_time((mCacheDir + "/aaaa.nodes").c_str(), clock::now() - std::chrono::hours(3));
+	std::filesystem::last_write_time((mCacheDir + "/bbbb.nodes").c_str(), clock::now() - std::chrono::hours(2));
+	std::filesystem::last_write_time((mCacheDir + "/cccc.nodes").c_str(), clock::now() - std::chrono::hours(1));
+
+	std::vector<NodeCache::Lump> lumps;
+	ASSERT_TRUE(cache.load("aaaa", lumps));
+
+	ASSERT_TRUE(cache.store("dddd", makeLumps(1000, 4)));
+
+	ASSERT_TRUE(cache.load("aaaa", lumps));
+	ASSERT_FALSE(cache.load("bbbb", lumps));
+	ASSERT_TRUE(cache.load("cccc", lumps));
+	ASSERT_TRUE(cache.load("dddd", lumps));
+
+	ASSERT_LE(cache.totalSize(), 3 * 1600);
+
+	// an entry bigger than the whole cache is not kept
+	ASSERT_FALSE(cache.store("eeee", makeLumps(5000, 5)));
+	ASSERT_FALSE(cache.load("eeee", lumps));
+}
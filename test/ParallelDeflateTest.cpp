@@ -0,0 +1,101 @@
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#include "ParallelDeflate.h"
+#include "TaskPool.h"
+#include "gtest/gtest.h"
+
+#include <random>
+
+#include <zlib.h>
+
+namespace
+{
+
+// something like node data: small numbers with a lot of repetition
+std::vector<uint8_t> makeData(size_t length, unsigned seed)
+{
+	std::mt19937 rng(seed);
+	std::uniform_int_distribution<int> value(0, 40);
+
+	std::vector<uint8_t> data(length);
+
+	for (size_t i = 0 ; i < length ; i++)
+		data[i] = (i % 7 == 0) ? (uint8_t)value(rng) : (uint8_t)(i / 64);
+
+	return data;
+}
+
+std::vector<uint8_t> unpack(const std::vector<uint8_t> &packed, size_t length)
+{
+	std::vector<uint8_t> result(length + 1);
+
+	uLongf result_len = (uLongf)result.size();
+
+	int err = uncompress(result.data(), &result_len, packed.data(), (uLong)packed.size());
+
+	EXPECT_EQ(err, Z_OK);
+
+	result.resize(result_len);
+	return result;
+}
+
+}	// namespace
+
+
+TEST(ParallelDeflate, SingleChunkIsSameAsCompress2)
+{
+	TaskPool pool(2);
+
+	std::vector<uint8_t> data = makeData(50000, 1);
+
+	for (int level : { 1, 6, 9 })
+	{
+		std::vector<uint8_t> expect(compressBound((uLong)data.size()));
+
+		uLongf expect_len = (uLongf)expect.size();
+
+		ASSERT_EQ(compress2(expect.data(), &expect_len, data.data(), (uLong)data.size(), level), Z_OK);
+
+		expect.resize(expect_len);
+
+		ASSERT_EQ(ParallelDeflate(data.data(), data.size(), level, pool), expect);
+	}
+}
+
+
+TEST(ParallelDeflate, ChunksMakeOneStream)
+{
+	TaskPool pool(3);
+
+	for (size_t length : { (size_t)0, (size_t)1, (size_t)4096, (size_t)70001, (size_t)1000000 })
+	{
+		std::vector<uint8_t> data = makeData(length, 2);
+
+		std::vector<uint8_t> packed = ParallelDeflate(data.data(), data.size(), 6, pool, 4096);
+
+		ASSERT_EQ(unpack(packed, length), data);
+
+		// priming each chunk keeps it about as good as zlib alone
+		uLongf whole_len = compressBound((uLong)length);
+		std::vector<uint8_t> whole(whole_len);
+
+		ASSERT_EQ(compress2(whole.data(), &whole_len, data.data(), (uLong)length, 6), Z_OK);
+		ASSERT_LT(packed.size(), whole_len + whole_len / 10 + 64);
+	}
+}
@@ -0,0 +1,361 @@
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#include "RejectBuilder.h"
+#include "TaskPool.h"
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <random>
+
+namespace
+{
+
+struct Segment
+{
+	double x1, y1, x2, y2;
+};
+
+//
+// A grid of rooms, each one its own sector.  The corners are moved
+// about a bit, some cells are void, and the edges between rooms are
+// split into pieces which are either open (two-sided) or solid walls.
+//
+class GridMap
+{
+public:
+	static const int CELL = 64;
+
+	GridMap(int _width, int _height) : width(_width), height(_height),
+		present(_width * _height, true),
+		corners((_width + 1) * (_height + 1))
+	{
+		for (int x = 0 ; x <= width ; x++)
+			for (int y = 0 ; y <= height ; y++)
+				corners[y * (width + 1) + x] = { (double)(x * CELL), (double)(y * CELL) };
+	}
+
+	void makeRandom(std::mt19937 &rng, double void_chance, double open_chance, double jitter)
+	{
+		std::uniform_real_distribution<double> chance(0.0, 1.0);
+		std::uniform_real_distribution<double> offset(-jitter, jitter);
+
+		for (size_t i = 0 ; i < present.size() ; i++)
+			present[i] = chance(rng) >= void_chance;
+
+		for (Point &P : corners)
+		{
+			P.x += offset(rng);
+			P.y += offset(rng);
+		}
+
+		for (int x = 0 ; x <= width ; x++)
+		for (int y = 0 ; y <= height ; y++)
+		{
+			// vertical edge on the left of cell (x, y)
+			if (y < height)
+				addEdge(rng, x, y, x - 1, y, corner(x, y), corner(x, y + 1), open_chance);
+
+			// horizontal edge below cell (x, y)
+			if (x < width)
+				addEdge(rng, x, y, x, y - 1, corner(x + 1, y), corner(x, y), open_chance);
+		}
+	}
+
+	struct Point
+	{
+		double x, y;
+	};
+
+	Point corner(int x, int y) const
+	{
+		return corners[y * (width + 1) + x];
+	}
+
+	// a point inside a cell, 'u' and 'v' are between 0 and 1
+	Point spot(int x, int y, double u, double v) const
+	{
+		Point A = corner(x, y),     B = corner(x + 1, y);
+		Point C = corner(x, y + 1), D = corner(x + 1, y + 1);
+
+		return { (A.x * (1 - u) + B.x * u) * (1 - v) + (C.x * (1 - u) + D.x * u) * v,
+				 (A.y * (1 - u) + B.y * u) * (1 - v) + (C.y * (1 - u) + D.y * u) * v };
+	}
+
+	// the edge goes from P1 to P2, with cell A on its right
+	void addEdge(std::mt19937 &rng, int ax, int ay, int bx, int by,
+				 Point P1, Point P2, double open_chance)
+	{
+		std::uniform_real_distribution<double> chance(0.0, 1.0);
+
+		int A = sector(ax, ay);
+		int B = sector(bx, by);
+
+		// split the edge into up to three pieces
+		std::vector<double> cuts = { 0, 1 };
+
+		for (int k = (int)(chance(rng) * 3) ; k > 0 ; k--)
+			cuts.push_back(chance(rng));
+
+		std::sort(cuts.begin(), cuts.end());
+
+		for (size_t k = 0 ; k + 1 < cuts.size() ; k++)
+		{
+			double t1 = cuts[k];
+			double t2 = cuts[k + 1];
+
+			Segment seg = { P1.x + (P2.x - P1.x) * t1, P1.y + (P2.y - P1.y) * t1,
+							P1.x + (P2.x - P1.x) * t2, P1.y + (P2.y - P1.y) * t2 };
+
+			if (A >= 0 && B >= 0 && chance(rng) < open_chance)
+				portals.push_back({ seg, A, B });
+			else
+				walls.push_back(seg);
+		}
+	}
+
+	int sector(int x, int y) const
+	{
+		if (x < 0 || y < 0 || x >= width || y >= height)
+			return -1;
+
+		if (! present[y * width + x])
+			return -1;
+
+		return y * width + x;
+	}
+
+	int numSectors() const
+	{
+		return width * height;
+	}
+
+	void fill(RejectBuilder &rb) const
+	{
+		for (const Portal &P : portals)
+			rb.addPortal(P.seg.x1, P.seg.y1, P.seg.x2, P.seg.y2, P.front, P.back);
+	}
+
+	bool blocked(const Point &P1, const Point &P2) const
+	{
+		for (const Segment &W : walls)
+			if (crosses(P1.x, P1.y, P2.x, P2.y, W))
+				return true;
+
+		return false;
+	}
+
+	int width, height;
+
+	std::vector<bool> present;
+	std::vector<Point> corners;
+
+	struct Portal
+	{
+		Segment seg;
+		int front, back;
+	};
+
+	std::vector<Portal> portals;
+	std::vector<Segment> walls;
+
+private:
+	static double side(double x, double y, double x1, double y1, double x2, double y2)
+	{
+		return (x - x1) * (y2 - y1) - (y - y1) * (x2 - x1);
+	}
+
+	static bool crosses(double x1, double y1, double x2, double y2, const Segment &W)
+	{
+		double a = side(W.x1, W.y1, x1, y1, x2, y2);
+		double b = side(W.x2, W.y2, x1, y1, x2, y2);
+		double c = side(x1, y1, W.x1, W.y1, W.x2, W.y2);
+		double d = side(x2, y2, W.x1, W.y1, W.x2, W.y2);
+
+		return (a * b <= 0) && (c * d <= 0);
+	}
+};
+
+}	// namespace
+
+
+//
+// Shoot random sight lines between random spots, none which gets
+// through may connect two sectors which are said to be hidden.
+//
+TEST(RejectBuilder, NeverHidesVisibleSectors)
+{
+	TaskPool pool(2);
+
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<double> coord(0.01, 0.99);
+
+	for (int round = 0 ; round < 8 ; round++)
+	{
+		GridMap map(10 + round, 8 + round);
+		map.makeRandom(rng, 0.15, 0.3 + round * 0.08, (round & 1) ? 20.0 : 0.0);
+
+		RejectBuilder rb(map.numSectors());
+		map.fill(rb);
+
+		ASSERT_TRUE(rb.build(pool, 1000.0));
+		ASSERT_EQ(rb.numUnfinished(), 0);
+
+		std::uniform_int_distribution<int> pick_x(0, map.width - 1);
+		std::uniform_int_distribution<int> pick_y(0, map.height - 1);
+
+		int num_visible = 0;
+
+		for (int i = 0 ; i < 10000 ; i++)
+		{
+			int cx1 = pick_x(rng), cy1 = pick_y(rng);
+			int cx2 = pick_x(rng), cy2 = pick_y(rng);
+
+			int sec1 = map.sector(cx1, cy1);
+			int sec2 = map.sector(cx2, cy2);
+
+			if (sec1 < 0 || sec2 < 0)
+				continue;
+
+			GridMap::Point P1 = map.spot(cx1, cy1, coord(rng), coord(rng));
+			GridMap::Point P2 = map.spot(cx2, cy2, coord(rng), coord(rng));
+
+			if (map.blocked(P1, P2))
+				continue;
+
+			num_visible++;
+
+			ASSERT_TRUE(rb.canSee(sec1, sec2)) << "round " << round << ": ("
+				<< P1.x << " " << P1.y << ") to (" << P2.x << " " << P2.y << ")";
+		}
+
+		ASSERT_GT(num_visible, 0);
+
+		// it should hide a fair amount of sectors from each other
+		int num_hidden = 0;
+
+		for (int a = 0 ; a < map.numSectors() ; a++)
+			for (int b = 0 ; b < map.numSectors() ; b++)
+				if (map.sector(a % map.width, a / map.width) >= 0 &&
+					map.sector(b % map.width, b / map.width) >= 0 &&
+					! rb.canSee(a, b))
+				{
+					num_hidden++;
+				}
+
+		ASSERT_GT(num_hidden, 0);
+	}
+}
+
+
+TEST(RejectBuilder, CorridorAroundCorner)
+{
+	//   6 7 8
+	//   . . 5
+	//   0 1 2
+	GridMap map(3, 3);
+
+	map.present = { true,  true,  true,
+					false, false, true,
+					true,  true,  true };
+
+	auto open = [&map](int a, int b, double x1, double y1, double x2, double y2)
+	{
+		map.portals.push_back({ { x1, y1, x2, y2 }, a, b });
+	};
+
+	open(0, 1,  64,  64,  64,   0);
+	open(1, 2, 128,  64, 128,   0);
+	open(2, 5, 128,  64, 192,  64);
+	open(5, 8, 128, 128, 192, 128);
+	open(8, 7, 128, 128, 128, 192);
+	open(7, 6,  64, 128,  64, 192);
+
+	RejectBuilder rb(map.numSectors());
+	map.fill(rb);
+
+	TaskPool pool(0);
+	ASSERT_TRUE(rb.build(pool, 1000.0));
+
+	ASSERT_TRUE(rb.canSee(0, 2));
+	ASSERT_TRUE(rb.canSee(0, 5));
+	ASSERT_TRUE(rb.canSee(1, 8));
+	ASSERT_TRUE(rb.canSee(2, 7));
+
+	ASSERT_FALSE(rb.canSee(0, 7));
+	ASSERT_FALSE(rb.canSee(0, 6));
+	ASSERT_FALSE(rb.canSee(6, 1));
+
+	// the void
+	ASSERT_FALSE(rb.canSee(0, 3));
+}
+
+
+TEST(RejectBuilder, SameResultWithAnyThreads)
+{
+	std::mt19937 rng(99);
+
+	GridMap map(16, 16);
+	map.makeRandom(rng, 0.1, 0.6, 20.0);
+
+	RejectBuilder rb1(map.numSectors());
+	RejectBuilder rb2(map.numSectors());
+	map.fill(rb1);
+	map.fill(rb2);
+
+	TaskPool pool1(0);
+	TaskPool pool2(3);
+
+	ASSERT_TRUE(rb1.build(pool1, 1000.0));
+	ASSERT_TRUE(rb2.build(pool2, 1000.0));
+
+	for (int a = 0 ; a < map.numSectors() ; a++)
+		for (int b = 0 ; b < map.numSectors() ; b++)
+			ASSERT_EQ(rb1.canSee(a, b), rb2.canSee(a, b));
+}
+
+
+TEST(RejectBuilder, GivesUpConservatively)
+{
+	std::mt19937 rng(7);
+
+	GridMap map(12, 12);
+	map.makeRandom(rng, 0.0, 0.5, 0.0);
+
+	TaskPool pool(1);
+
+	RejectBuilder rb(map.numSectors());
+	map.fill(rb);
+
+	ASSERT_FALSE(rb.build(pool, 0.0));
+	ASSERT_EQ(rb.numUnfinished(), map.numSectors());
+
+	std::atomic<bool> cancelled(true);
+
+	RejectBuilder rb2(map.numSectors());
+	map.fill(rb2);
+
+	ASSERT_FALSE(rb2.build(pool, 1000.0, &cancelled));
+
+	for (int a = 0 ; a < map.numSectors() ; a++)
+		for (int b = 0 ; b < map.numSectors() ; b++)
+		{
+			ASSERT_TRUE(rb.canSee(a, b));
+			ASSERT_TRUE(rb2.canSee(a, b));
+		}
+}
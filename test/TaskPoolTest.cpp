@@ -0,0 +1,95 @@
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#include "TaskPool.h"
+#include "gtest/gtest.h"
+
+#include <stdexcept>
+
+TEST(TaskPool, RunsAllTasks)
+{
+	for (int workers : { 0, 1, 4 })
+	{
+		TaskPool pool(workers);
+		ASSERT_EQ(pool.numWorkers(), workers);
+
+		std::vector<int> values(1000);
+
+		TaskGroup group(pool);
+		for (int i = 0; i < (int)values.size(); ++i)
+			group.run([&values, i]() { values[i] = i * 2; });
+		group.wait();
+
+		for (int i = 0; i < (int)values.size(); ++i)
+			ASSERT_EQ(values[i], i * 2);
+	}
+}
+
+static int sumRange(TaskPool &pool, int first, int last)
+{
+	if (last - first <= 8)
+	{
+		int sum = 0;
+		for (int i = first; i < last; ++i)
+			sum += i;
+		return sum;
+	}
+
+	int mid = (first + last) / 2;
+	int left = 0;
+	int right = 0;
+
+	TaskGroup group(pool);
+	group.run([&]() { left = sumRange(pool, first, mid); });
+	group.run([&]() { right = sumRange(pool, mid, last); });
+	group.wait();
+
+	return left + right;
+}
+
+TEST(TaskPool, NestedGroups)
+{
+	for (int workers : { 0, 3 })
+	{
+		TaskPool pool(workers);
+		ASSERT_EQ(sumRange(pool, 0, 10000), 10000 * 9999 / 2);
+	}
+}
+
+TEST(TaskPool, RethrowsFirstError)
+{
+	TaskPool pool(2);
+	std::atomic<int> count(0);
+
+	TaskGroup group(pool);
+	for (int i = 0; i < 50; ++i)
+	{
+		group.run([&count, i]()
+		{
+			++count;
+			if (i == 10)
+				throw std::runtime_error("failed");
+		});
+	}
+
+	ASSERT_THROW(group.wait(), std::runtime_error);
+	ASSERT_EQ(count, 50);
+
+	// the error is only reported once
+	group.wait();
+}
@@ -0,0 +1,90 @@
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#include "UnionFind.h"
+#include "gtest/gtest.h"
+
+#include <random>
+
+TEST(UnionFind, StartsApart)
+{
+	UnionFind groups(5);
+
+	ASSERT_EQ(groups.count(), 5);
+	ASSERT_EQ(groups.numGroups(), 5);
+
+	for (int i = 0 ; i < 5 ; i++)
+	{
+		ASSERT_EQ(groups.find(i), i);
+		ASSERT_EQ(groups.groupSize(i), 1);
+	}
+}
+
+TEST(UnionFind, Merge)
+{
+	UnionFind groups(6);
+
+	ASSERT_TRUE(groups.merge(0, 1));
+	ASSERT_TRUE(groups.merge(2, 3));
+	ASSERT_TRUE(groups.merge(1, 3));
+	ASSERT_FALSE(groups.merge(0, 2));
+
+	ASSERT_EQ(groups.numGroups(), 3);
+	ASSERT_EQ(groups.groupSize(3), 4);
+
+	ASSERT_TRUE(groups.connected(0, 3));
+	ASSERT_FALSE(groups.connected(0, 4));
+	ASSERT_FALSE(groups.connected(4, 5));
+}
+
+//
+// Compare against simple relabelling of the whole group on each merge.
+//
+TEST(UnionFind, MatchesRelabelling)
+{
+	const int count = 300;
+
+	std::mt19937 rng(42);
+	std::uniform_int_distribution<int> pick(0, count - 1);
+
+	UnionFind groups(count);
+
+	std::vector<int> label(count);
+
+	for (int i = 0 ; i < count ; i++)
+		label[i] = i;
+
+	for (int step = 0 ; step < 250 ; step++)
+	{
+		int a = pick(rng);
+		int b = pick(rng);
+
+		int old_label = label[b];
+
+		ASSERT_EQ(groups.merge(a, b), label[a] != old_label);
+
+		for (int i = 0 ; i < count ; i++)
+			if (label[i] == old_label)
+				label[i] = label[a];
+
+		int c = pick(rng);
+		int d = pick(rng);
+
+		ASSERT_EQ(groups.connected(c, d), label[c] == label[d]);
+	}
+}
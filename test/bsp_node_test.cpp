@@ -0,0 +1,710 @@
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#include "gtest/gtest.h"
+
+#include "bsp.h"
+#include "Instance.h"
+#include "lib_file.h"
+#include "LineDef.h"
+#include "Sector.h"
+#include "SideDef.h"
+#include "Vertex.h"
+#include "testUtils/GridLevel.hpp"
+
+#include <random>
+#include <stdexcept>
+
+//==============================================================================
+//
+// Mock-ups
+//
+//==============================================================================
+
+void FatalError(EUR_FORMAT_STRING(const char *fmt), ...)
+{
+	throw std::runtime_error(fmt);
+}
+
+void Instance::GB_PrintMsg(EUR_FORMAT_STRING(const char *str), ...) const
+{
+}
+
+bool linetype_t::isPolyObjectSpecial() const
+{
+	return false;
+}
+
+void SectorModule::groupConnectedSectors(UnionFind &groups,
+		const std::function<bool(const LineDef &)> &joins) const
+{
+}
+
+//==============================================================================
+//
+// Tests
+//
+//==============================================================================
+
+using namespace ajbsp;
+
+namespace
+{
+
+class BspNodeTest : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		inst.wad.master.edit_wad = Wad_file::Open("dummy.wad", WadOpenMode::write);
+		inst.wad.master.edit_wad->AddLevel("MAP01");
+	}
+
+	void TearDown() override
+	{
+		// Save() writes the wad out
+		inst.wad.master.edit_wad.reset();
+		FileDelete("dummy.wad");
+	}
+
+	// collect the segs of a subtree
+	static void collectSegs(const child_t &child, std::vector<const seg_t *> &segs)
+	{
+		if (child.subsec)
+		{
+			for (const seg_t *seg = child.subsec->seg_list ; seg ; seg = seg->next)
+				segs.push_back(seg);
+		}
+		else
+		{
+			collectSegs(child.node->r, segs);
+			collectSegs(child.node->l, segs);
+		}
+	}
+
+	// every seg must be on the correct side of each partition above it
+	static void checkTree(const LevelBuilder &builder)
+	{
+		ASSERT_FALSE(builder.lev_nodes.empty());
+
+		for (const node_t *node : builder.lev_nodes)
+		{
+			for (int side = 0 ; side < 2 ; side++)
+			{
+				std::vector<const seg_t *> segs;
+				collectSegs(side ? node->l : node->r, segs);
+
+				ASSERT_FALSE(segs.empty());
+
+				for (const seg_t *seg : segs)
+				{
+					double len = hypot(node->part_x2 - node->part_x1, node->part_y2 - node->part_y1);
+
+					for (const vertex_t *V : { seg->start, seg->end })
+					{
+						double d = ((V->x - node->part_x1) * (node->part_y2 - node->part_y1) -
+									(V->y - node->part_y1) * (node->part_x2 - node->part_x1)) / len;
+
+						// positive is on the right
+						if (side == 0)
+							ASSERT_GT(d, -0.01);
+						else
+							ASSERT_LT(d, 0.01);
+					}
+				}
+			}
+		}
+	}
+
+	Instance inst;
+	nodebuildinfo_t info;
+};
+
+}	// namespace
+
+
+TEST_F(BspNodeTest, UnchangedLevelReusesEverything)
+{
+	GridLevel level(8, 1);
+	level.install(inst.level);
+
+	nodebuildcache_t cache;
+
+	LevelBuilder first(&info, 0, inst);
+	first.cache = &cache;
+
+	ASSERT_EQ(first.Build(), BUILD_OK);
+	ASSERT_EQ(first.partitions_reused, 0);
+	ASSERT_EQ(cache.partitions.size(), first.lev_nodes.size());
+
+	LevelBuilder second(&info, 0, inst);
+	second.cache = &cache;
+
+	ASSERT_EQ(second.Build(), BUILD_OK);
+	checkTree(second);
+
+	// only the subsectors were looked at again
+	ASSERT_EQ(second.partitions_reused, (int)first.lev_nodes.size());
+	ASSERT_EQ(second.partitions_searched, (int)first.lev_subsecs.size());
+
+	ASSERT_EQ(second.lev_nodes.size(),   first.lev_nodes.size());
+	ASSERT_EQ(second.lev_subsecs.size(), first.lev_subsecs.size());
+	ASSERT_EQ(second.lev_segs.size(),    first.lev_segs.size());
+}
+
+
+TEST_F(BspNodeTest, SmallEditRebuildsLittle)
+{
+	GridLevel level(14, 2);
+	level.install(inst.level);
+
+	nodebuildcache_t cache;
+
+	LevelBuilder full(&info, 0, inst);
+	full.cache = &cache;
+
+	ASSERT_EQ(full.Build(), BUILD_OK);
+	checkTree(full);
+
+	int full_searches = full.partitions_searched;
+
+	// move a corner of a pillar, and a corner of a room
+	Vertex &V1 = level.vertices[level.vertices.size() - 7];
+	Vertex &V2 = level.vertices[level.vertices.size() / 4];
+
+	V1.SetRawXY(MapFormat::doom, { V1.x() + 5, V1.y() - 3 });
+	V2.SetRawXY(MapFormat::doom, { V2.x() + 8, V2.y() + 8 });
+
+	LevelBuilder again(&info, 0, inst);
+	again.cache = &cache;
+
+	ASSERT_EQ(again.Build(), BUILD_OK);
+	checkTree(again);
+
+	// the leaves are always checked, but little else
+	int extra_searches = again.partitions_searched - (int)again.lev_subsecs.size();
+
+	ASSERT_GT(again.partitions_reused, (int)full.lev_nodes.size() / 2);
+	ASSERT_LT(extra_searches, (full_searches - (int)full.lev_subsecs.size()) / 10);
+
+	// the tree must be about as good as a fresh one
+	LevelBuilder fresh(&info, 0, inst);
+
+	ASSERT_EQ(fresh.Build(), BUILD_OK);
+
+	ASSERT_LT(again.lev_segs.size(), fresh.lev_segs.size() * 11 / 10);
+}
+
+
+TEST_F(BspNodeTest, CacheNeedsSameOptions)
+{
+	GridLevel level(6, 3);
+	level.install(inst.level);
+
+	nodebuildcache_t cache;
+
+	LevelBuilder first(&info, 0, inst);
+	first.cache = &cache;
+
+	ASSERT_EQ(first.Build(), BUILD_OK);
+
+	info.factor = DEFAULT_FACTOR + 5;
+
+	LevelBuilder second(&info, 0, inst);
+	second.cache = &cache;
+
+	ASSERT_EQ(second.Build(), BUILD_OK);
+	ASSERT_EQ(second.partitions_reused, 0);
+	ASSERT_EQ(cache.factor, DEFAULT_FACTOR + 5);
+}
+
+
+TEST(BspSegBlock, DistancesMatchPerpDist)
+{
+	std::mt19937 rng(4);
+	std::uniform_real_distribution<double> coord(-3000.0, 3000.0);
+
+	const int COUNT = 37;
+
+	vertex_t verts[2 * COUNT + 2] = {};
+	seg_t    segs[COUNT + 1] = {};
+
+	for (vertex_t &V : verts)
+	{
+		V.x = floor(coord(rng)) + ((rng() & 1) ? 0.5 : 0.0);
+		V.y = coord(rng);
+	}
+
+	for (int i = 0 ; i <= COUNT ; i++)
+	{
+		segs[i].start = &verts[2 * i];
+		segs[i].end   = &verts[2 * i + 1];
+		segs[i].next  = (i + 1 < COUNT) ? &segs[i + 1] : NULL;
+		segs[i].Recompute();
+	}
+
+	const seg_t &part = segs[COUNT];
+
+	seg_block_t block;
+	ASSERT_EQ(block.Add(&segs[0]), 0);
+
+	ASSERT_EQ(block.count, COUNT);
+
+	// some segs are closer than this to the partition, most are not
+	double margin = 500 * part.p_length;
+
+	for (int kernel = EVAL_Scalar ; kernel <= BestEvalKernel() ; kernel++)
+	{
+		// odd sizes and offsets, to reach the leftovers
+		for (int first = 0 ; first < COUNT ; first += 5)
+		{
+			int num = std::min(7, COUNT - first);
+
+			double a[7], b[7];
+			unsigned right, left;
+
+			block.Distances((eval_kernel_e)kernel, &part, first, num, margin, a, b, &right, &left);
+
+			for (int k = 0 ; k < num ; k++)
+			{
+				const seg_t &seg = segs[first + k];
+
+				ASSERT_EQ(a[k] / part.p_length, part.PerpDist(seg.psx, seg.psy)) << "kernel " << kernel;
+				ASSERT_EQ(b[k] / part.p_length, part.PerpDist(seg.pex, seg.pey)) << "kernel " << kernel;
+
+				ASSERT_EQ((right >> k) & 1, (a[k] >=  margin && b[k] >=  margin) ? 1u : 0u);
+				ASSERT_EQ((left  >> k) & 1, (a[k] <= -margin && b[k] <= -margin) ? 1u : 0u);
+			}
+
+			ASSERT_EQ(right >> num, 0u);
+			ASSERT_EQ(left  >> num, 0u);
+		}
+	}
+}
+
+
+TEST_F(BspNodeTest, SameTreeWithAnyKernel)
+{
+	GridLevel level(10, 5);
+	level.install(inst.level);
+
+	info.kernel = EVAL_Scalar;
+
+	LevelBuilder scalar(&info, 0, inst);
+	ASSERT_EQ(scalar.Build(), BUILD_OK);
+
+	info.kernel = BestEvalKernel();
+
+	LevelBuilder best(&info, 0, inst);
+	ASSERT_EQ(best.Build(), BUILD_OK);
+
+	ASSERT_EQ(best.lev_nodes.size(), scalar.lev_nodes.size());
+	ASSERT_EQ(best.lev_segs.size(),  scalar.lev_segs.size());
+
+	for (size_t i = 0 ; i < scalar.lev_nodes.size() ; i++)
+	{
+		const node_t *N1 = scalar.lev_nodes[i];
+		const node_t *N2 = best.lev_nodes[i];
+
+		ASSERT_EQ(N1->part_line, N2->part_line);
+		ASSERT_EQ(N1->part_x1, N2->part_x1);
+		ASSERT_EQ(N1->part_y1, N2->part_y1);
+		ASSERT_EQ(N1->part_x2, N2->part_x2);
+		ASSERT_EQ(N1->part_y2, N2->part_y2);
+	}
+}
+
+
+TEST_F(BspNodeTest, BuildCollectsStats)
+{
+	GridLevel level(10, 5);
+	level.install(inst.level);
+
+	LevelBuilder builder(&info, 0, inst);
+	ASSERT_EQ(builder.Build(), BUILD_OK);
+
+	const nodebuildstats_t &stats = builder.stats;
+
+	ASSERT_EQ(stats.level_name, "MAP01");
+	ASSERT_GE(stats.time_tree, 0.0);
+	ASSERT_GE(stats.time_segs, 0.0);
+
+	// every node needs at least one partition to be looked at, and
+	// the grid cannot be divided without splitting some segs.
+	ASSERT_GE(builder.partitions_evaluated, (long long)builder.lev_nodes.size());
+	ASSERT_GT(builder.seg_splits, 0);
+
+	// each split adds a seg (and one more for the partner)
+	ASSERT_LE(builder.seg_splits, (int)builder.lev_segs.size());
+}
+
+
+TEST(BspStats, VanillaLimits)
+{
+	nodebuildstats_t stats;
+
+	stats.segs = 40000;
+	stats.blockmap_size = 32768;
+
+	for (const nodebuildstats_t::limit_t &limit : stats.VanillaLimits())
+	{
+		if (strcmp(limit.name, "segs") == 0)
+			ASSERT_GT(limit.count, limit.limit);
+		else if (strcmp(limit.name, "blockmap") == 0)
+			ASSERT_EQ(limit.count * 2, limit.limit);
+		else
+			ASSERT_EQ(limit.count, 0);
+	}
+}
+
+
+TEST(BspStrategies, FirstOneIsConfigured)
+{
+	nodebuildinfo_t info;
+
+	info.factor = 17;
+
+	ASSERT_EQ(AJBSP_Strategies(&info).size(), 1u);
+
+	info.goal = GOAL_FewestSegs;
+
+	std::vector<nodebuildstrategy_t> list = AJBSP_Strategies(&info);
+
+	ASSERT_GT(list.size(), 3u);
+
+	ASSERT_EQ(list[0].factor, 17);
+	ASSERT_FALSE(list[0].fast);
+	ASSERT_TRUE(list[0].axis_bias);
+
+	// no strategy is tried twice
+	for (size_t i = 0 ; i < list.size() ; i++)
+	for (size_t k = 0 ; k < i ; k++)
+	{
+		ASSERT_FALSE(list[i].factor == list[k].factor &&
+					 list[i].fast == list[k].fast &&
+					 list[i].axis_bias == list[k].axis_bias);
+	}
+
+	std::unique_ptr<nodebuildinfo_t> copy = AJBSP_StrategyInfo(&info, list[1]);
+
+	ASSERT_EQ(copy->factor, list[1].factor);
+	ASSERT_EQ(copy->goal, GOAL_None);
+	ASSERT_FALSE(copy->cancelled);
+}
+
+
+TEST(BspStrategies, BetterTreeFollowsGoal)
+{
+	tree_stats_t few_segs;
+	few_segs.real_segs = 1000;
+	few_segs.all_segs  = 1500;
+	few_segs.height    = 20;
+
+	tree_stats_t shallow;
+	shallow.real_segs = 1100;
+	shallow.all_segs  = 1600;
+	shallow.height    = 14;
+
+	ASSERT_TRUE (BetterTree(few_segs, shallow, GOAL_FewestSegs));
+	ASSERT_FALSE(BetterTree(shallow, few_segs, GOAL_FewestSegs));
+
+	ASSERT_TRUE (BetterTree(shallow, few_segs, GOAL_Shallowest));
+	ASSERT_FALSE(BetterTree(few_segs, shallow, GOAL_Shallowest));
+
+	ASSERT_TRUE (BetterTree(few_segs, shallow, GOAL_Vanilla));
+
+	few_segs.vanilla = false;
+
+	ASSERT_TRUE (BetterTree(shallow, few_segs, GOAL_Vanilla));
+
+	// a tie keeps the earlier one
+	ASSERT_FALSE(BetterTree(shallow, shallow, GOAL_Shallowest));
+	ASSERT_FALSE(BetterTree(shallow, few_segs, GOAL_None));
+}
+
+
+TEST_F(BspNodeTest, BuildStrategiesKeepsTheBest)
+{
+	nodebuildinfo_t base;
+	base.goal = GOAL_FewestSegs;
+
+	std::vector<nodebuildstrategy_t> strategies = AJBSP_Strategies(&base);
+
+	// each strategy needs its own copy of the level
+	std::vector<std::unique_ptr<GridLevel>> levels;
+	std::vector<std::unique_ptr<Instance>> insts;
+	std::vector<std::unique_ptr<nodebuildinfo_t>> infos;
+	std::vector<std::unique_ptr<LevelBuilder>> owners;
+	std::vector<LevelBuilder *> builders;
+
+	for (const nodebuildstrategy_t &strategy : strategies)
+	{
+		levels.push_back(std::make_unique<GridLevel>(9, 6));
+		insts.push_back(std::make_unique<Instance>());
+
+		insts.back()->wad.master = inst.wad.master;
+		levels.back()->install(insts.back()->level);
+
+		infos.push_back(AJBSP_StrategyInfo(&base, strategy));
+		owners.push_back(std::make_unique<LevelBuilder>(infos.back().get(), 0, *insts.back()));
+		builders.push_back(owners.back().get());
+	}
+
+	for (build_goal_e goal : { GOAL_FewestSegs, GOAL_Shallowest })
+	{
+		int best = BuildStrategies(builders, goal, 3600, base.cancelled);
+
+		ASSERT_GE(best, 0);
+
+		checkTree(*builders[best]);
+
+		tree_stats_t chosen = builders[best]->TreeStats();
+
+		for (LevelBuilder *other : builders)
+			ASSERT_FALSE(BetterTree(other->TreeStats(), chosen, goal));
+
+		// the builders are used again for the next goal
+		for (size_t i = 0 ; i < strategies.size() ; i++)
+		{
+			owners[i] = std::make_unique<LevelBuilder>(infos[i].get(), 0, *insts[i]);
+			builders[i] = owners[i].get();
+		}
+	}
+
+	base.cancelled = true;
+
+	ASSERT_EQ(BuildStrategies(builders, GOAL_FewestSegs, 3600, base.cancelled), -1);
+}
+
+
+namespace
+{
+
+//
+// The blockmap made the way the builder did before the bands and the
+// hashing: a list for each block, with the duplicates found by sorting
+// the blocks.  Only the order of the shared lists can differ.
+//
+std::vector<u16_t> SortedBlockmap(const Document &doc)
+{
+	int minx = SHRT_MAX, miny = SHRT_MAX;
+	int maxx = SHRT_MIN, maxy = SHRT_MIN;
+
+	for (const LineDef *L : doc.linedefs)
+	{
+		if (L->IsZeroLength(doc))
+			continue;
+
+		minx = std::min(minx, (int)floor(std::min(L->Start(doc)->x(), L->End(doc)->x())));
+		miny = std::min(miny, (int)floor(std::min(L->Start(doc)->y(), L->End(doc)->y())));
+		maxx = std::max(maxx, (int)ceil(std::max(L->Start(doc)->x(), L->End(doc)->x())));
+		maxy = std::max(maxy, (int)ceil(std::max(L->Start(doc)->y(), L->End(doc)->y())));
+	}
+
+	int block_x = minx - (minx & 0x7);
+	int block_y = miny - (miny & 0x7);
+	int block_w = ((maxx - block_x) / 128) + 1;
+	int block_h = ((maxy - block_y) / 128) + 1;
+	int block_count = block_w * block_h;
+
+	std::vector<std::vector<u16_t>> lists(block_count);
+
+	for (int i = 0 ; i < doc.numLinedefs() ; i++)
+	{
+		const LineDef *L = doc.linedefs[i];
+
+		if (L->IsZeroLength(doc))
+			continue;
+
+		int x1 = (int) L->Start(doc)->x();
+		int y1 = (int) L->Start(doc)->y();
+		int x2 = (int) L->End(doc)->x();
+		int y2 = (int) L->End(doc)->y();
+
+		int bx1 = std::max(0, (std::min(x1,x2) - block_x) / 128);
+		int by1 = std::max(0, (std::min(y1,y2) - block_y) / 128);
+		int bx2 = std::min(block_w - 1, (std::max(x1,x2) - block_x) / 128);
+		int by2 = std::min(block_h - 1, (std::max(y1,y2) - block_y) / 128);
+
+		for (int by = by1 ; by <= by2 ; by++)
+		for (int bx = bx1 ; bx <= bx2 ; bx++)
+		{
+			int bminx = block_x + bx * 128;
+			int bminy = block_y + by * 128;
+
+			if (by1 == by2 || bx1 == bx2 ||
+				CheckLinedefInsideBox(bminx, bminy, bminx + 127, bminy + 127, x1, y1, x2, y2))
+			{
+				lists[by * block_w + bx].push_back((u16_t)i);
+			}
+		}
+	}
+
+	std::vector<int> dups(block_count);
+
+	for (int i = 0 ; i < block_count ; i++)
+		dups[i] = i;
+
+	std::sort(dups.begin(), dups.end(), [&lists](int A, int B)
+	{
+		if (lists[A].size() != lists[B].size())
+			return lists[A].size() < lists[B].size();
+
+		return lists[A] < lists[B];
+	});
+
+	std::vector<u16_t> ptrs(block_count);
+	std::vector<u16_t> data;
+
+	int null_offset = 4 + block_count;
+	int cur_offset  = null_offset + 2;
+
+	for (int i = 0 ; i < block_count ; i++)
+	{
+		const std::vector<u16_t> &list = lists[dups[i]];
+
+		if (list.empty())
+		{
+			ptrs[dups[i]] = (u16_t)null_offset;
+			continue;
+		}
+
+		// only the last of a run of duplicates is written
+		ptrs[dups[i]] = (u16_t)cur_offset;
+
+		if (i + 1 < block_count && lists[dups[i + 1]] == list)
+			continue;
+
+		data.push_back(0);
+		data.insert(data.end(), list.begin(), list.end());
+		data.push_back(0xFFFF);
+
+		cur_offset += 2 + (int)list.size();
+	}
+
+	std::vector<u16_t> lump = { (u16_t)block_x, (u16_t)block_y, (u16_t)block_w, (u16_t)block_h };
+
+	lump.insert(lump.end(), ptrs.begin(), ptrs.end());
+	lump.push_back(0);
+	lump.push_back(0xFFFF);
+	lump.insert(lump.end(), data.begin(), data.end());
+
+	return lump;
+}
+
+// the lines of each block, from a BLOCKMAP lump
+std::vector<std::vector<int>> DecodeBlockmap(const std::vector<u16_t> &lump)
+{
+	int block_count = lump[2] * lump[3];
+
+	std::vector<std::vector<int>> lists(block_count);
+
+	for (int blk_num = 0 ; blk_num < block_count ; blk_num++)
+	{
+		size_t pos = lump[4 + blk_num];
+
+		EXPECT_EQ(lump.at(pos), 0);
+
+		for (pos++ ; lump.at(pos) != 0xFFFF ; pos++)
+			lists[blk_num].push_back(lump[pos]);
+	}
+
+	return lists;
+}
+
+// the lumps which Save() expects the level to have already
+void AddLevelLumps(const Instance &inst)
+{
+	for (const char *name : { "THINGS", "LINEDEFS", "SIDEDEFS", "VERTEXES", "SECTORS" })
+		inst.wad.master.edit_wad->AddLump(name);
+}
+
+std::vector<u16_t> SavedBlockmap(const Instance &inst)
+{
+	const Wad_file *wad = inst.wad.master.edit_wad.get();
+
+	int idx = wad->LevelLookupLump(0, "BLOCKMAP");
+
+	if (idx < 0)
+		return {};
+
+	const Lump_c *lump = wad->GetLump(idx);
+
+	std::vector<u16_t> words(lump->Length() / 2);
+
+	for (size_t i = 0 ; i < words.size() ; i++)
+		words[i] = LE_U16(((const u16_t *)lump->getData())[i]);
+
+	return words;
+}
+
+}	// namespace
+
+
+TEST_F(BspNodeTest, BlockmapMatchesSortedBuilder)
+{
+	// big enough for the blocks to be done in several bands, but
+	// without an overflow
+	GridLevel level(34, 6);
+	level.install(inst.level);
+
+	LevelBuilder builder(&info, 0, inst);
+	ASSERT_EQ(builder.Build(), BUILD_OK);
+
+	AddLevelLumps(inst);
+	ASSERT_EQ(builder.Save(), BUILD_OK);
+
+	std::vector<u16_t> saved = SavedBlockmap(inst);
+	std::vector<u16_t> sorted = SortedBlockmap(inst.level);
+
+	ASSERT_GE(saved.size(), 4u);
+	ASSERT_GE(saved[2] * saved[3], 4096);
+
+	// the same header, the same size, and the same lines in each block
+	ASSERT_EQ(std::vector<u16_t>(saved.begin(), saved.begin() + 4),
+			  std::vector<u16_t>(sorted.begin(), sorted.begin() + 4));
+
+	ASSERT_EQ(saved.size(), sorted.size());
+	ASSERT_EQ(DecodeBlockmap(saved), DecodeBlockmap(sorted));
+}
+
+
+TEST_F(BspNodeTest, BlockmapOverflowIsEmpty)
+{
+	GridLevel level(4, 7);
+
+	// line numbers above 65535 cannot be stored.  Zero-length lines
+	// have no segs, so the tree stays small.
+	LineDef dot;
+	dot.start = dot.end = 0;
+	dot.right = 0;
+	dot.flags = 1;
+
+	level.lines.resize(65536 + 10, dot);
+	level.install(inst.level);
+
+	LevelBuilder builder(&info, 0, inst);
+	ASSERT_EQ(builder.Build(), BUILD_OK);
+
+	AddLevelLumps(inst);
+	ASSERT_EQ(builder.Save(), BUILD_LumpOverflow);
+
+	// the lump is still there, for the ports to build their own
+	ASSERT_GE(inst.wad.master.edit_wad->LevelLookupLump(0, "BLOCKMAP"), 0);
+	ASSERT_TRUE(SavedBlockmap(inst).empty());
+}
@@ -26,7 +26,11 @@
 #include "LineDef.h"
 #include "m_select.h"
 #include "Sector.h"
+#include "Thing.h"
 #include "ui_window.h"
+#include "Vertex.h"
+
+#include <random>
 
 //==============================================================================
 //
@@ -74,6 +78,42 @@ void ObjectsModule::del(EditOperation &op, const selection_c &list) const
 
 bool ObjectsModule::lineTouchesBox(int ld, double x0, double y0, double x1, double y1) const
 {
+	// Same as the real one
+	double lx0 = doc.linedefs[ld]->Start(doc)->x();
+	double ly0 = doc.linedefs[ld]->Start(doc)->y();
+	double lx1 = doc.linedefs[ld]->End(doc)->x();
+	double ly1 = doc.linedefs[ld]->End(doc)->y();
+
+	if (lx0 >= x0 && lx0 <= x1 && ly0 >= y0 && ly0 <= y1)
+		return true;
+	if (lx1 >= x0 && lx1 <= x1 && ly1 >= y0 && ly1 <= y1)
+		return true;
+
+	double i;
+	if ((ly0 > y0) != (ly1 > y0))
+	{
+		i = lx0 + (y0 - ly0) * (lx1 - lx0) / (ly1 - ly0);
+		if (i >= x0 && i <= x1)
+			return true;
+	}
+	if ((ly0 > y1) != (ly1 > y1))
+	{
+		i = lx0 + (y1 - ly0) * (lx1 - lx0) / (ly1 - ly0);
+		if (i >= x0 && i <= x1)
+			return true;
+	}
+	if ((lx0 > x0) != (lx1 > x0))
+	{
+		i = ly0 + (x0 - lx0) * (ly1 - ly0) / (lx1 - lx0);
+		if (i >= y0 && i <= y1)
+			return true;
+	}
+	if ((lx0 > x1) != (lx1 > x1))
+	{
+		i = ly0 + (x1 - lx0) * (ly1 - ly0) / (lx1 - lx0);
+		if (i >= y0 && i <= y1)
+			return true;
+	}
 	return false;
 }
 
@@ -321,3 +361,149 @@ TEST(EChecks, TagsApplyNewValue)
 
 	ASSERT_EQ(inst.level.checks.mLastTag, 1);	// changed again
 }
+
+//
+// Test that the bucketed stuck-thing check matches the exhaustive one
+//
+TEST(EChecks, FindStuckiesMatchesBruteForce)
+{
+	Instance inst;
+
+	// A few thing types of various groups and sizes
+	auto addType = [&inst](int type, char group, short flags, short radius)
+	{
+		thingtype_t info = {};
+		info.group = group;
+		info.flags = flags;
+		info.radius = radius;
+		info.desc = "Thing";
+		inst.conf.thing_types[type] = info;
+	};
+	addType(1, 'p', 0, 16);
+	addType(2, 'm', 0, 20);
+	addType(3, 'm', 0, 128);	// large monster
+	addType(4, 'm', 0, 2);		// tiny monster, less than the step
+	addType(5, 'd', 0, 16);		// obstacle
+	addType(6, 'm', THINGDEF_TELEPT, 20);
+	addType(7, 'd', THINGDEF_PASS, 20);
+	addType(8, 'p', 0, 0);
+
+	std::mt19937 random(12345);
+	auto coord = [&random](int range)
+	{
+		return (int)(random() % (2 * range)) - range;
+	};
+
+	for(int pass = 0; pass < 6; ++pass)
+	{
+		inst.loaded.levelFormat = pass & 1 ? MapFormat::hexen : MapFormat::doom;
+
+		// The map size decides how crowded it is
+		int range = 256 << (pass / 2);
+
+		std::vector<Vertex> vertices(300);
+		std::vector<LineDef> lines(150);
+		std::vector<Thing> things(1500);
+
+		inst.level.vertices.clear();
+		inst.level.linedefs.clear();
+		inst.level.things.clear();
+
+		for(Vertex &vertex : vertices)
+		{
+			vertex.SetRawXY(inst.loaded.levelFormat, { (double)coord(range), (double)coord(range) });
+			inst.level.vertices.push_back(&vertex);
+		}
+		for(size_t i = 0; i < lines.size(); ++i)
+		{
+			LineDef &line = lines[i];
+			line.start = (int)(2 * i);
+			// Make some lines axis-aligned or tiny, they are worth checking
+			if(i % 5 == 0)
+				vertices[2 * i + 1].raw_y = vertices[2 * i].raw_y;
+			else if(i % 7 == 0)
+				vertices[2 * i + 1].raw_x = vertices[2 * i].raw_x + FFixedPoint(1);
+			line.end = (int)(2 * i + 1);
+			// One-sided lines are always blocking, the virtual ones never
+			line.right = i % 11 == 0 ? -1 : 0;
+			inst.level.linedefs.push_back(&line);
+		}
+		for(Thing &thing : things)
+		{
+			thing.SetRawXY(inst.loaded.levelFormat, { (double)coord(range), (double)coord(range) });
+			thing.type = (int)(random() % 10);	// includes unknown types
+			thing.options = (int)(random() % 0x800);
+			inst.level.things.push_back(&thing);
+		}
+
+		selection_c fast, slow;
+		Things_FindStuckies(fast, inst);
+		Things_FindStuckiesSlow(slow, inst);
+
+		ASSERT_EQ(fast.what_type(), ObjType::things);
+		ASSERT_EQ(slow.what_type(), ObjType::things);
+		ASSERT_TRUE(fast.test_equal(slow)) << "pass " << pass;
+		// Make sure the maps actually exercised something
+		ASSERT_GT(slow.count_obj(), 0);
+		ASSERT_LT(slow.count_obj(), (int)things.size());
+	}
+
+	// Empty map doesn't break
+	inst.level.things.clear();
+	selection_c fast;
+	Things_FindStuckies(fast, inst);
+	ASSERT_TRUE(fast.empty());
+}
+
+//
+// Test that the hashed overlap checks match a brute-force comparison
+//
+TEST(EChecks, FindDuplicatesMatchesBruteForce)
+{
+	Instance inst;
+
+	std::mt19937 random(4321);
+
+	// A tiny range so there are plenty of duplicates
+	std::vector<Vertex> vertices(2000);
+	for(Vertex &vertex : vertices)
+	{
+		vertex.SetRawXY(MapFormat::doom, { (double)(random() % 40), (double)(random() % 40) });
+		inst.level.vertices.push_back(&vertex);
+	}
+
+	std::vector<Thing> things(2000);
+	for(Thing &thing : things)
+	{
+		thing.SetRawXY(MapFormat::doom, { (double)(random() % 30), (double)(random() % 30) });
+		thing.type = (int)(random() % 3);
+		inst.level.things.push_back(&thing);
+	}
+
+	selection_c verts;
+	Vertex_FindOverlaps(verts, inst.level);
+	ASSERT_EQ(verts.what_type(), ObjType::vertices);
+
+	for(int i = 0; i < (int)vertices.size(); ++i)
+	{
+		bool expected = false;
+		for(int k = 0; k < i && !expected; ++k)
+			expected = vertices[k].raw_x == vertices[i].raw_x && vertices[k].raw_y == vertices[i].raw_y;
+		ASSERT_EQ(verts.get(i), expected) << "vertex " << i;
+	}
+
+	selection_c dups;
+	Things_FindDuplicates(dups, inst.level);
+	ASSERT_EQ(dups.what_type(), ObjType::things);
+
+	for(int i = 0; i < (int)things.size(); ++i)
+	{
+		bool expected = false;
+		for(int k = 0; k < i && !expected; ++k)
+			expected = things[k].raw_x == things[i].raw_x && things[k].raw_y == things[i].raw_y &&
+					things[k].type == things[i].type;
+		ASSERT_EQ(dups.get(i), expected) << "thing " << i;
+	}
+	ASSERT_GT(dups.count_obj(), 0);
+	ASSERT_LT(dups.count_obj(), (int)things.size());
+}
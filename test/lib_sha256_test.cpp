@@ -0,0 +1,59 @@
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#include "lib_sha256.h"
+#include "gtest/gtest.h"
+
+#include <string>
+
+static SString Hash(const std::string &text)
+{
+	sha256_c hash;
+	hash.AddBlock(text.data(), text.length());
+
+	return hash.Finish();
+}
+
+TEST(LibSha256, KnownHashes)
+{
+	// the examples of FIPS 180-4
+	ASSERT_EQ(Hash(""), "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+	ASSERT_EQ(Hash("abc"), "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+	ASSERT_EQ(Hash("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"),
+			  "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+	ASSERT_EQ(Hash(std::string(1000000, 'a')),
+			  "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+}
+
+TEST(LibSha256, AddedInPieces)
+{
+	std::string text;
+
+	for (int i = 0 ; i < 300 ; i++)
+		text += (char)(i * 7);
+
+	// any split of the data gives the same hash
+	for (size_t split : { 1, 55, 56, 63, 64, 65, 128, 299 })
+	{
+		sha256_c hash;
+		hash.AddBlock(text.data(), split);
+		hash.AddBlock(text.data() + split, text.length() - split);
+
+		ASSERT_EQ(hash.Finish(), Hash(text)) << "split at " << split;
+	}
+}
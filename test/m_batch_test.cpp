@@ -0,0 +1,328 @@
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#include "gtest/gtest.h"
+
+#include "bsp.h"
+#include "e_basis.h"
+#include "Instance.h"
+#include "lib_file.h"
+#include "LineDef.h"
+#include "m_batch.h"
+#include "Sector.h"
+#include "SideDef.h"
+#include "Thing.h"
+#include "ui_window.h"
+#include "Vertex.h"
+#include "w_rawdef.h"
+
+#include <stdio.h>
+
+//==============================================================================
+//
+// Mock-ups
+//
+//==============================================================================
+
+namespace global
+{
+	SString check_wad;
+	SString check_format;
+}
+
+namespace
+{
+	//
+	// A square room.  Optionally it has a wall with an unknown texture
+	// (a major problem) and a thing, which is in the void since the
+	// sector lookup is stubbed out (a minor problem).
+	//
+	struct RoomLevel
+	{
+		RoomLevel(bool bad_texture, bool with_thing)
+		{
+			const int coords[4][2] = { { 0, 0 }, { 0, 256 }, { 256, 256 }, { 256, 0 } };
+
+			vertices.resize(4);
+			sides.resize(4);
+			lines.resize(4);
+			sectors.resize(1);
+
+			for (int n = 0 ; n < 4 ; n++)
+			{
+				vertices[n].SetRawXY(MapFormat::doom, { (double)coords[n][0], (double)coords[n][1] });
+
+				sides[n].upper_tex = sides[n].lower_tex = BA_InternaliseString("-");
+				sides[n].mid_tex = BA_InternaliseString((bad_texture && n == 2) ? "BADTEX" : "STARTAN3");
+
+				lines[n].start = n;
+				lines[n].end   = (n + 1) % 4;
+				lines[n].right = n;
+				lines[n].flags = MLF_Blocking;
+			}
+
+			sectors[0].floor_tex = BA_InternaliseString("FLOOR4_8");
+			sectors[0].ceil_tex  = BA_InternaliseString("CEIL3_5");
+			sectors[0].ceilh = 128;
+
+			if (with_thing)
+			{
+				things.resize(1);
+				things[0].SetRawXY(MapFormat::doom, { 128, 128 });
+				things[0].type = 1;
+				things[0].options = 7;
+			}
+		}
+
+		void install(Document &doc)
+		{
+			for (Vertex &V : vertices)
+				doc.vertices.push_back(&V);
+			for (SideDef &SD : sides)
+				doc.sidedefs.push_back(&SD);
+			for (Sector &S : sectors)
+				doc.sectors.push_back(&S);
+			for (LineDef &L : lines)
+				doc.linedefs.push_back(&L);
+			for (Thing &T : things)
+				doc.things.push_back(&T);
+		}
+
+		std::vector<Vertex>  vertices;
+		std::vector<SideDef> sides;
+		std::vector<Sector>  sectors;
+		std::vector<LineDef> lines;
+		std::vector<Thing>   things;
+	};
+
+	// how each level of the wad looks, and the loaded copies of them
+	std::vector<std::pair<bool, bool>> level_kinds;
+	std::vector<std::unique_ptr<RoomLevel>> loaded_levels;
+}
+
+bool ImageSet::W_FlatIsKnown(const ConfigData &config, const SString &name) const
+{
+	return true;
+}
+
+Img_c * ImageSet::getTexture(const ConfigData &config, const SString &name, bool try_uppercase) const
+{
+	return nullptr;
+}
+
+bool ImageSet::W_TextureCausesMedusa(const SString &name) const
+{
+	return false;
+}
+
+bool ImageSet::W_TextureIsKnown(const ConfigData &config, const SString &name) const
+{
+	return name != "BADTEX";
+}
+
+bool is_null_tex(const SString &tex)
+{
+	return tex == "-";
+}
+
+bool is_special_tex(const SString &tex)
+{
+	return false;
+}
+
+void LogViewer_Open()
+{
+}
+
+void ObjectsModule::del(EditOperation &op, const selection_c &list) const
+{
+}
+
+bool ObjectsModule::lineTouchesBox(int ld, double x0, double y0, double x1, double y1) const
+{
+	return false;
+}
+
+int UI_Escapable_Window::handle(int event)
+{
+	return 0;
+}
+
+void UnusedVertices(const Document &doc, const selection_c &lines, selection_c &result)
+{
+}
+
+std::vector<nodebuildstats_t::limit_t> nodebuildstats_t::VanillaLimits() const
+{
+	return {};
+}
+
+void Instance::LoadLevelNum(Wad_file *wad, int lev_num)
+{
+	const std::pair<bool, bool> &kind = level_kinds[lev_num];
+
+	loaded_levels.push_back(std::make_unique<RoomLevel>(kind.first, kind.second));
+	loaded_levels.back()->install(level);
+}
+
+void Instance::Main_LoadResources(LoadingData &loading)
+{
+}
+
+//==============================================================================
+//
+// Tests
+//
+//==============================================================================
+
+namespace
+{
+
+class BatchCheckTest : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		inst.wad.master.edit_wad = Wad_file::Open("dummy.wad", WadOpenMode::write);
+
+		// no player starts are needed, the map has none
+		inst.conf.features.no_need_players = true;
+
+		global::check_wad = "dummy.wad";
+	}
+
+	void TearDown() override
+	{
+		inst.wad.master.edit_wad.reset();
+		FileDelete("dummy.wad");
+
+		level_kinds.clear();
+		loaded_levels.clear();
+	}
+
+	void addLevel(const char *name, bool bad_texture, bool with_thing)
+	{
+		Wad_file *wad = inst.wad.master.edit_wad.get();
+
+		wad->AddLevel(name);
+
+		for (const char *lump : { "THINGS", "LINEDEFS", "SIDEDEFS", "VERTEXES", "SECTORS" })
+			wad->AddLump(lump);
+
+		level_kinds.emplace_back(bad_texture, with_thing);
+	}
+
+	// runs the check, returning the exit status and the report
+	int check(const char *format, SString &report)
+	{
+		global::check_format = format;
+
+		FILE *fp = tmpfile();
+		EXPECT_NE(fp, nullptr);
+
+		int result = M_BatchCheck(inst, fp);
+
+		rewind(fp);
+
+		char buffer[1024];
+		size_t length;
+
+		while ((length = fread(buffer, 1, sizeof(buffer), fp)) > 0)
+			report += SString(buffer, (int)length);
+
+		fclose(fp);
+
+		return result;
+	}
+
+	Instance inst;
+};
+
+}	// namespace
+
+
+TEST_F(BatchCheckTest, JsonReport)
+{
+	addLevel("MAP01", true, true);
+
+	SString report;
+
+	ASSERT_EQ(check("json", report), 1);
+
+	ASSERT_EQ(report,
+		"{\n"
+		"  \"wad\": \"dummy.wad\",\n"
+		"  \"levels\": [\n"
+		"    {\n"
+		"      \"name\": \"MAP01\",\n"
+		"      \"problems\": [\n"
+		"        { \"category\": \"things\", \"severity\": \"minor\", \"message\": \"1 things in the void\", \"type\": \"things\", \"objects\": [0] },\n"
+		"        { \"category\": \"textures\", \"severity\": \"major\", \"message\": \"1 unknown textures\", \"type\": \"linedefs\", \"objects\": [2] }\n"
+		"      ]\n"
+		"    }\n"
+		"  ]\n"
+		"}\n");
+}
+
+
+TEST_F(BatchCheckTest, CsvReport)
+{
+	addLevel("MAP01", true, true);
+	addLevel("MAP02", false, false);
+
+	SString report;
+
+	ASSERT_EQ(check("csv", report), 1);
+
+	ASSERT_EQ(report,
+		"map,category,severity,message,type,objects\n"
+		"MAP01,things,minor,1 things in the void,things,0\n"
+		"MAP01,textures,major,1 unknown textures,linedefs,2\n");
+}
+
+
+TEST_F(BatchCheckTest, ExitStatus)
+{
+	SString report;
+
+	// a minor problem alone is not a failure
+	addLevel("MAP01", false, true);
+	addLevel("MAP02", false, false);
+
+	ASSERT_EQ(check("csv", report), 0);
+
+	// neither is the major problem of a map which is not checked
+	addLevel("MAP03", true, false);
+	inst.loaded.levelName = "MAP02";
+
+	ASSERT_EQ(check("csv", report), 0);
+
+	inst.loaded.levelName = "MAP03";
+
+	ASSERT_EQ(check("csv", report), 1);
+}
+
+
+TEST_F(BatchCheckTest, UnknownFormat)
+{
+	addLevel("MAP01", false, false);
+
+	SString report;
+
+	ASSERT_THROW(check("xml", report), std::runtime_error);
+}
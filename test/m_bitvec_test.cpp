@@ -134,3 +134,92 @@ TEST(BitVec, Frob)
 		ASSERT_FALSE(vec.get(i));
 }
 
+
+TEST(BitVec, FrobRange)
+{
+	bitvec_c vec(10);
+	vec.frob_range(60, 200, BitOp::add);	// grows and crosses words
+	ASSERT_GT(vec.size(), 200);
+	for(int i = 0; i < vec.size(); ++i)
+		ASSERT_EQ(vec.get(i), i >= 60 && i <= 200);
+	ASSERT_EQ(vec.count(), 141);
+
+	vec.frob_range(64, 127, BitOp::remove);
+	vec.frob_range(190, 1000, BitOp::remove);	// past the end is fine
+	for(int i = 0; i < vec.size(); ++i)
+		ASSERT_EQ(vec.get(i), (i >= 60 && i < 64) || (i >= 128 && i < 190));
+
+	vec.frob_range(0, 130, BitOp::toggle);
+	for(int i = 0; i < vec.size(); ++i)
+		ASSERT_EQ(vec.get(i), i < 60 || (i >= 64 && i < 128) || (i >= 131 && i < 190));
+
+	vec.frob_range(65, 64, BitOp::remove);	// empty range
+	ASSERT_TRUE(vec.get(64));
+	ASSERT_TRUE(vec.get(65));
+}
+
+TEST(BitVec, CountAndFind)
+{
+	bitvec_c vec(300);
+	ASSERT_EQ(vec.count(), 0);
+	ASSERT_EQ(vec.find_next(0), -1);
+	ASSERT_EQ(vec.find_last(), -1);
+
+	vec.set(0);
+	vec.set(63);
+	vec.set(64);
+	vec.set(250);
+	ASSERT_EQ(vec.count(), 4);
+	ASSERT_EQ(vec.find_next(0), 0);
+	ASSERT_EQ(vec.find_next(1), 63);
+	ASSERT_EQ(vec.find_next(64), 64);
+	ASSERT_EQ(vec.find_next(65), 250);
+	ASSERT_EQ(vec.find_next(251), -1);
+	ASSERT_EQ(vec.find_next(5000), -1);
+	ASSERT_EQ(vec.find_last(), 250);
+
+	// bits past the size never count
+	vec.set_all();
+	ASSERT_EQ(vec.count(), vec.size());
+	ASSERT_EQ(vec.find_last(), vec.size() - 1);
+	vec.toggle_all();
+	ASSERT_EQ(vec.count(), 0);
+}
+
+TEST(BitVec, ShrinkAndGrowLeavesNoStaleBits)
+{
+	bitvec_c vec(100);
+	vec.set_all();
+	vec.set(300);	// grows
+	for(int i = 0; i < vec.size(); ++i)
+		ASSERT_EQ(vec.get(i), i < 100 || i == 300);
+	ASSERT_EQ(vec.count(), 101);
+}
+
+TEST(BitVec, BooleanOps)
+{
+	bitvec_c a(200), b(70);
+	for(int i = 0; i < 200; i += 3)
+		a.set(i);
+	for(int i = 0; i < 70; i += 2)
+		b.set(i);
+
+	bitvec_c merged(10);
+	merged.merge(a);
+	merged.merge(b);
+	for(int i = 0; i < 300; ++i)
+		ASSERT_EQ(merged.get(i), (i < 200 && i % 3 == 0) || (i < 70 && i % 2 == 0));
+
+	bitvec_c unmerged(10);
+	unmerged.merge(a);
+	unmerged.unmerge(b);
+	for(int i = 0; i < 300; ++i)
+		ASSERT_EQ(unmerged.get(i), i < 200 && i % 3 == 0 && !(i < 70 && i % 2 == 0));
+
+	bitvec_c intersected(10);
+	intersected.merge(a);
+	intersected.intersect(b);
+	for(int i = 0; i < 300; ++i)
+		ASSERT_EQ(intersected.get(i), i < 70 && i % 6 == 0);
+	ASSERT_EQ(intersected.count(), 12);
+}
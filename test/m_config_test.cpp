@@ -353,6 +353,40 @@ TEST(MConfigArgs, MParseCommandLine)
 	global::Pwad_list.clear();
 	gInstance.loaded.levelName.clear();
 
+	// Check the batch checking options: --check is handled in the early pass
+	argv = { "--check", "file1", "--map", "map02", "--report", "csv" };
+	M_ParseCommandLine(6, argv.data(), CommandLinePass::early);
+	ASSERT_EQ(global::check_wad, "file1");
+	ASSERT_TRUE(gInstance.loaded.levelName.empty());
+	M_ParseCommandLine(6, argv.data(), CommandLinePass::normal);
+	ASSERT_TRUE(global::Pwad_list.empty());
+	ASSERT_EQ(gInstance.loaded.levelName, "map02");
+	ASSERT_EQ(global::check_format, "csv");
+	global::check_wad.clear();
+	global::check_format = "json";
+	gInstance.loaded.levelName.clear();
+
+	// Same for building the nodes.  Put --fast last, since a boolean
+	// option takes the next argument if it is not an option
+	argv = { "--build-nodes", "in.wad", "-o", "out.wad", "--factor", "7", "-j", "3", "--fast" };
+	M_ParseCommandLine(9, argv.data(), CommandLinePass::early);
+	ASSERT_EQ(global::build_nodes_wad, "in.wad");
+	ASSERT_TRUE(global::build_nodes_output.empty());
+	M_ParseCommandLine(9, argv.data(), CommandLinePass::normal);
+	ASSERT_TRUE(global::Pwad_list.empty());
+	ASSERT_EQ(global::build_nodes_output, "out.wad");
+	ASSERT_EQ(global::build_nodes_factor, 7);
+	ASSERT_EQ(global::build_nodes_jobs, 3);
+	ASSERT_TRUE(global::build_nodes_fast);
+	// the preferences are left alone
+	ASSERT_EQ(config::bsp_split_factor, DEFAULT_FACTOR);
+	ASSERT_FALSE(config::bsp_fast);
+	global::build_nodes_wad.clear();
+	global::build_nodes_output.clear();
+	global::build_nodes_jobs = 0;
+	global::build_nodes_factor = 0;
+	global::build_nodes_fast = false;
+
 	// Check that stringList options can be repeatedly argumented
 	argv = { "file1", "-file", "file2", "-merge", "res1", "--file", "file3",
 		"file4", "-merge", "res2", "res3" };
@@ -501,6 +535,8 @@ int config::panel_gamma = 2;
 bool config::bsp_force_v5        = false;
 bool config::bsp_gl_nodes        = true;
 bool config::bsp_warnings    = false;
+bool config::bsp_los_reject    = false;
+int  config::bsp_reject_time    = 30;
 SString config::default_port = "vanilla";
 int config::gui_color_set = 1;  // bright
 rgb_color_t config::gui_custom_bg = RGB_MAKE(0xCC, 0xD5, 0xDD);
@@ -508,6 +544,9 @@ rgb_color_t config::gui_custom_ig = RGB_MAKE(255, 255, 255);
 rgb_color_t config::gui_custom_fg = RGB_MAKE(0, 0, 0);
 bool config::swap_sidedefs = false;
 bool config::bsp_compressed        = false;
+int  config::bsp_compress_level    = 6;
+bool config::bsp_stats_json        = false;
+int  config::bsp_cache_size        = 64;
 rgb_color_t config::dotty_axis_col  = RGB_MAKE(0, 128, 255);
 int  config::grid_ratio_low  = 1;  // (low must be > 0)
 bool config::begin_maximized  = false;
@@ -527,6 +566,8 @@ bool config::auto_load_recent = false;
 int config::backup_max_files = 30;
 int config::backup_max_space = 60;  // MB
 int  config::bsp_split_factor    = DEFAULT_FACTOR;
+int  config::bsp_goal    = GOAL_None;
+int  config::bsp_strategy_time    = 60;
 int config::floor_bump_medium = 8;
 int config::floor_bump_large  = 64;
 int config::floor_bump_small  = 1;
@@ -566,6 +607,13 @@ SString global::log_file;
 std::vector<SString> global::Pwad_list;
 SString global::cache_dir;
 int global::show_help     = 0;
+SString global::check_wad;
+SString global::check_format = "json";
+SString global::build_nodes_wad;
+SString global::build_nodes_output;
+int     global::build_nodes_jobs = 0;
+bool    global::build_nodes_fast = false;
+int     global::build_nodes_factor = 0;
 
 Instance gInstance;
 
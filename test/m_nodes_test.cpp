@@ -0,0 +1,210 @@
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#include "gtest/gtest.h"
+
+#include "bsp.h"
+#include "Instance.h"
+#include "lib_file.h"
+#include "m_batch.h"
+#include "testUtils/GridLevel.hpp"
+
+#include <stdexcept>
+
+//==============================================================================
+//
+// Mock-ups
+//
+//==============================================================================
+
+namespace global
+{
+	SString cache_dir;
+	SString build_nodes_wad;
+	bool build_nodes_fast;
+	int build_nodes_factor;
+}
+
+namespace
+{
+	// the sizes of the levels of the wad, and their contents
+	std::vector<int> level_sizes;
+	std::vector<std::unique_ptr<GridLevel>> loaded_levels;
+}
+
+void FatalError(EUR_FORMAT_STRING(const char *fmt), ...)
+{
+	throw std::runtime_error(fmt);
+}
+
+bool linetype_t::isPolyObjectSpecial() const
+{
+	return false;
+}
+
+void SectorModule::groupConnectedSectors(UnionFind &groups,
+		const std::function<bool(const LineDef &)> &joins) const
+{
+}
+
+void M_WriteNodeStats(FILE *fp, const SString &wad_name,
+					  const std::vector<nodebuildstats_t> &stats)
+{
+}
+
+void Instance::LoadLevelNum(Wad_file *wad, int lev_num)
+{
+	// each copy gets its own, since they are built at the same time
+	loaded_levels.push_back(std::make_unique<GridLevel>(level_sizes[lev_num], 1));
+	loaded_levels.back()->install(level);
+}
+
+void Instance::LoadLevel(Wad_file *wad, const SString &level)
+{
+}
+
+void Instance::Main_LoadResources(LoadingData &loading)
+{
+}
+
+bool Instance::M_SaveMap()
+{
+	return false;
+}
+
+void Instance::Editor_ClearAction()
+{
+}
+
+void Instance::Selection_InvalidateLast()
+{
+}
+
+//==============================================================================
+//
+// Tests
+//
+//==============================================================================
+
+namespace
+{
+
+class BuildAllNodesTest : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		inst.wad.master.edit_wad = Wad_file::Open("dummy.wad", WadOpenMode::write);
+
+		info.goal = GOAL_FewestSegs;
+		info.jobs = 1;
+	}
+
+	void TearDown() override
+	{
+		gLog.openWindow(nullptr, nullptr);
+
+		// Save() writes the wad out
+		inst.wad.master.edit_wad.reset();
+		FileDelete("dummy.wad");
+
+		level_sizes.clear();
+		loaded_levels.clear();
+	}
+
+	void addLevel(const char *name, int size)
+	{
+		Wad_file *wad = inst.wad.master.edit_wad.get();
+
+		wad->AddLevel(name);
+
+		for (const char *lump : { "THINGS", "LINEDEFS", "SIDEDEFS", "VERTEXES", "SECTORS" })
+			wad->AddLump(lump);
+
+		level_sizes.push_back(size);
+	}
+
+	// cancels the build once a message starting with the given text
+	// has been logged
+	void cancelOn(const char *text)
+	{
+		cancel_text = text;
+
+		gLog.openWindow([](const SString &message, void *data)
+		{
+			auto self = static_cast<BuildAllNodesTest *>(data);
+
+			if (message.find(self->cancel_text) != std::string::npos)
+				self->info.cancelled = true;
+		}, this);
+	}
+
+	bool hasNodes(int lev_num) const
+	{
+		return inst.wad.master.edit_wad->LevelLookupLump(lev_num, "NODES") >= 0;
+	}
+
+	Instance inst;
+	nodebuildinfo_t info;
+
+	SString cancel_text;
+};
+
+}	// namespace
+
+
+TEST_F(BuildAllNodesTest, CancelledBeforeBuilding)
+{
+	addLevel("MAP01", 4);
+	addLevel("MAP02", 4);
+
+	// logged once the levels are loaded, before any is built
+	cancelOn("Building nodes for");
+
+	ASSERT_EQ(inst.BuildAllNodes(&info), BUILD_Cancelled);
+	ASSERT_FALSE(hasNodes(0));
+	ASSERT_FALSE(hasNodes(1));
+}
+
+
+TEST_F(BuildAllNodesTest, CancelledPartway)
+{
+	// the first level is done long before the second one
+	addLevel("MAP01", 2);
+	addLevel("MAP02", 24);
+	addLevel("MAP03", 24);
+
+	// logged once the first level has been saved
+	cancelOn("Kept the");
+
+	ASSERT_EQ(inst.BuildAllNodes(&info), BUILD_Cancelled);
+	ASSERT_TRUE(hasNodes(0));
+	ASSERT_FALSE(hasNodes(1));
+	ASSERT_FALSE(hasNodes(2));
+}
+
+
+TEST_F(BuildAllNodesTest, Finished)
+{
+	addLevel("MAP01", 2);
+	addLevel("MAP02", 3);
+
+	ASSERT_EQ(inst.BuildAllNodes(&info), BUILD_OK);
+	ASSERT_TRUE(hasNodes(0));
+	ASSERT_TRUE(hasNodes(1));
+}
@@ -19,6 +19,12 @@
 #include "m_select.h"
 #include "gtest/gtest.h"
 
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <random>
+#include <set>
+
 TEST(MSelect, ChangeType)
 {
 	selection_c selection(ObjType::things);
@@ -657,3 +663,158 @@ TEST(MSelect, ExtendedSizeCanGrow)
 	for(int i = 0; i < 1024; ++i)
 		ASSERT_EQ(selection.get_ext(i), static_cast<byte>((i * i + 1) % 256));
 }
+
+//
+// Compares the word-based operations against a plain reference set
+//
+TEST(MSelect, OperationsMatchReference)
+{
+	std::mt19937 random(777);
+
+	for(int pass = 0; pass < 40; ++pass)
+	{
+		bool extended = pass % 4 == 3;
+		// Vary the density so both the small list and the bit vector get used
+		int range = pass % 2 ? 3000 : 60;
+		int amount = (int)(random() % 100);
+
+		selection_c a(ObjType::linedefs, extended), b(ObjType::linedefs);
+		std::set<int> refA, refB;
+		for(int i = 0; i < amount; ++i)
+		{
+			int n = (int)(random() % range);
+			a.set(n);
+			refA.insert(n);
+			n = (int)(random() % range);
+			b.set(n);
+			refB.insert(n);
+		}
+		int lo = (int)(random() % range);
+		int hi = lo + (int)(random() % 200);
+		b.frob_range(lo, hi, BitOp::add);
+		for(int n = lo; n <= hi; ++n)
+			refB.insert(n);
+
+		auto check = [](const selection_c &sel, const std::set<int> &ref)
+		{
+			ASSERT_EQ(sel.count_obj(), (int)ref.size());
+			ASSERT_EQ(sel.max_obj(), ref.empty() ? -1 : *ref.rbegin());
+			std::vector<int> items;
+			for(sel_iter_c it(sel); !it.done(); it.next())
+				items.push_back(*it);
+			std::sort(items.begin(), items.end());
+			ASSERT_EQ(items, std::vector<int>(ref.begin(), ref.end()));
+			if(!ref.empty())
+			{
+				ASSERT_TRUE(ref.count(sel.find_first()));
+			}
+		};
+
+		check(a, refA);
+		check(b, refB);
+
+		switch(pass % 4)
+		{
+		case 0:
+			a.merge(b);
+			refA.insert(refB.begin(), refB.end());
+			break;
+		case 1:
+			a.unmerge(b);
+			for(int n : refB)
+				refA.erase(n);
+			break;
+		case 2:
+			a.intersect(b);
+			for(auto it = refA.begin(); it != refA.end();)
+				it = refB.count(*it) ? std::next(it) : refA.erase(it);
+			break;
+		default:
+			a.frob_range(lo / 2, hi, BitOp::toggle);
+			for(int n = lo / 2; n <= hi; ++n)
+				if(!refA.erase(n))
+					refA.insert(n);
+			break;
+		}
+		check(a, refA);
+	}
+}
+
+//
+// Micro-benchmarks for large selections.  These only report the timings,
+// since they depend too much on the machine to be tested.
+//
+TEST(MSelect, BenchmarkLargeSelections)
+{
+	const int total = 100000;
+	const int repeats = 20;
+
+	auto measure = [](const char *what, const std::function<void()> &func)
+	{
+		auto start = std::chrono::steady_clock::now();
+		for(int i = 0; i < repeats; ++i)
+			func();
+		auto elapsed = std::chrono::steady_clock::now() - start;
+		printf("  %-36s %8.3f ms\n", what,
+			   std::chrono::duration<double, std::milli>(elapsed).count() / repeats);
+	};
+
+	selection_c all(ObjType::linedefs);
+	selection_c half(ObjType::linedefs);
+	for(int i = 0; i < total; i += 2)
+		half.set(i);
+
+	measure("select all (per object)", [&all]()
+	{
+		all.clear_all();
+		for(int i = 0; i < total; ++i)
+			all.set(i);
+	});
+	measure("select all (range)", [&all]()
+	{
+		all.clear_all();
+		all.frob_range(0, total - 1, BitOp::add);
+	});
+	ASSERT_EQ(all.count_obj(), total);
+
+	long long sum = 0;
+	measure("iterate half", [&half, &sum]()
+	{
+		for(sel_iter_c it(half); !it.done(); it.next())
+			sum += *it;
+	});
+	ASSERT_EQ(sum, repeats * (long long)(total / 2) * (total - 2) / 2);
+
+	selection_c work(ObjType::linedefs);
+	measure("merge", [&work, &half]()
+	{
+		work.clear_all();
+		work.merge(half);
+	});
+	ASSERT_EQ(work.count_obj(), total / 2);
+
+	measure("intersect", [&work, &all, &half]()
+	{
+		work.clear_all();
+		work.merge(all);
+		work.intersect(half);
+	});
+	ASSERT_EQ(work.count_obj(), total / 2);
+
+	measure("unmerge", [&work, &all, &half]()
+	{
+		work.clear_all();
+		work.merge(all);
+		work.unmerge(half);
+	});
+	ASSERT_EQ(work.count_obj(), total / 2);
+	ASSERT_EQ(work.max_obj(), total - 1);
+
+	selection_c ext(ObjType::linedefs, true);
+	measure("select all (extended)", [&ext]()
+	{
+		ext.clear_all();
+		ext.frob_range(0, total - 1, BitOp::add);
+	});
+	ASSERT_EQ(ext.count_obj(), total);
+}
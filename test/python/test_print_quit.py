@@ -27,7 +27,7 @@ def test_help_command():
     saved_pos = None
     for line in lines:
         pos = line.find('<')
-        match = re.search('--[a-z_]+', line)
+        match = re.search('--[a-z_-]+', line)
         if match:
             parm = match.group()
             parms.add(parm)
@@ -38,7 +38,8 @@ def test_help_command():
                 saved_pos = pos
 
     assert parms == {'--home', '--install', '--log', '--config', '--help', '--version', '--debug',
-        '--quiet', '--file', '--merge', '--iwad', '--port', '--warp',
+        '--quiet', '--check', '--build-nodes', '--file', '--merge', '--iwad', '--port', '--map',
+        '--report', '--output', '--fast', '--factor', '--jobs', '--warp',
     }
 
     # Check that '<' marked arguments (like -warp) have an extra newline after
@@ -0,0 +1,272 @@
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#include "gtest/gtest.h"
+
+#include "Instance.h"
+#include "LineDef.h"
+#include "r_vanilla.h"
+#include "Sector.h"
+#include "SideDef.h"
+#include "Vertex.h"
+#include "w_rawdef.h"
+
+//==============================================================================
+//
+// Mock-ups
+//
+//==============================================================================
+
+bool is_null_tex(const SString &tex)
+{
+	return tex.good() && tex[0] == '-';
+}
+
+void Instance::Beep(EUR_FORMAT_STRING(const char *fmt), ...)
+{
+}
+
+//==============================================================================
+//
+// Tests
+//
+//==============================================================================
+
+namespace
+{
+
+//
+// A room from (0, -half) to (depth, half), cut across into sectors of
+// the same size by two-sided lines.  The viewer stands near the west
+// wall looking east, and the room is wide enough for the north and
+// south walls to be out of sight.
+//
+class StripeLevel
+{
+public:
+	static const int STRIPE = 64;
+
+	explicit StripeLevel(int num_stripes, int half = -1)
+	{
+		int depth = num_stripes * STRIPE;
+
+		if (half < 0)
+			half = depth + 256;
+
+		for (int i = 0 ; i < num_stripes ; i++)
+		{
+			Sector S;
+			S.floorh = 0;
+			S.ceilh  = 256;
+			S.floor_tex = BA_InternaliseString("FLOOR0_1");
+			S.ceil_tex  = BA_InternaliseString("CEIL1_1");
+			S.light = 160;
+
+			sectors.push_back(S);
+		}
+
+		for (int i = 0 ; i <= num_stripes ; i++)
+		{
+			addVertex(i * STRIPE, -half);
+			addVertex(i * STRIPE,  half);
+		}
+
+		auto south = [](int i) { return 2 * i; };
+		auto north = [](int i) { return 2 * i + 1; };
+
+		// the west and east walls
+		addLine(south(0), north(0), 0, -1);
+		addLine(north(num_stripes), south(num_stripes), num_stripes - 1, -1);
+
+		for (int i = 0 ; i < num_stripes ; i++)
+		{
+			addLine(south(i + 1), south(i), i, -1);
+			addLine(north(i), north(i + 1), i, -1);
+
+			if (i > 0)
+				addLine(south(i), north(i), i, i - 1);
+		}
+	}
+
+	void install(Document &doc)
+	{
+		doc.vertices.clear();
+		doc.sidedefs.clear();
+		doc.sectors.clear();
+		doc.linedefs.clear();
+
+		for (Vertex &V : vertices)
+			doc.vertices.push_back(&V);
+		for (SideDef &SD : sides)
+			doc.sidedefs.push_back(&SD);
+		for (Sector &S : sectors)
+			doc.sectors.push_back(&S);
+		for (LineDef &L : lines)
+			doc.linedefs.push_back(&L);
+	}
+
+	std::vector<Vertex>  vertices;
+	std::vector<SideDef> sides;
+	std::vector<Sector>  sectors;
+	std::vector<LineDef> lines;
+
+private:
+	void addVertex(int x, int y)
+	{
+		Vertex V;
+		V.SetRawXY(MapFormat::doom, { (double)x, (double)y });
+
+		vertices.push_back(V);
+	}
+
+	void addLine(int v1, int v2, int right, int left)
+	{
+		LineDef L;
+		L.start = v1;
+		L.end   = v2;
+		L.right = addSide(right, left >= 0);
+		L.left  = (left >= 0) ? addSide(left, true) : -1;
+		L.flags = (left >= 0) ? MLF_TwoSided : MLF_Blocking;
+
+		lines.push_back(L);
+	}
+
+	int addSide(int sector, bool two_sided)
+	{
+		SideDef SD;
+		SD.sector    = sector;
+		SD.upper_tex = BA_InternaliseString(two_sided ? "STEP1" : "-");
+		SD.mid_tex   = BA_InternaliseString(two_sided ? "-" : "STARTAN3");
+		SD.lower_tex = BA_InternaliseString(two_sided ? "STEP1" : "-");
+
+		sides.push_back(SD);
+		return (int)sides.size() - 1;
+	}
+};
+
+
+class VanillaViewTest : public ::testing::Test
+{
+protected:
+	vanilla_counts_t lookEast(StripeLevel &level)
+	{
+		level.install(inst.level);
+
+		vanilla_counts_t counts;
+
+		EXPECT_TRUE(R_CountVanillaView(inst, 16, 0, 0, counts));
+
+		return counts;
+	}
+
+	Instance inst;
+};
+
+}	// namespace
+
+
+TEST_F(VanillaViewTest, SingleRoom)
+{
+	// a square room, small enough to see the north and south walls
+	StripeLevel level(1, 32);
+
+	vanilla_counts_t counts = lookEast(level);
+
+	// the floor and the ceiling, the east wall and the ends of the
+	// north and south walls.  Solid walls need no openings.
+	ASSERT_EQ(counts.visplanes, 2);
+	ASSERT_EQ(counts.drawsegs, 3);
+	ASSERT_EQ(counts.openings, 0);
+}
+
+
+TEST_F(VanillaViewTest, NothingChanges)
+{
+	// the lines across the room are not drawn, and the sectors share
+	// their planes
+	StripeLevel level(8);
+
+	vanilla_counts_t counts = lookEast(level);
+
+	ASSERT_EQ(counts.visplanes, 2);
+	ASSERT_EQ(counts.drawsegs, 1);
+	ASSERT_EQ(counts.openings, 0);
+}
+
+
+TEST_F(VanillaViewTest, FlatChanges)
+{
+	for (int changes : { 1, 4, 20 })
+	{
+		StripeLevel level(changes + 1);
+
+		for (int i = 0 ; i <= changes ; i++)
+			level.sectors[i].floor_tex = BA_InternaliseString(SString::printf("FLAT%d", i));
+
+		vanilla_counts_t counts = lookEast(level);
+
+		// a floor for each sector and one ceiling, and a drawseg for
+		// each change and for the east wall.  Lines where only the
+		// flat changes need no openings.
+		ASSERT_EQ(counts.visplanes, changes + 2) << changes << " changes";
+		ASSERT_EQ(counts.drawsegs, changes + 1) << changes << " changes";
+		ASSERT_EQ(counts.openings, 0) << changes << " changes";
+	}
+
+	// that is one too many
+	StripeLevel level(128);
+
+	for (int i = 0 ; i < 128 ; i++)
+		level.sectors[i].floor_tex = BA_InternaliseString(SString::printf("FLAT%d", i));
+
+	vanilla_counts_t counts = lookEast(level);
+
+	ASSERT_EQ(counts.visplanes, VANILLA_MAXVISPLANES + 1);
+	ASSERT_GT(counts.Load(), 1.0);
+}
+
+
+TEST_F(VanillaViewTest, StepsDown)
+{
+	for (int steps : { 1, 5, 30 })
+	{
+		StripeLevel level(steps + 1);
+
+		for (int i = 0 ; i <= steps ; i++)
+			level.sectors[i].floorh = -8 * i;
+
+		vanilla_counts_t counts = lookEast(level);
+
+		// each step down keeps the floor clipping of every column, for
+		// the sprites behind it.
+		ASSERT_EQ(counts.visplanes, steps + 2) << steps << " steps";
+		ASSERT_EQ(counts.drawsegs, steps + 1) << steps << " steps";
+		ASSERT_EQ(counts.openings, steps * 320) << steps << " steps";
+	}
+}
+
+
+TEST_F(VanillaViewTest, OutsideTheLevel)
+{
+	StripeLevel level(2);
+	level.install(inst.level);
+
+	vanilla_counts_t counts;
+
+	ASSERT_FALSE(R_CountVanillaView(inst, -100, 0, 0, counts));
+}
@@ -38,6 +38,9 @@ const sectortype_t &Instance::M_GetSectorType(int type) const
 
 const thingtype_t &M_GetThingType(const ConfigData &config, int type)
 {
+   auto TI = config.thing_types.find(type);
+   if(TI != config.thing_types.end())
+      return TI->second;
    static thingtype_t thingtype;
    return thingtype;
 }
@@ -0,0 +1,159 @@
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#ifndef GridLevel_hpp
+#define GridLevel_hpp
+
+#include "Document.h"
+#include "LineDef.h"
+#include "Sector.h"
+#include "SideDef.h"
+#include "Vertex.h"
+
+#include <random>
+#include <vector>
+
+//
+// A grid of rooms with a diamond-shaped pillar in each one.  Some of
+// the walls between the rooms are solid.
+//
+class GridLevel
+{
+public:
+	static const int CELL = 256;
+
+	GridLevel(int size, unsigned seed)
+	{
+		std::mt19937 rng(seed);
+		std::uniform_int_distribution<int> offset(80, CELL - 80);
+		std::uniform_int_distribution<int> radius(16, 60);
+		std::uniform_int_distribution<int> percent(0, 99);
+
+		auto cell = [size](int x, int y)
+		{
+			if (x < 0 || y < 0 || x >= size || y >= size)
+				return -1;
+			return y * size + x;
+		};
+
+		sectors.resize(size * size);
+
+		auto addLine = [&](int v1, int v2, int right, int left)
+		{
+			// make some walls solid
+			if (right >= 0 && left >= 0 && percent(rng) < 40)
+				left = -1;
+
+			// the right side must face a room
+			if (right < 0)
+			{
+				std::swap(v1, v2);
+				std::swap(right, left);
+			}
+
+			LineDef L;
+			L.start = v1;
+			L.end   = v2;
+			L.right = addSide(right);
+			L.left  = (left >= 0) ? addSide(left) : -1;
+			L.flags = (left >= 0) ? 4 : 1;
+
+			lines.push_back(L);
+		};
+
+		for (int i = 0 ; i <= size ; i++)
+		for (int j = 0 ; j < size ; j++)
+		{
+			// vertical edge at x=i and horizontal edge at y=i
+			addLine(vertex(i * CELL, j * CELL), vertex(i * CELL, (j + 1) * CELL),
+					cell(i, j), cell(i - 1, j));
+
+			addLine(vertex(j * CELL, i * CELL), vertex((j + 1) * CELL, i * CELL),
+					cell(j, i - 1), cell(j, i));
+		}
+
+		for (int x = 0 ; x < size ; x++)
+		for (int y = 0 ; y < size ; y++)
+		{
+			int cx = x * CELL + offset(rng);
+			int cy = y * CELL + offset(rng);
+			int r  = radius(rng);
+
+			int pts[4] = { vertex(cx + r, cy), vertex(cx, cy + r),
+						   vertex(cx - r, cy), vertex(cx, cy - r) };
+
+			for (int k = 0 ; k < 4 ; k++)
+			{
+				LineDef L;
+				L.start = pts[k];
+				L.end   = pts[(k + 1) % 4];
+				L.right = addSide(cell(x, y));
+				L.flags = 1;
+
+				lines.push_back(L);
+			}
+		}
+	}
+
+	void install(Document &doc)
+	{
+		doc.vertices.clear();
+		doc.sidedefs.clear();
+		doc.sectors.clear();
+		doc.linedefs.clear();
+
+		for (Vertex &V : vertices)
+			doc.vertices.push_back(&V);
+		for (SideDef &SD : sides)
+			doc.sidedefs.push_back(&SD);
+		for (Sector &S : sectors)
+			doc.sectors.push_back(&S);
+		for (LineDef &L : lines)
+			doc.linedefs.push_back(&L);
+	}
+
+	std::vector<Vertex>  vertices;
+	std::vector<SideDef> sides;
+	std::vector<Sector>  sectors;
+	std::vector<LineDef> lines;
+
+private:
+	int vertex(int x, int y)
+	{
+		for (int i = 0 ; i < (int)vertices.size() ; i++)
+			if (vertices[i].x() == x && vertices[i].y() == y)
+				return i;
+
+		Vertex V;
+		V.SetRawXY(MapFormat::doom, { (double)x, (double)y });
+
+		vertices.push_back(V);
+		return (int)vertices.size() - 1;
+	}
+
+	int addSide(int sector)
+	{
+		SideDef SD;
+		SD.sector = sector;
+
+		sides.push_back(SD);
+		return (int)sides.size() - 1;
+	}
+};
+
+#endif /* GridLevel_hpp */
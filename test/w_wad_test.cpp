@@ -17,12 +17,15 @@
 //------------------------------------------------------------------------
 
 #include "w_wad.h"
+#include "WadData.h"
 #include "testUtils/TempDirContext.hpp"
 #ifdef None	// fix pollution
 #undef None
 #endif
 #include "gtest/gtest.h"
 
+#include <filesystem>
+
 class WadFileTest : public TempDirContext
 {
 };
@@ -168,7 +171,8 @@ TEST_F(WadFileTest, WriteRead)
 	lump->Printf("Doom");
 
 	ASSERT_EQ(wad->TotalSize(), 12 + 13 + 4 + 2 + 48);
-	wad->writeToDisk();
+	// a compacted wad has the lumps in the order of the directory
+	wad->compactToDisk();
 
 	// Check
 	readFromPath(path, data);
@@ -316,6 +320,230 @@ TEST_F(WadFileTest, FindLumpInNamespace)
 			  wad->GetLump(19));
 }
 
+//
+// Saving only writes what has changed
+//
+TEST_F(WadFileTest, InPlaceSave)
+{
+	SString path = getChildPath("wad.wad");
+	auto wad = Wad_file::Open(path, WadOpenMode::write);
+	ASSERT_TRUE(wad);
+
+	wad->AddLump("FIRST")->Printf("0123456789");
+	wad->AddLump("SECOND")->Printf("abcdefghij");
+	wad->AddLump("THIRD")->Printf("ABCDEFGHIJ");
+	wad->writeToDisk();
+	mDeleteList.push(path);
+
+	// header, 30 bytes of lumps, directory
+	std::vector<uint8_t> data;
+	readFromPath(path, data);
+	ASSERT_EQ(data.size(), 12 + 30 + 48);
+	ASSERT_EQ(wad->wastedSpace(), 0);
+
+	auto edit = Wad_file::Open(path, WadOpenMode::append);
+	ASSERT_TRUE(edit);
+
+	// a changed lump and the directory go at the end, the old ones
+	// become unused
+	Lump_c *second = edit->GetLump(1);
+	second->clearData();
+	second->Printf("klmnopqrst");
+	edit->writeToDisk();
+
+	readFromPath(path, data);
+	ASSERT_EQ(data.size(), 12 + 30 + 48 + 10 + 48);
+	ASSERT_FALSE(memcmp(data.data() + 12, "0123456789abcdefghijABCDEFGHIJ", 30));
+	ASSERT_FALSE(memcmp(data.data() + 90, "klmnopqrst", 10));
+	ASSERT_EQ(edit->wastedSpace(), 10 + 48);
+
+	// a smaller lump goes into the smallest hole which fits
+	second->clearData();
+	second->Printf("uvw");
+	edit->writeToDisk();
+
+	readFromPath(path, data);
+	ASSERT_EQ(data.size(), 12 + 30 + 48 + 10 + 48);
+	ASSERT_FALSE(memcmp(data.data() + 22, "uvw", 3));
+
+	auto read = Wad_file::Open(path, WadOpenMode::read);
+	ASSERT_TRUE(read);
+	ASSERT_EQ(read->NumLumps(), 3);
+	ASSERT_EQ(read->GetLump(0)->Length(), 10);
+	ASSERT_FALSE(memcmp(read->GetLump(0)->getData(), "0123456789", 10));
+	ASSERT_EQ(read->GetLump(1)->Length(), 3);
+	ASSERT_FALSE(memcmp(read->GetLump(1)->getData(), "uvw", 3));
+	ASSERT_FALSE(memcmp(read->GetLump(2)->getData(), "ABCDEFGHIJ", 10));
+	read.reset();
+
+	// renaming only writes a new directory
+	edit->RenameLump(2, "LAST");
+	edit->writeToDisk();
+
+	read = Wad_file::Open(path, WadOpenMode::read);
+	ASSERT_TRUE(read);
+	ASSERT_EQ(read->GetLump(2)->Name(), "LAST");
+	ASSERT_FALSE(memcmp(read->GetLump(2)->getData(), "ABCDEFGHIJ", 10));
+	read.reset();
+
+	// compacting drops the unused space
+	edit->compactToDisk();
+
+	readFromPath(path, data);
+	ASSERT_EQ(data.size(), 12 + 23 + 48);
+	ASSERT_EQ(edit->wastedSpace(), 0);
+	ASSERT_FALSE(memcmp(data.data() + 12, "0123456789uvwABCDEFGHIJ", 23));
+}
+
+//
+// A file which something else has changed is written again in full
+//
+TEST_F(WadFileTest, InPlaceSaveOfChangedFile)
+{
+	SString path = getChildPath("wad.wad");
+	auto wad = Wad_file::Open(path, WadOpenMode::write);
+	ASSERT_TRUE(wad);
+
+	wad->AddLump("FIRST")->Printf("0123456789");
+	wad->AddLump("SECOND")->Printf("abcdefghij");
+	wad->writeToDisk();
+	mDeleteList.push(path);
+
+	FILE *fp = fopen(path.c_str(), "ab");
+	ASSERT_NE(fp, nullptr);
+	ASSERT_GE(fputs("garbage", fp), 0);
+	ASSERT_EQ(fclose(fp), 0);
+
+	wad->GetLump(1)->Seek();
+	wad->GetLump(1)->Printf("!");
+	wad->writeToDisk();
+
+	std::vector<uint8_t> data;
+	readFromPath(path, data);
+	ASSERT_EQ(data.size(), 12 + 21 + 32);
+	ASSERT_EQ(wad->wastedSpace(), 0);
+	ASSERT_FALSE(memcmp(data.data() + 12, "0123456789!abcdefghij", 21));
+}
+
+//
+// So is one which something else has rewritten at the same size
+//
+TEST_F(WadFileTest, InPlaceSaveOfRewrittenFile)
+{
+	SString path = getChildPath("wad.wad");
+	auto wad = Wad_file::Open(path, WadOpenMode::write);
+	ASSERT_TRUE(wad);
+
+	wad->AddLump("FIRST")->Printf("0123456789");
+	wad->AddLump("SECOND")->Printf("abcdefghij");
+	wad->writeToDisk();
+	mDeleteList.push(path);
+
+	FILE *fp = fopen(path.c_str(), "r+b");
+	ASSERT_NE(fp, nullptr);
+	ASSERT_EQ(fseek(fp, 12, SEEK_SET), 0);
+	ASSERT_GE(fputs("XXXXXXXXXX", fp), 0);
+	ASSERT_EQ(fclose(fp), 0);
+
+	// the time may not have changed on a coarse clock
+	std::error_code ec;
+	std::filesystem::path fspath = std::filesystem::u8path(path.c_str());
+	std::filesystem::last_write_time(fspath,
+			std::filesystem::last_write_time(fspath) - std::chrono::hours(1), ec);
+	ASSERT_FALSE(ec);
+
+	wad->GetLump(1)->Seek();
+	wad->GetLump(1)->Printf("!");
+	wad->writeToDisk();
+
+	std::vector<uint8_t> data;
+	readFromPath(path, data);
+	ASSERT_EQ(data.size(), 12 + 21 + 32);
+	ASSERT_FALSE(memcmp(data.data() + 12, "0123456789!abcdefghij", 21));
+}
+
+//
+// The lookups follow the directory as it changes
+//
+TEST_F(WadFileTest, FindLumpAfterChanges)
+{
+	auto wad = Wad_file::Open("dummy.wad", WadOpenMode::write);
+	ASSERT_TRUE(wad);
+
+	Lump_c *first = wad->AddLump("DUP");
+	Lump_c *other = wad->AddLump("OTHER");
+	Lump_c *second = wad->AddLump("dup");
+
+	// the last one of a name wins, in any case
+	ASSERT_EQ(wad->FindLump("DUP"), second);
+	ASSERT_EQ(wad->FindLump("Dup"), second);
+	ASSERT_EQ(wad->FindLumpNum("dup"), 2);
+	ASSERT_EQ(wad->FindLumpInNamespace("DUP", WadNamespace::Global), first);
+	ASSERT_EQ(wad->FindLump("DUPLICATE"), nullptr);
+	ASSERT_EQ(wad->FindLump("LONGERTHAN8"), nullptr);
+
+	wad->RenameLump(2, "NEWNAME");
+	ASSERT_EQ(wad->FindLump("DUP"), first);
+	ASSERT_EQ(wad->FindLump("NEWNAME"), second);
+
+	wad->RemoveLumps(0, 1);
+	ASSERT_EQ(wad->FindLump("DUP"), nullptr);
+	ASSERT_EQ(wad->FindLumpNum("OTHER"), 0);
+	ASSERT_EQ(wad->FindLumpNum("NEWNAME"), 1);
+
+	wad->InsertPoint(1);
+	Lump_c *inserted = wad->AddLump("OTHER");
+	ASSERT_EQ(wad->FindLumpNum("OTHER"), 1);
+	ASSERT_EQ(wad->FindLump("OTHER"), inserted);
+	ASSERT_EQ(wad->FindLumpInNamespace("OTHER", WadNamespace::Global), other);
+}
+
+//
+// Later wads override the earlier ones in the master directory
+//
+TEST_F(WadFileTest, MasterDirLookup)
+{
+	auto iwad = Wad_file::Open("iwad.wad", WadOpenMode::write);
+	auto pwad = Wad_file::Open("pwad.wad", WadOpenMode::write);
+	ASSERT_TRUE(iwad);
+	ASSERT_TRUE(pwad);
+
+	Lump_c *playpal = iwad->AddLump("PLAYPAL");
+	Lump_c *colormap = iwad->AddLump("COLORMAP");
+	iwad->AddLump("S_START");
+	Lump_c *troo = iwad->AddLump("TROOA1");
+	troo->Printf("data");
+	iwad->AddLump("S_END");
+
+	MasterDir master;
+	master.MasterDir_Add(iwad);
+
+	ASSERT_EQ(master.W_FindGlobalLump("playpal"), playpal);
+	ASSERT_EQ(master.W_FindGlobalLump("TROOA1"), nullptr);
+	ASSERT_EQ(master.W_FindSpriteLump("TROOA1"), troo);
+
+	master.MasterDir_Add(pwad);
+	ASSERT_EQ(master.W_FindGlobalLump("PLAYPAL"), playpal);
+
+	// changes to a wad already in the list are seen
+	Lump_c *newpal = pwad->AddLump("PLAYPAL");
+	pwad->AddLump("SS_START");
+	Lump_c *newtroo = pwad->AddLump("TROOA1");
+	newtroo->Printf("data");
+	pwad->AddLump("SS_END");
+
+	ASSERT_EQ(master.W_FindGlobalLump("PLAYPAL"), newpal);
+	ASSERT_EQ(master.W_FindGlobalLump("COLORMAP"), colormap);
+	ASSERT_EQ(master.W_FindSpriteLump("TROOA1"), newtroo);
+
+	master.MasterDir_Remove(pwad);
+	ASSERT_EQ(master.W_FindGlobalLump("PLAYPAL"), playpal);
+	ASSERT_EQ(master.W_FindSpriteLump("TROOA1"), troo);
+
+	master.MasterDir_CloseAll();
+	ASSERT_EQ(master.W_FindGlobalLump("PLAYPAL"), nullptr);
+}
+
 //
 // Query levels
 //
@@ -517,3 +745,96 @@ TEST_F(WadFileTest, LumpFromFile)
 	// Test getData
 	ASSERT_FALSE(memcmp(lump->getData(), "PWAD\0\0\0\0\x0c\0\0\0", 12));
 }
+
+TEST_F(WadFileTest, MappedLumps)
+{
+	SString path = getChildPath("wad.wad");
+	auto wad = Wad_file::Open(path, WadOpenMode::write);
+	ASSERT_TRUE(wad);
+
+	wad->AddLump("LUMP1")->Printf("Hello, world!");
+	wad->AddLump("EMPTY");
+	wad->AddLump("LUMP2")->Printf("Goodbye!");
+	wad->writeToDisk();
+	mDeleteList.push(path);
+
+	std::vector<uint8_t> original;
+	readFromPath(path, original);
+
+	auto read = Wad_file::Open(path, WadOpenMode::append);
+	ASSERT_TRUE(read);
+	ASSERT_EQ(read->NumLumps(), 3);
+
+	Lump_c *lump1 = read->GetLump(0);
+	ASSERT_EQ(lump1->Length(), 13);
+	ASSERT_FALSE(memcmp(lump1->getData(), "Hello, world!", 13));
+	ASSERT_EQ(read->GetLump(1)->Length(), 0);
+
+	SString line;
+	lump1->Seek(7);
+	ASSERT_TRUE(lump1->GetLine(line));
+	ASSERT_EQ(line, "world!");
+
+	// changing a lump must not touch the file
+	lump1->Seek(5);
+	lump1->Printf(" there");
+	ASSERT_EQ(lump1->Length(), 19);
+	ASSERT_FALSE(memcmp(lump1->getData(), "Hello there, world!", 19));
+
+	std::vector<uint8_t> data;
+	readFromPath(path, data);
+	ASSERT_EQ(data, original);
+
+	// saving over the file keeps every lump intact
+	read->writeToDisk();
+
+	ASSERT_FALSE(memcmp(read->GetLump(0)->getData(), "Hello there, world!", 19));
+	ASSERT_FALSE(memcmp(read->GetLump(2)->getData(), "Goodbye!", 8));
+
+	auto again = Wad_file::Open(path, WadOpenMode::read);
+	ASSERT_TRUE(again);
+	ASSERT_EQ(again->NumLumps(), 3);
+	ASSERT_EQ(again->GetLump(0)->Length(), 19);
+	ASSERT_FALSE(memcmp(again->GetLump(0)->getData(), "Hello there, world!", 19));
+	ASSERT_EQ(again->GetLump(1)->Length(), 0);
+	ASSERT_FALSE(memcmp(again->GetLump(2)->getData(), "Goodbye!", 8));
+
+	// the lumps of the first wad still hold the old contents
+	ASSERT_FALSE(memcmp(wad->GetLump(0)->getData(), "Hello, world!", 13));
+}
+
+//
+// A wad opened for writing keeps its own copy of the lumps, so nothing
+// which happens to the file can take them away
+//
+TEST_F(WadFileTest, WritableWadKeepsItsLumps)
+{
+	SString path = getChildPath("wad.wad");
+	auto wad = Wad_file::Open(path, WadOpenMode::write);
+	ASSERT_TRUE(wad);
+
+	wad->AddLump("LUMP1")->Printf("Hello, world!");
+	wad->AddLump("LUMP2")->Printf("Goodbye!");
+	wad->writeToDisk();
+	mDeleteList.push(path);
+
+	auto edit = Wad_file::Open(path, WadOpenMode::append);
+	ASSERT_TRUE(edit);
+
+	FILE *fp = fopen(path.c_str(), "wb");
+	ASSERT_NE(fp, nullptr);
+	ASSERT_EQ(fclose(fp), 0);
+
+	ASSERT_EQ(edit->GetLump(0)->Length(), 13);
+	ASSERT_FALSE(memcmp(edit->GetLump(0)->getData(), "Hello, world!", 13));
+	ASSERT_FALSE(memcmp(edit->GetLump(1)->getData(), "Goodbye!", 8));
+
+	// saving writes it all again
+	edit->writeToDisk();
+
+	auto read = Wad_file::Open(path, WadOpenMode::read);
+	ASSERT_TRUE(read);
+	ASSERT_EQ(read->NumLumps(), 2);
+	ASSERT_FALSE(memcmp(read->GetLump(0)->getData(), "Hello, world!", 13));
+	ASSERT_FALSE(memcmp(read->GetLump(1)->getData(), "Goodbye!", 8));
+}